@@ -1,4 +1,10 @@
 @echo off
 
-glslc vertex_shader.vert -o vertex_shader.spv
-glslc fragment_shader.frag -o fragment_shader.spv
\ No newline at end of file
+glslc vertex_shader.vert -o vertex_shader.spv || exit /b 1
+spirv-val --target-env vulkan1.0 vertex_shader.spv || exit /b 1
+
+glslc fragment_shader.frag -o fragment_shader.spv || exit /b 1
+spirv-val --target-env vulkan1.0 fragment_shader.spv || exit /b 1
+
+glslc fragment_shader_bindless.frag -o fragment_shader_bindless.spv || exit /b 1
+spirv-val --target-env vulkan1.0 fragment_shader_bindless.spv || exit /b 1
@@ -1,5 +1,8 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : require
+
+#include "material_features.glsl"
 
 layout(binding = 1) uniform sampler2D texSampler;
 
@@ -9,5 +12,16 @@ layout(location = 1) in vec2 fragTexCoord;
 layout(location = 0) out vec4 outColor;
 
 void main() {
-    outColor = vec4(fragColor, 1.0) * texture(texSampler, fragTexCoord);
+    vec4 color = vec4(1.0);
+    if (featureVertexColor) {
+        color.rgb *= fragColor;
+    }
+    if (featureBaseColorTexture) {
+        color *= texture(texSampler, fragTexCoord);
+    }
+    if (featureAlphaTest && color.a < defaultAlphaCutoff) {
+        discard;
+    }
+
+    outColor = color;
 }
\ No newline at end of file
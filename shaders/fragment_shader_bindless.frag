@@ -0,0 +1,46 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : require
+#extension GL_GOOGLE_include_directive : require
+
+#include "material_features.glsl"
+
+struct Material {
+    uint baseColorTexture;
+    vec4 baseColorFactor;
+    vec4 emissiveFactor;
+    float alphaCutoff;
+};
+
+// Bindless texture table, see vulkan_texture_table
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+
+layout(std430, set = 1, binding = 1) readonly buffer MaterialBuffer {
+    Material materials[];
+};
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) flat in uint fragMaterialIndex;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    Material material = materials[fragMaterialIndex];
+
+    vec4 color = material.baseColorFactor;
+    if (featureVertexColor) {
+        color.rgb *= fragColor;
+    }
+    if (featureBaseColorTexture) {
+        color *= texture(textures[nonuniformEXT(material.baseColorTexture)], fragTexCoord);
+    }
+    if (featureAlphaTest && color.a < material.alphaCutoff) {
+        discard;
+    }
+    if (featureEmissive) {
+        color.rgb += material.emissiveFactor.rgb;
+    }
+
+    outColor = color;
+}
\ No newline at end of file
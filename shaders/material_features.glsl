@@ -0,0 +1,8 @@
+// Material features, see material_feature. Specialization constants, every pipeline is compiled with the code of its disabled features removed.
+layout(constant_id = 0) const bool featureVertexColor = true;
+layout(constant_id = 1) const bool featureBaseColorTexture = true;
+layout(constant_id = 2) const bool featureAlphaTest = false;
+layout(constant_id = 3) const bool featureEmissive = false;
+
+// Alpha test threshold of materials without a material buffer entry.
+const float defaultAlphaCutoff = 0.5;
@@ -3,22 +3,41 @@
 
 // Uniforms
 layout(binding = 0) uniform UniformBufferObject {
-    mat4 model;
     mat4 view;
     mat4 proj;
 } ubo;
 
+// Per Draw Constants, see draw_push_constants
+layout(push_constant) uniform DrawConstants {
+    uint objectIndex;
+    uint materialIndex;
+    uint flags;
+    uint padding;
+    vec4 modelRows[3];
+} draw;
+
 // Input
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec2 inTexCoord;
 
+// Per Instance Input
+layout(location = 3) in mat4 inModel;
+
 // Output
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) flat out uint fragMaterialIndex;
 
 void main() {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
+    // Single instance draws push their model matrix instead of going through the instance buffer.
+    mat4 model = inModel;
+    if ((draw.flags & 1u) != 0u) {
+        model = transpose(mat4(draw.modelRows[0], draw.modelRows[1], draw.modelRows[2], vec4(0.0, 0.0, 0.0, 1.0)));
+    }
+
+    gl_Position = ubo.proj * ubo.view * model * vec4(inPosition, 1.0);
     fragColor = inColor;
     fragTexCoord = inTexCoord;
+    fragMaterialIndex = draw.materialIndex;
 }
\ No newline at end of file
@@ -0,0 +1,314 @@
+#include "Benchmarks.hpp"
+
+#include "MeshData.hpp"
+#include "TextureData.hpp"
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// NOTE(dhaval): Set by CMake, same as for the sandbox. The on-disk inputs are skipped when they are not there.
+#if !defined(PBR_ASSET_ROOT)
+#define PBR_ASSET_ROOT "D:/PBR"
+#endif
+
+static const char* benchmark_model_path = PBR_ASSET_ROOT "/models/chalet.obj";
+static const char* benchmark_texture_path = PBR_ASSET_ROOT "/textures/chalet.jpg";
+
+// NOTE(dhaval): Quads per side of the synthetic grid meshes and pixels per side of the synthetic images.
+static const uint32_t benchmark_grid_sizes[] = {32, 128, 512};
+static const uint32_t benchmark_image_sizes[] = {256, 1024, 4096};
+
+// NOTE(dhaval): The largest inputs take seconds to load, fewer runs than the other benchmarks.
+static const uint32_t asset_iteration_count = 3;
+
+/**
+ * \brief Reads a whole file, so the stages below are timed without disk I/O.
+ * \param path File to read.
+ * \param contents Receives the bytes of the file.
+ * \return bool False if the file can't be opened.
+ */
+static bool read_file(const std::string& path, std::vector<uint8_t>& contents)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+/**
+ * \brief Writes an OBJ of a flat grid with texture coordinates, (grid_size + 1)^2 vertices and 2 * grid_size^2 triangles once vertices are joined.
+ * \param grid_size Quads per side.
+ * \return std::vector<uint8_t>
+ */
+static std::vector<uint8_t> create_grid_obj(uint32_t grid_size)
+{
+    std::ostringstream obj;
+
+    for (uint32_t y = 0; y <= grid_size; y++)
+    {
+        for (uint32_t x = 0; x <= grid_size; x++)
+        {
+            obj << "v " << x << " " << y << " 0\n";
+        }
+    }
+
+    for (uint32_t y = 0; y <= grid_size; y++)
+    {
+        for (uint32_t x = 0; x <= grid_size; x++)
+        {
+            obj << "vt " << static_cast<float>(x) / grid_size << " " << static_cast<float>(y) / grid_size << "\n";
+        }
+    }
+
+    // NOTE(dhaval): OBJ indices start at 1.
+    for (uint32_t y = 0; y < grid_size; y++)
+    {
+        for (uint32_t x = 0; x < grid_size; x++)
+        {
+            uint32_t a = y * (grid_size + 1) + x + 1;
+            uint32_t b = a + 1;
+            uint32_t c = a + grid_size + 1;
+            uint32_t d = c + 1;
+
+            obj << "f " << a << "/" << a << " " << b << "/" << b << " " << d << "/" << d << "\n";
+            obj << "f " << a << "/" << a << " " << d << "/" << d << " " << c << "/" << c << "\n";
+        }
+    }
+
+    std::string text = obj.str();
+    return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+/**
+ * \brief Writes an uncompressed 32 bit TGA of a color gradient.
+ * \param size Pixels per side.
+ * \return std::vector<uint8_t>
+ */
+static std::vector<uint8_t> create_gradient_tga(uint32_t size)
+{
+    std::vector<uint8_t> tga(18 + static_cast<size_t>(size) * size * 4);
+
+    tga[2] = 2;
+    tga[12] = static_cast<uint8_t>(size & 0xff);
+    tga[13] = static_cast<uint8_t>(size >> 8);
+    tga[14] = static_cast<uint8_t>(size & 0xff);
+    tga[15] = static_cast<uint8_t>(size >> 8);
+    tga[16] = 32;
+    tga[17] = 8;
+
+    uint8_t* pixel = tga.data() + 18;
+    for (uint32_t y = 0; y < size; y++)
+    {
+        for (uint32_t x = 0; x < size; x++)
+        {
+            *pixel++ = static_cast<uint8_t>(x * 255 / size);
+            *pixel++ = static_cast<uint8_t>(y * 255 / size);
+            *pixel++ = static_cast<uint8_t>((x + y) * 127 / size);
+            *pixel++ = 255;
+        }
+    }
+
+    return tga;
+}
+
+/**
+ * \brief Times parsing, conversion and the staging copy of a model held in memory.
+ * \param name Name of the input in the report.
+ * \param file Model file contents.
+ * \param format_hint Extension of the file format.
+ * \param mesh Receives the converted mesh.
+ * \return bool False if the model can't be parsed.
+ */
+static bool run_mesh_stages(const std::string& name, const std::vector<uint8_t>& file, const char* format_hint, mesh_data& mesh)
+{
+    bool parsed = true;
+    double parse_ms = measure_best_ms(asset_iteration_count, [&]() {
+        Assimp::Importer importer;
+        parsed = importer.ReadFileFromMemory(file.data(), file.size(), mesh_data::get_import_flags(), format_hint) != nullptr && parsed;
+    });
+
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFileFromMemory(file.data(), file.size(), mesh_data::get_import_flags(), format_hint);
+    if (!parsed || scene == nullptr || !mesh.convert(scene))
+    {
+        std::cerr << "asset_pipeline: can't parse " << name << ": " << importer.GetErrorString() << std::endl;
+        return false;
+    }
+
+    double convert_ms = measure_best_ms(asset_iteration_count, [&]() { mesh.convert(scene); });
+
+    size_t vertex_size = mesh.vertices.size() * sizeof(mesh_vertex);
+    size_t index_size = mesh.indices.size() * sizeof(uint32_t);
+
+    // NOTE(dhaval): Stands in for the mapped staging buffer, touched once so page faults are not timed.
+    std::vector<uint8_t> staging(vertex_size + index_size, 0);
+    double staging_ms = measure_best_ms(asset_iteration_count, [&]() {
+        memcpy(staging.data(), mesh.vertices.data(), vertex_size);
+        memcpy(staging.data() + vertex_size, mesh.indices.data(), index_size);
+    });
+
+    double file_mb = file.size() / (1024.0 * 1024.0);
+    double staging_mb = staging.size() / (1024.0 * 1024.0);
+
+    std::cout << "  mesh " << name << ": " << mesh.vertices.size() << " vertices, " << mesh.indices.size() / 3 << " triangles, " << file_mb << " MB file" << std::endl;
+    std::cout << "    parse " << parse_ms << " ms (" << file_mb * 1000.0 / parse_ms << " MB/s), convert " << convert_ms << " ms (" << mesh.vertices.size() / (convert_ms * 1000.0)
+              << " M vertices/s), staging copy " << staging_ms << " ms (" << staging_mb / staging_ms << " GB/s)" << std::endl;
+
+    return true;
+}
+
+/**
+ * \brief Times decoding, mip generation and the staging copy of an image held in memory.
+ * \param name Name of the input in the report.
+ * \param file Image file contents.
+ * \param texture Receives the decoded texture with its mip chain.
+ * \return bool False if the image can't be decoded.
+ */
+static bool run_texture_stages(const std::string& name, const std::vector<uint8_t>& file, texture_data& texture)
+{
+    bool decoded = true;
+    double decode_ms = measure_best_ms(asset_iteration_count, [&]() { decoded = texture.load_from_memory(file.data(), file.size()) && decoded; });
+
+    if (!decoded)
+    {
+        std::cerr << "asset_pipeline: can't decode " << name << std::endl;
+        return false;
+    }
+
+    // NOTE(dhaval): Decoding again resets the chain to the base level, so every run generates all of it.
+    double mips_ms = measure_best_ms(asset_iteration_count, [&]() { texture.generate_mips(); }, [&]() { texture.load_from_memory(file.data(), file.size()); });
+
+    std::vector<uint8_t> staging(texture.get_size(), 0);
+    double staging_ms = measure_best_ms(asset_iteration_count, [&]() { memcpy(staging.data(), texture.get_pixels(), staging.size()); });
+
+    double base_megapixels = static_cast<double>(texture.get_width()) * texture.get_height() / 1000000.0;
+    double staging_mb = staging.size() / (1024.0 * 1024.0);
+
+    std::cout << "  texture " << name << ": " << texture.get_width() << "x" << texture.get_height() << ", " << texture.get_mip_count() << " mips, "
+              << file.size() / 1024 << " KB file" << std::endl;
+    std::cout << "    decode " << decode_ms << " ms (" << base_megapixels * 1000.0 / decode_ms << " M pixels/s), mips " << mips_ms << " ms (" << base_megapixels * 1000.0 / mips_ms
+              << " M pixels/s), staging copy " << staging_ms << " ms (" << staging_mb / staging_ms << " GB/s)" << std::endl;
+
+    return true;
+}
+
+/**
+ * \brief Checks that the smallest mip of a chain holds the average color of the base level, up to the rounding of every level.
+ * \param texture Texture with a full mip chain.
+ * \return bool
+ */
+static bool check_mip_chain(const texture_data& texture)
+{
+    if (texture.get_mip_count() != texture_data::get_full_mip_count(texture.get_width(), texture.get_height()))
+    {
+        return false;
+    }
+
+    const texture_mip& base = texture.get_mip(0);
+    const texture_mip& last = texture.get_mip(texture.get_mip_count() - 1);
+    if (last.width != 1 || last.height != 1)
+    {
+        return false;
+    }
+
+    double pixel_count = static_cast<double>(base.width) * base.height;
+    double tolerance = texture.get_mip_count() * 0.5 + 1.0;
+
+    for (uint32_t c = 0; c < 4; c++)
+    {
+        double sum = 0.0;
+        for (size_t i = c; i < base.size; i += 4)
+        {
+            sum += texture.get_pixels()[base.offset + i];
+        }
+
+        if (std::abs(sum / pixel_count - texture.get_pixels()[last.offset + c]) > tolerance)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool run_asset_pipeline_benchmark()
+{
+    bool succeeded = true;
+
+    for (uint32_t grid_size : benchmark_grid_sizes)
+    {
+        mesh_data mesh;
+        std::string name = "grid " + std::to_string(grid_size) + "x" + std::to_string(grid_size);
+
+        if (!run_mesh_stages(name, create_grid_obj(grid_size), "obj", mesh))
+        {
+            succeeded = false;
+            continue;
+        }
+
+        // NOTE(dhaval): Shared corners must be joined, otherwise the conversion is timed on three times the vertices the model has.
+        size_t expected_vertex_count = static_cast<size_t>(grid_size + 1) * (grid_size + 1);
+        size_t expected_index_count = static_cast<size_t>(grid_size) * grid_size * 6;
+        if (mesh.vertices.size() != expected_vertex_count || mesh.indices.size() != expected_index_count)
+        {
+            std::cerr << "asset_pipeline: " << name << " has " << mesh.vertices.size() << " vertices and " << mesh.indices.size() << " indices, expected " << expected_vertex_count
+                      << " and " << expected_index_count << std::endl;
+            succeeded = false;
+        }
+    }
+
+    for (uint32_t image_size : benchmark_image_sizes)
+    {
+        texture_data texture;
+        std::string name = "gradient " + std::to_string(image_size) + "x" + std::to_string(image_size) + " tga";
+
+        if (!run_texture_stages(name, create_gradient_tga(image_size), texture))
+        {
+            succeeded = false;
+            continue;
+        }
+
+        if (!check_mip_chain(texture))
+        {
+            std::cerr << "asset_pipeline: mip chain of " << name << " does not average the base level" << std::endl;
+            succeeded = false;
+        }
+    }
+
+    std::vector<uint8_t> file;
+
+    if (read_file(benchmark_model_path, file))
+    {
+        mesh_data mesh;
+        succeeded = run_mesh_stages(benchmark_model_path, file, "obj", mesh) && succeeded;
+    }
+    else
+    {
+        std::cout << "  " << benchmark_model_path << " not found, skipped" << std::endl;
+    }
+
+    if (read_file(benchmark_texture_path, file))
+    {
+        texture_data texture;
+        succeeded = run_texture_stages(benchmark_texture_path, file, texture) && succeeded;
+    }
+    else
+    {
+        std::cout << "  " << benchmark_texture_path << " not found, skipped" << std::endl;
+    }
+
+    return succeeded;
+}
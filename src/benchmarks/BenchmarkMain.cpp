@@ -0,0 +1,92 @@
+/*****************************************************************/ /**
+ * \file   BenchmarkMain.cpp
+ * \brief  Entry point of the CPU benchmarks. Runs every benchmark, or only the ones named on the command line.
+ *********************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include "Benchmarks.hpp"
+#include "JobSystem.hpp"
+
+struct benchmark_entry
+{
+    const char* name;
+    bool (*run)();
+};
+
+static const benchmark_entry benchmarks[] = {
+    {"frustum_culling", run_frustum_culling_benchmark},
+    {"scene_graph", run_scene_graph_benchmark},
+    {"occlusion_culling", run_occlusion_culling_benchmark},
+    {"draw_sort", run_draw_sort_benchmark},
+    {"render_graph", run_render_graph_benchmark},
+    {"profiler", run_profiler_benchmark},
+    {"asset_pipeline", run_asset_pipeline_benchmark},
+    {"job_system", run_job_system_benchmark},
+    {"simulation", run_simulation_benchmark},
+};
+
+double measure_best_ms(uint32_t iteration_count, const std::function<void()>& function, const std::function<void()>& prepare)
+{
+    double best_ms = 0.0;
+
+    for (uint32_t i = 0; i < iteration_count; i++)
+    {
+        if (prepare)
+        {
+            prepare();
+        }
+
+        auto start_time = std::chrono::high_resolution_clock::now();
+        function();
+        auto end_time = std::chrono::high_resolution_clock::now();
+
+        double ms = std::chrono::duration<double, std::milli>(end_time - start_time).count();
+        best_ms = i == 0 ? ms : std::min(best_ms, ms);
+    }
+
+    return best_ms;
+}
+
+void init_benchmark_job_system(job_system& jobs)
+{
+    jobs.init(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+}
+
+int main(int argc, char** argv)
+{
+    bool succeeded = true;
+    bool found = argc <= 1;
+
+    for (const benchmark_entry& benchmark : benchmarks)
+    {
+        bool selected = argc <= 1;
+        for (int i = 1; i < argc; i++)
+        {
+            selected = selected || strcmp(argv[i], benchmark.name) == 0;
+        }
+
+        if (!selected)
+        {
+            continue;
+        }
+
+        found = true;
+
+        std::cout << "benchmark: " << benchmark.name << std::endl;
+        succeeded = benchmark.run() && succeeded;
+    }
+
+    if (!found)
+    {
+        std::cerr << "No benchmark matches the given names" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return succeeded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+class job_system;
+
+// NOTE(dhaval): Runs per measurement unless a benchmark needs fewer, the fastest one counts.
+static const uint32_t benchmark_iteration_count = 20;
+
+/**
+ * \brief Runs a function several times and returns the fastest run in milliseconds.
+ * \param iteration_count Number of runs.
+ * \param function Function to time.
+ * \param prepare Runs untimed before every run, e.g. to reset the state the function consumes. May be empty.
+ * \return double
+ */
+double measure_best_ms(uint32_t iteration_count, const std::function<void()>& function, const std::function<void()>& prepare = {});
+
+/**
+ * \brief Starts one worker per core besides the calling thread, which helps while it waits.
+ * \param jobs Job system to start.
+ */
+void init_benchmark_job_system(job_system& jobs);
+
+/**
+ * \brief Compares frustum culling throughput (objects per ms) of the scalar reference, the AVX2 path and the threaded AVX2 path.
+ * \return bool False if the paths disagree on the visible set.
+ */
+bool run_frustum_culling_benchmark();
+
+/**
+ * \brief Times world transform updates of a 100k node scene graph: everything dirty, a few subtrees dirty and nothing dirty, serial and threaded.
+ * \return bool False if the threaded update disagrees with the serial one.
+ */
+bool run_scene_graph_benchmark();
+
+/**
+ * \brief Rasterizes a wall of occluders and tests a dense crowd of boxes behind it, reports raster and test time and the share of rejected boxes.
+ * \return bool False if a box in front of the occluders was rejected.
+ */
+bool run_occlusion_culling_benchmark();
+
+/**
+ * \brief Sorts 100k random draw keys with the radix sorter and with std::stable_sort, reports sort time and binds needed before and after sorting.
+ * \return bool False if the radix sort order differs from std::stable_sort.
+ */
+bool run_draw_sort_benchmark();
+
+/**
+ * \brief Declares and compiles a deferred frame's render graph, reports compile time, culled passes, barriers and the memory saved by aliasing.
+ * \return bool False if the wrong passes were culled or two aliased attachments are alive at the same time.
+ */
+bool run_render_graph_benchmark();
+
+/**
+ * \brief Measures the cost of a profiler zone and counter with and without a capture, then captures a few frames from several threads.
+ * \return bool False if the capture lost or duplicated events.
+ */
+bool run_profiler_benchmark();
+
+/**
+ * \brief Times the CPU side of asset loading stage by stage: model parsing and conversion, image decoding, mip generation and the staging copies,
+ *        on synthetic inputs of several sizes and on the sandbox's own model and texture when they are found.
+ * \return bool False if an input fails to load, a grid mesh comes out with the wrong vertex count or a mip chain does not average its base level.
+ */
+bool run_asset_pipeline_benchmark();
+
+/**
+ * \brief Runs fine grained synthetic work on 1 up to hardware_concurrency threads, a parallel_for over 1M cheap items and 16k small jobs,
+ *        reports the speedup over one thread and the parallel efficiency, then runs a chain of dependent jobs.
+ * \return bool False if parallel_for skipped or repeated an item or a job ran before its dependency.
+ */
+bool run_job_system_benchmark();
+
+/**
+ * \brief Hands 1M payloads from one thread to another through the triple buffer, then runs the simulation thread at 1 kHz against a 400 Hz
+ *        reader, reports tick jitter, the reader's wait and the age of the snapshots it takes.
+ * \return bool False if a payload was torn or a snapshot went backwards.
+ */
+bool run_simulation_benchmark();
@@ -0,0 +1,63 @@
+#include "Benchmarks.hpp"
+
+#include "DrawSorter.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <vector>
+
+// NOTE(dhaval): 100k draws spread over a shadow and a main pass, with a mix of pipelines, materials and meshes typical for a large scene.
+static const uint32_t benchmark_draw_count = 100 * 1000;
+static const uint32_t benchmark_pass_count = 2;
+static const uint32_t benchmark_pipeline_count = 16;
+static const uint32_t benchmark_material_count = 256;
+static const uint32_t benchmark_mesh_count = 64;
+
+bool run_draw_sort_benchmark()
+{
+    std::mt19937 random(1234);
+    std::uniform_int_distribution<uint32_t> pass(0, benchmark_pass_count - 1);
+    std::uniform_int_distribution<uint32_t> pipeline(0, benchmark_pipeline_count - 1);
+    std::uniform_int_distribution<uint32_t> material(0, benchmark_material_count - 1);
+    std::uniform_int_distribution<uint32_t> mesh(0, benchmark_mesh_count - 1);
+    std::uniform_real_distribution<float> depth(0.0f, 1.0f);
+
+    std::vector<uint64_t> keys(benchmark_draw_count);
+    for (uint64_t& key : keys)
+    {
+        key = make_draw_key(pass(random), pipeline(random), material(random), mesh(random), depth(random));
+    }
+
+    draw_sorter sorter;
+    double radix_ms = measure_best_ms(benchmark_iteration_count, [&]() { sorter.sort(keys.data(), benchmark_draw_count); });
+
+    std::vector<uint32_t> reference_order(benchmark_draw_count);
+    double stable_sort_ms = measure_best_ms(benchmark_iteration_count, [&]() {
+        std::iota(reference_order.begin(), reference_order.end(), 0u);
+        std::stable_sort(reference_order.begin(), reference_order.end(), [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+    });
+
+    std::vector<uint32_t> submission_order(benchmark_draw_count);
+    std::iota(submission_order.begin(), submission_order.end(), 0u);
+
+    draw_state_changes unsorted_changes = draw_sorter::count_state_changes(keys.data(), submission_order.data(), benchmark_draw_count);
+    draw_state_changes sorted_changes = draw_sorter::count_state_changes(keys.data(), sorter.get_order().data(), benchmark_draw_count);
+
+    std::cout << "  " << benchmark_draw_count << " draws, " << benchmark_pass_count << " passes, " << benchmark_pipeline_count << " pipelines, " << benchmark_material_count
+              << " materials, " << benchmark_mesh_count << " meshes" << std::endl;
+    std::cout << "  sort: " << radix_ms << " ms radix, " << stable_sort_ms << " ms std::stable_sort" << std::endl;
+    std::cout << "  binds unsorted: " << unsorted_changes.pipeline_binds << " pipeline, " << unsorted_changes.material_binds << " descriptor set, " << unsorted_changes.mesh_binds
+              << " mesh, " << unsorted_changes.get_total() << " total" << std::endl;
+    std::cout << "  binds sorted: " << sorted_changes.pipeline_binds << " pipeline, " << sorted_changes.material_binds << " descriptor set, " << sorted_changes.mesh_binds
+              << " mesh, " << sorted_changes.get_total() << " total" << std::endl;
+
+    if (sorter.get_order() != reference_order)
+    {
+        std::cerr << "draw_sort: radix sort order differs from std::stable_sort" << std::endl;
+        return false;
+    }
+
+    return true;
+}
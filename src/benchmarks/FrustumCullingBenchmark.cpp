@@ -0,0 +1,90 @@
+#include "Benchmarks.hpp"
+
+#include "CpuFeatures.hpp"
+#include "FrustumCuller.hpp"
+#include "JobSystem.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <iostream>
+#include <random>
+
+// NOTE(dhaval): Large enough for the threaded path to kick in, objects are scattered around a camera at the origin.
+static const uint32_t benchmark_object_count = 1024 * 1024;
+static const float benchmark_scene_extent = 200.0f;
+
+/**
+ * \brief Prints one result line.
+ * \param name Name of the culling path.
+ * \param ms Time of one cull in milliseconds.
+ * \param visible_count Number of visible objects.
+ */
+static void report(const char* name, double ms, size_t visible_count)
+{
+    std::cout << "  " << name << ": " << ms << " ms, " << benchmark_object_count / ms << " objects/ms, " << visible_count << " visible" << std::endl;
+}
+
+bool run_frustum_culling_benchmark()
+{
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> position(-benchmark_scene_extent, benchmark_scene_extent);
+    std::uniform_real_distribution<float> scale(0.25f, 4.0f);
+    std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+
+    bounding_volume unit_bounds{};
+    unit_bounds.center = glm::vec3(0.0f);
+    unit_bounds.extent = glm::vec3(0.5f);
+    unit_bounds.radius = std::sqrt(0.75f);
+
+    frustum_culler culler;
+    culler.resize(benchmark_object_count);
+
+    for (uint32_t i = 0; i < benchmark_object_count; i++)
+    {
+        glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(position(random), position(random), position(random)));
+        transform = glm::rotate(transform, angle(random), glm::normalize(glm::vec3(1.0f, 2.0f, 3.0f)));
+        transform = glm::scale(transform, glm::vec3(scale(random)));
+
+        culler.set_bounds(i, unit_bounds, transform);
+    }
+
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(1.0f, 0.5f, 0.25f), glm::vec3(0.0f, 0.0f, 1.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, benchmark_scene_extent);
+    frustum view_frustum = frustum::from_view_projection(projection * view);
+
+    job_system jobs;
+    init_benchmark_job_system(jobs);
+
+    std::vector<uint32_t> scalar_visible;
+    std::vector<uint32_t> simd_visible;
+    std::vector<uint32_t> threaded_visible;
+
+    double scalar_ms = measure_best_ms(benchmark_iteration_count, [&]() { culler.cull_scalar(view_frustum, scalar_visible); });
+    double simd_ms = measure_best_ms(benchmark_iteration_count, [&]() { culler.cull(view_frustum, simd_visible); });
+    double threaded_ms = measure_best_ms(benchmark_iteration_count, [&]() { culler.cull(view_frustum, threaded_visible, &jobs); });
+
+#if defined(PBR_ENABLE_AVX2)
+    const char* simd_name = cpu_supports_avx2() ? "avx2" : "scalar fallback";
+#else
+    const char* simd_name = "scalar fallback";
+#endif
+
+    std::cout << "  " << benchmark_object_count << " objects, " << jobs.get_worker_count() << " worker thread(s)" << std::endl;
+    report("scalar reference", scalar_ms, scalar_visible.size());
+    report(simd_name, simd_ms, simd_visible.size());
+    report("threaded", threaded_ms, threaded_visible.size());
+
+    jobs.shutdown();
+
+    bool matches = simd_visible == scalar_visible && threaded_visible == scalar_visible;
+    if (!matches)
+    {
+        std::cerr << "frustum_culling: visible sets differ from the scalar reference" << std::endl;
+    }
+
+    return matches;
+}
@@ -0,0 +1,157 @@
+#include "Benchmarks.hpp"
+
+#include "JobSystem.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// NOTE(dhaval): About 50 ns an item and 1 us a job, fine enough that scheduling overhead shows up in the speedup.
+static const uint32_t benchmark_item_count = 1u << 20;
+static const uint32_t benchmark_item_rounds = 32;
+static const uint32_t benchmark_job_count = 16384;
+static const uint32_t benchmark_job_rounds = 512;
+static const uint32_t benchmark_dependency_depth = 64;
+
+// NOTE(dhaval): Everything is measured once per thread count, fewer runs than the other benchmarks.
+static const uint32_t job_system_iteration_count = 5;
+
+static uint32_t hash_item(uint32_t value, uint32_t rounds)
+{
+    for (uint32_t i = 0; i < rounds; i++)
+    {
+        value = value * 1664525u + 1013904223u;
+        value ^= value >> 16;
+    }
+
+    return value;
+}
+
+/**
+ * \brief Builds a chain of jobs where every link starts a batch of jobs that the next link runs after. Checks that no link starts early.
+ * \param jobs System to run on.
+ * \return bool
+ */
+static bool run_dependency_chain(job_system& jobs)
+{
+    std::vector<job_counter> links(benchmark_dependency_depth);
+    std::atomic<uint32_t> finished_links{0};
+    std::atomic<bool> in_order{true};
+
+    for (uint32_t link = 0; link < benchmark_dependency_depth; link++)
+    {
+        std::function<void()> link_job = [&, link]() {
+            in_order = in_order && finished_links.load() == link;
+            finished_links++;
+        };
+
+        if (link == 0)
+        {
+            jobs.run(link_job, &links[link]);
+        }
+        else
+        {
+            jobs.run_after(links[link - 1], link_job, &links[link]);
+        }
+    }
+
+    for (job_counter& link : links)
+    {
+        jobs.wait(link);
+    }
+
+    return in_order && finished_links == benchmark_dependency_depth;
+}
+
+bool run_job_system_benchmark()
+{
+    uint32_t core_count = std::max(std::thread::hardware_concurrency(), 1u);
+
+    std::vector<uint32_t> thread_counts;
+    for (uint32_t thread_count = 1; thread_count < core_count; thread_count *= 2)
+    {
+        thread_counts.push_back(thread_count);
+    }
+
+    thread_counts.push_back(core_count);
+
+    std::vector<uint32_t> reference(benchmark_item_count);
+    for (uint32_t i = 0; i < benchmark_item_count; i++)
+    {
+        reference[i] = hash_item(i, benchmark_item_rounds);
+    }
+
+    std::vector<uint32_t> items(benchmark_item_count);
+    std::vector<uint32_t> job_results(benchmark_job_count);
+
+    bool succeeded = true;
+    double single_thread_for_ms = 0.0;
+    double single_thread_jobs_ms = 0.0;
+
+    std::cout << "  " << benchmark_item_count << " parallel_for items, " << benchmark_job_count << " jobs, " << core_count << " core(s)" << std::endl;
+
+    for (uint32_t thread_count : thread_counts)
+    {
+        job_system jobs;
+        jobs.init(thread_count - 1);
+
+        std::atomic<uint64_t> visited_items{0};
+
+        double for_ms = measure_best_ms(job_system_iteration_count, [&]() {
+            jobs.parallel_for(benchmark_item_count, 256, [&](uint32_t first, uint32_t last) {
+                for (uint32_t i = first; i < last; i++)
+                {
+                    items[i] = hash_item(i, benchmark_item_rounds);
+                }
+
+                visited_items.fetch_add(last - first, std::memory_order_relaxed);
+            });
+        });
+
+        double jobs_ms = measure_best_ms(job_system_iteration_count, [&]() {
+            job_counter counter;
+
+            for (uint32_t i = 0; i < benchmark_job_count; i++)
+            {
+                jobs.run([&job_results, i]() { job_results[i] = hash_item(i, benchmark_job_rounds); }, &counter);
+            }
+
+            jobs.wait(counter);
+        });
+
+        job_system_statistics statistics = jobs.get_statistics();
+
+        bool in_order = run_dependency_chain(jobs);
+
+        jobs.shutdown();
+
+        if (thread_count == 1)
+        {
+            single_thread_for_ms = for_ms;
+            single_thread_jobs_ms = jobs_ms;
+        }
+
+        double for_speedup = single_thread_for_ms / for_ms;
+        double jobs_speedup = single_thread_jobs_ms / jobs_ms;
+
+        std::cout << "  " << thread_count << " thread(s): parallel_for " << for_ms << " ms (" << for_speedup << "x, " << 100.0 * for_speedup / thread_count << "% efficiency), jobs "
+            << jobs_ms << " ms (" << jobs_speedup << "x, " << 100.0 * jobs_speedup / thread_count << "% efficiency), " << statistics.steal_count << " steal(s)" << std::endl;
+
+        if (visited_items != static_cast<uint64_t>(benchmark_item_count) * job_system_iteration_count || items != reference)
+        {
+            std::cerr << "job_system: parallel_for skipped or repeated items on " << thread_count << " thread(s)" << std::endl;
+            succeeded = false;
+        }
+
+        if (!in_order)
+        {
+            std::cerr << "job_system: a dependent job ran before its dependency on " << thread_count << " thread(s)" << std::endl;
+            succeeded = false;
+        }
+    }
+
+    return succeeded;
+}
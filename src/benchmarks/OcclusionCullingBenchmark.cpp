@@ -0,0 +1,269 @@
+#include "Benchmarks.hpp"
+
+#include "FrustumCuller.hpp"
+#include "OcclusionCuller.hpp"
+#include "JobSystem.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <iostream>
+#include <random>
+
+// NOTE(dhaval): A wall of panels with narrow gaps between the camera and a crowd of small boxes, plus a few boxes in front of the wall.
+static const uint32_t benchmark_hidden_object_count = 100 * 1000;
+static const uint32_t benchmark_front_object_count = 1000;
+static const uint32_t benchmark_depth_width = 256;
+static const uint32_t benchmark_depth_height = 128;
+static const float benchmark_wall_distance = 20.0f;
+
+// NOTE(dhaval): A finely tessellated panel with a square hole in the middle, and a box far behind that is only visible through the hole.
+static const uint32_t hole_panel_cell_count = 16;
+static const uint32_t hole_panel_hole_cell_count = 2;
+static const float hole_panel_size = 30.0f;
+static const float hole_box_distance = 60.0f;
+
+/**
+ * \brief Unit cube centered on the origin, 12 triangles.
+ * \return occluder_mesh
+ */
+static occluder_mesh make_box_occluder()
+{
+    occluder_mesh box;
+
+    for (int corner = 0; corner < 8; corner++)
+    {
+        box.positions.push_back(glm::vec3((corner & 1) ? 0.5f : -0.5f, (corner & 2) ? 0.5f : -0.5f, (corner & 4) ? 0.5f : -0.5f));
+    }
+
+    box.indices = {0, 1, 3, 0, 3, 2, 4, 6, 7, 4, 7, 5, 0, 4, 5, 0, 5, 1, 2, 3, 7, 2, 7, 6, 0, 2, 6, 0, 6, 4, 1, 5, 7, 1, 7, 3};
+
+    return box;
+}
+
+/**
+ * \brief Square panel in the x = 0 plane from -0.5 to 0.5, split into cells of two triangles each, without the cells in the middle.
+ * \return occluder_mesh
+ */
+static occluder_mesh make_panel_with_hole()
+{
+    occluder_mesh panel;
+
+    uint32_t row_size = hole_panel_cell_count + 1;
+    for (uint32_t row = 0; row < row_size; row++)
+    {
+        for (uint32_t column = 0; column < row_size; column++)
+        {
+            panel.positions.push_back(glm::vec3(0.0f, static_cast<float>(column) / hole_panel_cell_count - 0.5f, static_cast<float>(row) / hole_panel_cell_count - 0.5f));
+        }
+    }
+
+    uint32_t hole_first = (hole_panel_cell_count - hole_panel_hole_cell_count) / 2;
+    uint32_t hole_last = hole_first + hole_panel_hole_cell_count;
+
+    for (uint32_t row = 0; row < hole_panel_cell_count; row++)
+    {
+        for (uint32_t column = 0; column < hole_panel_cell_count; column++)
+        {
+            if (row >= hole_first && row < hole_last && column >= hole_first && column < hole_last)
+            {
+                continue;
+            }
+
+            uint32_t corner = row * row_size + column;
+            panel.indices.insert(panel.indices.end(), {corner, corner + 1, corner + row_size + 1, corner, corner + row_size + 1, corner + row_size});
+        }
+    }
+
+    return panel;
+}
+
+/**
+ * \brief Checks that simplified occluders stay conservative. Every triangle of occluder_mesh::simplify() must be one of the source mesh's,
+ *        and a box seen through a hole in the occluder must stay visible while one behind the solid part gets rejected.
+ * \param view_projection Camera of the benchmark, looking down the x axis.
+ * \return bool
+ */
+static bool run_occluder_hole_check(const glm::mat4& view_projection)
+{
+    occluder_mesh panel = make_panel_with_hole();
+    uint32_t panel_triangle_count = static_cast<uint32_t>(panel.indices.size() / 3);
+
+    glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(benchmark_wall_distance, 0.0f, 0.0f));
+    transform = glm::scale(transform, glm::vec3(1.0f, hole_panel_size, hole_panel_size));
+
+    bounding_volume hole_box{};
+    hole_box.center = glm::vec3(hole_box_distance, 0.0f, 0.0f);
+    hole_box.extent = glm::vec3(0.5f);
+    hole_box.radius = std::sqrt(0.75f);
+
+    bounding_volume hidden_box = hole_box;
+    hidden_box.center.y = hole_panel_size * hole_box_distance / benchmark_wall_distance / 4.0f;
+
+    occlusion_culler culler;
+    culler.init(benchmark_depth_width, benchmark_depth_height);
+
+    bool succeeded = true;
+
+    // NOTE(dhaval): The whole panel, then half of it. Dropping triangles may only let more through.
+    for (uint32_t max_triangle_count : {panel_triangle_count, panel_triangle_count / 2})
+    {
+        occluder_mesh occluder = occluder_mesh::simplify(panel.positions.data(), panel.positions.size(), sizeof(glm::vec3), panel.indices.data(), panel.indices.size(), max_triangle_count);
+
+        uint32_t foreign_triangle_count = 0;
+        for (size_t i = 0; i + 2 < occluder.indices.size(); i += 3)
+        {
+            bool found = false;
+            for (size_t j = 0; j + 2 < panel.indices.size() && !found; j += 3)
+            {
+                found = occluder.positions[occluder.indices[i]] == panel.positions[panel.indices[j]] && occluder.positions[occluder.indices[i + 1]] == panel.positions[panel.indices[j + 1]]
+                        && occluder.positions[occluder.indices[i + 2]] == panel.positions[panel.indices[j + 2]];
+            }
+
+            foreign_triangle_count += found ? 0 : 1;
+        }
+
+        culler.begin(view_projection);
+        culler.add_occluder(occluder, transform);
+        culler.rasterize();
+
+        std::cout << "  hole: " << occluder.indices.size() / 3 << " of " << panel_triangle_count << " panel triangles, box behind the hole "
+                  << (culler.is_visible(hole_box) ? "visible" : "rejected") << ", box behind the panel " << (culler.is_visible(hidden_box) ? "visible" : "rejected") << std::endl;
+
+        if (foreign_triangle_count > 0)
+        {
+            std::cerr << "occlusion_culling: " << foreign_triangle_count << " simplified occluder triangles are not in the source mesh" << std::endl;
+            succeeded = false;
+        }
+
+        if (!culler.is_visible(hole_box))
+        {
+            std::cerr << "occlusion_culling: the box visible through the hole in the occluder was rejected" << std::endl;
+            succeeded = false;
+        }
+
+        if (max_triangle_count == panel_triangle_count && culler.is_visible(hidden_box))
+        {
+            std::cerr << "occlusion_culling: the box behind the solid panel was not rejected" << std::endl;
+            succeeded = false;
+        }
+    }
+
+    culler.shutdown();
+
+    return succeeded;
+}
+
+bool run_occlusion_culling_benchmark()
+{
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 2.0f, 0.1f, 500.0f);
+    glm::mat4 view_projection = projection * view;
+
+    // NOTE(dhaval): 5 x 3 panels of 9 x 9 units, one unit gaps.
+    occluder_mesh box = make_box_occluder();
+    std::vector<glm::mat4> wall_transforms;
+    for (int row = -1; row <= 1; row++)
+    {
+        for (int column = -2; column <= 2; column++)
+        {
+            glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(benchmark_wall_distance, column * 10.0f, row * 10.0f));
+            wall_transforms.push_back(glm::scale(transform, glm::vec3(1.0f, 9.0f, 9.0f)));
+        }
+    }
+
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> hidden_distance(benchmark_wall_distance + 5.0f, 150.0f);
+    std::uniform_real_distribution<float> front_distance(3.0f, benchmark_wall_distance - 5.0f);
+
+    uint32_t object_count = benchmark_hidden_object_count + benchmark_front_object_count;
+
+    frustum_culler bounds;
+    bounds.resize(object_count);
+
+    for (uint32_t i = 0; i < object_count; i++)
+    {
+        float distance = i < benchmark_front_object_count ? front_distance(random) : hidden_distance(random);
+
+        bounding_volume object{};
+        object.center = glm::vec3(distance, unit(random) * distance * 1.1f, unit(random) * distance * 0.55f);
+        object.extent = glm::vec3(0.5f);
+        object.radius = std::sqrt(0.75f);
+
+        bounds.set_bounds(i, object);
+    }
+
+    std::vector<uint32_t> frustum_visible;
+    bounds.cull(frustum::from_view_projection(view_projection), frustum_visible);
+
+    job_system jobs;
+    init_benchmark_job_system(jobs);
+
+    occlusion_culler culler;
+    culler.init(benchmark_depth_width, benchmark_depth_height);
+
+    auto add_occluders = [&]() {
+        culler.begin(view_projection);
+        for (const glm::mat4& transform : wall_transforms)
+        {
+            culler.add_occluder(box, transform);
+        }
+    };
+
+    double serial_raster_ms = measure_best_ms(benchmark_iteration_count, [&]() {
+        add_occluders();
+        culler.rasterize();
+    });
+
+    double threaded_raster_ms = measure_best_ms(benchmark_iteration_count, [&]() {
+        add_occluders();
+        culler.rasterize(&jobs);
+    });
+
+    std::vector<uint32_t> visible;
+
+    double serial_test_ms = measure_best_ms(benchmark_iteration_count, [&]() {
+        visible = frustum_visible;
+        culler.cull(bounds, visible);
+    });
+
+    double threaded_test_ms = measure_best_ms(benchmark_iteration_count, [&]() {
+        visible = frustum_visible;
+        culler.cull(bounds, visible, &jobs);
+    });
+
+    double rejected_percent = frustum_visible.empty() ? 0.0 : 100.0 * (frustum_visible.size() - visible.size()) / frustum_visible.size();
+
+    std::cout << "  " << frustum_visible.size() << " objects in the frustum, " << culler.get_triangle_count() << " occluder triangles, " << culler.get_width() << "x"
+              << culler.get_height() << " depth, " << jobs.get_worker_count() << " worker thread(s)" << std::endl;
+    std::cout << "  raster: " << serial_raster_ms << " ms serial, " << threaded_raster_ms << " ms threaded" << std::endl;
+    std::cout << "  test: " << serial_test_ms << " ms serial, " << threaded_test_ms << " ms threaded" << std::endl;
+    std::cout << "  rejected: " << rejected_percent << " %" << std::endl;
+
+    jobs.shutdown();
+    culler.shutdown();
+
+    // NOTE(dhaval): Nothing in front of the wall may be rejected.
+    uint32_t front_visible_count = 0;
+    uint32_t front_in_frustum_count = 0;
+    for (uint32_t object : frustum_visible)
+    {
+        front_in_frustum_count += object < benchmark_front_object_count;
+    }
+    for (uint32_t object : visible)
+    {
+        front_visible_count += object < benchmark_front_object_count;
+    }
+
+    if (front_visible_count != front_in_frustum_count)
+    {
+        std::cerr << "occlusion_culling: " << front_in_frustum_count - front_visible_count << " objects in front of the occluders were rejected" << std::endl;
+        return false;
+    }
+
+    return run_occluder_hole_check(view_projection);
+}
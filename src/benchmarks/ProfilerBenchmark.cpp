@@ -0,0 +1,120 @@
+#include "Benchmarks.hpp"
+
+#include "Profiler.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+static const uint32_t benchmark_zone_count = 1000000;
+
+// NOTE(dhaval): Every run records benchmark_zone_count zones, fewer runs than the other benchmarks.
+static const uint32_t zone_cost_iteration_count = 10;
+
+static const uint32_t benchmark_thread_count = 4;
+static const uint32_t benchmark_frame_count = 3;
+static const uint32_t benchmark_zones_per_frame = 1000;
+static const double benchmark_zone_budget_ns = 50.0;
+
+/**
+ * \brief Records benchmark_zone_count zones and returns the cost of one in nanoseconds.
+ * \return double
+ */
+static double measure_zone_ns()
+{
+    double ms = measure_best_ms(zone_cost_iteration_count, []() {
+        for (uint32_t i = 0; i < benchmark_zone_count; i++)
+        {
+            profiler_zone zone("zone");
+        }
+    });
+
+    return ms * 1000000.0 / benchmark_zone_count;
+}
+
+bool run_profiler_benchmark()
+{
+#if defined(PBR_ENABLE_PROFILER)
+    std::cout << "  PBR_ENABLE_PROFILER on, PBR_PROFILE_* macros record" << std::endl;
+#else
+    std::cout << "  PBR_ENABLE_PROFILER off, PBR_PROFILE_* macros compile to nothing" << std::endl;
+#endif
+
+    double idle_zone_ns = measure_zone_ns();
+
+    // NOTE(dhaval): Never ended by frames, the ring wraps many times, which is the steady state cost of a long capture.
+    profiler::begin_capture(0, "");
+    double capturing_zone_ns = measure_zone_ns();
+    profiler::record_counter("counter", 1.0);
+
+    auto counter_start_time = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < benchmark_zone_count; i++)
+    {
+        profiler::record_counter("counter", static_cast<double>(i));
+    }
+    auto counter_end_time = std::chrono::high_resolution_clock::now();
+    double counter_ns = std::chrono::duration<double, std::nano>(counter_end_time - counter_start_time).count() / benchmark_zone_count;
+
+    profiler::end_capture();
+
+    std::cout << "  zone cost: " << idle_zone_ns << " ns without a capture, " << capturing_zone_ns << " ns while capturing (budget " << benchmark_zone_budget_ns << " ns)" << std::endl;
+    std::cout << "  counter cost: " << counter_ns << " ns" << std::endl;
+
+    if (capturing_zone_ns > benchmark_zone_budget_ns)
+    {
+        std::cout << "  zone cost is over budget on this machine" << std::endl;
+    }
+
+    // NOTE(dhaval): A small capture from several threads, every event must come out exactly once.
+    profiler::begin_capture(benchmark_frame_count, "");
+
+    for (uint32_t frame = 0; frame < benchmark_frame_count; frame++)
+    {
+        std::vector<std::thread> threads;
+
+        for (uint32_t t = 0; t < benchmark_thread_count; t++)
+        {
+            threads.emplace_back([]() {
+                profiler::set_thread_name("benchmark worker");
+
+                for (uint32_t i = 0; i < benchmark_zones_per_frame; i++)
+                {
+                    profiler_zone zone("work");
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        profiler::mark_frame();
+    }
+
+    if (profiler::is_capturing())
+    {
+        std::cerr << "profiler: capture did not end after " << benchmark_frame_count << " frames" << std::endl;
+        profiler::end_capture();
+        return false;
+    }
+
+    std::ostringstream trace;
+    profiler::write_trace(trace);
+
+    const profiler_capture_statistics& statistics = profiler::get_capture_statistics();
+    uint64_t expected_event_count = static_cast<uint64_t>(benchmark_frame_count) * (benchmark_thread_count * benchmark_zones_per_frame + 1);
+
+    std::cout << "  capture: " << statistics.frame_count << " frames, " << statistics.event_count << " events from " << statistics.thread_count << " thread(s), "
+              << trace.str().size() / 1024 << " KB of trace JSON" << std::endl;
+
+    if (statistics.event_count != expected_event_count || statistics.dropped_event_count != 0)
+    {
+        std::cerr << "profiler: expected " << expected_event_count << " events, captured " << statistics.event_count << std::endl;
+        return false;
+    }
+
+    return true;
+}
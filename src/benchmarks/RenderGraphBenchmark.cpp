@@ -0,0 +1,175 @@
+#include "Benchmarks.hpp"
+
+#include "RenderGraph.hpp"
+
+#include <iostream>
+#include <vector>
+
+// NOTE(dhaval): A deferred frame at 1920x1080: shadow map, depth prepass, gbuffer, SSAO, lighting, bloom, tonemap and a debug view nobody reads.
+static const uint64_t benchmark_width = 1920;
+static const uint64_t benchmark_height = 1080;
+static const uint64_t benchmark_shadow_map_size = 2048;
+static const uint64_t benchmark_memory_alignment = 64 * 1024;
+static const uint32_t benchmark_compile_count = 1000;
+
+/**
+ * \brief Size of an image rounded up to the benchmark's memory alignment, roughly what a driver reports.
+ * \param width Width in pixels.
+ * \param height Height in pixels.
+ * \param bytes_per_pixel Bytes per pixel.
+ * \return uint64_t
+ */
+static uint64_t get_image_size(uint64_t width, uint64_t height, uint64_t bytes_per_pixel)
+{
+    uint64_t size = width * height * bytes_per_pixel;
+    return (size + benchmark_memory_alignment - 1) / benchmark_memory_alignment * benchmark_memory_alignment;
+}
+
+/**
+ * \brief Declares the benchmark frame.
+ * \param graph Graph to declare the frame into, reset first.
+ * \param sizes Receives the memory size of every resource.
+ * \return uint32_t Index of the debug view pass, which must be culled.
+ */
+static uint32_t declare_frame(render_graph& graph, std::vector<uint64_t>& sizes)
+{
+    graph.reset();
+    sizes.clear();
+
+    auto create = [&](const char* name, uint64_t size) {
+        sizes.push_back(size);
+        return graph.create_resource(name);
+    };
+
+    uint32_t backbuffer = graph.import_resource("backbuffer", render_graph_usage::present, render_graph_usage::present);
+    sizes.push_back(0);
+
+    uint32_t shadow_map = create("shadow_map", get_image_size(benchmark_shadow_map_size, benchmark_shadow_map_size, 4));
+    uint32_t depth = create("depth", get_image_size(benchmark_width, benchmark_height, 4));
+    uint32_t albedo = create("albedo", get_image_size(benchmark_width, benchmark_height, 4));
+    uint32_t normal = create("normal", get_image_size(benchmark_width, benchmark_height, 8));
+    uint32_t material = create("material", get_image_size(benchmark_width, benchmark_height, 4));
+    uint32_t ambient_occlusion = create("ambient_occlusion", get_image_size(benchmark_width, benchmark_height, 1));
+    uint32_t hdr = create("hdr", get_image_size(benchmark_width, benchmark_height, 8));
+    uint32_t bloom_half = create("bloom_half", get_image_size(benchmark_width / 2, benchmark_height / 2, 8));
+    uint32_t bloom = create("bloom", get_image_size(benchmark_width, benchmark_height, 8));
+    uint32_t debug = create("debug", get_image_size(benchmark_width, benchmark_height, 4));
+
+    uint32_t shadow_pass = graph.add_pass("shadow");
+    graph.write(shadow_pass, shadow_map, render_graph_usage::depth_attachment, render_graph_load_op::clear);
+
+    uint32_t prepass = graph.add_pass("depth_prepass");
+    graph.write(prepass, depth, render_graph_usage::depth_attachment, render_graph_load_op::clear);
+
+    uint32_t gbuffer_pass = graph.add_pass("gbuffer");
+    graph.read(gbuffer_pass, depth, render_graph_usage::depth_read);
+    graph.write(gbuffer_pass, albedo, render_graph_usage::color_attachment, render_graph_load_op::dont_care);
+    graph.write(gbuffer_pass, normal, render_graph_usage::color_attachment, render_graph_load_op::dont_care);
+    graph.write(gbuffer_pass, material, render_graph_usage::color_attachment, render_graph_load_op::dont_care);
+
+    uint32_t ssao_pass = graph.add_pass("ssao");
+    graph.read(ssao_pass, depth, render_graph_usage::shader_read);
+    graph.read(ssao_pass, normal, render_graph_usage::shader_read);
+    graph.write(ssao_pass, ambient_occlusion, render_graph_usage::color_attachment, render_graph_load_op::dont_care);
+
+    uint32_t lighting_pass = graph.add_pass("lighting");
+    graph.read(lighting_pass, albedo, render_graph_usage::shader_read);
+    graph.read(lighting_pass, normal, render_graph_usage::shader_read);
+    graph.read(lighting_pass, material, render_graph_usage::shader_read);
+    graph.read(lighting_pass, ambient_occlusion, render_graph_usage::shader_read);
+    graph.read(lighting_pass, shadow_map, render_graph_usage::shader_read);
+    graph.write(lighting_pass, hdr, render_graph_usage::color_attachment, render_graph_load_op::clear);
+
+    uint32_t debug_pass = graph.add_pass("debug_view");
+    graph.read(debug_pass, normal, render_graph_usage::shader_read);
+    graph.write(debug_pass, debug, render_graph_usage::color_attachment, render_graph_load_op::dont_care);
+
+    uint32_t bloom_downsample_pass = graph.add_pass("bloom_downsample");
+    graph.read(bloom_downsample_pass, hdr, render_graph_usage::shader_read);
+    graph.write(bloom_downsample_pass, bloom_half, render_graph_usage::color_attachment, render_graph_load_op::dont_care);
+
+    uint32_t bloom_upsample_pass = graph.add_pass("bloom_upsample");
+    graph.read(bloom_upsample_pass, bloom_half, render_graph_usage::shader_read);
+    graph.write(bloom_upsample_pass, bloom, render_graph_usage::color_attachment, render_graph_load_op::dont_care);
+
+    uint32_t tonemap_pass = graph.add_pass("tonemap");
+    graph.read(tonemap_pass, hdr, render_graph_usage::shader_read);
+    graph.read(tonemap_pass, bloom, render_graph_usage::shader_read);
+    graph.write(tonemap_pass, backbuffer, render_graph_usage::color_attachment, render_graph_load_op::dont_care);
+
+    graph.set_output(backbuffer);
+
+    return debug_pass;
+}
+
+bool run_render_graph_benchmark()
+{
+    render_graph graph;
+    std::vector<uint64_t> sizes;
+
+    auto get_memory_requirements = [&](uint32_t resource) {
+        render_graph_memory_requirements requirements;
+        requirements.size = sizes[resource];
+        requirements.alignment = benchmark_memory_alignment;
+        requirements.memory_type_bits = 1;
+
+        return requirements;
+    };
+
+    uint32_t debug_pass = declare_frame(graph, sizes);
+
+    double compile_ms = measure_best_ms(benchmark_iteration_count, [&]() {
+        for (uint32_t i = 0; i < benchmark_compile_count; i++)
+        {
+            declare_frame(graph, sizes);
+            graph.compile(get_memory_requirements);
+        }
+    });
+
+    const render_graph_statistics& statistics = graph.get_statistics();
+
+    std::cout << "  " << statistics.pass_count << " passes, " << statistics.culled_pass_count << " culled, " << statistics.transient_count << " transient attachments in "
+              << statistics.memory_block_count << " memory blocks" << std::endl;
+    std::cout << "  declare and compile: " << compile_ms * 1000.0 / benchmark_compile_count << " us" << std::endl;
+    std::cout << "  barriers/frame: " << statistics.barrier_count << std::endl;
+    std::cout << "  transient memory: " << statistics.transient_memory_size / (1024 * 1024) << " MB without aliasing, " << statistics.allocated_memory_size / (1024 * 1024)
+              << " MB aliased, " << (statistics.transient_memory_size - statistics.allocated_memory_size) / (1024 * 1024) << " MB saved" << std::endl;
+
+    if (!graph.is_pass_culled(debug_pass) || statistics.culled_pass_count != 1)
+    {
+        std::cerr << "render_graph: only the unused debug view pass should be culled" << std::endl;
+        return false;
+    }
+
+    // NOTE(dhaval): Resources sharing a block must never be alive at the same time.
+    for (const render_graph_memory_block& block : graph.get_memory_blocks())
+    {
+        for (uint32_t a : block.resources)
+        {
+            for (uint32_t b : block.resources)
+            {
+                if (a != b && graph.get_resource_first_pass(a) <= graph.get_resource_last_pass(b) && graph.get_resource_first_pass(b) <= graph.get_resource_last_pass(a))
+                {
+                    std::cerr << "render_graph: " << graph.get_resource_name(a) << " and " << graph.get_resource_name(b) << " alias while both alive" << std::endl;
+                    return false;
+                }
+            }
+        }
+    }
+
+    // NOTE(dhaval): Transient memory is shared by the frames in flight, even the first access of a frame waits for an earlier one.
+    for (uint32_t pass = 0; pass < graph.get_pass_count(); pass++)
+    {
+        for (const render_graph_barrier& barrier : graph.get_pass_barriers(pass))
+        {
+            if (!graph.is_resource_imported(barrier.resource) && barrier.source_usage == render_graph_usage::undefined)
+            {
+                std::cerr << "render_graph: " << graph.get_resource_name(barrier.resource) << " is written by " << graph.get_pass_name(pass)
+                          << " without waiting for the previous use of its memory" << std::endl;
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,120 @@
+#include "Benchmarks.hpp"
+
+#include "SceneGraph.hpp"
+#include "JobSystem.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+
+// NOTE(dhaval): 100 roots of 1000 nodes each, with random depth so both wide and deep hierarchies show up.
+static const uint32_t benchmark_root_count = 100;
+static const uint32_t benchmark_nodes_per_root = 1000;
+
+/**
+ * \brief Builds the benchmark graph. Every node hangs below the previous node or one of its ancestors, so insertion is depth first.
+ * \param graph Graph to fill.
+ */
+static void build_graph(scene_graph& graph)
+{
+    std::mt19937 random(1234);
+    std::uniform_int_distribution<uint32_t> pop_count(0, 2);
+    std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+
+    std::vector<uint32_t> path;
+
+    for (uint32_t root = 0; root < benchmark_root_count; root++)
+    {
+        path.clear();
+        path.push_back(graph.add_node(invalid_scene_index, glm::vec3(root * 10.0f, 0.0f, 0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f)));
+
+        for (uint32_t i = 1; i < benchmark_nodes_per_root; i++)
+        {
+            uint32_t pops = std::min(pop_count(random), static_cast<uint32_t>(path.size()) - 1);
+            path.resize(path.size() - pops);
+
+            glm::quat rotation = glm::angleAxis(offset(random), glm::normalize(glm::vec3(offset(random), offset(random), 1.0f)));
+            path.push_back(graph.add_node(path.back(), glm::vec3(offset(random), offset(random), offset(random)), rotation, glm::vec3(1.0f)));
+        }
+    }
+}
+
+/**
+ * \brief Dirties some nodes, then times the update. Returns the fastest of several runs in milliseconds.
+ * \param graph Graph to update.
+ * \param jobs Job system passed to the update, may be null.
+ * \param dirty Marks the nodes that should be updated.
+ * \return double
+ */
+static double measure_update_ms(scene_graph& graph, job_system* jobs, const std::function<void(scene_graph&)>& dirty)
+{
+    return measure_best_ms(benchmark_iteration_count, [&]() { graph.update_world_transforms(jobs); }, [&]() { dirty(graph); });
+}
+
+/**
+ * \brief Re-applies the local transform of a node, which marks it dirty.
+ * \param graph Graph the node belongs to.
+ * \param node Node to touch.
+ */
+static void touch_node(scene_graph& graph, uint32_t node)
+{
+    graph.set_local_transform(node, graph.get_translation(node), graph.get_rotation(node), graph.get_scale(node));
+}
+
+bool run_scene_graph_benchmark()
+{
+    scene_graph serial_graph;
+    scene_graph threaded_graph;
+    build_graph(serial_graph);
+    build_graph(threaded_graph);
+
+    uint32_t node_count = serial_graph.get_node_count();
+
+    job_system jobs;
+    init_benchmark_job_system(jobs);
+
+    std::function<void(scene_graph&)> dirty_roots = [](scene_graph& graph) {
+        for (uint32_t root : graph.get_roots())
+        {
+            touch_node(graph, root);
+        }
+    };
+
+    // NOTE(dhaval): Same nodes every run, one in a hundred, mostly small subtrees near the leaves.
+    std::function<void(scene_graph&)> dirty_some = [node_count](scene_graph& graph) {
+        for (uint32_t node = 7; node < node_count; node += 100)
+        {
+            touch_node(graph, node);
+        }
+    };
+
+    std::function<void(scene_graph&)> dirty_none = [](scene_graph&) {};
+
+    double serial_full_ms = measure_update_ms(serial_graph, nullptr, dirty_roots);
+    double threaded_full_ms = measure_update_ms(threaded_graph, &jobs, dirty_roots);
+    double serial_partial_ms = measure_update_ms(serial_graph, nullptr, dirty_some);
+    double threaded_partial_ms = measure_update_ms(threaded_graph, &jobs, dirty_some);
+    double serial_clean_ms = measure_update_ms(serial_graph, nullptr, dirty_none);
+
+    std::cout << "  " << node_count << " nodes, " << serial_graph.get_roots().size() << " roots, " << jobs.get_worker_count() << " worker thread(s)" << std::endl;
+    std::cout << "  all dirty: " << serial_full_ms << " ms serial, " << threaded_full_ms << " ms threaded" << std::endl;
+    std::cout << "  1% dirty: " << serial_partial_ms << " ms serial, " << threaded_partial_ms << " ms threaded" << std::endl;
+    std::cout << "  clean: " << serial_clean_ms << " ms" << std::endl;
+
+    jobs.shutdown();
+
+    bool matches = true;
+    for (uint32_t node = 0; node < node_count && matches; node++)
+    {
+        matches = memcmp(&serial_graph.get_world_transform(node), &threaded_graph.get_world_transform(node), sizeof(glm::mat4)) == 0;
+    }
+
+    if (!matches)
+    {
+        std::cerr << "scene_graph: threaded world transforms differ from the serial update" << std::endl;
+    }
+
+    return matches;
+}
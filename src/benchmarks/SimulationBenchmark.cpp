@@ -0,0 +1,150 @@
+#include "Benchmarks.hpp"
+
+#include "Simulation.hpp"
+#include "TripleBuffer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+// NOTE(dhaval): Large enough that a torn copy, half of one publish and half of another, can't go unnoticed.
+static const uint32_t handoff_payload_size = 64;
+static const uint64_t handoff_publish_count = 1000000;
+
+static const double benchmark_tick_rate = 1000.0;
+static const uint32_t benchmark_frame_count = 200;
+static const auto benchmark_frame_time = std::chrono::microseconds(2500);
+
+struct handoff_payload
+{
+    std::array<uint64_t, handoff_payload_size> values{};
+};
+
+/**
+ * \brief Publishes numbered payloads from one thread while the calling thread acquires them as fast as it can. Every payload must be whole
+ *        and the sequence must never go backwards.
+ * \return bool
+ */
+static bool run_triple_buffer_handoff()
+{
+    triple_buffer<handoff_payload> buffer;
+    std::atomic<bool> writer_done{false};
+
+    std::thread writer([&]() {
+        for (uint64_t sequence = 1; sequence <= handoff_publish_count; sequence++)
+        {
+            handoff_payload& payload = buffer.get_write_buffer();
+            payload.values.fill(sequence);
+            buffer.publish();
+        }
+
+        writer_done = true;
+    });
+
+    uint64_t acquire_count = 0;
+    uint64_t fresh_count = 0;
+    uint64_t last_sequence = 0;
+    bool torn = false;
+    bool reordered = false;
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    // NOTE(dhaval): One more acquire after the writer finished picks up its last publish.
+    bool last_round = false;
+    while (!last_round)
+    {
+        last_round = writer_done;
+
+        acquire_count++;
+        if (!buffer.acquire())
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        fresh_count++;
+
+        const handoff_payload& payload = buffer.get_read_buffer();
+        uint64_t sequence = payload.values[0];
+
+        torn = torn || std::any_of(payload.values.begin(), payload.values.end(), [sequence](uint64_t value) { return value != sequence; });
+        reordered = reordered || sequence <= last_sequence;
+        last_sequence = sequence;
+    }
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+
+    writer.join();
+
+    double ms = std::chrono::duration<double, std::milli>(end_time - start_time).count();
+    std::cout << "  triple buffer: " << handoff_publish_count << " publishes of " << sizeof(handoff_payload) << " bytes in " << ms << " ms ("
+        << 1000000.0 * ms / handoff_publish_count << " ns/publish), " << fresh_count << " taken by " << acquire_count << " acquires" << std::endl;
+
+    if (torn || reordered || last_sequence != handoff_publish_count)
+    {
+        std::cerr << "triple_buffer: " << (torn ? "torn payload, " : "") << (reordered ? "sequence went backwards, " : "") << "last sequence " << last_sequence
+            << " of " << handoff_publish_count << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * \brief Runs the simulation thread while the calling thread takes a snapshot every frame like the render thread does.
+ * \return bool False if a snapshot went backwards or its time is off the tick grid.
+ */
+static bool run_simulation_thread()
+{
+    simulation_config config{};
+    config.tick_rate = benchmark_tick_rate;
+
+    simulation sim;
+    sim.init(config);
+
+    bool consistent = true;
+    uint64_t last_tick = 0;
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    sim.start(start_time);
+
+    for (uint32_t frame = 0; frame < benchmark_frame_count; frame++)
+    {
+        std::this_thread::sleep_until(start_time + benchmark_frame_time * (frame + 1));
+
+        const simulation_snapshot& snapshot = sim.acquire_snapshot();
+        consistent = consistent && snapshot.tick >= last_tick && std::abs(snapshot.time - snapshot.tick / benchmark_tick_rate) < 1e-9;
+        last_tick = snapshot.tick;
+    }
+
+    sim.stop();
+
+    const simulation_statistics& statistics = sim.get_statistics();
+    std::cout << "  simulation: " << statistics.tick_count << " ticks at " << benchmark_tick_rate << " Hz, tick jitter " << statistics.total_tick_jitter_ms / std::max<uint64_t>(statistics.tick_count, 1)
+        << " ms avg, " << statistics.max_tick_jitter_ms << " ms max, " << statistics.skipped_tick_count << " skipped" << std::endl;
+    std::cout << "  simulation: " << statistics.snapshot_count << " frames, snapshot wait " << 1000.0 * statistics.total_snapshot_wait_ms / statistics.snapshot_count
+        << " us avg, " << 1000.0 * statistics.max_snapshot_wait_ms << " us max, snapshot age " << statistics.total_snapshot_age_ms / statistics.snapshot_count << " ms avg, "
+        << statistics.max_snapshot_age_ms << " ms max, " << statistics.reused_snapshot_count << " reused" << std::endl;
+
+    sim.shutdown();
+
+    if (!consistent || last_tick == 0)
+    {
+        std::cerr << "simulation: snapshots went backwards or left the tick grid, last tick " << last_tick << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool run_simulation_benchmark()
+{
+    bool succeeded = run_triple_buffer_handoff();
+    succeeded = run_simulation_thread() && succeeded;
+
+    return succeeded;
+}
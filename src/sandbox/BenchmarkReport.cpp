@@ -0,0 +1,273 @@
+#include "BenchmarkReport.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+static const char* benchmark_metric_names[benchmark_metric_count] = {"cpu_frame_ms", "gpu_frame_ms", "fence_wait_ms", "acquire_ms"};
+
+// NOTE(dhaval): Fence waits and acquires are often a few microseconds, a slowdown smaller than this is noise however large in percent.
+static const double benchmark_compare_min_delta_ms = 0.05;
+
+/**
+ * \brief Nearest rank percentile of sorted samples.
+ * \param sorted Samples in ascending order, not empty.
+ * \param percentile Percentile in [0, 100].
+ * \return double
+ */
+static double get_percentile(const std::vector<double>& sorted, double percentile)
+{
+    size_t rank = static_cast<size_t>(percentile / 100.0 * static_cast<double>(sorted.size()) + 0.5);
+    rank = std::clamp(rank, static_cast<size_t>(1), sorted.size());
+
+    return sorted[rank - 1];
+}
+
+/**
+ * \brief Reads the number following "key": inside text[begin, end).
+ * \param text JSON text.
+ * \param begin Start of the object to search.
+ * \param end End of the object to search.
+ * \param key Key to look for.
+ * \param value Receives the number.
+ * \return bool False if the key is not there.
+ */
+static bool read_json_number(const std::string& text, size_t begin, size_t end, const char* key, double& value)
+{
+    std::string quoted_key = std::string("\"") + key + "\"";
+
+    size_t position = text.find(quoted_key, begin);
+    if (position == std::string::npos || position >= end)
+    {
+        return false;
+    }
+
+    position = text.find(':', position + quoted_key.size());
+    if (position == std::string::npos || position >= end)
+    {
+        return false;
+    }
+
+    value = strtod(text.c_str() + position + 1, nullptr);
+    return true;
+}
+
+/**
+ * \brief Drops the samples of the previous run.
+ * \param expected_frame_count Number of frames that will be measured, reserves space so sampling never allocates.
+ */
+void benchmark_report::reset(uint64_t expected_frame_count)
+{
+    for (std::vector<double>& samples : samples_)
+    {
+        samples.clear();
+        samples.reserve(static_cast<size_t>(expected_frame_count));
+    }
+}
+
+/**
+ * \brief Adds the timing of one frame.
+ * \param metric Metric the sample belongs to.
+ * \param ms Time in milliseconds.
+ */
+void benchmark_report::add_sample(benchmark_metric metric, double ms)
+{
+    samples_[static_cast<uint32_t>(metric)].push_back(ms);
+}
+
+/**
+ * \brief Computes the distribution of a metric.
+ * \param metric Metric to summarize.
+ * \return benchmark_summary All zero if the metric has no samples.
+ */
+benchmark_summary benchmark_report::summarize(benchmark_metric metric) const
+{
+    benchmark_summary summary{};
+
+    std::vector<double> sorted = samples_[static_cast<uint32_t>(metric)];
+    if (sorted.empty())
+    {
+        return summary;
+    }
+
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0.0;
+    for (double sample : sorted)
+    {
+        sum += sample;
+    }
+
+    summary.sample_count = sorted.size();
+    summary.min = sorted.front();
+    summary.mean = sum / sorted.size();
+    summary.p50 = get_percentile(sorted, 50.0);
+    summary.p95 = get_percentile(sorted, 95.0);
+    summary.p99 = get_percentile(sorted, 99.0);
+    summary.max = sorted.back();
+
+    return summary;
+}
+
+/**
+ * \brief Prints one line per metric with samples.
+ * \param stream Stream to print to.
+ */
+void benchmark_report::print(std::ostream& stream) const
+{
+    for (uint32_t i = 0; i < benchmark_metric_count; i++)
+    {
+        benchmark_summary summary = summarize(static_cast<benchmark_metric>(i));
+        if (summary.sample_count == 0)
+        {
+            continue;
+        }
+
+        stream << "benchmark: " << std::left << std::setw(14) << benchmark_metric_names[i] << std::right << std::fixed << std::setprecision(3) << " min " << summary.min
+               << " mean " << summary.mean << " p50 " << summary.p50 << " p95 " << summary.p95 << " p99 " << summary.p99 << " max " << summary.max << " (" << summary.sample_count
+               << " frames)" << std::defaultfloat << std::endl;
+    }
+}
+
+/**
+ * \brief Writes the run settings and the summary of every metric with samples as JSON.
+ * \param path File to write.
+ * \param description Settings of the run.
+ * \return bool False if the file can't be written.
+ */
+bool benchmark_report::write_json(const std::string& path, const benchmark_run_description& description) const
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    file << std::setprecision(6);
+    file << "{\n";
+    file << "  \"device\": \"";
+    for (char c : description.device_name)
+    {
+        file << (c == '"' || c == '\\' ? '_' : c);
+    }
+    file << "\",\n";
+    file << "  \"width\": " << description.width << ",\n";
+    file << "  \"height\": " << description.height << ",\n";
+    file << "  \"warmup_frames\": " << description.warmup_frame_count << ",\n";
+    file << "  \"measured_frames\": " << description.measured_frame_count << ",\n";
+    file << "  \"timestep_ms\": " << description.timestep_ms << ",\n";
+    file << "  \"metrics\": {";
+
+    bool first = true;
+    for (uint32_t i = 0; i < benchmark_metric_count; i++)
+    {
+        benchmark_summary summary = summarize(static_cast<benchmark_metric>(i));
+        if (summary.sample_count == 0)
+        {
+            continue;
+        }
+
+        file << (first ? "\n" : ",\n");
+        first = false;
+
+        file << "    \"" << benchmark_metric_names[i] << "\": {\"samples\": " << summary.sample_count << ", \"min\": " << summary.min << ", \"mean\": " << summary.mean
+             << ", \"p50\": " << summary.p50 << ", \"p95\": " << summary.p95 << ", \"p99\": " << summary.p99 << ", \"max\": " << summary.max << "}";
+    }
+
+    file << "\n  }\n}\n";
+
+    return file.good();
+}
+
+/**
+ * \brief Reads the metric summaries of a report written by write_json(). Metrics missing from the file keep a sample count of 0.
+ * \param path File to read.
+ * \param summaries Receives the summary of every metric.
+ * \return bool False if the file can't be read or has no metrics.
+ */
+bool benchmark_report::read_json(const std::string& path, std::array<benchmark_summary, benchmark_metric_count>& summaries)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string text = buffer.str();
+
+    size_t metrics_begin = text.find("\"metrics\"");
+    if (metrics_begin == std::string::npos)
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < benchmark_metric_count; i++)
+    {
+        benchmark_summary& summary = summaries[i];
+        summary = {};
+
+        std::string quoted_name = std::string("\"") + benchmark_metric_names[i] + "\"";
+
+        size_t begin = text.find(quoted_name, metrics_begin);
+        size_t end = begin == std::string::npos ? std::string::npos : text.find('}', begin);
+        if (begin == std::string::npos || end == std::string::npos)
+        {
+            continue;
+        }
+
+        double samples = 0.0;
+        bool complete = read_json_number(text, begin, end, "samples", samples) && read_json_number(text, begin, end, "min", summary.min) &&
+                        read_json_number(text, begin, end, "mean", summary.mean) && read_json_number(text, begin, end, "p50", summary.p50) &&
+                        read_json_number(text, begin, end, "p95", summary.p95) && read_json_number(text, begin, end, "p99", summary.p99) &&
+                        read_json_number(text, begin, end, "max", summary.max);
+
+        summary.sample_count = complete ? static_cast<uint64_t>(samples) : 0;
+    }
+
+    return std::any_of(summaries.begin(), summaries.end(), [](const benchmark_summary& summary) { return summary.sample_count > 0; });
+}
+
+/**
+ * \brief Prints how every metric measured in both runs changed against the baseline. The mean, p95 and p99 are compared,
+ *        min and max are too noisy to gate on.
+ * \param baseline Summaries of the baseline run.
+ * \param threshold_percent Slowdown in percent above which a statistic counts as a regression, if it is also above benchmark_compare_min_delta_ms.
+ * \param stream Stream to print to.
+ * \return bool True if any statistic regressed.
+ */
+bool benchmark_report::compare(const std::array<benchmark_summary, benchmark_metric_count>& baseline, double threshold_percent, std::ostream& stream) const
+{
+    bool regressed = false;
+
+    for (uint32_t i = 0; i < benchmark_metric_count; i++)
+    {
+        benchmark_summary current = summarize(static_cast<benchmark_metric>(i));
+        if (current.sample_count == 0 || baseline[i].sample_count == 0)
+        {
+            continue;
+        }
+
+        const char* statistic_names[] = {"mean", "p95", "p99"};
+        double baseline_values[] = {baseline[i].mean, baseline[i].p95, baseline[i].p99};
+        double current_values[] = {current.mean, current.p95, current.p99};
+
+        for (uint32_t s = 0; s < 3; s++)
+        {
+            double change_percent = baseline_values[s] > 0.0 ? (current_values[s] - baseline_values[s]) / baseline_values[s] * 100.0 : 0.0;
+            bool statistic_regressed = change_percent > threshold_percent && current_values[s] - baseline_values[s] > benchmark_compare_min_delta_ms;
+            regressed = regressed || statistic_regressed;
+
+            stream << "benchmark: " << std::left << std::setw(14) << benchmark_metric_names[i] << std::setw(5) << statistic_names[s] << std::right << std::fixed
+                   << std::setprecision(3) << baseline_values[s] << " -> " << current_values[s] << " ms (" << std::showpos << std::setprecision(1) << change_percent << std::noshowpos
+                   << "%)" << (statistic_regressed ? " REGRESSION" : "") << std::defaultfloat << std::endl;
+        }
+    }
+
+    return regressed;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * \brief Per frame timings a benchmark run collects.
+ */
+enum class benchmark_metric : uint32_t
+{
+    cpu_frame,
+    gpu_frame,
+    fence_wait,
+    acquire,
+    count
+};
+
+static const uint32_t benchmark_metric_count = static_cast<uint32_t>(benchmark_metric::count);
+
+/**
+ * \brief Distribution of one metric over the measured frames, in milliseconds.
+ */
+struct benchmark_summary
+{
+    uint64_t sample_count{0};
+    double min{0.0};
+    double mean{0.0};
+    double p50{0.0};
+    double p95{0.0};
+    double p99{0.0};
+    double max{0.0};
+};
+
+/**
+ * \brief Settings of the run, written next to the results so two reports can be checked for comparability.
+ */
+struct benchmark_run_description
+{
+    uint64_t warmup_frame_count{0};
+    uint64_t measured_frame_count{0};
+    double timestep_ms{0.0};
+    uint32_t width{0};
+    uint32_t height{0};
+    std::string device_name;
+};
+
+/**
+ * \brief Collects frame timings of a benchmark run, summarizes them and writes or reads them as JSON.
+ *        compare() diffs a run against a baseline report and flags metrics that got slower than a threshold.
+ */
+class benchmark_report
+{
+public:
+    void reset(uint64_t expected_frame_count);
+    void add_sample(benchmark_metric metric, double ms);
+
+    benchmark_summary summarize(benchmark_metric metric) const;
+
+    void print(std::ostream& stream) const;
+    bool write_json(const std::string& path, const benchmark_run_description& description) const;
+
+    static bool read_json(const std::string& path, std::array<benchmark_summary, benchmark_metric_count>& summaries);
+    bool compare(const std::array<benchmark_summary, benchmark_metric_count>& baseline, double threshold_percent, std::ostream& stream) const;
+
+private:
+    std::array<std::vector<double>, benchmark_metric_count> samples_;
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+/**
+ * \brief Axis aligned box and sphere sharing one center. Both bound the same geometry, so a culler may reject with whichever is tighter.
+ */
+struct bounding_volume
+{
+    glm::vec3 center{0.0f, 0.0f, 0.0f};
+    glm::vec3 extent{0.0f, 0.0f, 0.0f};
+    float radius{0.0f};
+};
+
+/**
+ * \brief Computes the box of a point set and the sphere around the box center that contains every point.
+ * \param points Positions to bound.
+ * \param count Number of positions.
+ * \param stride Distance in bytes between two positions.
+ * \return bounding_volume
+ */
+inline bounding_volume compute_bounding_volume(const void* points, size_t count, size_t stride)
+{
+    bounding_volume bounds{};
+    if (count == 0)
+    {
+        return bounds;
+    }
+
+    const unsigned char* bytes = static_cast<const unsigned char*>(points);
+
+    glm::vec3 min_position = *reinterpret_cast<const glm::vec3*>(bytes);
+    glm::vec3 max_position = min_position;
+
+    for (size_t i = 1; i < count; i++)
+    {
+        const glm::vec3& position = *reinterpret_cast<const glm::vec3*>(bytes + i * stride);
+        min_position = glm::min(min_position, position);
+        max_position = glm::max(max_position, position);
+    }
+
+    bounds.center = (min_position + max_position) * 0.5f;
+    bounds.extent = (max_position - min_position) * 0.5f;
+
+    float radius_squared = 0.0f;
+    for (size_t i = 0; i < count; i++)
+    {
+        glm::vec3 offset = *reinterpret_cast<const glm::vec3*>(bytes + i * stride) - bounds.center;
+        radius_squared = std::max(radius_squared, glm::dot(offset, offset));
+    }
+
+    bounds.radius = std::sqrt(radius_squared);
+
+    return bounds;
+}
+
+/**
+ * \brief Transforms a bounding volume. The box is re-fit around the transformed box and the radius scaled by the largest axis scale.
+ * \param bounds Bounding volume in object space.
+ * \param transform Object to world transform.
+ * \return bounding_volume
+ */
+inline bounding_volume transform_bounding_volume(const bounding_volume& bounds, const glm::mat4& transform)
+{
+    bounding_volume transformed{};
+    transformed.center = glm::vec3(transform * glm::vec4(bounds.center, 1.0f));
+
+    glm::vec3 axis_x = glm::vec3(transform[0]);
+    glm::vec3 axis_y = glm::vec3(transform[1]);
+    glm::vec3 axis_z = glm::vec3(transform[2]);
+
+    transformed.extent = glm::abs(axis_x) * bounds.extent.x + glm::abs(axis_y) * bounds.extent.y + glm::abs(axis_z) * bounds.extent.z;
+
+    float max_scale_squared = std::max(glm::dot(axis_x, axis_x), std::max(glm::dot(axis_y, axis_y), glm::dot(axis_z, axis_z)));
+    transformed.radius = bounds.radius * std::sqrt(max_scale_squared);
+
+    return transformed;
+}
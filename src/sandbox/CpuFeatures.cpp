@@ -0,0 +1,45 @@
+#include "CpuFeatures.hpp"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+/**
+ * \brief Queries the CPU once, the result never changes while the process runs.
+ * \return bool
+ */
+static bool detect_avx2()
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int registers[4];
+
+    __cpuid(registers, 0);
+    if (registers[0] < 7)
+    {
+        return false;
+    }
+
+    // NOTE(dhaval): AVX needs the OS to save the YMM registers (OSXSAVE and XCR0 bits 1 and 2), AVX2 is leaf 7 EBX bit 5.
+    __cpuid(registers, 1);
+    bool os_saves_ymm = (registers[2] & (1 << 27)) != 0 && (registers[2] & (1 << 28)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+
+    __cpuidex(registers, 7, 0);
+    return os_saves_ymm && (registers[1] & (1 << 5)) != 0;
+#elif defined(__x86_64__) || defined(__i386__)
+    // NOTE(dhaval): Also checks that the OS saves the YMM registers.
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+/**
+ * \brief Whether the CPU and the OS support AVX2. The AVX2 paths live in their own translation units and are only called when this is true.
+ * \return bool
+ */
+bool cpu_supports_avx2()
+{
+    static const bool supported = detect_avx2();
+    return supported;
+}
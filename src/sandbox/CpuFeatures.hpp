@@ -0,0 +1,3 @@
+#pragma once
+
+bool cpu_supports_avx2();
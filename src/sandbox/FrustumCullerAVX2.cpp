@@ -0,0 +1,83 @@
+#include "FrustumCuller.hpp"
+
+// NOTE(dhaval): Only this file is compiled with AVX2 enabled, frustum_culler::cull_range() calls into it once the CPU reported AVX2 support.
+#if defined(PBR_ENABLE_AVX2)
+
+#include <cmath>
+
+#include <immintrin.h>
+
+// NOTE(dhaval): Objects tested per iteration, one per lane.
+static const uint32_t avx2_batch_size = 8;
+
+/**
+ * \brief Culls [first_object, last_object) eight objects at a time, the range must be a whole number of batches. Multiplies and adds are
+ *        kept separate (no FMA) so the results match cull_range_scalar() bit for bit.
+ * \param view_frustum Frustum to test against.
+ * \param first_object First object to test.
+ * \param last_object One past the last object to test.
+ * \param visible_indices Output, must have room for (last_object - first_object) entries.
+ * \return uint32_t Number of visible objects written.
+ */
+uint32_t frustum_culler::cull_range_avx2(const frustum& view_frustum, uint32_t first_object, uint32_t last_object, uint32_t* visible_indices) const
+{
+    uint32_t visible_count = 0;
+
+    __m256 plane_x[6];
+    __m256 plane_y[6];
+    __m256 plane_z[6];
+    __m256 plane_w[6];
+    __m256 plane_abs_x[6];
+    __m256 plane_abs_y[6];
+    __m256 plane_abs_z[6];
+
+    for (int i = 0; i < 6; i++)
+    {
+        plane_x[i] = _mm256_set1_ps(view_frustum.planes[i].x);
+        plane_y[i] = _mm256_set1_ps(view_frustum.planes[i].y);
+        plane_z[i] = _mm256_set1_ps(view_frustum.planes[i].z);
+        plane_w[i] = _mm256_set1_ps(view_frustum.planes[i].w);
+        plane_abs_x[i] = _mm256_set1_ps(std::fabs(view_frustum.planes[i].x));
+        plane_abs_y[i] = _mm256_set1_ps(std::fabs(view_frustum.planes[i].y));
+        plane_abs_z[i] = _mm256_set1_ps(std::fabs(view_frustum.planes[i].z));
+    }
+
+    const __m256 zero = _mm256_setzero_ps();
+
+    for (uint32_t object = first_object; object < last_object; object += avx2_batch_size)
+    {
+        __m256 center_x = _mm256_loadu_ps(center_x_.data() + object);
+        __m256 center_y = _mm256_loadu_ps(center_y_.data() + object);
+        __m256 center_z = _mm256_loadu_ps(center_z_.data() + object);
+        __m256 extent_x = _mm256_loadu_ps(extent_x_.data() + object);
+        __m256 extent_y = _mm256_loadu_ps(extent_y_.data() + object);
+        __m256 extent_z = _mm256_loadu_ps(extent_z_.data() + object);
+        __m256 radius = _mm256_loadu_ps(radius_.data() + object);
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+        for (int i = 0; i < 6; i++)
+        {
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(plane_x[i], center_x), _mm256_mul_ps(plane_y[i], center_y)),
+                                            _mm256_add_ps(_mm256_mul_ps(plane_z[i], center_z), plane_w[i]));
+
+            __m256 box_radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(plane_abs_x[i], extent_x), _mm256_mul_ps(plane_abs_y[i], extent_y)), _mm256_mul_ps(plane_abs_z[i], extent_z));
+
+            // NOTE(dhaval): Outside when the whole volume is behind the plane, using the tighter of box and sphere.
+            __m256 projected_radius = _mm256_min_ps(radius, box_radius);
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, projected_radius), zero, _CMP_GE_OQ));
+        }
+
+        // NOTE(dhaval): Branch free compaction, every candidate is written and only visible ones advance the cursor.
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(inside));
+        for (uint32_t lane = 0; lane < avx2_batch_size; lane++)
+        {
+            visible_indices[visible_count] = object + lane;
+            visible_count += (mask >> lane) & 1;
+        }
+    }
+
+    return visible_count;
+}
+
+#endif
@@ -0,0 +1,701 @@
+#include "JobSystem.hpp"
+
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+
+static const uint32_t invalid_thread_index = UINT32_MAX;
+
+// NOTE(dhaval): Jobs a thread can have queued, a thread that starts more runs the extra ones right away.
+static const int64_t job_deque_capacity = 4096;
+
+// NOTE(dhaval): parallel_for() cuts a range into at least this many chunks per thread, so threads that got slow chunks are evened out by the others.
+static const uint32_t parallel_for_chunks_per_thread = 8;
+
+static const uint64_t counter_pending_mask = 0xffffffffull;
+static const uint64_t counter_releasing_one = 1ull << 32;
+
+/**
+ * \brief A job: a function, or a piece of a parallel_for() range.
+ */
+struct job_entry
+{
+    std::function<void()> function;
+
+    const job_range* range{nullptr};
+    uint32_t first{0};
+    uint32_t last{0};
+
+    job_counter* counter{nullptr};
+};
+
+/**
+ * \brief The shared part of a parallel_for(), it lives on the stack of the thread that called it until every piece finished.
+ */
+struct job_range
+{
+    const std::function<void(uint32_t, uint32_t)>* body{nullptr};
+    uint32_t chunk_size{1};
+    job_counter* counter{nullptr};
+};
+
+/**
+ * \brief Chase-Lev work stealing deque of fixed capacity, after Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models".
+ *        Only the owner pushes and pops at the bottom, any thread steals from the top.
+ */
+class job_deque
+{
+public:
+    job_deque()
+    {
+        for (std::atomic<job_entry*>& job : jobs_)
+        {
+            job.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * \brief Owner only.
+     * \param job Job to queue.
+     * \return bool False if the deque is full.
+     */
+    bool push(job_entry* job)
+    {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed);
+        int64_t top = top_.load(std::memory_order_acquire);
+
+        if (bottom - top >= job_deque_capacity)
+        {
+            return false;
+        }
+
+        jobs_[bottom & (job_deque_capacity - 1)].store(job, std::memory_order_relaxed);
+
+        // NOTE(dhaval): Sequentially consistent so a worker going to sleep either sees the job or is seen sleeping, see job_system::wake_worker().
+        bottom_.store(bottom + 1, std::memory_order_seq_cst);
+        return true;
+    }
+
+    /**
+     * \brief Owner only, takes the job pushed last.
+     * \return job_entry* Null if the deque is empty.
+     */
+    job_entry* pop()
+    {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(bottom, std::memory_order_seq_cst);
+
+        int64_t top = top_.load(std::memory_order_seq_cst);
+
+        if (top > bottom)
+        {
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        job_entry* job = jobs_[bottom & (job_deque_capacity - 1)].load(std::memory_order_relaxed);
+
+        // NOTE(dhaval): The last job, a thief may be taking it at the same time, whoever moves top first gets it.
+        if (top == bottom)
+        {
+            if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            {
+                job = nullptr;
+            }
+
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+        }
+
+        return job;
+    }
+
+    /**
+     * \brief Any thread, takes the job pushed first.
+     * \return job_entry* Null if the deque is empty or another thread took the job first.
+     */
+    job_entry* steal()
+    {
+        int64_t top = top_.load(std::memory_order_seq_cst);
+        int64_t bottom = bottom_.load(std::memory_order_seq_cst);
+
+        if (top >= bottom)
+        {
+            return nullptr;
+        }
+
+        job_entry* job = jobs_[top & (job_deque_capacity - 1)].load(std::memory_order_relaxed);
+
+        if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            return nullptr;
+        }
+
+        return job;
+    }
+
+    inline bool is_empty() const { return bottom_.load(std::memory_order_seq_cst) <= top_.load(std::memory_order_seq_cst); }
+
+private:
+    std::atomic<int64_t> top_{0};
+    std::atomic<int64_t> bottom_{0};
+    std::array<std::atomic<job_entry*>, job_deque_capacity> jobs_;
+};
+
+/**
+ * \brief Deque and counters of one thread taking part in the system.
+ */
+struct job_system::thread_state
+{
+    job_deque deque;
+
+    std::atomic<uint64_t> job_count{0};
+    std::atomic<uint64_t> steal_count{0};
+
+    // NOTE(dhaval): xorshift state picking the first victim to steal from, only touched by the owning thread.
+    uint32_t random_state{1};
+};
+
+// NOTE(dhaval): Which system the current thread belongs to and its index there. Threads outside every system have none.
+static thread_local const job_system* current_job_system = nullptr;
+static thread_local uint32_t current_thread_index = invalid_thread_index;
+
+static uint32_t get_thread_index(const job_system* system)
+{
+    return current_job_system == system ? current_thread_index : invalid_thread_index;
+}
+
+job_system::job_system() = default;
+
+job_system::~job_system() = default;
+
+/**
+ * \brief Starts the workers. The calling thread becomes thread 0 of the system, it runs jobs while it waits.
+ * \param worker_count Number of background threads, one less than the cores makes one thread per core. 0 runs every job inline.
+ */
+void job_system::init(uint32_t worker_count)
+{
+    stop_ = false;
+
+    for (uint32_t i = 0; i < worker_count + 1; i++)
+    {
+        threads_.push_back(std::make_unique<thread_state>());
+        threads_.back()->random_state = 0x9e3779b9u * (i + 1);
+    }
+
+    current_job_system = this;
+    current_thread_index = 0;
+
+    for (uint32_t i = 1; i < worker_count + 1; i++)
+    {
+        workers_.emplace_back(&job_system::worker_main, this, i);
+    }
+}
+
+/**
+ * \brief Stops and joins the workers. Every job must have finished, wait() for their counters first.
+ */
+void job_system::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stop_ = true;
+    }
+
+    work_available_.notify_all();
+
+    for (std::thread& worker : workers_)
+    {
+        worker.join();
+    }
+
+    workers_.clear();
+
+    // NOTE(dhaval): Background jobs nobody waited for are dropped.
+    for (job_entry* job : background_jobs_)
+    {
+        delete job;
+    }
+
+    assert(shared_jobs_.empty() && "Jobs still queued at shutdown");
+
+    background_jobs_.clear();
+    shared_job_count_ = 0;
+    background_job_count_ = 0;
+    threads_.clear();
+
+    if (current_job_system == this)
+    {
+        current_job_system = nullptr;
+        current_thread_index = invalid_thread_index;
+    }
+}
+
+/**
+ * \brief Starts a job.
+ * \param function Work of the job, may start and wait for more jobs.
+ * \param counter Optional, counts the job until it finished.
+ */
+void job_system::run(std::function<void()> function, job_counter* counter)
+{
+    submit(create_job(std::move(function), counter));
+}
+
+/**
+ * \brief Starts a job once every job counted by dependency finished, right away if they already did.
+ * \param dependency Counter to wait for, it must outlive the job.
+ * \param function Work of the job.
+ * \param counter Optional, counts the job from now until it finished.
+ */
+void job_system::run_after(job_counter& dependency, std::function<void()> function, job_counter* counter)
+{
+    job_entry* job = create_job(std::move(function), counter);
+
+    {
+        std::lock_guard<std::mutex> lock(dependency.mutex_);
+
+        if ((dependency.state_.load(std::memory_order_acquire) & counter_pending_mask) != 0)
+        {
+            dependency.continuations_.push_back(job);
+            return;
+        }
+    }
+
+    submit(job);
+}
+
+/**
+ * \brief Starts a long job, e.g. loading a file. It runs on an idle worker, threads waiting for other jobs never pick it up.
+ *        Without workers it runs inline.
+ * \param function Work of the job.
+ * \param counter Optional, counts the job until it finished.
+ */
+void job_system::run_background(std::function<void()> function, job_counter* counter)
+{
+    job_entry* job = create_job(std::move(function), counter);
+
+    if (workers_.empty())
+    {
+        execute(job, get_thread_index(this));
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        background_jobs_.push_back(job);
+        background_job_count_.fetch_add(1, std::memory_order_seq_cst);
+    }
+
+    wake_worker();
+}
+
+/**
+ * \brief Runs other jobs until every job counted by counter finished.
+ * \param counter Counter to wait for.
+ */
+void job_system::wait(job_counter& counter)
+{
+    uint32_t thread_index = get_thread_index(this);
+
+    while (!counter.is_done())
+    {
+        job_entry* job = find_job(thread_index, false);
+
+        if (job != nullptr)
+        {
+            execute(job, thread_index);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+/**
+ * \brief Calls body on consecutive chunks covering [0, count) across the threads, returns once every chunk finished. The range is split lazily:
+ *        a thread only hands out half of what it has left while its own deque is empty, busy threads work through their chunks without making jobs.
+ * \param count Number of items.
+ * \param min_chunk_size Fewest items body is called with, except for the last chunk. Larger for cheaper items.
+ * \param body Called concurrently from several threads with each chunk [first, last).
+ */
+void job_system::parallel_for(uint32_t count, uint32_t min_chunk_size, const std::function<void(uint32_t first, uint32_t last)>& body)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    uint32_t chunk_size = std::max({min_chunk_size, 1u, count / (get_thread_count() * parallel_for_chunks_per_thread)});
+
+    if (workers_.empty() || count <= chunk_size)
+    {
+        body(0, count);
+        return;
+    }
+
+    job_counter counter;
+
+    job_range range;
+    range.body = &body;
+    range.chunk_size = chunk_size;
+    range.counter = &counter;
+
+    run_range(range, 0, count);
+    wait(counter);
+}
+
+/**
+ * \brief Runs task(0) ... task(task_count - 1) as one job each, the calling thread takes task 0. Returns once every task has finished.
+ *        For a few coarse tasks with a fixed split, e.g. one per command buffer, parallel_for() suits large uniform ranges better.
+ * \param task_count Number of tasks.
+ * \param task Function called with the index of each task. Called concurrently from several threads.
+ */
+void job_system::dispatch(uint32_t task_count, const std::function<void(uint32_t)>& task)
+{
+    if (task_count == 0)
+    {
+        return;
+    }
+
+    if (task_count == 1 || workers_.empty())
+    {
+        for (uint32_t i = 0; i < task_count; i++)
+        {
+            task(i);
+        }
+
+        return;
+    }
+
+    job_counter counter;
+
+    for (uint32_t i = 1; i < task_count; i++)
+    {
+        run([&task, i]() { task(i); }, &counter);
+    }
+
+    task(0);
+    wait(counter);
+}
+
+/**
+ * \brief Counters summed over every thread, approximate while jobs run.
+ * \return job_system_statistics
+ */
+job_system_statistics job_system::get_statistics() const
+{
+    job_system_statistics statistics{};
+
+    for (const std::unique_ptr<thread_state>& thread : threads_)
+    {
+        statistics.job_count += thread->job_count.load(std::memory_order_relaxed);
+        statistics.steal_count += thread->steal_count.load(std::memory_order_relaxed);
+    }
+
+    return statistics;
+}
+
+job_entry* job_system::create_job(std::function<void()> function, job_counter* counter)
+{
+    job_entry* job = new job_entry();
+    job->function = std::move(function);
+    job->counter = counter;
+
+    if (counter != nullptr)
+    {
+        counter->state_.fetch_add(1, std::memory_order_acq_rel);
+    }
+
+    return job;
+}
+
+/**
+ * \brief Queues a job on the calling thread's deque, or on the shared queue for threads outside the system.
+ * \param job Job to queue, the system owns it from now on.
+ */
+void job_system::submit(job_entry* job)
+{
+    uint32_t thread_index = get_thread_index(this);
+
+    if (workers_.empty())
+    {
+        execute(job, thread_index);
+        return;
+    }
+
+    if (thread_index != invalid_thread_index)
+    {
+        if (!threads_[thread_index]->deque.push(job))
+        {
+            execute(job, thread_index);
+            return;
+        }
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        shared_jobs_.push_back(job);
+        shared_job_count_.fetch_add(1, std::memory_order_seq_cst);
+    }
+
+    wake_worker();
+}
+
+void job_system::execute(job_entry* job, uint32_t thread_index)
+{
+    if (job->range != nullptr)
+    {
+        run_range(*job->range, job->first, job->last);
+    }
+    else
+    {
+        job->function();
+    }
+
+    if (thread_index != invalid_thread_index)
+    {
+        threads_[thread_index]->job_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    job_counter* counter = job->counter;
+    delete job;
+
+    finish(counter);
+}
+
+/**
+ * \brief Counts a job of counter as finished. The thread finishing the last one starts the jobs that waited for the counter.
+ * \param counter Counter of the job, may be null.
+ */
+void job_system::finish(job_counter* counter)
+{
+    if (counter == nullptr)
+    {
+        return;
+    }
+
+    uint64_t state = counter->state_.load(std::memory_order_relaxed);
+    uint64_t next_state = 0;
+
+    do
+    {
+        next_state = state - 1;
+        if ((state & counter_pending_mask) == 1)
+        {
+            next_state += counter_releasing_one;
+        }
+    } while (!counter->state_.compare_exchange_weak(state, next_state, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+    if ((state & counter_pending_mask) != 1)
+    {
+        return;
+    }
+
+    std::vector<job_entry*> continuations;
+    {
+        std::lock_guard<std::mutex> lock(counter->mutex_);
+        continuations.swap(counter->continuations_);
+    }
+
+    // NOTE(dhaval): Last use of the counter, a waiter may destroy it from here on.
+    counter->state_.fetch_sub(counter_releasing_one, std::memory_order_release);
+
+    for (job_entry* job : continuations)
+    {
+        submit(job);
+    }
+}
+
+/**
+ * \brief Works through a piece of a parallel_for() range chunk by chunk, handing out the upper half whenever the own deque ran empty.
+ * \param range Shared state of the parallel_for().
+ * \param first First item of the piece.
+ * \param last One past the last item of the piece.
+ */
+void job_system::run_range(const job_range& range, uint32_t first, uint32_t last)
+{
+    uint32_t thread_index = get_thread_index(this);
+
+    while (first < last)
+    {
+        while (last - first > range.chunk_size && is_local_queue_empty(thread_index))
+        {
+            uint32_t middle = first + (last - first) / 2;
+
+            job_entry* job = create_job(nullptr, range.counter);
+            job->range = &range;
+            job->first = middle;
+            job->last = last;
+
+            submit(job);
+            last = middle;
+        }
+
+        uint32_t chunk_last = std::min(first + range.chunk_size, last);
+        (*range.body)(first, chunk_last);
+        first = chunk_last;
+    }
+}
+
+/**
+ * \brief Next job for a thread: its own newest job, else the oldest job of another thread, else a shared or, if allowed, a background job.
+ * \param thread_index Index of the calling thread, invalid_thread_index for threads outside the system.
+ * \param background Whether background jobs may be taken.
+ * \return job_entry* Null if nothing was found.
+ */
+job_entry* job_system::find_job(uint32_t thread_index, bool background)
+{
+    uint32_t thread_count = static_cast<uint32_t>(threads_.size());
+    uint32_t first_victim = 0;
+
+    if (thread_index != invalid_thread_index)
+    {
+        thread_state& thread = *threads_[thread_index];
+
+        job_entry* job = thread.deque.pop();
+        if (job != nullptr)
+        {
+            return job;
+        }
+
+        thread.random_state ^= thread.random_state << 13;
+        thread.random_state ^= thread.random_state >> 17;
+        thread.random_state ^= thread.random_state << 5;
+        first_victim = thread.random_state % thread_count;
+    }
+
+    for (uint32_t i = 0; i < thread_count; i++)
+    {
+        uint32_t victim = (first_victim + i) % thread_count;
+        if (victim == thread_index)
+        {
+            continue;
+        }
+
+        job_entry* job = threads_[victim]->deque.steal();
+        if (job != nullptr)
+        {
+            if (thread_index != invalid_thread_index)
+            {
+                threads_[thread_index]->steal_count.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            return job;
+        }
+    }
+
+    bool shared = shared_job_count_.load(std::memory_order_seq_cst) > 0;
+    background = background && background_job_count_.load(std::memory_order_seq_cst) > 0;
+
+    if (!shared && !background)
+    {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+
+    std::deque<job_entry*>* queue = nullptr;
+    std::atomic<uint32_t>* queue_count = nullptr;
+
+    if (!shared_jobs_.empty())
+    {
+        queue = &shared_jobs_;
+        queue_count = &shared_job_count_;
+    }
+    else if (background && !background_jobs_.empty())
+    {
+        queue = &background_jobs_;
+        queue_count = &background_job_count_;
+    }
+    else
+    {
+        return nullptr;
+    }
+
+    job_entry* job = queue->front();
+    queue->pop_front();
+    queue_count->fetch_sub(1, std::memory_order_seq_cst);
+
+    return job;
+}
+
+bool job_system::is_local_queue_empty(uint32_t thread_index) const
+{
+    if (thread_index == invalid_thread_index)
+    {
+        return shared_job_count_.load(std::memory_order_seq_cst) == 0;
+    }
+
+    return threads_[thread_index]->deque.is_empty();
+}
+
+bool job_system::has_queued_jobs() const
+{
+    if (shared_job_count_.load(std::memory_order_seq_cst) > 0 || background_job_count_.load(std::memory_order_seq_cst) > 0)
+    {
+        return true;
+    }
+
+    return std::any_of(threads_.begin(), threads_.end(), [](const std::unique_ptr<thread_state>& thread) { return !thread->deque.is_empty(); });
+}
+
+/**
+ * \brief Wakes a sleeping worker after a job was queued. Queuing and going to sleep both act sequentially consistent on the queue state and
+ *        sleeping_count_, so either the producer sees the sleeper or the worker sees the job before it sleeps.
+ */
+void job_system::wake_worker()
+{
+    if (sleeping_count_.load(std::memory_order_seq_cst) == 0)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        wake_generation_++;
+    }
+
+    work_available_.notify_one();
+}
+
+/**
+ * \brief Worker thread loop. Runs jobs until nothing is left to steal, then sleeps until a job is queued.
+ * \param thread_index Index of the worker's thread_state.
+ */
+void job_system::worker_main(uint32_t thread_index)
+{
+    PBR_PROFILE_THREAD("worker");
+
+    current_job_system = this;
+    current_thread_index = thread_index;
+
+    while (true)
+    {
+        job_entry* job = find_job(thread_index, true);
+
+        if (job != nullptr)
+        {
+            execute(job, thread_index);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+
+        if (stop_)
+        {
+            return;
+        }
+
+        uint64_t generation = wake_generation_;
+        sleeping_count_.fetch_add(1, std::memory_order_seq_cst);
+
+        if (!has_queued_jobs())
+        {
+            work_available_.wait(lock, [this, generation]() { return stop_ || wake_generation_ != generation; });
+        }
+
+        sleeping_count_.fetch_sub(1, std::memory_order_seq_cst);
+    }
+}
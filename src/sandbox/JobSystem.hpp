@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct job_entry;
+struct job_range;
+
+/**
+ * \brief Counts the unfinished jobs started with it. A thread can wait for it to reach zero, job_system::run_after() starts jobs once it does.
+ *        Must outlive its jobs, wait() for it before it goes out of scope.
+ */
+class job_counter
+{
+public:
+    inline bool is_done() const { return state_.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class job_system;
+
+    // NOTE(dhaval): Unfinished jobs in the low 32 bits. The thread finishing the last job also sets the high bits until it released the
+    // continuations, so a waiter can't destroy the counter while that thread still uses it.
+    std::atomic<uint64_t> state_{0};
+
+    std::mutex mutex_;
+    std::vector<job_entry*> continuations_;
+};
+
+/**
+ * \brief Jobs run and threads that stole, summed over every thread.
+ */
+struct job_system_statistics
+{
+    uint64_t job_count{0};
+    uint64_t steal_count{0};
+};
+
+/**
+ * \brief Work stealing job system. Every thread owns a Chase-Lev deque: it pushes and pops jobs at the bottom, idle threads steal from the top.
+ *        The thread calling init() takes part as thread 0 whenever it waits. A job can start more jobs and wait for them, jobs started by
+ *        other threads go through a shared queue. Background jobs, long ones like file loading, only run on idle workers and never inside a
+ *        wait(), so they can't stall a frame that waits for its own short jobs.
+ */
+class job_system
+{
+public:
+    job_system();
+    ~job_system();
+
+    void init(uint32_t worker_count);
+    void shutdown();
+
+    void run(std::function<void()> function, job_counter* counter = nullptr);
+    void run_after(job_counter& dependency, std::function<void()> function, job_counter* counter = nullptr);
+    void run_background(std::function<void()> function, job_counter* counter = nullptr);
+    void wait(job_counter& counter);
+
+    void parallel_for(uint32_t count, uint32_t min_chunk_size, const std::function<void(uint32_t first, uint32_t last)>& body);
+    void dispatch(uint32_t task_count, const std::function<void(uint32_t)>& task);
+
+    inline uint32_t get_worker_count() const { return static_cast<uint32_t>(workers_.size()); }
+    inline uint32_t get_thread_count() const { return get_worker_count() + 1; }
+
+    job_system_statistics get_statistics() const;
+
+private:
+    struct thread_state;
+
+    job_entry* create_job(std::function<void()> function, job_counter* counter);
+    void submit(job_entry* job);
+    void execute(job_entry* job, uint32_t thread_index);
+    void finish(job_counter* counter);
+
+    void run_range(const job_range& range, uint32_t first, uint32_t last);
+    job_entry* find_job(uint32_t thread_index, bool background);
+    bool is_local_queue_empty(uint32_t thread_index) const;
+    bool has_queued_jobs() const;
+    void wake_worker();
+
+    void worker_main(uint32_t thread_index);
+
+private:
+    // NOTE(dhaval): threads_[0] belongs to the thread that called init(), threads_[i] to workers_[i - 1].
+    std::vector<std::unique_ptr<thread_state>> threads_;
+    std::vector<std::thread> workers_;
+
+    // NOTE(dhaval): Jobs started on threads outside the system and background jobs.
+    mutable std::mutex queue_mutex_;
+    std::deque<job_entry*> shared_jobs_;
+    std::deque<job_entry*> background_jobs_;
+    std::atomic<uint32_t> shared_job_count_{0};
+    std::atomic<uint32_t> background_job_count_{0};
+
+    // NOTE(dhaval): Workers sleep once nothing is left to steal. A producer only takes sleep_mutex_ when sleeping_count_ says someone sleeps.
+    std::mutex sleep_mutex_;
+    std::condition_variable work_available_;
+    std::atomic<uint32_t> sleeping_count_{0};
+    uint64_t wake_generation_{0};
+    bool stop_{false};
+};
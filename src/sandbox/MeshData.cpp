@@ -0,0 +1,151 @@
+#include "MeshData.hpp"
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include <cassert>
+#include <iostream>
+
+/**
+ * \brief Adds an Assimp node and everything below it to a scene graph, depth first. A node with several meshes gets one child per extra mesh.
+ * \param scene Scene the node belongs to.
+ * \param node Node to import.
+ * \param parent Scene graph node to attach it to.
+ * \param nodes Scene graph to add to.
+ */
+static void import_node(const aiScene* scene, const aiNode* node, uint32_t parent, scene_graph& nodes)
+{
+    aiVector3D scaling;
+    aiQuaternion rotation;
+    aiVector3D position;
+    node->mTransformation.Decompose(scaling, rotation, position);
+
+    uint32_t mesh_index = node->mNumMeshes > 0 ? node->mMeshes[0] : invalid_scene_index;
+    uint32_t material_index = mesh_index != invalid_scene_index ? scene->mMeshes[mesh_index]->mMaterialIndex : invalid_scene_index;
+
+    uint32_t scene_node = nodes.add_node(parent, glm::vec3(position.x, position.y, position.z), glm::quat(rotation.w, rotation.x, rotation.y, rotation.z),
+                                         glm::vec3(scaling.x, scaling.y, scaling.z), mesh_index, material_index);
+
+    for (unsigned int i = 1; i < node->mNumMeshes; i++)
+    {
+        nodes.add_node(scene_node, glm::vec3(0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f), node->mMeshes[i], scene->mMeshes[node->mMeshes[i]]->mMaterialIndex);
+    }
+
+    for (unsigned int i = 0; i < node->mNumChildren; i++)
+    {
+        import_node(scene, node->mChildren[i], scene_node, nodes);
+    }
+}
+
+/**
+ * \brief Parses a model file and converts its first mesh.
+ * \param path Model file.
+ * \param nodes Optional, receives the node hierarchy of the file.
+ * \return bool
+ */
+bool mesh_data::load_from_file(const std::string& path, scene_graph* nodes)
+{
+    Assimp::Importer importer;
+
+    const aiScene* scene = importer.ReadFile(path, get_import_flags());
+    if (!scene)
+    {
+        std::cerr << importer.GetErrorString() << std::endl;
+        return false;
+    }
+
+    return convert(scene, nodes);
+}
+
+/**
+ * \brief Parses a model held in memory and converts its first mesh.
+ * \param data File contents.
+ * \param size Size of the contents in bytes.
+ * \param format_hint Extension of the file format without the dot, e.g. "obj".
+ * \param nodes Optional, receives the node hierarchy of the file.
+ * \return bool
+ */
+bool mesh_data::load_from_memory(const void* data, size_t size, const char* format_hint, scene_graph* nodes)
+{
+    Assimp::Importer importer;
+
+    const aiScene* scene = importer.ReadFileFromMemory(data, size, get_import_flags(), format_hint);
+    if (!scene)
+    {
+        std::cerr << importer.GetErrorString() << std::endl;
+        return false;
+    }
+
+    return convert(scene, nodes);
+}
+
+/**
+ * \brief Converts the first mesh of a parsed scene to mesh_vertex and 32 bit indices and computes its bounds.
+ * \param scene Scene parsed with get_import_flags(), its faces are triangles.
+ * \param nodes Optional, receives the node hierarchy of the scene.
+ * \return bool False if the scene has no meshes.
+ */
+bool mesh_data::convert(const aiScene* scene, scene_graph* nodes)
+{
+    if (!scene->HasMeshes())
+    {
+        std::cerr << "mesh_data::convert(): model has no meshs" << std::endl;
+        return false;
+    }
+
+    aiMesh* mesh = scene->mMeshes[0];
+    assert(mesh != nullptr && "Mesh is null");
+
+    vertices.resize(mesh->mNumVertices);
+    indices.resize(mesh->mNumFaces * 3);
+
+    aiVector3D* mesh_vertices = mesh->mVertices;
+    aiVector3D* mesh_uvs = mesh->mTextureCoords[0];
+    aiColor4D* mesh_colors = mesh->mColors[0];
+
+    // NOTE(dhaval): One pass over the vertices, each one is written once and in order.
+    for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+    {
+        mesh_vertex& vertex = vertices[i];
+
+        vertex.position = glm::vec3(mesh_vertices[i].x, mesh_vertices[i].y, mesh_vertices[i].z);
+        vertex.uv = mesh_uvs ? glm::vec2(mesh_uvs[i].x, 1.0f - mesh_uvs[i].y) : glm::vec2(0.0f, 0.0f);
+        vertex.color = mesh_colors ? glm::vec3(mesh_colors[i].r, mesh_colors[i].g, mesh_colors[i].b) : glm::vec3(1.0f, 1.0f, 1.0f);
+    }
+
+    aiFace* mesh_faces = mesh->mFaces;
+    unsigned int index = 0;
+    for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+    {
+        for (unsigned int face_index = 0; face_index < mesh_faces[i].mNumIndices; face_index++)
+        {
+            indices[index++] = mesh_faces[i].mIndices[face_index];
+        }
+    }
+
+    bounds = compute_bounding_volume(vertices.data(), vertices.size(), sizeof(mesh_vertex));
+
+    if (nodes != nullptr && scene->mRootNode != nullptr)
+    {
+        nodes->clear();
+        import_node(scene, scene->mRootNode, invalid_scene_index, *nodes);
+    }
+
+    return true;
+}
+
+void mesh_data::clear()
+{
+    vertices.clear();
+    indices.clear();
+}
+
+/**
+ * \brief Post processing steps every model is imported with.
+ * \return unsigned int
+ */
+unsigned int mesh_data::get_import_flags()
+{
+    return aiProcess_CalcTangentSpace | aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_SortByPType;
+}
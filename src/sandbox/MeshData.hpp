@@ -0,0 +1,41 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+#include "BoundingVolume.hpp"
+#include "SceneGraph.hpp"
+
+struct aiScene;
+
+/**
+ * \brief Vertex layout of every mesh the sandbox draws.
+ */
+struct mesh_vertex
+{
+    glm::vec3 position;
+    glm::vec3 color;
+    glm::vec2 uv;
+};
+
+/**
+ * \brief CPU side of a mesh, parsed from a model file and converted to the vertex layout the GPU reads. Needs no Vulkan device,
+ *        vulkan_mesh uploads it and the asset benchmark times it on its own.
+ */
+struct mesh_data
+{
+    std::vector<mesh_vertex> vertices;
+    std::vector<uint32_t> indices;
+
+    // NOTE(dhaval): Object space bounds of the vertices.
+    bounding_volume bounds{};
+
+    bool load_from_file(const std::string& path, scene_graph* nodes = nullptr);
+    bool load_from_memory(const void* data, size_t size, const char* format_hint, scene_graph* nodes = nullptr);
+    bool convert(const aiScene* scene, scene_graph* nodes = nullptr);
+    void clear();
+
+    static unsigned int get_import_flags();
+};
@@ -0,0 +1,563 @@
+#include "OcclusionCuller.hpp"
+#include "CpuFeatures.hpp"
+#include "FrustumCuller.hpp"
+#include "JobSystem.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+// NOTE(dhaval): Tiles are the unit of work of the rasterizer, a multiple of the 8 pixels processed per SIMD iteration.
+static const uint32_t occlusion_tile_size = 32;
+
+// NOTE(dhaval): Below this many objects testing against the depth hierarchy runs on the calling thread only.
+static const uint32_t parallel_occlusion_test_threshold = 4096;
+
+/**
+ * \brief Picks the largest triangles of a mesh, up to a budget, as its occluder. Vertices are never moved or merged, so the occluder covers
+ *        a subset of the pixels the mesh covers at exactly the mesh's depth and can't hide anything the mesh doesn't, holes and thin parts
+ *        included. Dropped triangles only make the culling less effective.
+ * \param positions First position of the source vertices.
+ * \param vertex_count Number of source vertices.
+ * \param stride Distance in bytes between two positions.
+ * \param indices Triangle list of the source mesh.
+ * \param index_count Number of indices.
+ * \param max_triangle_count Most triangles to keep.
+ * \return occluder_mesh
+ */
+occluder_mesh occluder_mesh::simplify(const void* positions, size_t vertex_count, size_t stride, const uint32_t* indices, size_t index_count, uint32_t max_triangle_count)
+{
+    occluder_mesh mesh;
+    if (vertex_count == 0)
+    {
+        return mesh;
+    }
+
+    const unsigned char* bytes = static_cast<const unsigned char*>(positions);
+    auto position = [&](size_t i) -> const glm::vec3& { return *reinterpret_cast<const glm::vec3*>(bytes + i * stride); };
+
+    std::vector<uint32_t> triangles;
+    std::vector<float> triangle_areas(index_count / 3, 0.0f);
+
+    for (size_t i = 0; i + 2 < index_count; i += 3)
+    {
+        if (indices[i] >= vertex_count || indices[i + 1] >= vertex_count || indices[i + 2] >= vertex_count)
+        {
+            continue;
+        }
+
+        const glm::vec3& a = position(indices[i]);
+        glm::vec3 normal = glm::cross(position(indices[i + 1]) - a, position(indices[i + 2]) - a);
+
+        float area_squared = glm::dot(normal, normal);
+        if (area_squared > 0.0f)
+        {
+            triangles.push_back(static_cast<uint32_t>(i / 3));
+            triangle_areas[i / 3] = area_squared;
+        }
+    }
+
+    // NOTE(dhaval): Large triangles cover the most pixels. The kept ones go back into mesh order, which keeps the vertex remap below local.
+    if (triangles.size() > max_triangle_count)
+    {
+        std::nth_element(triangles.begin(), triangles.begin() + max_triangle_count, triangles.end(),
+                         [&](uint32_t a, uint32_t b) { return triangle_areas[a] > triangle_areas[b]; });
+        triangles.resize(max_triangle_count);
+        std::sort(triangles.begin(), triangles.end());
+    }
+
+    std::vector<uint32_t> vertex_remap(vertex_count, UINT32_MAX);
+    mesh.indices.reserve(triangles.size() * 3);
+
+    for (uint32_t triangle : triangles)
+    {
+        for (size_t corner = 0; corner < 3; corner++)
+        {
+            uint32_t vertex = indices[triangle * 3 + corner];
+            if (vertex_remap[vertex] == UINT32_MAX)
+            {
+                vertex_remap[vertex] = static_cast<uint32_t>(mesh.positions.size());
+                mesh.positions.push_back(position(vertex));
+            }
+
+            mesh.indices.push_back(vertex_remap[vertex]);
+        }
+    }
+
+    return mesh;
+}
+
+/**
+ * \brief Allocates the depth buffer and its hierarchy. The size is rounded up to whole tiles.
+ * \param width Width of the depth buffer in pixels.
+ * \param height Height of the depth buffer in pixels.
+ */
+void occlusion_culler::init(uint32_t width, uint32_t height)
+{
+    tile_count_x_ = std::max((width + occlusion_tile_size - 1) / occlusion_tile_size, 1u);
+    tile_count_y_ = std::max((height + occlusion_tile_size - 1) / occlusion_tile_size, 1u);
+    width_ = tile_count_x_ * occlusion_tile_size;
+    height_ = tile_count_y_ * occlusion_tile_size;
+
+    tile_bins_.resize(tile_count_x_ * tile_count_y_);
+
+    depth_levels_.clear();
+    level_widths_.clear();
+    level_heights_.clear();
+
+    uint32_t level_width = width_;
+    uint32_t level_height = height_;
+
+    while (true)
+    {
+        depth_levels_.emplace_back(level_width * level_height, 1.0f);
+        level_widths_.push_back(level_width);
+        level_heights_.push_back(level_height);
+
+        if (level_width == 1 && level_height == 1)
+        {
+            break;
+        }
+
+        level_width = std::max((level_width + 1) / 2, 1u);
+        level_height = std::max((level_height + 1) / 2, 1u);
+    }
+}
+
+/**
+ * \brief Frees the depth buffer, the hierarchy and the occluder triangles.
+ */
+void occlusion_culler::shutdown()
+{
+    triangles_.clear();
+    tile_bins_.clear();
+    depth_levels_.clear();
+    level_widths_.clear();
+    level_heights_.clear();
+    clip_positions_.clear();
+
+    width_ = 0;
+    height_ = 0;
+    tile_count_x_ = 0;
+    tile_count_y_ = 0;
+}
+
+/**
+ * \brief Starts a new frame, drops the occluders of the previous one.
+ * \param view_projection Projection matrix multiplied by the view matrix, [0, 1] clip space depth.
+ */
+void occlusion_culler::begin(const glm::mat4& view_projection)
+{
+    view_projection_ = view_projection;
+
+    triangles_.clear();
+    for (auto& bin : tile_bins_)
+    {
+        bin.clear();
+    }
+}
+
+/**
+ * \brief Projects the triangles of an occluder and bins them into the tiles they overlap.
+ * \param mesh Occluder to add.
+ * \param transform Object to world transform of the occluder.
+ */
+void occlusion_culler::add_occluder(const occluder_mesh& mesh, const glm::mat4& transform)
+{
+    glm::mat4 model_view_projection = view_projection_ * transform;
+
+    clip_positions_.resize(mesh.positions.size());
+    for (size_t i = 0; i < mesh.positions.size(); i++)
+    {
+        clip_positions_[i] = model_view_projection * glm::vec4(mesh.positions[i], 1.0f);
+    }
+
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+    {
+        glm::vec3 screen[3];
+        bool clipped = false;
+
+        for (int corner = 0; corner < 3; corner++)
+        {
+            const glm::vec4& clip = clip_positions_[mesh.indices[i + corner]];
+
+            // NOTE(dhaval): Triangles crossing the near plane are dropped, losing occluder area only makes the result more conservative.
+            if (clip.w <= 0.0f || clip.z < 0.0f)
+            {
+                clipped = true;
+                break;
+            }
+
+            float inverse_w = 1.0f / clip.w;
+            screen[corner] = glm::vec3((clip.x * inverse_w * 0.5f + 0.5f) * width_, (clip.y * inverse_w * 0.5f + 0.5f) * height_, clip.z * inverse_w);
+        }
+
+        if (clipped)
+        {
+            continue;
+        }
+
+        // NOTE(dhaval): Occluders are double sided, flip clockwise triangles so the edge functions are positive inside.
+        float area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) - (screen[2].x - screen[0].x) * (screen[1].y - screen[0].y);
+        if (area == 0.0f)
+        {
+            continue;
+        }
+
+        if (area < 0.0f)
+        {
+            std::swap(screen[1], screen[2]);
+            area = -area;
+        }
+
+        // NOTE(dhaval): Pixels are sampled at their centers.
+        float min_x = std::min({screen[0].x, screen[1].x, screen[2].x});
+        float max_x = std::max({screen[0].x, screen[1].x, screen[2].x});
+        float min_y = std::min({screen[0].y, screen[1].y, screen[2].y});
+        float max_y = std::max({screen[0].y, screen[1].y, screen[2].y});
+
+        raster_triangle triangle;
+        triangle.min_x = std::max(static_cast<int32_t>(std::ceil(min_x - 0.5f)), 0);
+        triangle.max_x = std::min(static_cast<int32_t>(std::floor(max_x - 0.5f)), static_cast<int32_t>(width_) - 1);
+        triangle.min_y = std::max(static_cast<int32_t>(std::ceil(min_y - 0.5f)), 0);
+        triangle.max_y = std::min(static_cast<int32_t>(std::floor(max_y - 0.5f)), static_cast<int32_t>(height_) - 1);
+
+        if (triangle.min_x > triangle.max_x || triangle.min_y > triangle.max_y)
+        {
+            continue;
+        }
+
+        for (int edge = 0; edge < 3; edge++)
+        {
+            const glm::vec3& from = screen[edge];
+            const glm::vec3& to = screen[(edge + 1) % 3];
+
+            triangle.edge_a[edge] = from.y - to.y;
+            triangle.edge_b[edge] = to.x - from.x;
+            triangle.edge_c[edge] = from.x * to.y - from.y * to.x;
+        }
+
+        glm::vec3 edge_1 = screen[1] - screen[0];
+        glm::vec3 edge_2 = screen[2] - screen[0];
+        glm::vec3 normal(edge_1.y * edge_2.z - edge_1.z * edge_2.y, edge_1.z * edge_2.x - edge_1.x * edge_2.z, area);
+
+        triangle.depth_a = -normal.x / normal.z;
+        triangle.depth_b = -normal.y / normal.z;
+        triangle.depth_c = screen[0].z - triangle.depth_a * screen[0].x - triangle.depth_b * screen[0].y;
+
+        uint32_t triangle_index = static_cast<uint32_t>(triangles_.size());
+        triangles_.push_back(triangle);
+
+        for (uint32_t tile_y = triangle.min_y / occlusion_tile_size; tile_y <= triangle.max_y / occlusion_tile_size; tile_y++)
+        {
+            for (uint32_t tile_x = triangle.min_x / occlusion_tile_size; tile_x <= triangle.max_x / occlusion_tile_size; tile_x++)
+            {
+                tile_bins_[tile_y * tile_count_x_ + tile_x].push_back(triangle_index);
+            }
+        }
+    }
+}
+
+/**
+ * \brief Rasterizes every occluder added since begin() and rebuilds the depth hierarchy.
+ * \param jobs Optional job system, tiles are spread across its threads.
+ */
+void occlusion_culler::rasterize(job_system* jobs)
+{
+    uint32_t tile_count = tile_count_x_ * tile_count_y_;
+
+    if (jobs == nullptr)
+    {
+        for (uint32_t tile = 0; tile < tile_count; tile++)
+        {
+            rasterize_tile(tile);
+        }
+    }
+    else
+    {
+        // NOTE(dhaval): Occluders tend to bunch up in a few neighbouring tiles, one tile per chunk lets idle threads steal around the busy ones.
+        jobs->parallel_for(tile_count, 1, [this](uint32_t first_tile, uint32_t last_tile) {
+            for (uint32_t tile = first_tile; tile < last_tile; tile++)
+            {
+                rasterize_tile(tile);
+            }
+        });
+    }
+
+    build_depth_hierarchy();
+}
+
+/**
+ * \brief Tests a world space box against the depth hierarchy.
+ * \param world_bounds Box to test, only center and extent are used.
+ * \return bool False only if the whole box is behind the occluders.
+ */
+bool occlusion_culler::is_visible(const bounding_volume& world_bounds) const
+{
+    glm::vec4 center = view_projection_ * glm::vec4(world_bounds.center, 1.0f);
+    glm::vec4 axis_x = view_projection_[0] * world_bounds.extent.x;
+    glm::vec4 axis_y = view_projection_[1] * world_bounds.extent.y;
+    glm::vec4 axis_z = view_projection_[2] * world_bounds.extent.z;
+
+    // NOTE(dhaval): Corners are kept as separate arrays so the compiler can project all eight at once.
+    float corner_x[8];
+    float corner_y[8];
+    float corner_z[8];
+    float corner_w[8];
+
+    for (int corner = 0; corner < 8; corner++)
+    {
+        float sign_x = (corner & 1) ? 1.0f : -1.0f;
+        float sign_y = (corner & 2) ? 1.0f : -1.0f;
+        float sign_z = (corner & 4) ? 1.0f : -1.0f;
+
+        corner_x[corner] = center.x + sign_x * axis_x.x + sign_y * axis_y.x + sign_z * axis_z.x;
+        corner_y[corner] = center.y + sign_x * axis_x.y + sign_y * axis_y.y + sign_z * axis_z.y;
+        corner_z[corner] = center.z + sign_x * axis_x.z + sign_y * axis_y.z + sign_z * axis_z.z;
+        corner_w[corner] = center.w + sign_x * axis_x.w + sign_y * axis_y.w + sign_z * axis_z.w;
+    }
+
+    float min_w = corner_w[0];
+    float min_clip_z = corner_z[0];
+    for (int corner = 1; corner < 8; corner++)
+    {
+        min_w = std::min(min_w, corner_w[corner]);
+        min_clip_z = std::min(min_clip_z, corner_z[corner]);
+    }
+
+    // NOTE(dhaval): A box reaching in front of the near plane can't be projected, keep it.
+    if (min_w <= 0.0f || min_clip_z < 0.0f)
+    {
+        return true;
+    }
+
+    float min_x = width_;
+    float max_x = 0.0f;
+    float min_y = height_;
+    float max_y = 0.0f;
+    float min_depth = 1.0f;
+
+    for (int corner = 0; corner < 8; corner++)
+    {
+        float inverse_w = 1.0f / corner_w[corner];
+        float screen_x = (corner_x[corner] * inverse_w * 0.5f + 0.5f) * width_;
+        float screen_y = (corner_y[corner] * inverse_w * 0.5f + 0.5f) * height_;
+
+        min_x = std::min(min_x, screen_x);
+        max_x = std::max(max_x, screen_x);
+        min_y = std::min(min_y, screen_y);
+        max_y = std::max(max_y, screen_y);
+        min_depth = std::min(min_depth, corner_z[corner] * inverse_w);
+    }
+
+    // NOTE(dhaval): Truncation instead of floor is fine here, negative coordinates are clamped to the first pixel anyway.
+    int32_t pixel_min_x = std::max(static_cast<int32_t>(std::max(min_x, 0.0f)), 0);
+    int32_t pixel_max_x = std::min(static_cast<int32_t>(std::max(max_x, 0.0f)), static_cast<int32_t>(width_) - 1);
+    int32_t pixel_min_y = std::max(static_cast<int32_t>(std::max(min_y, 0.0f)), 0);
+    int32_t pixel_max_y = std::min(static_cast<int32_t>(std::max(max_y, 0.0f)), static_cast<int32_t>(height_) - 1);
+
+    if (min_x >= width_ || min_y >= height_ || max_x < 0.0f || max_y < 0.0f)
+    {
+        return true;
+    }
+
+    // NOTE(dhaval): Go up the hierarchy until the box covers at most 2x2 texels.
+    uint32_t level = 0;
+    while (level + 1 < depth_levels_.size() && ((pixel_max_x >> level) - (pixel_min_x >> level) > 1 || (pixel_max_y >> level) - (pixel_min_y >> level) > 1))
+    {
+        level++;
+    }
+
+    const float* depth = depth_levels_[level].data();
+    uint32_t level_width = level_widths_[level];
+
+    float max_depth = 0.0f;
+    for (int32_t y = pixel_min_y >> level; y <= (pixel_max_y >> level); y++)
+    {
+        for (int32_t x = pixel_min_x >> level; x <= (pixel_max_x >> level); x++)
+        {
+            max_depth = std::max(max_depth, depth[y * level_width + x]);
+        }
+    }
+
+    return min_depth <= max_depth;
+}
+
+/**
+ * \brief Removes the occluded objects from a list of visible objects, keeping the order of the survivors.
+ * \param bounds World bounds of the objects, indexed by the entries of visible_indices.
+ * \param visible_indices Objects to test, usually the output of frustum_culler::cull(). Receives the objects that are still visible.
+ * \param jobs Optional job system, used for long lists.
+ * \return uint32_t Number of visible objects.
+ */
+uint32_t occlusion_culler::cull(const frustum_culler& bounds, std::vector<uint32_t>& visible_indices, job_system* jobs) const
+{
+    uint32_t object_count = static_cast<uint32_t>(visible_indices.size());
+
+    uint32_t task_count = 1;
+    if (jobs != nullptr && object_count >= parallel_occlusion_test_threshold)
+    {
+        task_count = jobs->get_thread_count();
+    }
+
+    if (task_count <= 1)
+    {
+        uint32_t visible_count = cull_range(bounds, 0, object_count, visible_indices.data());
+        visible_indices.resize(visible_count);
+        return visible_count;
+    }
+
+    // NOTE(dhaval): Every task compacts its own slice in place, the slices are joined afterwards.
+    std::vector<uint32_t> task_visible_counts(task_count, 0);
+
+    auto task_first_object = [&](uint32_t task_index) { return static_cast<uint32_t>(static_cast<uint64_t>(object_count) * task_index / task_count); };
+
+    std::function<void(uint32_t)> test_task = [&](uint32_t task_index) {
+        uint32_t first_object = task_first_object(task_index);
+        uint32_t last_object = task_first_object(task_index + 1);
+
+        task_visible_counts[task_index] = cull_range(bounds, first_object, last_object, visible_indices.data());
+    };
+
+    jobs->dispatch(task_count, test_task);
+
+    uint32_t visible_count = task_visible_counts[0];
+    for (uint32_t i = 1; i < task_count; i++)
+    {
+        memmove(visible_indices.data() + visible_count, visible_indices.data() + task_first_object(i), task_visible_counts[i] * sizeof(uint32_t));
+        visible_count += task_visible_counts[i];
+    }
+
+    visible_indices.resize(visible_count);
+    return visible_count;
+}
+
+/**
+ * \brief Clears a tile and rasterizes the triangles binned into it. Tiles don't share pixels, so tiles can be rasterized concurrently.
+ * \param tile_index Index of the tile, row major.
+ */
+void occlusion_culler::rasterize_tile(uint32_t tile_index)
+{
+    int32_t tile_min_x = static_cast<int32_t>((tile_index % tile_count_x_) * occlusion_tile_size);
+    int32_t tile_min_y = static_cast<int32_t>((tile_index / tile_count_x_) * occlusion_tile_size);
+    int32_t tile_max_x = tile_min_x + occlusion_tile_size - 1;
+    int32_t tile_max_y = tile_min_y + occlusion_tile_size - 1;
+
+    float* depth = depth_levels_[0].data();
+
+    for (int32_t y = tile_min_y; y <= tile_max_y; y++)
+    {
+        std::fill(depth + y * width_ + tile_min_x, depth + y * width_ + tile_max_x + 1, 1.0f);
+    }
+
+    for (uint32_t triangle_index : tile_bins_[tile_index])
+    {
+        const raster_triangle& triangle = triangles_[triangle_index];
+
+        int32_t min_x = std::max(triangle.min_x, tile_min_x);
+        int32_t max_x = std::min(triangle.max_x, tile_max_x);
+        int32_t min_y = std::max(triangle.min_y, tile_min_y);
+        int32_t max_y = std::min(triangle.max_y, tile_max_y);
+
+#if defined(PBR_ENABLE_AVX2)
+        if (cpu_supports_avx2())
+        {
+            rasterize_triangle_avx2(triangle, min_x, min_y, max_x, max_y);
+            continue;
+        }
+#endif
+
+        rasterize_triangle_scalar(triangle, min_x, min_y, max_x, max_y);
+    }
+}
+
+/**
+ * \brief Rasterizes the part of a triangle inside a rectangle of the depth buffer one pixel at a time, keeping the nearest depth.
+ * \param triangle Triangle to rasterize.
+ * \param min_x First column.
+ * \param min_y First row.
+ * \param max_x Last column.
+ * \param max_y Last row.
+ */
+void occlusion_culler::rasterize_triangle_scalar(const raster_triangle& triangle, int32_t min_x, int32_t min_y, int32_t max_x, int32_t max_y)
+{
+    float* depth = depth_levels_[0].data();
+
+    for (int32_t y = min_y; y <= max_y; y++)
+    {
+        float pixel_y = y + 0.5f;
+        float* row = depth + y * width_;
+
+        for (int32_t x = min_x; x <= max_x; x++)
+        {
+            float pixel_x = x + 0.5f;
+
+            float edge_0 = triangle.edge_a[0] * pixel_x + (triangle.edge_b[0] * pixel_y + triangle.edge_c[0]);
+            float edge_1 = triangle.edge_a[1] * pixel_x + (triangle.edge_b[1] * pixel_y + triangle.edge_c[1]);
+            float edge_2 = triangle.edge_a[2] * pixel_x + (triangle.edge_b[2] * pixel_y + triangle.edge_c[2]);
+
+            if (edge_0 >= 0.0f && edge_1 >= 0.0f && edge_2 >= 0.0f)
+            {
+                float pixel_depth = triangle.depth_a * pixel_x + (triangle.depth_b * pixel_y + triangle.depth_c);
+                row[x] = std::min(row[x], pixel_depth);
+            }
+        }
+    }
+}
+
+/**
+ * \brief Rebuilds every level above the depth buffer, each texel keeps the farthest depth of the texels it covers.
+ */
+void occlusion_culler::build_depth_hierarchy()
+{
+    for (size_t level = 1; level < depth_levels_.size(); level++)
+    {
+        const std::vector<float>& source = depth_levels_[level - 1];
+        std::vector<float>& destination = depth_levels_[level];
+
+        uint32_t source_width = level_widths_[level - 1];
+        uint32_t source_height = level_heights_[level - 1];
+
+        for (uint32_t y = 0; y < level_heights_[level]; y++)
+        {
+            uint32_t source_y_0 = y * 2;
+            uint32_t source_y_1 = std::min(source_y_0 + 1, source_height - 1);
+
+            for (uint32_t x = 0; x < level_widths_[level]; x++)
+            {
+                uint32_t source_x_0 = x * 2;
+                uint32_t source_x_1 = std::min(source_x_0 + 1, source_width - 1);
+
+                float depth = std::max(std::max(source[source_y_0 * source_width + source_x_0], source[source_y_0 * source_width + source_x_1]),
+                                       std::max(source[source_y_1 * source_width + source_x_0], source[source_y_1 * source_width + source_x_1]));
+
+                destination[y * level_widths_[level] + x] = depth;
+            }
+        }
+    }
+}
+
+/**
+ * \brief Tests visible_indices[first, last) and compacts the survivors to visible_indices[first, ...).
+ * \param bounds World bounds of the objects.
+ * \param first First entry to test.
+ * \param last One past the last entry to test.
+ * \param visible_indices List being filtered.
+ * \return uint32_t Number of survivors.
+ */
+uint32_t occlusion_culler::cull_range(const frustum_culler& bounds, uint32_t first, uint32_t last, uint32_t* visible_indices) const
+{
+    uint32_t visible_count = 0;
+
+    for (uint32_t i = first; i < last; i++)
+    {
+        uint32_t object = visible_indices[i];
+        if (is_visible(bounds.get_bounds(object)))
+        {
+            visible_indices[first + visible_count++] = object;
+        }
+    }
+
+    return visible_count;
+}
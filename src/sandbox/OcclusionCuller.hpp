@@ -0,0 +1,90 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "BoundingVolume.hpp"
+
+class frustum_culler;
+class job_system;
+
+/**
+ * \brief Low polygon stand in of a mesh, only rasterized into the occlusion depth buffer. Made of the mesh's own triangles so it never covers
+ *        more than the mesh does.
+ */
+struct occluder_mesh
+{
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+
+    static occluder_mesh simplify(const void* positions, size_t vertex_count, size_t stride, const uint32_t* indices, size_t index_count, uint32_t max_triangle_count);
+};
+
+/**
+ * \brief Software occlusion culling. Occluders are rasterized into a small tiled depth buffer, a max depth hierarchy built on top of it
+ *        then rejects bounding boxes that lie entirely behind the occluders.
+ */
+class occlusion_culler
+{
+public:
+    void init(uint32_t width, uint32_t height);
+    void shutdown();
+
+    void begin(const glm::mat4& view_projection);
+    void add_occluder(const occluder_mesh& mesh, const glm::mat4& transform);
+    void rasterize(job_system* jobs = nullptr);
+
+    bool is_visible(const bounding_volume& world_bounds) const;
+    uint32_t cull(const frustum_culler& bounds, std::vector<uint32_t>& visible_indices, job_system* jobs = nullptr) const;
+
+    inline uint32_t get_width() const { return width_; }
+    inline uint32_t get_height() const { return height_; }
+    inline uint32_t get_triangle_count() const { return static_cast<uint32_t>(triangles_.size()); }
+    inline const std::vector<float>& get_depth_buffer() const { return depth_levels_[0]; }
+
+private:
+    /**
+     * \brief Screen space triangle ready for rasterization. Edge functions are positive inside, depth is a plane in screen space.
+     */
+    struct raster_triangle
+    {
+        float edge_a[3];
+        float edge_b[3];
+        float edge_c[3];
+        float depth_a;
+        float depth_b;
+        float depth_c;
+        int32_t min_x;
+        int32_t min_y;
+        int32_t max_x;
+        int32_t max_y;
+    };
+
+    void rasterize_tile(uint32_t tile_index);
+    void rasterize_triangle_avx2(const raster_triangle& triangle, int32_t min_x, int32_t min_y, int32_t max_x, int32_t max_y);
+    void rasterize_triangle_scalar(const raster_triangle& triangle, int32_t min_x, int32_t min_y, int32_t max_x, int32_t max_y);
+    void build_depth_hierarchy();
+    uint32_t cull_range(const frustum_culler& bounds, uint32_t first, uint32_t last, uint32_t* visible_indices) const;
+
+private:
+    uint32_t width_{0};
+    uint32_t height_{0};
+    uint32_t tile_count_x_{0};
+    uint32_t tile_count_y_{0};
+
+    glm::mat4 view_projection_{1.0f};
+
+    std::vector<raster_triangle> triangles_;
+    // NOTE(dhaval): Indices of the triangles overlapping each tile, in submission order.
+    std::vector<std::vector<uint32_t>> tile_bins_;
+
+    // NOTE(dhaval): Level 0 is the depth buffer, every further level keeps the farthest depth of 2x2 texels of the level below.
+    std::vector<std::vector<float>> depth_levels_;
+    std::vector<uint32_t> level_widths_;
+    std::vector<uint32_t> level_heights_;
+
+    std::vector<glm::vec4> clip_positions_;
+};
@@ -0,0 +1,65 @@
+#include "OcclusionCuller.hpp"
+
+// NOTE(dhaval): Only this file is compiled with AVX2 enabled, occlusion_culler::rasterize_tile() calls into it once the CPU reported AVX2 support.
+#if defined(PBR_ENABLE_AVX2)
+
+#include <immintrin.h>
+
+/**
+ * \brief Rasterizes the part of a triangle inside a rectangle of a tile eight pixels of a row at a time, keeping the nearest depth.
+ * \param triangle Triangle to rasterize.
+ * \param min_x First column.
+ * \param min_y First row.
+ * \param max_x Last column.
+ * \param max_y Last row.
+ */
+void occlusion_culler::rasterize_triangle_avx2(const raster_triangle& triangle, int32_t min_x, int32_t min_y, int32_t max_x, int32_t max_y)
+{
+    float* depth = depth_levels_[0].data();
+
+    // NOTE(dhaval): Eight pixels of a row per iteration. Groups start 8 aligned and tiles are a multiple of 8 wide, so groups never leave the tile.
+    //               Pixels of a group outside the triangle's bounds are outside the triangle and fail the edge tests.
+    const __m256 lane_offsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+    const __m256 zero = _mm256_setzero_ps();
+
+    __m256 edge_a_0 = _mm256_set1_ps(triangle.edge_a[0]);
+    __m256 edge_a_1 = _mm256_set1_ps(triangle.edge_a[1]);
+    __m256 edge_a_2 = _mm256_set1_ps(triangle.edge_a[2]);
+    __m256 depth_a = _mm256_set1_ps(triangle.depth_a);
+
+    int32_t first_group_x = min_x & ~7;
+
+    for (int32_t y = min_y; y <= max_y; y++)
+    {
+        float pixel_y = y + 0.5f;
+        __m256 edge_row_0 = _mm256_set1_ps(triangle.edge_b[0] * pixel_y + triangle.edge_c[0]);
+        __m256 edge_row_1 = _mm256_set1_ps(triangle.edge_b[1] * pixel_y + triangle.edge_c[1]);
+        __m256 edge_row_2 = _mm256_set1_ps(triangle.edge_b[2] * pixel_y + triangle.edge_c[2]);
+        __m256 depth_row = _mm256_set1_ps(triangle.depth_b * pixel_y + triangle.depth_c);
+
+        float* row = depth + y * width_;
+
+        for (int32_t x = first_group_x; x <= max_x; x += 8)
+        {
+            __m256 pixel_x = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), lane_offsets);
+
+            __m256 edge_0 = _mm256_add_ps(_mm256_mul_ps(edge_a_0, pixel_x), edge_row_0);
+            __m256 edge_1 = _mm256_add_ps(_mm256_mul_ps(edge_a_1, pixel_x), edge_row_1);
+            __m256 edge_2 = _mm256_add_ps(_mm256_mul_ps(edge_a_2, pixel_x), edge_row_2);
+
+            __m256 inside = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(edge_0, zero, _CMP_GE_OQ), _mm256_cmp_ps(edge_1, zero, _CMP_GE_OQ)), _mm256_cmp_ps(edge_2, zero, _CMP_GE_OQ));
+            if (_mm256_movemask_ps(inside) == 0)
+            {
+                continue;
+            }
+
+            __m256 pixel_depth = _mm256_add_ps(_mm256_mul_ps(depth_a, pixel_x), depth_row);
+            __m256 old_depth = _mm256_loadu_ps(row + x);
+            __m256 new_depth = _mm256_blendv_ps(old_depth, _mm256_min_ps(old_depth, pixel_depth), inside);
+
+            _mm256_storeu_ps(row + x, new_depth);
+        }
+    }
+}
+
+#endif
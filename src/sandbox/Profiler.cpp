@@ -0,0 +1,300 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+std::atomic<bool> profiler::capturing_{false};
+uint32_t profiler::capture_frames_left_ = 0;
+uint32_t profiler::capture_frame_number_ = 0;
+std::string profiler::capture_path_;
+profiler_capture_statistics profiler::capture_statistics_{};
+uint64_t profiler::calibration_ticks_ = 0;
+uint64_t profiler::calibration_ns_ = 0;
+
+std::mutex profiler::thread_buffers_mutex_;
+std::vector<std::unique_ptr<profiler_thread_buffer>> profiler::thread_buffers_;
+
+/**
+ * \brief Current steady_clock time in nanoseconds.
+ * \return uint64_t
+ */
+static uint64_t get_steady_time_ns()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * \brief Writes a string as a JSON string literal.
+ * \param stream Stream to write to.
+ * \param text Text to escape.
+ */
+static void write_json_string(std::ostream& stream, const char* text)
+{
+    stream << '"';
+
+    for (const char* c = text; *c != '\0'; c++)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            stream << '\\' << *c;
+        }
+        else if (static_cast<unsigned char>(*c) < 0x20)
+        {
+            stream << ' ';
+        }
+        else
+        {
+            stream << *c;
+        }
+    }
+
+    stream << '"';
+}
+
+/**
+ * \brief Starts keeping events. Does nothing if a capture is already running.
+ * \param frame_count Number of mark_frame() calls after which the capture ends and is written out, 0 to only end it with end_capture().
+ * \param path File the Chrome trace is written to. Empty to keep the events for write_trace() only.
+ */
+void profiler::begin_capture(uint32_t frame_count, const std::string& path)
+{
+    if (is_capturing())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(thread_buffers_mutex_);
+
+        for (auto& buffer : thread_buffers_)
+        {
+            buffer->capture_begin_count = buffer->write_count.load(std::memory_order_acquire);
+        }
+    }
+
+    if (calibration_ns_ == 0)
+    {
+        calibration_ticks_ = get_ticks();
+        calibration_ns_ = get_steady_time_ns();
+    }
+
+    capture_frames_left_ = frame_count;
+    capture_frame_number_ = 0;
+    capture_path_ = path;
+    capture_statistics_ = {};
+
+    capturing_.store(true, std::memory_order_release);
+}
+
+/**
+ * \brief Stops keeping events and writes the captured ones to the path given to begin_capture().
+ */
+void profiler::end_capture()
+{
+    if (!is_capturing())
+    {
+        return;
+    }
+
+    capturing_.store(false, std::memory_order_release);
+
+    if (capture_path_.empty())
+    {
+        return;
+    }
+
+    std::ofstream file(capture_path_);
+    if (!file.is_open())
+    {
+        std::cout << "profiler: can't open " << capture_path_ << ", capture dropped" << std::endl;
+        return;
+    }
+
+    write_trace(file);
+
+    std::cout << "profiler: captured " << capture_statistics_.frame_count << " frame(s), " << capture_statistics_.event_count << " events from " << capture_statistics_.thread_count
+              << " thread(s) to " << capture_path_ << std::endl;
+
+    if (capture_statistics_.dropped_event_count > 0)
+    {
+        std::cout << "profiler: " << capture_statistics_.dropped_event_count << " events were overwritten, capture fewer frames" << std::endl;
+    }
+}
+
+/**
+ * \brief Marks the end of a frame, ends the capture once it spans the requested number of frames.
+ */
+void profiler::mark_frame()
+{
+    if (!is_capturing())
+    {
+        return;
+    }
+
+    record({"frame", get_ticks(), capture_frame_number_++, profiler_event_type::frame});
+
+    if (capture_frames_left_ != 0 && --capture_frames_left_ == 0)
+    {
+        end_capture();
+    }
+}
+
+/**
+ * \brief Names the calling thread in the trace.
+ * \param name Thread name.
+ */
+void profiler::set_thread_name(const char* name)
+{
+    profiler_thread_buffer& buffer = get_thread_buffer();
+
+    std::lock_guard<std::mutex> lock(thread_buffers_mutex_);
+    buffer.name = name;
+}
+
+/**
+ * \brief Records the value of a counter, shown as a graph in the trace.
+ * \param name Counter name.
+ * \param value Counter value.
+ */
+void profiler::record_counter(const char* name, double value)
+{
+    uint64_t bits = 0;
+    memcpy(&bits, &value, sizeof(bits));
+
+    record({name, get_ticks(), bits, profiler_event_type::counter});
+}
+
+/**
+ * \brief Writes the events of the current or last capture as Chrome trace event JSON. Timestamps are microseconds since the first captured event.
+ *        Must not run while other threads record, call it between frames.
+ * \param stream Stream to write to.
+ */
+void profiler::write_trace(std::ostream& stream)
+{
+    std::lock_guard<std::mutex> lock(thread_buffers_mutex_);
+
+    // NOTE(dhaval): Only the last profiler_thread_event_capacity events of every thread are still in its ring.
+    struct captured_range
+    {
+        const profiler_thread_buffer* buffer;
+        uint64_t first;
+        uint64_t last;
+    };
+
+    std::vector<captured_range> ranges;
+    uint64_t origin_ticks = UINT64_MAX;
+
+    uint64_t elapsed_ticks = get_ticks() - calibration_ticks_;
+    uint64_t elapsed_ns = get_steady_time_ns() - calibration_ns_;
+    double us_per_tick = elapsed_ticks > 0 && elapsed_ns > 0 ? static_cast<double>(elapsed_ns) / elapsed_ticks / 1000.0 : 0.001;
+
+    capture_statistics_.thread_count = 0;
+    capture_statistics_.event_count = 0;
+    capture_statistics_.dropped_event_count = 0;
+    capture_statistics_.frame_count = capture_frame_number_;
+
+    for (auto& buffer : thread_buffers_)
+    {
+        uint64_t last = buffer->write_count.load(std::memory_order_acquire);
+        uint64_t first = std::max(buffer->capture_begin_count, last > profiler_thread_event_capacity ? last - profiler_thread_event_capacity : 0);
+
+        if (first == last)
+        {
+            continue;
+        }
+
+        ranges.push_back({buffer.get(), first, last});
+
+        capture_statistics_.thread_count++;
+        capture_statistics_.event_count += last - first;
+        capture_statistics_.dropped_event_count += first - buffer->capture_begin_count;
+
+        for (uint64_t i = first; i < last; i++)
+        {
+            origin_ticks = std::min(origin_ticks, buffer->events[i % profiler_thread_event_capacity].begin_ticks);
+        }
+    }
+
+    auto write_duration = [&](uint64_t ticks) { stream << std::fixed << std::setprecision(3) << static_cast<double>(ticks) * us_per_tick; };
+
+    stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    bool first_event = true;
+    auto begin_event = [&]() {
+        stream << (first_event ? "\n" : ",\n");
+        first_event = false;
+    };
+
+    for (const captured_range& range : ranges)
+    {
+        const profiler_thread_buffer& buffer = *range.buffer;
+
+        if (!buffer.name.empty())
+        {
+            begin_event();
+            stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << buffer.thread_index << ",\"args\":{\"name\":";
+            write_json_string(stream, buffer.name.c_str());
+            stream << "}}";
+        }
+
+        for (uint64_t i = range.first; i < range.last; i++)
+        {
+            const profiler_event& event = buffer.events[i % profiler_thread_event_capacity];
+
+            begin_event();
+            stream << "{\"name\":";
+
+            switch (event.type)
+            {
+            case profiler_event_type::zone:
+                write_json_string(stream, event.name);
+                stream << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer.thread_index << ",\"ts\":";
+                write_duration(event.begin_ticks - origin_ticks);
+                stream << ",\"dur\":";
+                write_duration(event.end_ticks - event.begin_ticks);
+                stream << "}";
+                break;
+            case profiler_event_type::counter:
+            {
+                double value = 0.0;
+                memcpy(&value, &event.end_ticks, sizeof(value));
+
+                write_json_string(stream, event.name);
+                stream << ",\"ph\":\"C\",\"pid\":0,\"tid\":" << buffer.thread_index << ",\"ts\":";
+                write_duration(event.begin_ticks - origin_ticks);
+                stream << ",\"args\":{\"value\":" << std::defaultfloat << value << "}}";
+                break;
+            }
+            case profiler_event_type::frame:
+                stream << "\"frame " << event.end_ticks << "\",\"ph\":\"i\",\"s\":\"g\",\"pid\":0,\"tid\":" << buffer.thread_index << ",\"ts\":";
+                write_duration(event.begin_ticks - origin_ticks);
+                stream << "}";
+                break;
+            }
+        }
+    }
+
+    stream << "\n]}\n";
+}
+
+/**
+ * \brief Creates and registers the ring buffer of the calling thread, called once per thread on its first event.
+ * \return profiler_thread_buffer*
+ */
+profiler_thread_buffer* profiler::create_thread_buffer()
+{
+    std::lock_guard<std::mutex> lock(thread_buffers_mutex_);
+
+    thread_buffers_.push_back(std::make_unique<profiler_thread_buffer>());
+
+    profiler_thread_buffer* buffer = thread_buffers_.back().get();
+    buffer->thread_index = static_cast<uint32_t>(thread_buffers_.size() - 1);
+
+    // NOTE(dhaval): A thread registered during a capture has all of its events inside it.
+    buffer->capture_begin_count = 0;
+
+    return buffer;
+}
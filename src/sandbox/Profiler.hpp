@@ -0,0 +1,194 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define PBR_PROFILE_HAS_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PBR_PROFILE_HAS_RDTSC 1
+#endif
+
+static const uint32_t profiler_thread_event_capacity = 64 * 1024;
+
+enum class profiler_event_type : uint32_t
+{
+    zone,
+    counter,
+    frame
+};
+
+/**
+ * \brief One recorded event. Names must be string literals or otherwise outlive the profiler, only the pointer is stored.
+ */
+struct profiler_event
+{
+    const char* name{nullptr};
+    uint64_t begin_ticks{0};
+    // NOTE(dhaval): End of a zone, the bits of the double value of a counter, the frame number of a frame marker.
+    uint64_t end_ticks{0};
+    profiler_event_type type{profiler_event_type::zone};
+};
+
+/**
+ * \brief Events of one thread. Only the owning thread writes, write_count is published with release so a reader sees every event before it.
+ */
+struct profiler_thread_buffer
+{
+    std::string name;
+    uint32_t thread_index{0};
+
+    std::unique_ptr<profiler_event[]> events{new profiler_event[profiler_thread_event_capacity]};
+    std::atomic<uint64_t> write_count{0};
+
+    // NOTE(dhaval): write_count when the current capture began, set by the capturing thread.
+    uint64_t capture_begin_count{0};
+};
+
+/**
+ * \brief Summary of the last capture.
+ */
+struct profiler_capture_statistics
+{
+    uint32_t frame_count{0};
+    uint32_t thread_count{0};
+    uint64_t event_count{0};
+    // NOTE(dhaval): Events overwritten because a thread recorded more than profiler_thread_event_capacity during the capture.
+    uint64_t dropped_event_count{0};
+};
+
+/**
+ * \brief Process wide CPU profiler. Every thread records into its own ring buffer without locking, events are only kept while a capture is running.
+ *        A capture spans a number of frames and is written out as Chrome trace event JSON, open it in chrome://tracing or ui.perfetto.dev.
+ *        Use the PBR_PROFILE_* macros, they compile to nothing unless PBR_ENABLE_PROFILER is defined.
+ */
+class profiler
+{
+public:
+    static void begin_capture(uint32_t frame_count, const std::string& path);
+    static void end_capture();
+    static void mark_frame();
+
+    static void set_thread_name(const char* name);
+    static void record_counter(const char* name, double value);
+
+    static inline bool is_capturing() { return capturing_.load(std::memory_order_relaxed); }
+    static inline const profiler_capture_statistics& get_capture_statistics() { return capture_statistics_; }
+
+    static void write_trace(std::ostream& stream);
+
+    /**
+     * \brief Current time in profiler ticks. The time stamp counter where there is one, it costs a fraction of a steady_clock read.
+     *        Ticks are converted to time when the trace is written.
+     * \return uint64_t
+     */
+    static inline uint64_t get_ticks()
+    {
+#if defined(PBR_PROFILE_HAS_RDTSC)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    /**
+     * \brief Appends an event to the calling thread's ring buffer, overwriting the oldest one once it is full.
+     * \param event Event to record.
+     */
+    static inline void record(const profiler_event& event)
+    {
+        profiler_thread_buffer& buffer = get_thread_buffer();
+
+        uint64_t write_count = buffer.write_count.load(std::memory_order_relaxed);
+        buffer.events[write_count % profiler_thread_event_capacity] = event;
+        buffer.write_count.store(write_count + 1, std::memory_order_release);
+    }
+
+private:
+    static inline profiler_thread_buffer& get_thread_buffer()
+    {
+        // NOTE(dhaval): Constant initialized so reading it needs no thread_local guard.
+        thread_local profiler_thread_buffer* buffer = nullptr;
+        if (buffer == nullptr)
+        {
+            buffer = create_thread_buffer();
+        }
+
+        return *buffer;
+    }
+
+    static profiler_thread_buffer* create_thread_buffer();
+
+private:
+    static std::atomic<bool> capturing_;
+    static uint32_t capture_frames_left_;
+    static uint32_t capture_frame_number_;
+    static std::string capture_path_;
+    static profiler_capture_statistics capture_statistics_;
+
+    // NOTE(dhaval): Ticks and steady_clock time of the first capture, the tick rate is measured from there to when the trace is written.
+    static uint64_t calibration_ticks_;
+    static uint64_t calibration_ns_;
+
+    // NOTE(dhaval): Buffers live until the process exits so events of threads that already finished can still be written out.
+    static std::mutex thread_buffers_mutex_;
+    static std::vector<std::unique_ptr<profiler_thread_buffer>> thread_buffers_;
+};
+
+/**
+ * \brief Records the time between its construction and destruction as a zone, if a capture was running when it was constructed.
+ */
+class profiler_zone
+{
+public:
+    explicit profiler_zone(const char* name) : name_(name), begin_ticks_(profiler::is_capturing() ? profiler::get_ticks() : 0)
+    {
+    }
+
+    ~profiler_zone()
+    {
+        if (begin_ticks_ != 0)
+        {
+            profiler::record({name_, begin_ticks_, profiler::get_ticks(), profiler_event_type::zone});
+        }
+    }
+
+    profiler_zone(const profiler_zone&) = delete;
+    profiler_zone& operator=(const profiler_zone&) = delete;
+
+private:
+    const char* name_;
+    uint64_t begin_ticks_;
+};
+
+#define PBR_PROFILE_CONCAT_INNER(a, b) a##b
+#define PBR_PROFILE_CONCAT(a, b) PBR_PROFILE_CONCAT_INNER(a, b)
+
+#if defined(PBR_ENABLE_PROFILER)
+#define PBR_PROFILE_ZONE(name) profiler_zone PBR_PROFILE_CONCAT(profiler_zone_, __LINE__)(name)
+#define PBR_PROFILE_COUNTER(name, value) \
+    do \
+    { \
+        if (profiler::is_capturing()) \
+            profiler::record_counter(name, static_cast<double>(value)); \
+    } while (false)
+#define PBR_PROFILE_FRAME() profiler::mark_frame()
+#define PBR_PROFILE_THREAD(name) profiler::set_thread_name(name)
+#define PBR_PROFILE_BEGIN_CAPTURE(frame_count, path) profiler::begin_capture(frame_count, path)
+#define PBR_PROFILE_END_CAPTURE() profiler::end_capture()
+#else
+#define PBR_PROFILE_ZONE(name) ((void)0)
+#define PBR_PROFILE_COUNTER(name, value) ((void)0)
+#define PBR_PROFILE_FRAME() ((void)0)
+#define PBR_PROFILE_THREAD(name) ((void)0)
+#define PBR_PROFILE_BEGIN_CAPTURE(frame_count, path) ((void)0)
+#define PBR_PROFILE_END_CAPTURE() ((void)0)
+#endif
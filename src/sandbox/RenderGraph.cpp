@@ -0,0 +1,395 @@
+#include "RenderGraph.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+/**
+ * \brief Removes every pass and resource. Call before declaring the graph again, e.g. after the swapchain was resized.
+ */
+void render_graph::reset()
+{
+    resources_.clear();
+    passes_.clear();
+    final_barriers_.clear();
+    memory_blocks_.clear();
+    statistics_ = {};
+}
+
+/**
+ * \brief Adds a resource that lives outside the graph, like a swapchain image. Its memory is never aliased.
+ * \param name Name of the resource, for debugging.
+ * \param initial_usage Usage the resource is in when the graph starts.
+ * \param final_usage Usage the resource is left in when the graph ends, render_graph_usage::undefined to leave it in its last usage.
+ * \return uint32_t Index of the resource.
+ */
+uint32_t render_graph::import_resource(const std::string& name, render_graph_usage initial_usage, render_graph_usage final_usage)
+{
+    resource_node resource;
+    resource.name = name;
+    resource.imported = true;
+    resource.initial_usage = initial_usage;
+    resource.final_usage = final_usage;
+
+    resources_.push_back(resource);
+    return static_cast<uint32_t>(resources_.size() - 1);
+}
+
+/**
+ * \brief Adds a transient resource. It only lives between its first and last access and may share memory with other transient resources.
+ * \param name Name of the resource, for debugging.
+ * \return uint32_t Index of the resource.
+ */
+uint32_t render_graph::create_resource(const std::string& name)
+{
+    resource_node resource;
+    resource.name = name;
+
+    resources_.push_back(resource);
+    return static_cast<uint32_t>(resources_.size() - 1);
+}
+
+/**
+ * \brief Marks a resource as a result of the graph. Passes only survive culling if they contribute to an output.
+ * \param resource Index of the resource.
+ */
+void render_graph::set_output(uint32_t resource)
+{
+    assert(resource < resources_.size() && "Invalid render graph resource");
+    resources_[resource].output = true;
+}
+
+/**
+ * \brief Adds a pass. Passes execute in the order they are added.
+ * \param name Name of the pass, for debugging.
+ * \return uint32_t Index of the pass.
+ */
+uint32_t render_graph::add_pass(const std::string& name)
+{
+    pass_node pass;
+    pass.name = name;
+
+    passes_.push_back(pass);
+    return static_cast<uint32_t>(passes_.size() - 1);
+}
+
+/**
+ * \brief Declares that a pass reads a resource.
+ * \param pass Index of the pass.
+ * \param resource Index of the resource.
+ * \param usage How the pass reads the resource.
+ */
+void render_graph::read(uint32_t pass, uint32_t resource, render_graph_usage usage)
+{
+    render_graph_access access;
+    access.resource = resource;
+    access.usage = usage;
+    access.load_op = render_graph_load_op::load;
+    access.write = false;
+
+    add_access(pass, access);
+}
+
+/**
+ * \brief Declares that a pass writes a resource.
+ * \param pass Index of the pass.
+ * \param resource Index of the resource.
+ * \param usage How the pass writes the resource.
+ * \param load_op render_graph_load_op::load if the pass needs the previous contents, which keeps the passes that wrote them alive.
+ */
+void render_graph::write(uint32_t pass, uint32_t resource, render_graph_usage usage, render_graph_load_op load_op)
+{
+    render_graph_access access;
+    access.resource = resource;
+    access.usage = usage;
+    access.load_op = load_op;
+    access.write = true;
+
+    add_access(pass, access);
+}
+
+/**
+ * \brief Appends an access to a pass. A pass accesses each resource at most once.
+ * \param pass Index of the pass.
+ * \param access Access to append.
+ */
+void render_graph::add_access(uint32_t pass, const render_graph_access& access)
+{
+    assert(pass < passes_.size() && "Invalid render graph pass");
+    assert(access.resource < resources_.size() && "Invalid render graph resource");
+
+    std::vector<render_graph_access>& accesses = passes_[pass].accesses;
+    assert(std::none_of(accesses.begin(), accesses.end(), [&](const render_graph_access& other) { return other.resource == access.resource; }) &&
+           "Render graph pass accesses the same resource twice");
+
+    accesses.push_back(access);
+}
+
+/**
+ * \brief Culls unused passes, assigns memory to the transient resources and places the barriers.
+ * \param get_memory_requirements Called once for every transient resource that survived culling.
+ */
+void render_graph::compile(const std::function<render_graph_memory_requirements(uint32_t)>& get_memory_requirements)
+{
+    statistics_ = {};
+
+    cull_passes();
+    assign_memory(get_memory_requirements);
+    place_barriers();
+
+    statistics_.pass_count = static_cast<uint32_t>(passes_.size());
+    for (const pass_node& pass : passes_)
+    {
+        statistics_.culled_pass_count += pass.culled;
+        statistics_.barrier_count += static_cast<uint32_t>(pass.barriers.size());
+    }
+
+    statistics_.barrier_count += static_cast<uint32_t>(final_barriers_.size());
+}
+
+/**
+ * \brief Walks the passes backwards from the outputs. A pass survives if it writes a resource a later surviving pass or the outside of the graph needs.
+ *        Also decides which writes must be stored and the lifetime of every resource.
+ */
+void render_graph::cull_passes()
+{
+    std::vector<bool> needed(resources_.size());
+    for (size_t i = 0; i < resources_.size(); i++)
+    {
+        needed[i] = resources_[i].output;
+    }
+
+    for (size_t i = passes_.size(); i-- > 0;)
+    {
+        pass_node& pass = passes_[i];
+
+        pass.culled = std::none_of(pass.accesses.begin(), pass.accesses.end(), [&](const render_graph_access& access) { return access.write && needed[access.resource]; });
+        if (pass.culled)
+        {
+            continue;
+        }
+
+        // NOTE(dhaval): Writes that do not load overwrite the resource, the passes before this one no longer need to produce it.
+        for (render_graph_access& access : pass.accesses)
+        {
+            access.store = needed[access.resource];
+            needed[access.resource] = !access.write || access.load_op == render_graph_load_op::load;
+        }
+    }
+
+    for (resource_node& resource : resources_)
+    {
+        resource.first_pass = invalid_render_graph_index;
+        resource.last_pass = invalid_render_graph_index;
+        resource.memory_block = invalid_render_graph_index;
+    }
+
+    for (uint32_t i = 0; i < passes_.size(); i++)
+    {
+        if (passes_[i].culled)
+        {
+            continue;
+        }
+
+        for (const render_graph_access& access : passes_[i].accesses)
+        {
+            resource_node& resource = resources_[access.resource];
+            resource.first_pass = resource.first_pass == invalid_render_graph_index ? i : resource.first_pass;
+            resource.last_pass = i;
+        }
+    }
+}
+
+/**
+ * \brief Places every used transient resource into a memory block. Largest resources go first, each one joins the first compatible block
+ *        whose resources are all dead before it starts or born after it ends.
+ * \param get_memory_requirements Called once for every transient resource that survived culling.
+ */
+void render_graph::assign_memory(const std::function<render_graph_memory_requirements(uint32_t)>& get_memory_requirements)
+{
+    memory_blocks_.clear();
+
+    std::vector<uint32_t> transients;
+    for (uint32_t i = 0; i < resources_.size(); i++)
+    {
+        resource_node& resource = resources_[i];
+        if (resource.imported || resource.first_pass == invalid_render_graph_index)
+        {
+            continue;
+        }
+
+        resource.memory_requirements = get_memory_requirements(i);
+        statistics_.transient_memory_size += resource.memory_requirements.size;
+        transients.push_back(i);
+    }
+
+    std::stable_sort(transients.begin(), transients.end(),
+                     [&](uint32_t a, uint32_t b) { return resources_[a].memory_requirements.size > resources_[b].memory_requirements.size; });
+
+    for (uint32_t index : transients)
+    {
+        resource_node& resource = resources_[index];
+        const render_graph_memory_requirements& requirements = resource.memory_requirements;
+
+        for (uint32_t block_index = 0; block_index < memory_blocks_.size() && resource.memory_block == invalid_render_graph_index; block_index++)
+        {
+            render_graph_memory_block& block = memory_blocks_[block_index];
+            if ((block.memory_type_bits & requirements.memory_type_bits) == 0)
+            {
+                continue;
+            }
+
+            bool overlaps = std::any_of(block.resources.begin(), block.resources.end(), [&](uint32_t other_index) {
+                const resource_node& other = resources_[other_index];
+                return other.first_pass <= resource.last_pass && resource.first_pass <= other.last_pass;
+            });
+
+            if (!overlaps)
+            {
+                block.size = std::max(block.size, requirements.size);
+                block.alignment = std::max(block.alignment, requirements.alignment);
+                block.memory_type_bits &= requirements.memory_type_bits;
+                block.resources.push_back(index);
+
+                resource.memory_block = block_index;
+            }
+        }
+
+        if (resource.memory_block == invalid_render_graph_index)
+        {
+            render_graph_memory_block block;
+            block.size = requirements.size;
+            block.alignment = requirements.alignment;
+            block.memory_type_bits = requirements.memory_type_bits;
+            block.resources.push_back(index);
+
+            resource.memory_block = static_cast<uint32_t>(memory_blocks_.size());
+            memory_blocks_.push_back(block);
+        }
+    }
+
+    statistics_.transient_count = static_cast<uint32_t>(transients.size());
+    statistics_.memory_block_count = static_cast<uint32_t>(memory_blocks_.size());
+    for (const render_graph_memory_block& block : memory_blocks_)
+    {
+        statistics_.allocated_memory_size += block.size;
+    }
+}
+
+/**
+ * \brief Walks the surviving passes in order and places a barrier wherever an access has to wait for the previous one.
+ *        Two reads in the same usage need nothing, anything involving a write or a change of usage (layout) needs a barrier.
+ */
+void render_graph::place_barriers()
+{
+    struct resource_state
+    {
+        render_graph_usage usage{render_graph_usage::undefined};
+        bool write{false};
+        bool touched{false};
+    };
+
+    std::vector<resource_state> states(resources_.size());
+    for (size_t i = 0; i < resources_.size(); i++)
+    {
+        states[i].usage = resources_[i].initial_usage;
+    }
+
+    // NOTE(dhaval): Usage every resource is left in at the end of the graph. Transient memory is shared by the frames in flight, the first
+    // access of a frame has to wait for the last access of the frame before.
+    std::vector<render_graph_usage> last_usages(resources_.size(), render_graph_usage::undefined);
+    for (const pass_node& pass : passes_)
+    {
+        if (!pass.culled)
+        {
+            for (const render_graph_access& access : pass.accesses)
+            {
+                last_usages[access.resource] = access.usage;
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < passes_.size(); i++)
+    {
+        pass_node& pass = passes_[i];
+        pass.barriers.clear();
+
+        if (pass.culled)
+        {
+            continue;
+        }
+
+        for (const render_graph_access& access : pass.accesses)
+        {
+            const resource_node& resource = resources_[access.resource];
+            resource_state& state = states[access.resource];
+
+            render_graph_barrier barrier;
+            barrier.resource = access.resource;
+            barrier.destination_usage = access.usage;
+            barrier.discard = access.write && access.load_op != render_graph_load_op::load;
+
+            if (!resource.imported && !state.touched)
+            {
+                assert(barrier.discard && "Transient render graph resource is read before it is written");
+
+                // NOTE(dhaval): The memory may still be in use by the resource it aliases, wait for that resource's last access instead. Without
+                // one earlier in the graph, the memory was last used at the end of the previous frame, by whichever resource of the block ran last.
+                const std::vector<uint32_t>& block_resources = memory_blocks_[resource.memory_block].resources;
+
+                uint32_t previous_last_pass = 0;
+                bool previous_found = false;
+                for (uint32_t other_index : block_resources)
+                {
+                    const resource_node& other = resources_[other_index];
+                    if (other_index != access.resource && other.last_pass < i && other.last_pass >= previous_last_pass)
+                    {
+                        previous_last_pass = other.last_pass;
+                        previous_found = true;
+                        barrier.source_usage = states[other_index].usage;
+                    }
+                }
+
+                if (!previous_found)
+                {
+                    uint32_t graph_last_pass = 0;
+                    for (uint32_t other_index : block_resources)
+                    {
+                        const resource_node& other = resources_[other_index];
+                        if (other.last_pass != invalid_render_graph_index && other.last_pass >= graph_last_pass)
+                        {
+                            graph_last_pass = other.last_pass;
+                            barrier.source_usage = last_usages[other_index];
+                        }
+                    }
+                }
+
+                pass.barriers.push_back(barrier);
+            }
+            else if (access.usage != state.usage || state.write || access.write)
+            {
+                barrier.source_usage = state.usage;
+                pass.barriers.push_back(barrier);
+            }
+
+            state.usage = access.usage;
+            state.write = access.write;
+            state.touched = true;
+        }
+    }
+
+    final_barriers_.clear();
+    for (uint32_t i = 0; i < resources_.size(); i++)
+    {
+        const resource_node& resource = resources_[i];
+        if (resource.imported && states[i].touched && resource.final_usage != render_graph_usage::undefined && resource.final_usage != states[i].usage)
+        {
+            render_graph_barrier barrier;
+            barrier.resource = i;
+            barrier.source_usage = states[i].usage;
+            barrier.destination_usage = resource.final_usage;
+            barrier.discard = false;
+
+            final_barriers_.push_back(barrier);
+        }
+    }
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+static const uint32_t invalid_render_graph_index = UINT32_MAX;
+
+/**
+ * \brief How a pass uses a resource. Decides the image layout, pipeline stages and access masks of the barriers around the pass.
+ */
+enum class render_graph_usage : uint32_t
+{
+    undefined,
+    color_attachment,
+    depth_attachment,
+    depth_read,
+    shader_read,
+    transfer_source,
+    transfer_destination,
+    present,
+};
+
+/**
+ * \brief What a writing pass does with the previous contents of the resource.
+ */
+enum class render_graph_load_op : uint32_t
+{
+    load,
+    clear,
+    dont_care,
+};
+
+/**
+ * \brief One resource a pass reads or writes. store is filled by render_graph::compile().
+ */
+struct render_graph_access
+{
+    uint32_t resource{invalid_render_graph_index};
+    render_graph_usage usage{render_graph_usage::undefined};
+    render_graph_load_op load_op{render_graph_load_op::load};
+    bool write{false};
+
+    // NOTE(dhaval): A later pass or the outside of the graph needs what this pass leaves in the resource.
+    bool store{true};
+};
+
+/**
+ * \brief Barrier placed before a pass, or at the end of the graph, for one resource.
+ *        source_usage is the previous use of the resource, or of the resource whose memory it aliases. For the first use of a transient
+ *        resource that is the last use of its memory in the previous frame.
+ */
+struct render_graph_barrier
+{
+    uint32_t resource{invalid_render_graph_index};
+    render_graph_usage source_usage{render_graph_usage::undefined};
+    render_graph_usage destination_usage{render_graph_usage::undefined};
+
+    // NOTE(dhaval): The previous contents are not needed, the layout transition may start from undefined.
+    bool discard{false};
+};
+
+/**
+ * \brief Memory a transient resource needs, as reported by vkGetImageMemoryRequirements.
+ */
+struct render_graph_memory_requirements
+{
+    uint64_t size{0};
+    uint64_t alignment{1};
+    uint32_t memory_type_bits{0};
+};
+
+/**
+ * \brief One allocation shared by transient resources whose lifetimes do not overlap. Every resource is placed at offset 0.
+ */
+struct render_graph_memory_block
+{
+    uint64_t size{0};
+    uint64_t alignment{1};
+    uint32_t memory_type_bits{0};
+    std::vector<uint32_t> resources;
+};
+
+/**
+ * \brief Result of the last render_graph::compile().
+ */
+struct render_graph_statistics
+{
+    uint32_t pass_count{0};
+    uint32_t culled_pass_count{0};
+    uint32_t transient_count{0};
+    uint32_t memory_block_count{0};
+    uint32_t barrier_count{0};
+
+    // NOTE(dhaval): Memory the transient resources would need with one allocation each, and what the aliased blocks need.
+    uint64_t transient_memory_size{0};
+    uint64_t allocated_memory_size{0};
+};
+
+/**
+ * \brief Graph of the passes of a frame. Passes are declared in execution order with the resources they read and write.
+ *        compile() culls passes whose results are never used, aliases the memory of transient resources with disjoint lifetimes
+ *        and places the minimal set of barriers between passes. Knows nothing about Vulkan, see vulkan_render_graph.
+ */
+class render_graph
+{
+public:
+    void reset();
+
+    uint32_t import_resource(const std::string& name, render_graph_usage initial_usage, render_graph_usage final_usage);
+    uint32_t create_resource(const std::string& name);
+    void set_output(uint32_t resource);
+
+    uint32_t add_pass(const std::string& name);
+    void read(uint32_t pass, uint32_t resource, render_graph_usage usage);
+    void write(uint32_t pass, uint32_t resource, render_graph_usage usage, render_graph_load_op load_op);
+
+    void compile(const std::function<render_graph_memory_requirements(uint32_t)>& get_memory_requirements);
+
+    inline uint32_t get_pass_count() const { return static_cast<uint32_t>(passes_.size()); }
+    inline const std::string& get_pass_name(uint32_t pass) const { return passes_[pass].name; }
+    inline bool is_pass_culled(uint32_t pass) const { return passes_[pass].culled; }
+    inline const std::vector<render_graph_access>& get_pass_accesses(uint32_t pass) const { return passes_[pass].accesses; }
+    inline const std::vector<render_graph_barrier>& get_pass_barriers(uint32_t pass) const { return passes_[pass].barriers; }
+    inline const std::vector<render_graph_barrier>& get_final_barriers() const { return final_barriers_; }
+
+    inline uint32_t get_resource_count() const { return static_cast<uint32_t>(resources_.size()); }
+    inline const std::string& get_resource_name(uint32_t resource) const { return resources_[resource].name; }
+    inline bool is_resource_imported(uint32_t resource) const { return resources_[resource].imported; }
+    inline uint32_t get_resource_first_pass(uint32_t resource) const { return resources_[resource].first_pass; }
+    inline uint32_t get_resource_last_pass(uint32_t resource) const { return resources_[resource].last_pass; }
+    inline uint32_t get_resource_memory_block(uint32_t resource) const { return resources_[resource].memory_block; }
+
+    inline const std::vector<render_graph_memory_block>& get_memory_blocks() const { return memory_blocks_; }
+    inline const render_graph_statistics& get_statistics() const { return statistics_; }
+
+private:
+    struct resource_node
+    {
+        std::string name;
+        bool imported{false};
+        bool output{false};
+        render_graph_usage initial_usage{render_graph_usage::undefined};
+        render_graph_usage final_usage{render_graph_usage::undefined};
+
+        // NOTE(dhaval): Passes of the first and last access that survived culling, invalid_render_graph_index if none did.
+        uint32_t first_pass{invalid_render_graph_index};
+        uint32_t last_pass{invalid_render_graph_index};
+
+        render_graph_memory_requirements memory_requirements;
+        uint32_t memory_block{invalid_render_graph_index};
+    };
+
+    struct pass_node
+    {
+        std::string name;
+        std::vector<render_graph_access> accesses;
+        std::vector<render_graph_barrier> barriers;
+        bool culled{false};
+    };
+
+    void add_access(uint32_t pass, const render_graph_access& access);
+
+    void cull_passes();
+    void assign_memory(const std::function<render_graph_memory_requirements(uint32_t)>& get_memory_requirements);
+    void place_barriers();
+
+private:
+    std::vector<resource_node> resources_;
+    std::vector<pass_node> passes_;
+
+    std::vector<render_graph_barrier> final_barriers_;
+    std::vector<render_graph_memory_block> memory_blocks_;
+
+    render_graph_statistics statistics_{};
+};
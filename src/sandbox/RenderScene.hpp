@@ -4,8 +4,11 @@
 
 #include <string>
 
+#include "SceneGraph.hpp"
 #include "VulkanRendererContext.hpp"
 #include "VulkanMesh.hpp"
+#include "VulkanResourceLoader.hpp"
+#include "VulkanShaderLibrary.hpp"
 #include "VulkanTexture.hpp"
 
 /**
@@ -14,30 +17,33 @@
 class render_scene
 {
 public:
-    render_scene(const vulkan_renderer_context& vk_renderer_context) : vk_renderer_context_(vk_renderer_context), mesh_(vk_renderer_context), texture_(vk_renderer_context)
+    render_scene(const vulkan_renderer_context& vk_renderer_context) : vk_renderer_context_(vk_renderer_context)
     {
     }
 
-    void init(const std::string& vertex_shader_file, const std::string& fragment_shader_file, const std::string& texture_file, const std::string& model_file);
+    bool init(vulkan_shader_library* shader_library, vulkan_resource_loader* resource_loader, const std::string& vertex_shader_file, const std::string& fragment_shader_file,
+              const std::string& texture_file, const std::string& model_file);
     void shutdown();
 
-    inline VkShaderModule get_vertex_shader() const { return vk_vertex_shader_; };
-    inline VkShaderModule get_fragment_shader() const { return vk_fragment_shader_; };
+    inline VkShaderModule get_vertex_shader() const { return shader_library_->get_module(vertex_shader_); };
+    inline VkShaderModule get_fragment_shader() const { return shader_library_->get_module(fragment_shader_); };
 
-    inline const vulkan_texture& get_texture() const { return texture_; }
-    inline const vulkan_mesh& get_mesh() const { return mesh_; }
+    // NOTE(dhaval): Placeholders until the loader finished the real resources, see vulkan_resource_loader.
+    inline const vulkan_texture& get_texture() const { return resource_loader_->get_texture(texture_); }
+    inline const vulkan_mesh& get_mesh() const { return resource_loader_->get_mesh(mesh_); }
+    inline const scene_graph& get_scene_graph() const { return resource_loader_->get_mesh_nodes(mesh_); }
 
-private:
-    VkShaderModule create_shader(const std::string& path) const;
-
-    void create_vertex_buffer();
-    void create_index_buffer();
+    inline bool is_loaded() const { return resource_loader_->is_ready(texture_) && resource_loader_->is_ready(mesh_); }
 
 private:
     vulkan_renderer_context vk_renderer_context_;
-    vulkan_mesh mesh_;
-    vulkan_texture texture_;
 
-    VkShaderModule vk_vertex_shader_{VK_NULL_HANDLE};
-    VkShaderModule vk_fragment_shader_{VK_NULL_HANDLE};
+    vulkan_resource_loader* resource_loader_{nullptr};
+    uint32_t mesh_{invalid_resource};
+    uint32_t texture_{invalid_resource};
+
+    // NOTE(dhaval): The library owns the modules, they change when a shader is hot reloaded.
+    vulkan_shader_library* shader_library_{nullptr};
+    uint32_t vertex_shader_{invalid_shader};
+    uint32_t fragment_shader_{invalid_shader};
 };
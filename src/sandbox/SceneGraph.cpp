@@ -0,0 +1,276 @@
+#include "SceneGraph.hpp"
+#include "JobSystem.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+// NOTE(dhaval): Below this many nodes the update runs on the calling thread only.
+static const uint32_t parallel_update_threshold = 16 * 1024;
+
+// NOTE(dhaval): The local transform of the node changed since the last update.
+static const uint8_t local_dirty_flag = 1 << 0;
+// NOTE(dhaval): Some node below this one has local_dirty_flag set.
+static const uint8_t descendant_dirty_flag = 1 << 1;
+// NOTE(dhaval): The world transform was rewritten by the update currently running, read by the children.
+static const uint8_t world_changed_flag = 1 << 2;
+
+/**
+ * \brief Builds translation * rotation * scale without going through three full matrix products.
+ * \param translation Local translation.
+ * \param rotation Local rotation, must be normalized.
+ * \param scale Local scale.
+ * \return glm::mat4
+ */
+static inline glm::mat4 compose_local_transform(const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale)
+{
+    glm::mat4 local = glm::mat4_cast(rotation);
+    local[0] *= scale.x;
+    local[1] *= scale.y;
+    local[2] *= scale.z;
+    local[3] = glm::vec4(translation, 1.0f);
+
+    return local;
+}
+
+/**
+ * \brief Product of two affine transforms. Skips the bottom row, which is always (0, 0, 0, 1), so it costs 3 instead of 4 multiply-adds per column.
+ * \param parent Left hand side.
+ * \param local Right hand side.
+ * \return glm::mat4
+ */
+static inline glm::mat4 multiply_affine(const glm::mat4& parent, const glm::mat4& local)
+{
+    glm::mat4 result;
+
+#if defined(__SSE2__) || defined(_M_X64)
+    // NOTE(dhaval): glm stays scalar unless GLM_FORCE_INTRINSICS is set, one SSE register per column is several times faster here.
+    __m128 parent_0 = _mm_loadu_ps(&parent[0][0]);
+    __m128 parent_1 = _mm_loadu_ps(&parent[1][0]);
+    __m128 parent_2 = _mm_loadu_ps(&parent[2][0]);
+    __m128 parent_3 = _mm_loadu_ps(&parent[3][0]);
+
+    for (int i = 0; i < 4; i++)
+    {
+        __m128 column = _mm_add_ps(_mm_add_ps(_mm_mul_ps(parent_0, _mm_set1_ps(local[i][0])), _mm_mul_ps(parent_1, _mm_set1_ps(local[i][1]))),
+                                   _mm_mul_ps(parent_2, _mm_set1_ps(local[i][2])));
+        if (i == 3)
+        {
+            column = _mm_add_ps(column, parent_3);
+        }
+
+        _mm_storeu_ps(&result[i][0], column);
+    }
+#else
+    result[0] = parent[0] * local[0].x + parent[1] * local[0].y + parent[2] * local[0].z;
+    result[1] = parent[0] * local[1].x + parent[1] * local[1].y + parent[2] * local[1].z;
+    result[2] = parent[0] * local[2].x + parent[1] * local[2].y + parent[2] * local[2].z;
+    result[3] = parent[0] * local[3].x + parent[1] * local[3].y + parent[2] * local[3].z + parent[3];
+#endif
+
+    return result;
+}
+
+/**
+ * \brief Adds a node. Nodes must be added depth first: the parent must be the last added node or one of its ancestors.
+ * \param parent Parent node, invalid_scene_index for a root.
+ * \param translation Local translation.
+ * \param rotation Local rotation.
+ * \param scale Local scale.
+ * \param mesh_index Mesh drawn at the node, invalid_scene_index for none.
+ * \param material_index Material of the mesh, invalid_scene_index for none.
+ * \return uint32_t Index of the new node.
+ */
+uint32_t scene_graph::add_node(uint32_t parent, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale, uint32_t mesh_index, uint32_t material_index)
+{
+    uint32_t node = get_node_count();
+
+    if (parent == invalid_scene_index)
+    {
+        roots_.push_back(node);
+    }
+    else
+    {
+        assert(parent < node && subtree_ends_[parent] == node && "Nodes must be added depth first");
+
+        // NOTE(dhaval): Every ancestor of the last added node has its subtree ending at the new node, grow them by one.
+        for (uint32_t ancestor = parent; ancestor != invalid_scene_index; ancestor = parents_[ancestor])
+        {
+            subtree_ends_[ancestor] = node + 1;
+        }
+    }
+
+    parents_.push_back(parent);
+    subtree_ends_.push_back(node + 1);
+    translations_.push_back(translation);
+    rotations_.push_back(rotation);
+    scales_.push_back(scale);
+    world_transforms_.push_back(glm::mat4(1.0f));
+    mesh_indices_.push_back(mesh_index);
+    material_indices_.push_back(material_index);
+    dirty_flags_.push_back(0);
+
+    mark_dirty(node);
+
+    return node;
+}
+
+/**
+ * \brief Copies every node of another graph, its roots become children of parent.
+ * \param other Graph to copy.
+ * \param parent Node to attach the copied roots to, invalid_scene_index to add them as roots.
+ * \return uint32_t Index of the first copied node, node i of other becomes node (first + i).
+ */
+uint32_t scene_graph::append(const scene_graph& other, uint32_t parent)
+{
+    uint32_t first_node = get_node_count();
+
+    for (uint32_t i = 0; i < other.get_node_count(); i++)
+    {
+        uint32_t other_parent = other.parents_[i];
+        uint32_t node_parent = other_parent == invalid_scene_index ? parent : first_node + other_parent;
+
+        add_node(node_parent, other.translations_[i], other.rotations_[i], other.scales_[i], other.mesh_indices_[i], other.material_indices_[i]);
+    }
+
+    return first_node;
+}
+
+/**
+ * \brief Removes every node.
+ */
+void scene_graph::clear()
+{
+    parents_.clear();
+    subtree_ends_.clear();
+    translations_.clear();
+    rotations_.clear();
+    scales_.clear();
+    world_transforms_.clear();
+    mesh_indices_.clear();
+    material_indices_.clear();
+    dirty_flags_.clear();
+    roots_.clear();
+}
+
+/**
+ * \brief Replaces the local transform of a node, its subtree is refreshed by the next update_world_transforms().
+ * \param node Node to move.
+ * \param translation Local translation.
+ * \param rotation Local rotation.
+ * \param scale Local scale.
+ */
+void scene_graph::set_local_transform(uint32_t node, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale)
+{
+    translations_[node] = translation;
+    rotations_[node] = rotation;
+    scales_[node] = scale;
+
+    mark_dirty(node);
+}
+
+/**
+ * \brief Recomputes the world transform of every dirty node and of everything below it.
+ * \param jobs Optional job system, separate roots are updated in parallel for large graphs.
+ */
+void scene_graph::update_world_transforms(job_system* jobs)
+{
+    uint32_t node_count = get_node_count();
+
+    uint32_t task_count = 1;
+    if (jobs != nullptr && node_count >= parallel_update_threshold)
+    {
+        task_count = std::min(jobs->get_thread_count(), static_cast<uint32_t>(roots_.size()));
+    }
+
+    if (task_count <= 1)
+    {
+        update_range(0, node_count);
+        return;
+    }
+
+    // NOTE(dhaval): Tasks get an even share of the nodes, rounded to whole root subtrees so no two tasks touch the same hierarchy.
+    auto task_first_node = [&](uint32_t task_index) {
+        uint32_t target_node = static_cast<uint32_t>(static_cast<uint64_t>(node_count) * task_index / task_count);
+        auto root = std::lower_bound(roots_.begin(), roots_.end(), target_node);
+        return root == roots_.end() ? node_count : *root;
+    };
+
+    std::function<void(uint32_t)> update_task = [&](uint32_t task_index) {
+        update_range(task_first_node(task_index), task_first_node(task_index + 1));
+    };
+
+    jobs->dispatch(task_count, update_task);
+}
+
+/**
+ * \brief Finds the first node that draws a mesh.
+ * \param mesh_index Index of the mesh.
+ * \return uint32_t The node, or invalid_scene_index.
+ */
+uint32_t scene_graph::find_mesh_node(uint32_t mesh_index) const
+{
+    auto node = std::find(mesh_indices_.begin(), mesh_indices_.end(), mesh_index);
+    return node == mesh_indices_.end() ? invalid_scene_index : static_cast<uint32_t>(node - mesh_indices_.begin());
+}
+
+/**
+ * \brief Flags a node and tells its ancestors that their subtree needs a visit. Stops at the first ancestor that already knows.
+ * \param node Node whose local transform changed.
+ */
+void scene_graph::mark_dirty(uint32_t node)
+{
+    dirty_flags_[node] |= local_dirty_flag;
+
+    for (uint32_t ancestor = parents_[node]; ancestor != invalid_scene_index; ancestor = parents_[ancestor])
+    {
+        if (dirty_flags_[ancestor] & descendant_dirty_flag)
+        {
+            break;
+        }
+
+        dirty_flags_[ancestor] |= descendant_dirty_flag;
+    }
+}
+
+/**
+ * \brief Updates the nodes in [first_node, last_node), which must be made of whole root subtrees.
+ * \param first_node First node of the range.
+ * \param last_node One past the last node of the range.
+ */
+void scene_graph::update_range(uint32_t first_node, uint32_t last_node)
+{
+    uint32_t node = first_node;
+
+    while (node < last_node)
+    {
+        uint8_t flags = dirty_flags_[node];
+        uint32_t parent = parents_[node];
+        bool parent_changed = parent != invalid_scene_index && (dirty_flags_[parent] & world_changed_flag);
+
+        // NOTE(dhaval): Nothing moved in or above this subtree, jump over it.
+        if (!parent_changed && (flags & (local_dirty_flag | descendant_dirty_flag)) == 0)
+        {
+            node = subtree_ends_[node];
+            continue;
+        }
+
+        if (parent_changed || (flags & local_dirty_flag))
+        {
+            glm::mat4 local = compose_local_transform(translations_[node], rotations_[node], scales_[node]);
+
+            world_transforms_[node] = parent == invalid_scene_index ? local : multiply_affine(world_transforms_[parent], local);
+            dirty_flags_[node] = world_changed_flag;
+        }
+        else
+        {
+            dirty_flags_[node] = 0;
+        }
+
+        node++;
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+#include <vector>
+
+class job_system;
+
+// NOTE(dhaval): Parent of a root node, and the mesh or material of a node that has none.
+static const uint32_t invalid_scene_index = UINT32_MAX;
+
+/**
+ * \brief Transform hierarchy stored as flat arrays in depth first order, so parents always precede their children and every subtree is a contiguous range.
+ *        World transforms are updated in one linear pass that skips clean subtrees, with separate roots updated in parallel.
+ */
+class scene_graph
+{
+public:
+    uint32_t add_node(uint32_t parent, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale, uint32_t mesh_index = invalid_scene_index,
+                      uint32_t material_index = invalid_scene_index);
+    uint32_t append(const scene_graph& other, uint32_t parent);
+    void clear();
+
+    void set_local_transform(uint32_t node, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale);
+    void update_world_transforms(job_system* jobs = nullptr);
+
+    uint32_t find_mesh_node(uint32_t mesh_index) const;
+
+    inline uint32_t get_node_count() const { return static_cast<uint32_t>(parents_.size()); }
+    inline uint32_t get_parent(uint32_t node) const { return parents_[node]; }
+    inline uint32_t get_subtree_end(uint32_t node) const { return subtree_ends_[node]; }
+    inline uint32_t get_mesh_index(uint32_t node) const { return mesh_indices_[node]; }
+    inline uint32_t get_material_index(uint32_t node) const { return material_indices_[node]; }
+
+    inline const glm::vec3& get_translation(uint32_t node) const { return translations_[node]; }
+    inline const glm::quat& get_rotation(uint32_t node) const { return rotations_[node]; }
+    inline const glm::vec3& get_scale(uint32_t node) const { return scales_[node]; }
+
+    // NOTE(dhaval): Valid after update_world_transforms().
+    inline const glm::mat4& get_world_transform(uint32_t node) const { return world_transforms_[node]; }
+
+    inline const std::vector<uint32_t>& get_roots() const { return roots_; }
+
+private:
+    void mark_dirty(uint32_t node);
+    void update_range(uint32_t first_node, uint32_t last_node);
+
+private:
+    std::vector<uint32_t> parents_;
+    // NOTE(dhaval): One past the last node of the subtree rooted at each node.
+    std::vector<uint32_t> subtree_ends_;
+
+    std::vector<glm::vec3> translations_;
+    std::vector<glm::quat> rotations_;
+    std::vector<glm::vec3> scales_;
+    std::vector<glm::mat4> world_transforms_;
+
+    std::vector<uint32_t> mesh_indices_;
+    std::vector<uint32_t> material_indices_;
+
+    std::vector<uint8_t> dirty_flags_;
+    std::vector<uint32_t> roots_;
+};
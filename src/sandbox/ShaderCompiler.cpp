@@ -0,0 +1,504 @@
+#include "ShaderCompiler.hpp"
+
+#if defined(PBR_ENABLE_SHADER_COMPILER)
+#include <shaderc/shaderc.h>
+#endif
+
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+static const uint32_t spirv_magic_number = 0x07230203;
+
+#if defined(PBR_ENABLE_SHADER_COMPILER)
+
+// NOTE(dhaval): Part of every cache key, bump it when the compile options change so old entries miss.
+static const uint32_t shader_cache_version = 1;
+
+/**
+ * \brief Folds bytes into a 64 bit FNV-1a hash.
+ * \param hash Running hash value.
+ * \param data Bytes to fold into the hash.
+ * \param size Number of bytes.
+ */
+static void hash_bytes(uint64_t& hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+}
+
+/**
+ * \brief Folds a string and its terminator into a hash, so "ab" + "c" and "a" + "bc" hash differently.
+ * \param hash Running hash value.
+ * \param text String to fold into the hash.
+ */
+static void hash_string(uint64_t& hash, const std::string& text)
+{
+    hash_bytes(hash, text.c_str(), text.size() + 1);
+}
+
+/**
+ * \brief Reads a whole text file.
+ * \param path File to read.
+ * \param text Receives the contents.
+ * \return bool False if the file can't be opened.
+ */
+static bool read_text_file(const std::string& path, std::string& text)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    text = buffer.str();
+
+    return true;
+}
+
+/**
+ * \brief Resolves an #include the way the compiler does: "file" relative to the including file, <file> relative to the root shader.
+ * \param requested Name inside the include directive.
+ * \param relative True for "file", false for <file>.
+ * \param including_path File containing the directive.
+ * \param root_path Shader being compiled.
+ * \return std::string
+ */
+static std::string resolve_include(const std::string& requested, bool relative, const std::string& including_path, const std::string& root_path)
+{
+    std::filesystem::path directory = std::filesystem::path(relative ? including_path : root_path).parent_path();
+    return (directory / requested).lexically_normal().generic_string();
+}
+
+/**
+ * \brief Appends a file and everything it includes to the dependency list, depth first and each file once. The scan is textual, an include
+ *        inside an inactive #if still counts, which only makes the cache key depend on a file more than it has to.
+ * \param path File to add.
+ * \param root_path Shader being compiled.
+ * \param dependencies Files found so far, path is appended if it is not there yet.
+ * \param contents Contents of the files in dependencies, in the same order.
+ * \return bool False if a file can't be read.
+ */
+static bool collect_dependencies(const std::string& path, const std::string& root_path, std::vector<std::string>& dependencies, std::vector<std::string>& contents)
+{
+    for (const std::string& dependency : dependencies)
+    {
+        if (dependency == path)
+        {
+            return true;
+        }
+    }
+
+    std::string text;
+    if (!read_text_file(path, text))
+    {
+        std::cerr << "shader_compiler: can't open " << path << std::endl;
+        return false;
+    }
+
+    dependencies.push_back(path);
+    contents.push_back(text);
+
+    std::istringstream lines(text);
+    std::string line;
+
+    while (std::getline(lines, line))
+    {
+        size_t position = line.find_first_not_of(" \t");
+        if (position == std::string::npos || line.compare(position, 8, "#include") != 0)
+        {
+            continue;
+        }
+
+        size_t begin = line.find_first_of("\"<", position + 8);
+        if (begin == std::string::npos)
+        {
+            continue;
+        }
+
+        bool relative = line[begin] == '"';
+        size_t end = line.find(relative ? '"' : '>', begin + 1);
+        if (end == std::string::npos)
+        {
+            continue;
+        }
+
+        std::string include_path = resolve_include(line.substr(begin + 1, end - begin - 1), relative, path, root_path);
+        if (!collect_dependencies(include_path, root_path, dependencies, contents))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * \brief An include handed to shaderc, owns the strings the result points at.
+ */
+struct shader_include
+{
+    std::string name;
+    std::string content;
+    shaderc_include_result result{};
+};
+
+/**
+ * \brief shaderc include resolver. An empty source name tells shaderc the include failed, the content is then the error message.
+ * \param user_data Path of the shader being compiled.
+ * \param requested_source Name inside the include directive.
+ * \param type shaderc_include_type_relative for "file", shaderc_include_type_standard for <file>.
+ * \param requesting_source File containing the directive.
+ * \param include_depth Unused.
+ * \return shaderc_include_result*
+ */
+static shaderc_include_result* resolve_shaderc_include(void* user_data, const char* requested_source, int type, const char* requesting_source, size_t include_depth)
+{
+    const std::string& root_path = *static_cast<const std::string*>(user_data);
+
+    shader_include* include = new shader_include;
+    include->name = resolve_include(requested_source, type == shaderc_include_type_relative, requesting_source, root_path);
+
+    if (!read_text_file(include->name, include->content))
+    {
+        include->content = "can't open " + include->name;
+        include->name.clear();
+    }
+
+    include->result.source_name = include->name.c_str();
+    include->result.source_name_length = include->name.size();
+    include->result.content = include->content.c_str();
+    include->result.content_length = include->content.size();
+    include->result.user_data = include;
+
+    return &include->result;
+}
+
+/**
+ * \brief shaderc include releaser.
+ * \param user_data Unused.
+ * \param include_result Result returned by resolve_shaderc_include().
+ */
+static void release_shaderc_include(void* user_data, shaderc_include_result* include_result)
+{
+    delete static_cast<shader_include*>(include_result->user_data);
+}
+
+#endif
+
+/**
+ * \brief Creates the compiler and the cache directory.
+ * \param cache_directory Directory the compiled SPIR-V is cached in.
+ */
+void shader_compiler::init(const std::string& cache_directory)
+{
+    cache_directory_ = cache_directory;
+    statistics_ = {};
+
+    std::error_code error_code;
+    std::filesystem::create_directories(cache_directory_, error_code);
+
+    if (error_code)
+    {
+        std::cout << "shader_compiler: can't create " << cache_directory_ << ", compiling without a cache: " << error_code.message() << std::endl;
+        cache_directory_.clear();
+    }
+
+#if defined(PBR_ENABLE_SHADER_COMPILER)
+    compiler_ = shaderc_compiler_initialize();
+    assert(compiler_ != nullptr && "Can't initialize shaderc");
+#endif
+}
+
+void shader_compiler::shutdown()
+{
+#if defined(PBR_ENABLE_SHADER_COMPILER)
+    shaderc_compiler_release(compiler_);
+#endif
+
+    compiler_ = nullptr;
+}
+
+/**
+ * \brief Compiles a GLSL shader, or reads it from the cache if its sources and defines were compiled before.
+ * \param path GLSL source file.
+ * \param stage Stage the shader is compiled for.
+ * \param defines Preprocessor macros, "NAME" or "NAME=VALUE".
+ * \param spirv Receives the SPIR-V words.
+ * \param dependencies Receives the files the result depends on, the source followed by everything it includes.
+ * \return bool False if a source can't be read or doesn't compile, the error is printed.
+ */
+bool shader_compiler::compile(const std::string& path, shader_stage stage, const std::vector<std::string>& defines, std::vector<uint32_t>& spirv,
+                              std::vector<std::string>& dependencies)
+{
+    dependencies.clear();
+
+#if defined(PBR_ENABLE_SHADER_COMPILER)
+    std::vector<std::string> contents;
+    if (!collect_dependencies(path, path, dependencies, contents))
+    {
+        statistics_.failure_count++;
+        return false;
+    }
+
+    uint64_t key = 14695981039346656037ull;
+    hash_bytes(key, &shader_cache_version, sizeof(shader_cache_version));
+    hash_bytes(key, &stage, sizeof(stage));
+
+    for (const std::string& define : defines)
+    {
+        hash_string(key, define);
+    }
+
+    for (size_t i = 0; i < dependencies.size(); i++)
+    {
+        hash_string(key, dependencies[i]);
+        hash_string(key, contents[i]);
+    }
+
+    if (read_cache(key, spirv))
+    {
+        statistics_.cache_hit_count++;
+        return true;
+    }
+
+    auto compile_start_time = std::chrono::high_resolution_clock::now();
+    bool compiled = compile_glsl(path, contents[0], stage, defines, spirv);
+    auto compile_end_time = std::chrono::high_resolution_clock::now();
+
+    if (!compiled)
+    {
+        statistics_.failure_count++;
+        return false;
+    }
+
+    statistics_.compile_count++;
+    statistics_.total_compile_ms += std::chrono::duration<double, std::milli>(compile_end_time - compile_start_time).count();
+
+    write_cache(key, spirv);
+
+    return true;
+#else
+    // NOTE(dhaval): Without shaderc the offline compiled file next to the source is loaded, watching it picks up a rebuild.
+    (void)stage;
+
+    dependencies.push_back(get_precompiled_path(path));
+
+    if (!defines.empty())
+    {
+        std::cout << "shader_compiler: defines need a build with PBR_ENABLE_SHADER_COMPILER, ignored for " << dependencies[0] << std::endl;
+    }
+
+    if (!load_precompiled(path, spirv))
+    {
+        statistics_.failure_count++;
+        return false;
+    }
+
+    return true;
+#endif
+}
+
+/**
+ * \brief Whether GLSL is compiled at runtime, false when the build has no shaderc.
+ * \return bool
+ */
+bool shader_compiler::is_available()
+{
+#if defined(PBR_ENABLE_SHADER_COMPILER)
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * \brief Reads the SPIR-V the build compiled offline next to a GLSL source, defines are not applied to it.
+ * \param path GLSL source file.
+ * \param spirv Receives the SPIR-V words.
+ * \return bool False if the file can't be read or is not SPIR-V, the error is printed.
+ */
+bool shader_compiler::load_precompiled(const std::string& path, std::vector<uint32_t>& spirv)
+{
+    std::string spirv_path = get_precompiled_path(path);
+
+    std::ifstream file(spirv_path, std::ios::ate | std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cerr << "shader_compiler: can't open " << spirv_path << std::endl;
+        return false;
+    }
+
+    size_t file_size = static_cast<size_t>(file.tellg());
+    spirv.resize(file_size / sizeof(uint32_t));
+
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(spirv.data()), spirv.size() * sizeof(uint32_t));
+
+    if (file.fail() || file_size % sizeof(uint32_t) != 0 || spirv.empty() || spirv[0] != spirv_magic_number)
+    {
+        std::cerr << "shader_compiler: " << spirv_path << " is not SPIR-V" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * \brief File the build writes the SPIR-V of a GLSL source to, shaders/foo.frag becomes shaders/foo.spv.
+ * \param path GLSL source file.
+ * \return std::string
+ */
+std::string shader_compiler::get_precompiled_path(const std::string& path)
+{
+    return std::filesystem::path(path).replace_extension(".spv").generic_string();
+}
+
+/**
+ * \brief Runs shaderc on a source.
+ * \param path Source file, used for include resolution and in error messages.
+ * \param source Contents of the source file.
+ * \param stage Stage the shader is compiled for.
+ * \param defines Preprocessor macros, "NAME" or "NAME=VALUE".
+ * \param spirv Receives the SPIR-V words.
+ * \return bool False if the shader doesn't compile, the error is printed.
+ */
+bool shader_compiler::compile_glsl(const std::string& path, const std::string& source, shader_stage stage, const std::vector<std::string>& defines, std::vector<uint32_t>& spirv) const
+{
+#if defined(PBR_ENABLE_SHADER_COMPILER)
+    shaderc_compile_options_t options = shaderc_compile_options_initialize();
+    shaderc_compile_options_set_target_env(options, shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_0);
+    shaderc_compile_options_set_optimization_level(options, shaderc_optimization_level_performance);
+    shaderc_compile_options_set_include_callbacks(options, resolve_shaderc_include, release_shaderc_include, const_cast<std::string*>(&path));
+
+    for (const std::string& define : defines)
+    {
+        size_t equals = define.find('=');
+        std::string name = define.substr(0, equals);
+        std::string value = equals == std::string::npos ? std::string() : define.substr(equals + 1);
+
+        shaderc_compile_options_add_macro_definition(options, name.c_str(), name.size(), value.c_str(), value.size());
+    }
+
+    shaderc_shader_kind kind = stage == shader_stage::vertex ? shaderc_vertex_shader : shaderc_fragment_shader;
+    shaderc_compilation_result_t result = shaderc_compile_into_spv(compiler_, source.c_str(), source.size(), kind, path.c_str(), "main", options);
+
+    bool compiled = shaderc_result_get_compilation_status(result) == shaderc_compilation_status_success;
+    if (compiled)
+    {
+        spirv.resize(shaderc_result_get_length(result) / sizeof(uint32_t));
+        memcpy(spirv.data(), shaderc_result_get_bytes(result), spirv.size() * sizeof(uint32_t));
+    }
+    else
+    {
+        std::cerr << "shader_compiler: " << path << " doesn't compile:\n" << shaderc_result_get_error_message(result) << std::endl;
+    }
+
+    shaderc_result_release(result);
+    shaderc_compile_options_release(options);
+
+    return compiled;
+#else
+    (void)path;
+    (void)source;
+    (void)stage;
+    (void)defines;
+    (void)spirv;
+
+    return false;
+#endif
+}
+
+/**
+ * \brief Reads a cached shader. A truncated or foreign file counts as a miss.
+ * \param key Cache key of the shader.
+ * \param spirv Receives the SPIR-V words.
+ * \return bool
+ */
+bool shader_compiler::read_cache(uint64_t key, std::vector<uint32_t>& spirv) const
+{
+    if (cache_directory_.empty())
+    {
+        return false;
+    }
+
+    std::ifstream file(get_cache_path(key), std::ios::ate | std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    size_t file_size = static_cast<size_t>(file.tellg());
+    if (file_size < 5 * sizeof(uint32_t) || file_size % sizeof(uint32_t) != 0)
+    {
+        return false;
+    }
+
+    spirv.resize(file_size / sizeof(uint32_t));
+
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(spirv.data()), file_size);
+
+    return !file.fail() && spirv[0] == spirv_magic_number;
+}
+
+/**
+ * \brief Writes a compiled shader to a temporary file and renames it into the cache, so a crash never leaves a truncated entry behind.
+ * \param key Cache key of the shader.
+ * \param spirv SPIR-V words.
+ */
+void shader_compiler::write_cache(uint64_t key, const std::vector<uint32_t>& spirv) const
+{
+    if (cache_directory_.empty())
+    {
+        return;
+    }
+
+    const std::string path = get_cache_path(key);
+    const std::string temporary_path = path + ".tmp";
+
+    std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        std::cerr << "shader_compiler: can't open " << temporary_path << std::endl;
+        return;
+    }
+
+    file.write(reinterpret_cast<const char*>(spirv.data()), spirv.size() * sizeof(uint32_t));
+    file.close();
+
+    std::error_code error_code;
+    if (!file.fail())
+    {
+        std::filesystem::rename(temporary_path, path, error_code);
+    }
+
+    if (file.fail() || error_code)
+    {
+        std::cerr << "shader_compiler: can't write " << path << std::endl;
+    }
+}
+
+/**
+ * \brief File a cache entry is stored in.
+ * \param key Cache key of the shader.
+ * \return std::string
+ */
+std::string shader_compiler::get_cache_path(uint64_t key) const
+{
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << key << ".spv";
+
+    return (std::filesystem::path(cache_directory_) / name.str()).generic_string();
+}
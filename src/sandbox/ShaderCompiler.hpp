@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct shaderc_compiler;
+
+/**
+ * \brief Pipeline stage a shader is compiled for.
+ */
+enum class shader_stage : uint32_t
+{
+    vertex,
+    fragment
+};
+
+/**
+ * \brief Counters of the shader compiler since it was initialized.
+ */
+struct shader_compiler_statistics
+{
+    uint32_t cache_hit_count{0};
+    uint32_t compile_count{0};
+    uint32_t failure_count{0};
+    double total_compile_ms{0.0};
+};
+
+/**
+ * \brief Compiles GLSL to SPIR-V at runtime with shaderc and keeps the results in an on-disk cache. The cache key hashes the shader source, every file it
+ *        includes and the defines, so a warm start reads SPIR-V without compiling anything and an edit to any of those misses the cache.
+ *        Builds without PBR_ENABLE_SHADER_COMPILER load the SPIR-V the build compiled offline instead.
+ *        Not thread safe, callers compiling from several threads serialize the calls.
+ */
+class shader_compiler
+{
+public:
+    void init(const std::string& cache_directory);
+    void shutdown();
+
+    bool compile(const std::string& path, shader_stage stage, const std::vector<std::string>& defines, std::vector<uint32_t>& spirv, std::vector<std::string>& dependencies);
+
+    inline const shader_compiler_statistics& get_statistics() const { return statistics_; }
+
+    static bool is_available();
+    static bool load_precompiled(const std::string& path, std::vector<uint32_t>& spirv);
+
+private:
+    bool compile_glsl(const std::string& path, const std::string& source, shader_stage stage, const std::vector<std::string>& defines, std::vector<uint32_t>& spirv) const;
+
+    bool read_cache(uint64_t key, std::vector<uint32_t>& spirv) const;
+    void write_cache(uint64_t key, const std::vector<uint32_t>& spirv) const;
+    std::string get_cache_path(uint64_t key) const;
+
+    static std::string get_precompiled_path(const std::string& path);
+
+private:
+    shaderc_compiler* compiler_{nullptr};
+    std::string cache_directory_;
+
+    shader_compiler_statistics statistics_{};
+};
@@ -0,0 +1,114 @@
+#include "ShaderPermutation.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <sstream>
+
+static const char* material_feature_names[material_feature_count] = {"vertex_color", "texture", "alpha_test", "emissive"};
+
+/**
+ * \brief Command line name of a feature.
+ * \param feature_index Bit index of the feature in the material_feature mask.
+ * \return const char*
+ */
+const char* get_material_feature_name(uint32_t feature_index)
+{
+    assert(feature_index < material_feature_count && "Material feature out of range");
+    return material_feature_names[feature_index];
+}
+
+/**
+ * \brief Features of a mask joined with '+', "none" for an empty mask.
+ * \param features Mask of material_feature bits.
+ * \return std::string
+ */
+std::string get_material_features_string(uint32_t features)
+{
+    std::string text;
+
+    for (uint32_t i = 0; i < material_feature_count; i++)
+    {
+        if ((features & (1u << i)) != 0)
+        {
+            text += text.empty() ? "" : "+";
+            text += material_feature_names[i];
+        }
+    }
+
+    return text.empty() ? "none" : text;
+}
+
+/**
+ * \brief Parses a comma separated list of materials, each a '+' separated list of feature names or "none", e.g. "texture+vertex_color,texture+alpha_test".
+ * \param text Text to parse.
+ * \param materials Receives the feature mask of every material.
+ * \return bool False if a feature name is unknown, materials is left untouched.
+ */
+bool parse_material_features(const std::string& text, std::vector<uint32_t>& materials)
+{
+    std::vector<uint32_t> parsed_materials;
+
+    std::stringstream material_stream(text);
+    std::string material;
+
+    while (std::getline(material_stream, material, ','))
+    {
+        uint32_t features = 0;
+
+        std::stringstream feature_stream(material);
+        std::string feature;
+
+        while (std::getline(feature_stream, feature, '+'))
+        {
+            if (feature == "none")
+            {
+                continue;
+            }
+
+            const char* const* name = std::find(std::begin(material_feature_names), std::end(material_feature_names), feature);
+            if (name == std::end(material_feature_names))
+            {
+                return false;
+            }
+
+            features |= 1u << static_cast<uint32_t>(name - std::begin(material_feature_names));
+        }
+
+        parsed_materials.push_back(features);
+    }
+
+    if (parsed_materials.empty())
+    {
+        return false;
+    }
+
+    materials = parsed_materials;
+    return true;
+}
+
+/**
+ * \brief Adds a feature set, or finds the permutation that already has it.
+ * \param features Mask of material_feature bits.
+ * \return uint32_t Index of the permutation.
+ */
+uint32_t shader_permutation_set::add(uint32_t features)
+{
+    // NOTE(dhaval): A scene has a handful of permutations, at most 2^material_feature_count, a linear search beats hashing.
+    auto it = std::find(permutations_.begin(), permutations_.end(), features);
+    if (it != permutations_.end())
+    {
+        return static_cast<uint32_t>(it - permutations_.begin());
+    }
+
+    permutations_.push_back(features);
+    return static_cast<uint32_t>(permutations_.size() - 1);
+}
+
+/**
+ * \brief
+ */
+void shader_permutation_set::clear()
+{
+    permutations_.clear();
+}
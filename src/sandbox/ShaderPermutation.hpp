@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// NOTE(dhaval): Bit i is the boolean specialization constant with constant_id i of the fragment shaders, see shaders/material_features.glsl.
+enum material_feature : uint32_t
+{
+    material_feature_vertex_color = 1u << 0,
+    material_feature_base_color_texture = 1u << 1,
+    material_feature_alpha_test = 1u << 2,
+    material_feature_emissive = 1u << 3,
+};
+
+static const uint32_t material_feature_count = 4;
+static const uint32_t material_feature_all = (1u << material_feature_count) - 1;
+static const uint32_t material_feature_default = material_feature_vertex_color | material_feature_base_color_texture;
+
+const char* get_material_feature_name(uint32_t feature_index);
+std::string get_material_features_string(uint32_t features);
+bool parse_material_features(const std::string& text, std::vector<uint32_t>& materials);
+
+/**
+ * \brief Distinct material feature sets of a scene. Every material adds its features, materials with equal features share a permutation
+ *        and so a pipeline. Permutation indices are dense and go into the pipeline field of the draw keys.
+ */
+class shader_permutation_set
+{
+public:
+    uint32_t add(uint32_t features);
+    void clear();
+
+    inline uint32_t get_features(uint32_t permutation) const { return permutations_[permutation]; }
+    inline uint32_t get_count() const { return static_cast<uint32_t>(permutations_.size()); }
+
+private:
+    std::vector<uint32_t> permutations_;
+};
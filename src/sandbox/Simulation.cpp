@@ -0,0 +1,166 @@
+#include "Simulation.hpp"
+#include "Profiler.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+static const float model_rotation_speed = 0.1f;
+
+static const glm::vec3 camera_target = {0.0f, 0.0f, 0.0f};
+static const glm::vec3 camera_up = {0.0f, 0.0f, 1.0f};
+
+/**
+ * \brief Publishes the snapshot of tick 0, so the render thread has one to draw before the first tick.
+ * \param config Tick rate.
+ */
+void simulation::init(const simulation_config& config)
+{
+    config_ = config;
+    config_.tick_rate = std::max(config_.tick_rate, 1.0);
+
+    statistics_ = {};
+    step_count_ = 0;
+    stop_ = false;
+
+    simulate(0, 0.0);
+}
+
+/**
+ * \brief Stops the simulation thread if it still runs.
+ */
+void simulation::shutdown()
+{
+    stop();
+}
+
+/**
+ * \brief Starts the simulation thread. Tick n is simulated at start_time plus n tick periods, to the time n tick periods after the start.
+ * \param start_time Time tick 0 belongs to.
+ */
+void simulation::start(std::chrono::high_resolution_clock::time_point start_time)
+{
+    assert(!thread_.joinable() && "Simulation thread is already running");
+
+    stop_ = false;
+    thread_ = std::thread(&simulation::simulation_main, this, start_time);
+}
+
+/**
+ * \brief Stops the simulation thread after its current tick. The last published snapshot stays readable.
+ */
+void simulation::stop()
+{
+    if (!thread_.joinable())
+    {
+        return;
+    }
+
+    stop_ = true;
+    thread_.join();
+}
+
+/**
+ * \brief Simulates one tick on the calling thread and publishes it. Only while the simulation thread is stopped.
+ * \param time Simulation time in seconds. Advancing it by a fixed step every frame makes runs draw the same frames.
+ */
+void simulation::step(double time)
+{
+    assert(!thread_.joinable() && "Can't step while the simulation thread is running");
+
+    simulate(++step_count_, time);
+}
+
+/**
+ * \brief Render thread side. Takes the newest published snapshot, or keeps the current one if no tick finished since. Never waits.
+ * \return const simulation_snapshot& Valid until the next call.
+ */
+const simulation_snapshot& simulation::acquire_snapshot()
+{
+    auto acquire_start_time = std::chrono::high_resolution_clock::now();
+    bool fresh = snapshots_.acquire();
+    auto acquire_end_time = std::chrono::high_resolution_clock::now();
+
+    const simulation_snapshot& snapshot = snapshots_.get_read_buffer();
+
+    double wait_ms = std::chrono::duration<double, std::milli>(acquire_end_time - acquire_start_time).count();
+    double age_ms = std::chrono::duration<double, std::milli>(acquire_end_time - snapshot.publish_time).count();
+
+    statistics_.snapshot_count++;
+    statistics_.reused_snapshot_count += fresh ? 0 : 1;
+    statistics_.total_snapshot_wait_ms += wait_ms;
+    statistics_.max_snapshot_wait_ms = std::max(statistics_.max_snapshot_wait_ms, wait_ms);
+    statistics_.total_snapshot_age_ms += age_ms;
+    statistics_.max_snapshot_age_ms = std::max(statistics_.max_snapshot_age_ms, age_ms);
+
+    return snapshot;
+}
+
+/**
+ * \brief Simulation thread. Sleeps until the next tick is due, simulates and publishes it.
+ * \param start_time Time tick 0 belongs to.
+ */
+void simulation::simulation_main(std::chrono::high_resolution_clock::time_point start_time)
+{
+    PBR_PROFILE_THREAD("simulation");
+
+    const std::chrono::duration<double> tick_period(1.0 / config_.tick_rate);
+
+    uint64_t tick = 1;
+    while (!stop_)
+    {
+        auto scheduled_time = start_time + std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(tick_period * static_cast<double>(tick));
+        std::this_thread::sleep_until(scheduled_time);
+
+        auto tick_start_time = std::chrono::high_resolution_clock::now();
+        simulate(tick, static_cast<double>(tick) / config_.tick_rate);
+        auto tick_end_time = std::chrono::high_resolution_clock::now();
+
+        double jitter_ms = std::chrono::duration<double, std::milli>(tick_start_time - scheduled_time).count();
+        double tick_ms = std::chrono::duration<double, std::milli>(tick_end_time - tick_start_time).count();
+
+        statistics_.tick_count++;
+        statistics_.total_tick_jitter_ms += jitter_ms;
+        statistics_.max_tick_jitter_ms = std::max(statistics_.max_tick_jitter_ms, jitter_ms);
+        statistics_.total_tick_ms += tick_ms;
+        statistics_.max_tick_ms = std::max(statistics_.max_tick_ms, tick_ms);
+
+        // NOTE(dhaval): A tick that ran into the next one's slot skips ahead instead of bursting to catch up, the snapshots still land on the
+        // tick grid and the render thread only ever takes the newest one anyway.
+        uint64_t due_tick = static_cast<uint64_t>(std::floor(std::chrono::duration<double>(tick_end_time - start_time) / tick_period)) + 1;
+        if (due_tick > tick + 1)
+        {
+            statistics_.skipped_tick_count += due_tick - tick - 1;
+            tick = due_tick;
+        }
+        else
+        {
+            tick++;
+        }
+    }
+}
+
+/**
+ * \brief Advances the scene to a point in time and publishes the result.
+ * \param tick Tick the snapshot belongs to.
+ * \param time Simulation time in seconds.
+ */
+void simulation::simulate(uint64_t tick, double time)
+{
+    PBR_PROFILE_ZONE("simulation::simulate");
+
+    simulation_snapshot& snapshot = snapshots_.get_write_buffer();
+
+    snapshot.tick = tick;
+    snapshot.time = time;
+
+    snapshot.camera = {};
+    snapshot.camera.view = glm::lookAt(snapshot.camera.position, camera_target, camera_up);
+
+    snapshot.model_rotation = glm::angleAxis(static_cast<float>(time) * model_rotation_speed * glm::radians(90.0f), camera_up);
+
+    snapshot.publish_time = std::chrono::high_resolution_clock::now();
+    snapshots_.publish();
+}
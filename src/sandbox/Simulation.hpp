@@ -0,0 +1,109 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#include "TripleBuffer.hpp"
+
+static const uint64_t invalid_simulation_tick = UINT64_MAX;
+
+/**
+ * \brief Startup options of the simulation.
+ */
+struct simulation_config
+{
+    // NOTE(dhaval): Ticks per second on the simulation thread, independent of the frame rate.
+    double tick_rate{120.0};
+};
+
+/**
+ * \brief Camera the frame is drawn from. The renderer adds the projection, the aspect ratio belongs to the swapchain.
+ */
+struct simulation_camera
+{
+    glm::vec3 position{2.0f, 2.0f, 2.0f};
+    glm::mat4 view{1.0f};
+
+    // NOTE(dhaval): View volume the renderer culls against, nothing outside of it is drawn.
+    float fov_y_degrees{45.0f};
+    float z_near{0.1f};
+    float z_far{10.0f};
+};
+
+/**
+ * \brief Everything the renderer needs from one simulation tick. Immutable once published, the render thread reads it while the simulation
+ *        writes the next one.
+ */
+struct simulation_snapshot
+{
+    uint64_t tick{invalid_simulation_tick};
+    double time{0.0};
+    std::chrono::high_resolution_clock::time_point publish_time{};
+
+    simulation_camera camera;
+
+    // NOTE(dhaval): Rotation of every instance around its grid position.
+    glm::quat model_rotation{1.0f, 0.0f, 0.0f, 0.0f};
+};
+
+/**
+ * \brief Tick timing on the simulation thread and snapshot handoff on the render thread. Ticks that started late count as jitter, ticks
+ *        skipped because one overran count separately. A snapshot's age is the time between its publish and the render thread taking it.
+ */
+struct simulation_statistics
+{
+    uint64_t tick_count{0};
+    uint64_t skipped_tick_count{0};
+    double total_tick_jitter_ms{0.0};
+    double max_tick_jitter_ms{0.0};
+    double total_tick_ms{0.0};
+    double max_tick_ms{0.0};
+
+    uint64_t snapshot_count{0};
+    uint64_t reused_snapshot_count{0};
+    double total_snapshot_wait_ms{0.0};
+    double max_snapshot_wait_ms{0.0};
+    double total_snapshot_age_ms{0.0};
+    double max_snapshot_age_ms{0.0};
+};
+
+/**
+ * \brief Animates the scene on a fixed tick on its own thread and hands every tick to the render thread through a triple buffer, so neither
+ *        thread waits for the other. Deterministic runs skip the thread and step() the simulation on the render thread instead.
+ */
+class simulation
+{
+public:
+    void init(const simulation_config& config);
+    void shutdown();
+
+    void start(std::chrono::high_resolution_clock::time_point start_time);
+    void stop();
+    void step(double time);
+
+    const simulation_snapshot& acquire_snapshot();
+
+    inline const simulation_statistics& get_statistics() const { return statistics_; }
+
+private:
+    void simulation_main(std::chrono::high_resolution_clock::time_point start_time);
+    void simulate(uint64_t tick, double time);
+
+private:
+    simulation_config config_;
+
+    triple_buffer<simulation_snapshot> snapshots_;
+    uint64_t step_count_{0};
+
+    std::thread thread_;
+    std::atomic<bool> stop_{false};
+
+    // NOTE(dhaval): The tick fields belong to the thread calling simulate(), the snapshot fields to the thread calling acquire_snapshot(). Only
+    // read them once the simulation thread stopped.
+    simulation_statistics statistics_;
+};
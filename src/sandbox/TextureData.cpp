@@ -0,0 +1,211 @@
+#include "TextureData.hpp"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <iostream>
+
+static const uint32_t texture_bytes_per_pixel = 4;
+
+/**
+ * \brief Halves a mip level with a 2x2 box filter. An odd last row or column is dropped, like a blit to half the size would.
+ * \param source Pixels of the larger level.
+ * \param source_width Width of the larger level.
+ * \param source_height Height of the larger level.
+ * \param destination Pixels of the smaller level.
+ * \param width Width of the smaller level, max(source_width / 2, 1).
+ * \param height Height of the smaller level, max(source_height / 2, 1).
+ */
+static void downsample_mip(const uint8_t* source, uint32_t source_width, uint32_t source_height, uint8_t* destination, uint32_t width, uint32_t height)
+{
+    // NOTE(dhaval): A level that is one pixel wide or high averages that pixel with itself along the collapsed axis.
+    size_t column_step = source_width > 1 ? 1 : 0;
+    size_t row_step = source_height > 1 ? source_width : 0;
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        const uint8_t* top = source + static_cast<size_t>(y) * 2 * source_width * texture_bytes_per_pixel;
+        uint8_t* row = destination + static_cast<size_t>(y) * width * texture_bytes_per_pixel;
+
+        for (uint32_t x = 0; x < width; x++)
+        {
+            size_t left = static_cast<size_t>(x) * 2;
+            size_t right = left + column_step;
+
+            uint32_t pixels[4];
+            memcpy(&pixels[0], top + left * texture_bytes_per_pixel, sizeof(uint32_t));
+            memcpy(&pixels[1], top + right * texture_bytes_per_pixel, sizeof(uint32_t));
+            memcpy(&pixels[2], top + (left + row_step) * texture_bytes_per_pixel, sizeof(uint32_t));
+            memcpy(&pixels[3], top + (right + row_step) * texture_bytes_per_pixel, sizeof(uint32_t));
+
+            // NOTE(dhaval): Sums two channels at a time in 16 bit lanes of a 32 bit integer, four bytes add up to at most 1020 so the lanes never carry.
+            uint32_t even = 0x00020002;
+            uint32_t odd = 0x00020002;
+            for (uint32_t pixel : pixels)
+            {
+                even += pixel & 0x00ff00ff;
+                odd += (pixel >> 8) & 0x00ff00ff;
+            }
+
+            uint32_t average = ((even >> 2) & 0x00ff00ff) | (((odd >> 2) & 0x00ff00ff) << 8);
+            memcpy(row + static_cast<size_t>(x) * texture_bytes_per_pixel, &average, sizeof(uint32_t));
+        }
+    }
+}
+
+/**
+ * \brief Decodes an image file to RGBA8, whatever its channel count. Only the base level is filled, see generate_mips().
+ * \param path Image file in a format stb_image reads.
+ * \return bool
+ */
+bool texture_data::load_from_file(const std::string& path)
+{
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+
+    // TODO(dhaval): Support other image formats
+    stbi_uc* stb_pixels = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+    if (!stb_pixels)
+    {
+        std::cerr << "texture_data::load_from_file(): " << stbi_failure_reason() << std::endl;
+        return false;
+    }
+
+    set_base_level(stb_pixels, static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+    stbi_image_free(stb_pixels);
+
+    return true;
+}
+
+/**
+ * \brief Decodes an image held in memory to RGBA8. Only the base level is filled, see generate_mips().
+ * \param data File contents.
+ * \param size Size of the contents in bytes.
+ * \return bool
+ */
+bool texture_data::load_from_memory(const void* data, size_t size)
+{
+    if (size > static_cast<size_t>(INT_MAX))
+    {
+        std::cerr << "texture_data::load_from_memory(): image is too large" << std::endl;
+        return false;
+    }
+
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+
+    stbi_uc* stb_pixels = stbi_load_from_memory(static_cast<const stbi_uc*>(data), static_cast<int>(size), &width, &height, &channels, STBI_rgb_alpha);
+    if (!stb_pixels)
+    {
+        std::cerr << "texture_data::load_from_memory(): " << stbi_failure_reason() << std::endl;
+        return false;
+    }
+
+    set_base_level(stb_pixels, static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+    stbi_image_free(stb_pixels);
+
+    return true;
+}
+
+/**
+ * \brief Copies RGBA8 pixels that are already decoded as the base level, see generate_mips().
+ * \param pixels width * height RGBA8 pixels.
+ * \param width Width in pixels.
+ * \param height Height in pixels.
+ */
+void texture_data::load_from_pixels(const uint8_t* pixels, uint32_t width, uint32_t height)
+{
+    set_base_level(pixels, width, height);
+}
+
+/**
+ * \brief Fills every level below the base one, each from the one above it.
+ */
+void texture_data::generate_mips()
+{
+    if (mips_.empty())
+    {
+        return;
+    }
+
+    uint32_t mip_count = get_full_mip_count(width_, height_);
+
+    while (mips_.size() < mip_count)
+    {
+        const texture_mip source = mips_.back();
+
+        texture_mip mip{};
+        mip.width = std::max(source.width / 2, 1u);
+        mip.height = std::max(source.height / 2, 1u);
+        mip.offset = source.offset + source.size;
+        mip.size = static_cast<size_t>(mip.width) * mip.height * texture_bytes_per_pixel;
+
+        downsample_mip(pixels_.data() + source.offset, source.width, source.height, pixels_.data() + mip.offset, mip.width, mip.height);
+
+        mips_.push_back(mip);
+    }
+}
+
+void texture_data::clear()
+{
+    pixels_.clear();
+    pixels_.shrink_to_fit();
+    mips_.clear();
+
+    width_ = 0;
+    height_ = 0;
+}
+
+/**
+ * \brief Number of levels of a full mip chain, down to 1x1.
+ * \param width Width of the base level.
+ * \param height Height of the base level.
+ * \return uint32_t
+ */
+uint32_t texture_data::get_full_mip_count(uint32_t width, uint32_t height)
+{
+    uint32_t mip_count = 1;
+
+    for (uint32_t size = std::max(width, height); size > 1; size /= 2)
+    {
+        mip_count++;
+    }
+
+    return mip_count;
+}
+
+/**
+ * \brief Copies the decoded pixels as the base level and sizes the storage for the full mip chain, so generate_mips() never reallocates.
+ * \param pixels RGBA8 pixels.
+ * \param width Width in pixels.
+ * \param height Height in pixels.
+ */
+void texture_data::set_base_level(const uint8_t* pixels, uint32_t width, uint32_t height)
+{
+    width_ = width;
+    height_ = height;
+
+    size_t chain_size = 0;
+    for (uint32_t level = 0, level_width = width_, level_height = height_; level < get_full_mip_count(width_, height_); level++)
+    {
+        chain_size += static_cast<size_t>(level_width) * level_height * texture_bytes_per_pixel;
+        level_width = std::max(level_width / 2, 1u);
+        level_height = std::max(level_height / 2, 1u);
+    }
+
+    texture_mip base{};
+    base.width = width_;
+    base.height = height_;
+    base.size = static_cast<size_t>(width_) * height_ * texture_bytes_per_pixel;
+
+    pixels_.resize(chain_size);
+    memcpy(pixels_.data(), pixels, base.size);
+
+    mips_.clear();
+    mips_.push_back(base);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * \brief Size of one mip level and where it starts in texture_data's pixels.
+ */
+struct texture_mip
+{
+    uint32_t width{0};
+    uint32_t height{0};
+    size_t offset{0};
+    size_t size{0};
+};
+
+/**
+ * \brief CPU side of a texture, RGBA8 pixels decoded with stb_image followed by their mip chain. The mips are laid out one after the other,
+ *        the way they are staged for upload, so the whole chain is one copy. Needs no Vulkan device, vulkan_texture uploads it and the asset benchmark times it on its own.
+ */
+class texture_data
+{
+public:
+    bool load_from_file(const std::string& path);
+    bool load_from_memory(const void* data, size_t size);
+    void load_from_pixels(const uint8_t* pixels, uint32_t width, uint32_t height);
+
+    void generate_mips();
+    void clear();
+
+    inline uint32_t get_width() const { return width_; }
+    inline uint32_t get_height() const { return height_; }
+    inline uint32_t get_mip_count() const { return static_cast<uint32_t>(mips_.size()); }
+    inline const texture_mip& get_mip(uint32_t level) const { return mips_[level]; }
+    inline const std::vector<texture_mip>& get_mips() const { return mips_; }
+
+    // NOTE(dhaval): Only the bytes of the mips generated so far, pixels_ is sized for the full chain up front.
+    inline const uint8_t* get_pixels() const { return pixels_.data(); }
+    inline size_t get_size() const { return mips_.empty() ? 0 : mips_.back().offset + mips_.back().size; }
+
+    static uint32_t get_full_mip_count(uint32_t width, uint32_t height);
+
+private:
+    void set_base_level(const uint8_t* pixels, uint32_t width, uint32_t height);
+
+private:
+    std::vector<uint8_t> pixels_;
+    std::vector<texture_mip> mips_;
+
+    uint32_t width_{0};
+    uint32_t height_{0};
+};
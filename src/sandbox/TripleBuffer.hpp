@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * \brief Hands values from one writer thread to one reader thread without locks and without either side ever waiting. The writer fills the
+ *        back buffer and publishes it, the reader takes the newest published buffer. Buffers published while the reader holds one are
+ *        overwritten, the reader only ever sees the newest.
+ */
+template <typename T>
+class triple_buffer
+{
+public:
+    /**
+     * \brief Writer side. Buffer to fill before the next publish(), it still holds whatever was written into it two publishes ago.
+     * \return T&
+     */
+    inline T& get_write_buffer() { return buffers_[write_index_]; }
+
+    /**
+     * \brief Writer side. Publishes the write buffer and takes the buffer the reader didn't pick up, or gave back, as the next write buffer.
+     */
+    inline void publish()
+    {
+        uint32_t previous = shared_state_.exchange(write_index_ | fresh_bit, std::memory_order_acq_rel);
+        write_index_ = previous & index_mask;
+    }
+
+    /**
+     * \brief Reader side. Swaps the read buffer for the newest published buffer, if there is one the reader hasn't taken yet.
+     * \return bool True if get_read_buffer() changed.
+     */
+    inline bool acquire()
+    {
+        // NOTE(dhaval): Only the reader clears fresh_bit, a buffer seen as fresh here is still fresh at the exchange.
+        if ((shared_state_.load(std::memory_order_relaxed) & fresh_bit) == 0)
+        {
+            return false;
+        }
+
+        uint32_t previous = shared_state_.exchange(read_index_, std::memory_order_acq_rel);
+        read_index_ = previous & index_mask;
+        return true;
+    }
+
+    /**
+     * \brief Reader side. Buffer taken by the last acquire(), the writer doesn't touch it until the reader acquires another one.
+     * \return const T&
+     */
+    inline const T& get_read_buffer() const { return buffers_[read_index_]; }
+
+private:
+    static const uint32_t index_mask = 0x3;
+    static const uint32_t fresh_bit = 0x4;
+
+    std::array<T, 3> buffers_{};
+
+    // NOTE(dhaval): Index of the buffer between the two threads, plus fresh_bit while it holds a publish the reader hasn't taken. The index
+    // of each side lives on its own cache line so neither thread invalidates the other's line.
+    alignas(64) std::atomic<uint32_t> shared_state_{1};
+    alignas(64) uint32_t write_index_{0};
+    alignas(64) uint32_t read_index_{2};
+};
@@ -1,22 +1,42 @@
 #include "VulkanApplication.hpp"
+#include "VulkanFrameContext.hpp"
+#include "VulkanPipelineCache.hpp"
 #include "VulkanRenderer.hpp"
+#include "VulkanResourceLoader.hpp"
+#include "VulkanShaderLibrary.hpp"
 #include "VulkanUtils.hpp"
 
+#include "Profiler.hpp"
 #include "RenderScene.hpp"
+#include "Simulation.hpp"
 
-#define GLFW_EXPOSE_NATIVE_WIN32
 #include <GLFW/glfw3.h>
-#include <GLFW/glfw3native.h>
 
 #include <iostream>
+#include <algorithm>
 #include <functional>
+#include <fstream>
 #include <set>
+#include <stdexcept>
 #include <array>
+#include <chrono>
+#include <cmath>
+#include <thread>
 
-static std::string vertex_shader_path = "D:/PBR/shaders/vertex_shader.spv";
-static std::string fragment_shader_path = "D:/PBR/shaders/fragment_shader.spv";
-static std::string texture_path = "D:/PBR/textures/chalet.jpg";
-static std::string model_path = "D:/PBR/models/chalet.obj";
+// NOTE(dhaval): Set by CMake, the PBR_ASSET_ROOT cache variable points builds on other machines at their checkout.
+#if !defined(PBR_ASSET_ROOT)
+#define PBR_ASSET_ROOT "D:/PBR"
+#endif
+
+static std::string vertex_shader_path = PBR_ASSET_ROOT "/shaders/vertex_shader.vert";
+static std::string fragment_shader_path = PBR_ASSET_ROOT "/shaders/fragment_shader.frag";
+static std::string bindless_fragment_shader_path = PBR_ASSET_ROOT "/shaders/fragment_shader_bindless.frag";
+static std::string shader_cache_path = PBR_ASSET_ROOT "/shaders/cache";
+static std::string texture_path = PBR_ASSET_ROOT "/textures/chalet.jpg";
+static std::string model_path = PBR_ASSET_ROOT "/models/chalet.obj";
+static std::string pipeline_cache_path = PBR_ASSET_ROOT "/pipeline_cache.bin";
+
+static const uint64_t headless_frame_count = 100;
 
 /**
  * \brief Callback Function for our debug messenger that the validation layers use.
@@ -38,32 +58,124 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debug_callback(VkDebugUtilsMessageSeverity
 
 
 std::vector<const char*> application::vk_required_physical_device_extensions_ = {VK_KHR_SWAPCHAIN_EXTENSION_NAME,};
+std::vector<const char*> application::vk_optional_physical_device_extensions_ = {VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME,};
 std::vector<const char*> application::vk_required_validation_layers_ = {"VK_LAYER_KHRONOS_validation",};
 
+/**
+ * \brief Stores the startup options. Nothing is created until run() is called.
+ * \param config Startup options parsed from the command line.
+ */
+application::application(const application_config& config) : config_(config)
+{
+    max_frames_in_flight_ = std::clamp(config_.frames_in_flight, 1u, 4u);
+
+    renderer_config_.record_thread_count = std::max(config_.record_thread_count, 1u);
+    renderer_config_.draw_count = std::max(config_.draw_count, 1u);
+    renderer_config_.instance_count = std::max(config_.instance_count, 1u);
+    renderer_config_.indirect_draws = config_.indirect_draws;
+    renderer_config_.frustum_culling = config_.frustum_culling;
+    renderer_config_.occluder_count = config_.occluder_count;
+    renderer_config_.bindless_textures = config_.bindless_textures;
+    // NOTE(dhaval): The GPU frame time of a benchmark comes from the profiler.
+    renderer_config_.gpu_profiling = config_.gpu_profiling || config_.gpu_pipeline_statistics || config_.benchmark_frame_count > 0;
+    renderer_config_.gpu_pipeline_statistics = config_.gpu_pipeline_statistics;
+
+    if (!config_.material_features.empty())
+    {
+        renderer_config_.material_features = config_.material_features;
+    }
+}
+
 /**
  * \brief Does what the name says. It runs our application. (Manages the creation and destruction of our applications state)
  */
 void application::run()
 {
-    init_window();
+    if (!config_.headless)
+    {
+        init_window();
+    }
+
+    init_job_system();
     init_vulkan();
-    init_vulkan_swapchain();
+    init_frame_contexts();
+
+    if (config_.headless)
+    {
+        init_offscreen_targets();
+    }
+    else
+    {
+        init_vulkan_swapchain();
+    }
+
     init_render_scene();
     init_renderer();
+    init_simulation();
     main_loop();
+
+    if (config_.headless && !config_.output_image_path.empty() && frame_number_ > 0)
+    {
+        save_offscreen_image(config_.output_image_path);
+    }
+
+    shutdown_simulation();
     shutdown_renderer();
     shutdown_render_scene();
-    shutdown_vulkan_swapchain();
+
+    if (config_.headless)
+    {
+        shutdown_offscreen_targets();
+    }
+    else
+    {
+        shutdown_vulkan_swapchain();
+    }
+
+    shutdown_frame_contexts();
     shutdown_vulkan();
-    shutdown_window();
+    shutdown_job_system();
+
+    if (window_)
+    {
+        shutdown_window();
+    }
 }
 
 void application::render()
 {
-    vkWaitForFences(vk_device_, 1, &vk_in_flight_fences_[current_frame_], VK_TRUE, std::numeric_limits<uint64_t>::max());
+    PBR_PROFILE_ZONE("application::render");
+
+    vulkan_frame_context& frame = *frame_contexts_[current_frame_];
+
+    auto wait_start_time = std::chrono::high_resolution_clock::now();
+    {
+        PBR_PROFILE_ZONE("fence wait");
+        frame.wait();
+    }
+    auto wait_end_time = std::chrono::high_resolution_clock::now();
+
+    double wait_ms = std::chrono::duration<double, std::milli>(wait_end_time - wait_start_time).count();
+    total_fence_wait_ms_ += wait_ms;
+    max_fence_wait_ms_ = std::max(max_fence_wait_ms_, wait_ms);
+    last_fence_wait_ms_ = wait_ms;
+
+    destroy_retired_swapchains(false);
+
+    // NOTE(dhaval): Headless targets belong to the frames in flight, the frame's fence already guarantees its target is free.
+    uint32_t image_index = static_cast<uint32_t>(current_frame_);
+    VkResult result = VK_SUCCESS;
+
+    if (!config_.headless)
+    {
+        PBR_PROFILE_ZONE("vkAcquireNextImageKHR");
 
-    uint32_t image_index = 0;
-    VkResult result = vkAcquireNextImageKHR(vk_device_, vk_swapchain_khr_, std::numeric_limits<uint64_t>::max(), vk_available_image_semaphores_[current_frame_], VK_NULL_HANDLE, &image_index);
+        auto acquire_start_time = std::chrono::high_resolution_clock::now();
+        result = vkAcquireNextImageKHR(vk_device_, vk_swapchain_khr_, std::numeric_limits<uint64_t>::max(), frame.get_image_available_semaphore(), VK_NULL_HANDLE, &image_index);
+        auto acquire_end_time = std::chrono::high_resolution_clock::now();
+
+        last_acquire_ms_ = std::chrono::duration<double, std::milli>(acquire_end_time - acquire_start_time).count();
+    }
 
     if (result == VK_ERROR_OUT_OF_DATE_KHR)
     {
@@ -75,25 +187,48 @@ void application::render()
         assert(false && "Cant aquire swapchain image");
     }
 
-    VkCommandBuffer command_buffer = renderer_->render(image_index);
+    // NOTE(dhaval): Only recycle the frame once an image was acquired, an early return above leaves it untouched.
+    frame.begin();
 
-    VkSemaphore wait_semaphores[] = {vk_available_image_semaphores_[current_frame_]};
+    // NOTE(dhaval): Ticks on wall clock time would make every benchmark run animate differently, it steps by the fixed timestep instead.
+    if (config_.benchmark_frame_count > 0)
+    {
+        simulation_->step(static_cast<double>(frame_number_) * config_.benchmark_timestep_ms / 1000.0);
+    }
+
+    VkCommandBuffer command_buffer = renderer_->render(frame, image_index, simulation_->acquire_snapshot());
+
+    VkSemaphore wait_semaphores[] = {frame.get_image_available_semaphore()};
     VkPipelineStageFlags pipeline_wait_stages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
 
-    VkSemaphore signal_semaphores[] = {vk_finished_render_semaphores_[current_frame_]};
+    VkSemaphore signal_semaphores[] = {frame.get_render_finished_semaphore()};
 
     VkSubmitInfo submit_info{};
     submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submit_info.waitSemaphoreCount = 1;
+    submit_info.waitSemaphoreCount = config_.headless ? 0 : 1;
     submit_info.pWaitSemaphores = wait_semaphores;
     submit_info.pWaitDstStageMask = pipeline_wait_stages;
     submit_info.commandBufferCount = 1;
     submit_info.pCommandBuffers = &command_buffer;
-    submit_info.signalSemaphoreCount = 1;
+    submit_info.signalSemaphoreCount = config_.headless ? 0 : 1;
     submit_info.pSignalSemaphores = signal_semaphores;
 
-    vkResetFences(vk_device_, 1, &vk_in_flight_fences_[current_frame_]);
-    VK_CHECK(vkQueueSubmit(vk_graphics_queue_, 1, &submit_info, vk_in_flight_fences_[current_frame_]));
+    VkFence in_flight_fence = frame.get_in_flight_fence();
+    vkResetFences(vk_device_, 1, &in_flight_fence);
+    {
+        PBR_PROFILE_ZONE("vkQueueSubmit");
+        VK_CHECK(vkQueueSubmit(vk_graphics_queue_, 1, &submit_info, in_flight_fence));
+    }
+
+    last_image_index_ = image_index;
+
+    // NOTE(dhaval): Nothing to present, the frame stays in its target until save_offscreen_image() reads it back.
+    if (config_.headless)
+    {
+        current_frame_ = (current_frame_ + 1) % max_frames_in_flight_;
+        frame_number_++;
+        return;
+    }
 
     VkSwapchainKHR swapchains[] = {vk_swapchain_khr_};
 
@@ -106,7 +241,10 @@ void application::render()
     present_info_khr.pImageIndices = &image_index;
     present_info_khr.pResults = nullptr;
 
-    result = vkQueuePresentKHR(vk_present_queue_, &present_info_khr);
+    {
+        PBR_PROFILE_ZONE("vkQueuePresentKHR");
+        result = vkQueuePresentKHR(vk_present_queue_, &present_info_khr);
+    }
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || frame_buffer_resized)
     {
         frame_buffer_resized = false;
@@ -118,6 +256,7 @@ void application::render()
     }
 
     current_frame_ = (current_frame_ + 1) % max_frames_in_flight_;
+    frame_number_++;
 }
 
 /**
@@ -149,13 +288,86 @@ void application::on_frame_buffer_resize(GLFWwindow* window, int width, int heig
 }
 
 
+/**
+ * \brief Starts the job system every subsystem shares. The main thread takes part as thread 0, so one thread less is started.
+ */
+void application::init_job_system()
+{
+    uint32_t thread_count = config_.job_thread_count > 0 ? config_.job_thread_count : std::max(std::thread::hardware_concurrency(), 1u);
+
+    jobs_ = new job_system();
+    jobs_->init(thread_count - 1);
+
+    std::cout << "application: job system with " << jobs_->get_thread_count() << " thread(s)" << std::endl;
+}
+
+/**
+ * \brief Stops the job system. Everything running jobs on it is shut down by now.
+ */
+void application::shutdown_job_system()
+{
+    job_system_statistics statistics = jobs_->get_statistics();
+    std::cout << "application: " << statistics.job_count << " job(s) run, " << statistics.steal_count << " steal(s)" << std::endl;
+
+    jobs_->shutdown();
+
+    delete jobs_;
+    jobs_ = nullptr;
+}
+
 /**
  * \brief
  */
 void application::init_render_scene()
 {
+    scene_load_start_time_ = std::chrono::high_resolution_clock::now();
+    scene_load_reported_ = false;
+
+    shader_library_ = new vulkan_shader_library(vk_renderer_context_);
+    shader_library_->init(shader_cache_path, config_.shader_hot_reload);
+
+    resource_loader_ = new vulkan_resource_loader(vk_renderer_context_);
+    resource_loader_->init(jobs_);
+
     render_scene_ = new render_scene(vk_renderer_context_);
-    render_scene_->init(vertex_shader_path, fragment_shader_path, texture_path, model_path);
+
+    // NOTE(dhaval): The renderer can't build a pipeline without the shaders, main() reports the error and exits.
+    if (!render_scene_->init(shader_library_, resource_loader_, vertex_shader_path, renderer_config_.bindless_textures ? bindless_fragment_shader_path : fragment_shader_path,
+                             texture_path, model_path))
+    {
+        throw std::runtime_error("application: can't load the scene's shaders");
+    }
+
+    // NOTE(dhaval): A warm start reads every shader from the cache, any compile here means a source, include or define changed.
+    shader_library_statistics shader_statistics = shader_library_->get_statistics();
+    std::cout << "application: " << shader_statistics.shader_count << " shader(s) loaded, " << shader_statistics.compiler.compile_count << " compiled in "
+        << shader_statistics.compiler.total_compile_ms << " ms, " << shader_statistics.compiler.cache_hit_count << " cache hit(s), render scene queued after "
+        << std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - scene_load_start_time_).count() << " ms" << std::endl;
+
+    // NOTE(dhaval): Headless and benchmark runs must draw the same frames every time, they don't start before the real scene is there.
+    if (config_.headless || config_.benchmark_frame_count > 0)
+    {
+        resource_loader_->wait_until_loaded();
+        report_scene_load();
+    }
+}
+
+/**
+ * \brief Prints the load progress once every queued resource is ready or failed.
+ */
+void application::report_scene_load()
+{
+    resource_load_progress progress = resource_loader_->get_progress();
+    if (scene_load_reported_ || !progress.is_done())
+    {
+        return;
+    }
+
+    std::cout << "application: scene loaded in " << std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - scene_load_start_time_).count()
+        << " ms, " << progress.ready_count << " resource(s) ready, " << progress.failed_count << " failed, " << progress.uploaded_bytes / (1024.0 * 1024.0) << " MB in "
+        << progress.upload_batch_count << " upload batch(es)" << std::endl;
+
+    scene_load_reported_ = true;
 }
 
 /**
@@ -167,6 +379,16 @@ void application::shutdown_render_scene()
 
     delete render_scene_;
     render_scene_ = nullptr;
+
+    resource_loader_->shutdown();
+
+    delete resource_loader_;
+    resource_loader_ = nullptr;
+
+    shader_library_->shutdown();
+
+    delete shader_library_;
+    shader_library_ = nullptr;
 }
 
 /**
@@ -174,16 +396,31 @@ void application::shutdown_render_scene()
  */
 void application::init_renderer()
 {
-    vulkan_swapchain_context vk_swapchain_context = {};
-    vk_swapchain_context.vk_descriptor_pool = vk_descriptor_pool_;
-    vk_swapchain_context.vk_color_format_ = vk_swapchain_image_format_;
-    vk_swapchain_context.vk_depth_format_ = vk_depth_format_;
-    vk_swapchain_context.vk_extent_2d_ = vk_swapchain_extent_2d_;
-    vk_swapchain_context.vk_swapchain_image_views_ = vk_swapchain_image_views_;
-    vk_swapchain_context.vk_depth_image_view_ = vk_depth_image_view_;
+    renderer_ = new renderer(vk_renderer_context_, create_swapchain_context());
+    renderer_->init(render_scene_, jobs_, renderer_config_);
+}
+
+/**
+ * \brief Creates the simulation, main_loop() starts its thread.
+ */
+void application::init_simulation()
+{
+    simulation_config simulation_config{};
+    simulation_config.tick_rate = config_.simulation_tick_rate;
+
+    simulation_ = new simulation();
+    simulation_->init(simulation_config);
+}
+
+/**
+ * \brief
+ */
+void application::shutdown_simulation()
+{
+    simulation_->shutdown();
 
-    renderer_ = new renderer(vk_renderer_context_, vk_swapchain_context);
-    renderer_->init(render_scene_);
+    delete simulation_;
+    simulation_ = nullptr;
 }
 
 /**
@@ -197,6 +434,23 @@ void application::shutdown_renderer()
     renderer_ = nullptr;
 }
 
+/**
+ * \brief Gathers the swapchain state the renderer needs.
+ * \return vulkan_swapchain_context
+ */
+vulkan_swapchain_context application::create_swapchain_context() const
+{
+    vulkan_swapchain_context vk_swapchain_context = {};
+    vk_swapchain_context.vk_color_format_ = vk_swapchain_image_format_;
+    vk_swapchain_context.vk_depth_format_ = vk_depth_format_;
+    vk_swapchain_context.vk_extent_2d_ = vk_swapchain_extent_2d_;
+    vk_swapchain_context.vk_swapchain_images_ = vk_swapchain_images_;
+    vk_swapchain_context.vk_swapchain_image_views_ = vk_swapchain_image_views_;
+    vk_swapchain_context.backbuffer_usage_ = config_.headless ? render_graph_usage::transfer_source : render_graph_usage::present;
+
+    return vk_swapchain_context;
+}
+
 /**
  * \brief Checks to make sure that our device has the neccessary vulkan extensions in order to run this application.
  * \param extensions Vector that contains all extensions used by the application
@@ -209,11 +463,19 @@ bool application::check_required_extensions(std::vector<const char*>& extensions
     std::vector<VkExtensionProperties> vk_extensions(vk_extension_count);
     vkEnumerateInstanceExtensionProperties(nullptr, &vk_extension_count, vk_extensions.data());
 
-    uint32_t glfw_extension_count = 0;
-    const char** glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extension_count);
+    // NOTE(dhaval): Headless runs create no surface and never initialize GLFW, so they need no window system extensions.
+    std::vector<const char*> required_extensions;
+    if (!config_.headless)
+    {
+        uint32_t glfw_extension_count = 0;
+        const char** glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extension_count);
+        required_extensions.assign(glfw_extensions, glfw_extensions + glfw_extension_count);
+    }
 
-    std::vector<const char*> required_extensions(glfw_extensions, glfw_extensions + glfw_extension_count);
-    required_extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+    if (config_.validation)
+    {
+        required_extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+    }
 
     extensions.clear();
     for (const auto& required_extension : required_extensions)
@@ -293,7 +555,7 @@ bool application::check_required_physical_device_extensions(VkPhysicalDevice phy
     vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &physical_device_extension_count, extensions.data());
 
     physical_device_extensions.clear();
-    for (const char* required_extension : vk_required_physical_device_extensions_)
+    for (const char* required_extension : get_required_physical_device_extensions())
     {
         bool supported = false;
         for (const auto extension : extensions)
@@ -318,6 +580,26 @@ bool application::check_required_physical_device_extensions(VkPhysicalDevice phy
     return true;
 }
 
+/**
+ * \brief Device extensions the application cannot run without. Headless runs have no swapchain.
+ * \return std::vector<const char*>
+ */
+std::vector<const char*> application::get_required_physical_device_extensions() const
+{
+    std::vector<const char*> extensions;
+    for (const char* extension : vk_required_physical_device_extensions_)
+    {
+        if (config_.headless && strcmp(extension, VK_KHR_SWAPCHAIN_EXTENSION_NAME) == 0)
+        {
+            continue;
+        }
+
+        extensions.push_back(extension);
+    }
+
+    return extensions;
+}
+
 /**
  * \brief Gets the index values for all the queue families that the application needs.
  * \param physical_device The physical device that is being checked for the queue families.
@@ -341,8 +623,16 @@ queue_family_indicies application::fetch_queue_family_indicies(VkPhysicalDevice
             indicies.graphics_family = std::make_optional(i);
         }
 
+        // NOTE(dhaval): Without a surface nothing is presented, the graphics queue stands in for the present queue.
         VkBool32 present_support = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(physical_device, i, vk_surface_khr_, &present_support);
+        if (vk_surface_khr_ != VK_NULL_HANDLE)
+        {
+            vkGetPhysicalDeviceSurfaceSupportKHR(physical_device, i, vk_surface_khr_, &present_support);
+        }
+        else
+        {
+            present_support = queue_family_property.queueFlags & VK_QUEUE_GRAPHICS_BIT ? VK_TRUE : VK_FALSE;
+        }
 
         if (queue_family_property.queueCount > 0 && present_support)
         {
@@ -384,10 +674,13 @@ VkPhysicalDevice application::pick_physical_device(const std::vector<VkPhysicalD
             return VK_NULL_HANDLE;
         }
 
-        SwapchainSupportDetails swapchain_detais = fetch_swapchain_support_details(physical_device, surface_khr);
-        if (swapchain_detais.surface_formats.empty() || swapchain_detais.present_modes.empty())
+        if (surface_khr != VK_NULL_HANDLE)
         {
-            return VK_NULL_HANDLE;
+            SwapchainSupportDetails swapchain_detais = fetch_swapchain_support_details(physical_device, surface_khr);
+            if (swapchain_detais.surface_formats.empty() || swapchain_detais.present_modes.empty())
+            {
+                return VK_NULL_HANDLE;
+            }
         }
 
         VkPhysicalDeviceFeatures physical_device_features;
@@ -423,10 +716,13 @@ VkPhysicalDevice application::pick_physical_device(const std::vector<VkPhysicalD
             return VK_NULL_HANDLE;
         }
 
-        SwapchainSupportDetails swapchain_detais = fetch_swapchain_support_details(physical_devices[0], surface_khr);
-        if (swapchain_detais.surface_formats.empty() || swapchain_detais.present_modes.empty())
+        if (surface_khr != VK_NULL_HANDLE)
         {
-            return VK_NULL_HANDLE;
+            SwapchainSupportDetails swapchain_detais = fetch_swapchain_support_details(physical_devices[0], surface_khr);
+            if (swapchain_detais.surface_formats.empty() || swapchain_detais.present_modes.empty())
+            {
+                return VK_NULL_HANDLE;
+            }
         }
 
         VkPhysicalDeviceFeatures physical_device_features;
@@ -597,12 +893,18 @@ void application::init_vulkan()
         assert(false && "Can't initialize Vulkan helper library");
     }
 
-    // NOTE(dhaval): Checking required extensions and layers.
+    // NOTE(dhaval): Checking required extensions and layers. Called outside the asserts so release builds still fill the lists.
     std::vector<const char*> extensions;
-    assert(check_required_extensions(extensions) != false && "This device does not have the supported extensions");
+    bool extensions_supported = check_required_extensions(extensions);
+    assert(extensions_supported && "This device does not have the supported extensions");
 
+    // NOTE(dhaval): Build machines and software ICDs often come without the validation layers, run without them rather than fail.
     std::vector<const char*> layers;
-    assert(check_required_layers(layers) != false && "This device does not have the supported layers");
+    if (config_.validation && !check_required_layers(layers))
+    {
+        std::cout << "application: validation layers are not available, running without them" << std::endl;
+        layers.clear();
+    }
 
     // NOTE(dhaval): Create Vulkan Instance.
     VkApplicationInfo application_info{};
@@ -611,7 +913,10 @@ void application::init_vulkan()
     application_info.applicationVersion = VK_MAKE_API_VERSION(0, 1, 0, 0);
     application_info.pEngineName = "No Engine";
     application_info.engineVersion = VK_MAKE_API_VERSION(0, 1, 0, 0);
-    application_info.apiVersion = VK_API_VERSION_1_0;
+
+    // NOTE(dhaval): 1.1 when the loader has it, descriptor indexing needs vkGetPhysicalDeviceFeatures2 and maintenance3 which are core there.
+    vk_instance_api_version_ = volkGetInstanceVersion() >= VK_API_VERSION_1_1 ? VK_API_VERSION_1_1 : VK_API_VERSION_1_0;
+    application_info.apiVersion = vk_instance_api_version_;
 
     VkDebugUtilsMessengerCreateInfoEXT debug_utils_messenger_create_info{};
     debug_utils_messenger_create_info.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
@@ -628,22 +933,23 @@ void application::init_vulkan()
     instance_create_info.ppEnabledExtensionNames = extensions.data();
     instance_create_info.enabledLayerCount = static_cast<uint32_t>(layers.size());
     instance_create_info.ppEnabledLayerNames = layers.data();
-    instance_create_info.pNext = &debug_utils_messenger_create_info;
+    instance_create_info.pNext = config_.validation ? &debug_utils_messenger_create_info : nullptr;
 
     VK_CHECK(vkCreateInstance(&instance_create_info, nullptr, &vk_instance_));
 
     volkLoadInstance(vk_instance_);
 
     // NOTE(dhaval): Create Vulkan Debug Messenger.
-    VK_CHECK(vkCreateDebugUtilsMessengerEXT(vk_instance_, &debug_utils_messenger_create_info, nullptr, &vk_debug_utils_messenger_));
-
-    // NOTE(dhaval): Create Vulkan Win32 Surface.
-    VkWin32SurfaceCreateInfoKHR win32_surface_create_info{};
-    win32_surface_create_info.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR;
-    win32_surface_create_info.hwnd = glfwGetWin32Window(window_);
-    win32_surface_create_info.hinstance = GetModuleHandleA(nullptr);
+    if (config_.validation)
+    {
+        VK_CHECK(vkCreateDebugUtilsMessengerEXT(vk_instance_, &debug_utils_messenger_create_info, nullptr, &vk_debug_utils_messenger_));
+    }
 
-    VK_CHECK(vkCreateWin32SurfaceKHR(vk_instance_, &win32_surface_create_info, nullptr, &vk_surface_khr_));
+    // NOTE(dhaval): Create the window surface, GLFW picks the platform's surface extension.
+    if (!config_.headless)
+    {
+        VK_CHECK(glfwCreateWindowSurface(vk_instance_, window_, nullptr, &vk_surface_khr_));
+    }
 
     // NOTE(dhaval): Enumerate Physical Devices
     uint32_t physical_device_count = 0;
@@ -675,16 +981,96 @@ void application::init_vulkan()
         queue_create_infos.push_back(queue_create_info);
     }
 
+    VkPhysicalDeviceFeatures supported_physical_device_features;
+    vkGetPhysicalDeviceFeatures(vk_physical_device_, &supported_physical_device_features);
+
     VkPhysicalDeviceFeatures physical_device_features{};
     physical_device_features.samplerAnisotropy = VK_TRUE;
+    physical_device_features.multiDrawIndirect = supported_physical_device_features.multiDrawIndirect;
+    physical_device_features.drawIndirectFirstInstance = supported_physical_device_features.drawIndirectFirstInstance;
+    physical_device_features.pipelineStatisticsQuery = supported_physical_device_features.pipelineStatisticsQuery;
+    physical_device_features.inheritedQueries = supported_physical_device_features.inheritedQueries;
+
+    // NOTE(dhaval): Optional extensions are enabled when present, the renderer checks the context flags before using them.
+    uint32_t available_extension_count = 0;
+    vkEnumerateDeviceExtensionProperties(vk_physical_device_, nullptr, &available_extension_count, nullptr);
+    std::vector<VkExtensionProperties> available_extensions(available_extension_count);
+    vkEnumerateDeviceExtensionProperties(vk_physical_device_, nullptr, &available_extension_count, available_extensions.data());
+
+    std::vector<const char*> device_extensions = get_required_physical_device_extensions();
+    for (const char* optional_extension : vk_optional_physical_device_extensions_)
+    {
+        for (const auto& available_extension : available_extensions)
+        {
+            if (strcmp(optional_extension, available_extension.extensionName) == 0)
+            {
+                std::cout << optional_extension << " is enabled on this physical device" << std::endl;
+                device_extensions.push_back(optional_extension);
+                break;
+            }
+        }
+    }
+
+    auto is_extension_enabled = [&device_extensions](const char* extension) {
+        return std::find_if(device_extensions.begin(), device_extensions.end(), [extension](const char* name) { return strcmp(name, extension) == 0; }) != device_extensions.end();
+    };
+
+    // NOTE(dhaval): Descriptor indexing is only enabled for bindless textures, and only with every feature the texture table relies on.
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptor_indexing_features{};
+    descriptor_indexing_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+
+    bool descriptor_indexing_supported = false;
+    if (renderer_config_.bindless_textures)
+    {
+        VkPhysicalDeviceProperties physical_device_properties;
+        vkGetPhysicalDeviceProperties(vk_physical_device_, &physical_device_properties);
+
+        bool descriptor_indexing_available = std::find_if(available_extensions.begin(), available_extensions.end(), [](const VkExtensionProperties& extension) {
+            return strcmp(extension.extensionName, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) == 0;
+        }) != available_extensions.end();
+
+        if (descriptor_indexing_available && vk_instance_api_version_ >= VK_API_VERSION_1_1 && physical_device_properties.apiVersion >= VK_API_VERSION_1_1)
+        {
+            VkPhysicalDeviceDescriptorIndexingFeaturesEXT supported_descriptor_indexing_features{};
+            supported_descriptor_indexing_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+
+            VkPhysicalDeviceFeatures2 supported_physical_device_features_2{};
+            supported_physical_device_features_2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+            supported_physical_device_features_2.pNext = &supported_descriptor_indexing_features;
+
+            vkGetPhysicalDeviceFeatures2(vk_physical_device_, &supported_physical_device_features_2);
+
+            descriptor_indexing_supported = supported_descriptor_indexing_features.runtimeDescriptorArray && supported_descriptor_indexing_features.descriptorBindingPartiallyBound
+                && supported_descriptor_indexing_features.descriptorBindingSampledImageUpdateAfterBind && supported_descriptor_indexing_features.descriptorBindingUpdateUnusedWhilePending
+                && supported_descriptor_indexing_features.shaderSampledImageArrayNonUniformIndexing;
+        }
+
+        if (descriptor_indexing_supported)
+        {
+            descriptor_indexing_features.runtimeDescriptorArray = VK_TRUE;
+            descriptor_indexing_features.descriptorBindingPartiallyBound = VK_TRUE;
+            descriptor_indexing_features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+            descriptor_indexing_features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+            descriptor_indexing_features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+
+            device_extensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+            std::cout << VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME << " is enabled on this physical device" << std::endl;
+        }
+        else
+        {
+            std::cout << "application: descriptor indexing is not supported, bindless textures disabled" << std::endl;
+            renderer_config_.bindless_textures = false;
+        }
+    }
 
     VkDeviceCreateInfo device_create_info{};
     device_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    device_create_info.pNext = descriptor_indexing_supported ? &descriptor_indexing_features : nullptr;
     device_create_info.pEnabledFeatures = &physical_device_features;
     device_create_info.queueCreateInfoCount = static_cast<uint32_t>(queue_create_infos.size());
     device_create_info.pQueueCreateInfos = queue_create_infos.data();
-    device_create_info.enabledExtensionCount = static_cast<uint32_t>(vk_required_physical_device_extensions_.size());
-    device_create_info.ppEnabledExtensionNames = vk_required_physical_device_extensions_.data();
+    device_create_info.enabledExtensionCount = static_cast<uint32_t>(device_extensions.size());
+    device_create_info.ppEnabledExtensionNames = device_extensions.data();
     device_create_info.enabledLayerCount = static_cast<uint32_t>(layers.size());
     device_create_info.ppEnabledLayerNames = layers.data();
 
@@ -707,31 +1093,23 @@ void application::init_vulkan()
 
     VK_CHECK(vkCreateCommandPool(vk_device_, &command_pool_create_info, nullptr, &vk_command_pool_));
 
-    // NOTE(dhaval): Create Sync Objects
-    vk_available_image_semaphores_.resize(max_frames_in_flight_);
-    vk_finished_render_semaphores_.resize(max_frames_in_flight_);
-    vk_in_flight_fences_.resize(max_frames_in_flight_);
-
-    for (size_t i = 0; i < max_frames_in_flight_; i++)
-    {
-        VkSemaphoreCreateInfo semaphore_create_info{};
-        semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-
-        VK_CHECK(vkCreateSemaphore(vk_device_, &semaphore_create_info, nullptr, &vk_available_image_semaphores_[i]));
-        VK_CHECK(vkCreateSemaphore(vk_device_, &semaphore_create_info, nullptr, &vk_finished_render_semaphores_[i]));
-
-        VkFenceCreateInfo fence_create_info{};
-        fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        fence_create_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-        VK_CHECK(vkCreateFence(vk_device_, &fence_create_info, nullptr, &vk_in_flight_fences_[i]));
-    }
-
     vk_renderer_context_.vk_device_ = vk_device_;
     vk_renderer_context_.vk_physical_device_ = vk_physical_device_;
     vk_renderer_context_.vk_command_pool_ = vk_command_pool_;
     vk_renderer_context_.graphics_queue = vk_graphics_queue_;
     vk_renderer_context_.present_queue = vk_present_queue_;
+    vk_renderer_context_.graphics_queue_family_index = indicies.graphics_family.value();
+    vk_renderer_context_.multi_draw_indirect_supported = physical_device_features.multiDrawIndirect == VK_TRUE;
+    vk_renderer_context_.draw_indirect_first_instance_supported = physical_device_features.drawIndirectFirstInstance == VK_TRUE;
+    vk_renderer_context_.draw_indirect_count_supported = is_extension_enabled(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    vk_renderer_context_.pipeline_statistics_query_supported = physical_device_features.pipelineStatisticsQuery == VK_TRUE && physical_device_features.inheritedQueries == VK_TRUE;
+    vk_renderer_context_.descriptor_indexing_supported = descriptor_indexing_supported;
+
+    // NOTE(dhaval): Create Pipeline Cache, shared by every pipeline the renderer creates.
+    pipeline_cache_ = new vulkan_pipeline_cache(vk_renderer_context_);
+    pipeline_cache_->init(pipeline_cache_path);
+
+    vk_renderer_context_.vk_pipeline_cache_ = pipeline_cache_->get_pipeline_cache();
 }
 
 /**
@@ -739,34 +1117,84 @@ void application::init_vulkan()
  */
 void application::shutdown_vulkan()
 {
-    vkDestroyCommandPool(vk_device_, vk_command_pool_, nullptr);
-    vk_command_pool_ = VK_NULL_HANDLE;
+    pipeline_cache_->shutdown();
 
-    for (size_t i = 0; i < max_frames_in_flight_; i++)
-    {
-        vkDestroySemaphore(vk_device_, vk_finished_render_semaphores_[i], nullptr);
-        vkDestroySemaphore(vk_device_, vk_available_image_semaphores_[i], nullptr);
-        vkDestroyFence(vk_device_, vk_in_flight_fences_[i], nullptr);
-    }
+    delete pipeline_cache_;
+    pipeline_cache_ = nullptr;
+
+    vk_renderer_context_.vk_pipeline_cache_ = VK_NULL_HANDLE;
 
-    vk_finished_render_semaphores_.clear();
-    vk_available_image_semaphores_.clear();
-    vk_in_flight_fences_.clear();
+    vkDestroyCommandPool(vk_device_, vk_command_pool_, nullptr);
+    vk_command_pool_ = VK_NULL_HANDLE;
 
     vkDestroyDevice(vk_device_, nullptr);
     vk_device_ = VK_NULL_HANDLE;
 
-    vkDestroySurfaceKHR(vk_instance_, vk_surface_khr_, nullptr);
-    vk_surface_khr_ = VK_NULL_HANDLE;
+    if (vk_surface_khr_ != VK_NULL_HANDLE)
+    {
+        vkDestroySurfaceKHR(vk_instance_, vk_surface_khr_, nullptr);
+        vk_surface_khr_ = VK_NULL_HANDLE;
+    }
 
-    vkDestroyDebugUtilsMessengerEXT(vk_instance_, vk_debug_utils_messenger_, nullptr);
-    vk_debug_utils_messenger_ = VK_NULL_HANDLE;
+    if (vk_debug_utils_messenger_ != VK_NULL_HANDLE)
+    {
+        vkDestroyDebugUtilsMessengerEXT(vk_instance_, vk_debug_utils_messenger_, nullptr);
+        vk_debug_utils_messenger_ = VK_NULL_HANDLE;
+    }
 
     vkDestroyInstance(vk_instance_, nullptr);
     vk_instance_ = VK_NULL_HANDLE;
 }
 
-void application::init_vulkan_swapchain()
+/**
+ * \brief Creates one frame context per frame in flight.
+ */
+void application::init_frame_contexts()
+{
+    const frame_context_config frame_config = renderer::get_frame_context_config(renderer_config_);
+
+    frame_contexts_.resize(max_frames_in_flight_);
+    for (uint32_t i = 0; i < max_frames_in_flight_; i++)
+    {
+        frame_contexts_[i] = new vulkan_frame_context(vk_renderer_context_, i);
+        frame_contexts_[i]->init(frame_config);
+    }
+
+    current_frame_ = 0;
+
+    std::cout << "application: " << max_frames_in_flight_ << " frame(s) in flight" << std::endl;
+}
+
+/**
+ * \brief Destroys the frame contexts created in init_frame_contexts(). The device must be idle.
+ */
+void application::shutdown_frame_contexts()
+{
+    for (vulkan_frame_context* frame_context : frame_contexts_)
+    {
+        frame_context->shutdown();
+        delete frame_context;
+    }
+
+    frame_contexts_.clear();
+}
+
+/**
+ * \brief Blocks until the GPU has finished every frame in flight.
+ */
+void application::wait_for_frame_contexts() const
+{
+    for (const vulkan_frame_context* frame_context : frame_contexts_)
+    {
+        frame_context->wait();
+    }
+}
+
+/**
+ * \brief Creates the swapchain and its image views, and picks the depth buffer format.
+ * \param old_swapchain Swapchain being replaced, handed to the driver so it can keep presenting while the new one is created.
+ */
+void application::init_vulkan_swapchain(VkSwapchainKHR old_swapchain)
 {
     // NOTE(dhaval): Create Swapchain
     queue_family_indicies indicies = fetch_queue_family_indicies(vk_physical_device_);
@@ -813,7 +1241,7 @@ void application::init_vulkan_swapchain()
     swapchain_create_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     swapchain_create_info.presentMode = swapchain_settings.present_mode_khr;
     swapchain_create_info.clipped = VK_TRUE;
-    swapchain_create_info.oldSwapchain = VK_NULL_HANDLE;
+    swapchain_create_info.oldSwapchain = old_swapchain;
 
     VK_CHECK(vkCreateSwapchainKHR(vk_device_, &swapchain_create_info, nullptr, &vk_swapchain_khr_));
 
@@ -834,47 +1262,28 @@ void application::init_vulkan_swapchain()
         vk_swapchain_image_views_[i] = vulkan_utils::create_image_2d_view(vk_renderer_context_, vk_swapchain_images_[i], 1, vk_swapchain_image_format_, VK_IMAGE_ASPECT_COLOR_BIT);
     }
 
-    // NOTE(dhaval): Create depth buffer
+    // NOTE(dhaval): The depth buffer itself is a transient attachment of the renderer's render graph, only its format is chosen here.
     vk_depth_format_ = select_optimal_depth_format();
-
-    vulkan_utils::create_image_2d(vk_renderer_context_, vk_swapchain_extent_2d_.width, vk_swapchain_extent_2d_.height, 1, vk_depth_format_, VK_IMAGE_TILING_OPTIMAL,
-                                  VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vk_depth_image_, vk_depth_image_memory_);
-
-    // NOTE(dhaval): Create depth buffer image view
-    vk_depth_image_view_ = vulkan_utils::create_image_2d_view(vk_renderer_context_, vk_depth_image_, 1, vk_depth_format_, VK_IMAGE_ASPECT_DEPTH_BIT);
-    vulkan_utils::transition_image_layout(vk_renderer_context_, vk_depth_image_, 1, vk_depth_format_, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
-
-    // NOTE(dhaval): Create descriptor pools
-    std::array<VkDescriptorPoolSize, 2> descriptor_pool_sizes{};
-    descriptor_pool_sizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    descriptor_pool_sizes[0].descriptorCount = swapchain_image_count;
-    descriptor_pool_sizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    descriptor_pool_sizes[1].descriptorCount = swapchain_image_count;
-
-    VkDescriptorPoolCreateInfo descriptor_pool_create_info{};
-    descriptor_pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    descriptor_pool_create_info.poolSizeCount = static_cast<uint32_t>(descriptor_pool_sizes.size());
-    descriptor_pool_create_info.pPoolSizes = descriptor_pool_sizes.data();
-    descriptor_pool_create_info.maxSets = swapchain_image_count;
-    descriptor_pool_create_info.flags = 0;
-
-    VK_CHECK(vkCreateDescriptorPool(vk_device_, &descriptor_pool_create_info, nullptr, &vk_descriptor_pool_));
 }
 
+/**
+ * \brief Destroys the swapchain and everything created in init_vulkan_swapchain().
+ */
 void application::shutdown_vulkan_swapchain()
 {
-    vkDestroyDescriptorPool(vk_device_, vk_descriptor_pool_, nullptr);
-    vk_descriptor_pool_ = VK_NULL_HANDLE;
-
-    vkDestroyImageView(vk_device_, vk_depth_image_view_, nullptr);
-    vk_depth_image_view_ = VK_NULL_HANDLE;
+    shutdown_vulkan_swapchain_attachments();
 
-    vkDestroyImage(vk_device_, vk_depth_image_, nullptr);
-    vk_depth_image_ = VK_NULL_HANDLE;
+    vkDestroySwapchainKHR(vk_device_, vk_swapchain_khr_, nullptr);
+    vk_swapchain_khr_ = VK_NULL_HANDLE;
 
-    vkFreeMemory(vk_device_, vk_depth_image_memory_, nullptr);
-    vk_depth_image_memory_ = VK_NULL_HANDLE;
+    destroy_retired_swapchains(true);
+}
 
+/**
+ * \brief Destroys the size dependent resources of the swapchain (image views) but keeps the swapchain itself.
+ */
+void application::shutdown_vulkan_swapchain_attachments()
+{
     for (auto image_view : vk_swapchain_image_views_)
     {
         vkDestroyImageView(vk_device_, image_view, nullptr);
@@ -882,11 +1291,11 @@ void application::shutdown_vulkan_swapchain()
 
     vk_swapchain_image_views_.clear();
     vk_swapchain_images_.clear();
-
-    vkDestroySwapchainKHR(vk_device_, vk_swapchain_khr_, nullptr);
-    vk_swapchain_khr_ = VK_NULL_HANDLE;
 }
 
+/**
+ * \brief Recreates the swapchain after a resize. Only size dependent resources are rebuilt, the renderer keeps its pipelines.
+ */
 void application::recreate_vulkan_swapchain()
 {
     int width = 0;
@@ -897,13 +1306,159 @@ void application::recreate_vulkan_swapchain()
         glfwWaitEvents();
     }
 
-    vkDeviceWaitIdle(vk_device_);
+    auto recreate_start_time = std::chrono::high_resolution_clock::now();
 
-    shutdown_renderer();
-    shutdown_vulkan_swapchain();
+    // NOTE(dhaval): Only the frames still in flight can reference the old framebuffers and render graph attachments, no need to idle the whole device.
+    wait_for_frame_contexts();
 
-    init_vulkan_swapchain();
-    init_renderer();
+    VkFormat old_color_format = vk_swapchain_image_format_;
+    VkSwapchainKHR old_swapchain = vk_swapchain_khr_;
+
+    renderer_->destroy_swapchain_resources();
+    shutdown_vulkan_swapchain_attachments();
+    init_vulkan_swapchain(old_swapchain);
+
+    // NOTE(dhaval): The retired swapchain may still have presents queued, destroy it once every frame in flight has cycled.
+    retired_swapchain retired{};
+    retired.vk_swapchain_khr = old_swapchain;
+    retired.destroy_frame = frame_number_ + max_frames_in_flight_;
+    retired_swapchains_.push_back(retired);
+
+    bool full_rebuild = old_color_format != vk_swapchain_image_format_;
+    if (full_rebuild)
+    {
+        shutdown_renderer();
+        init_renderer();
+    }
+    else
+    {
+        renderer_->resize(create_swapchain_context());
+    }
+
+    auto recreate_end_time = std::chrono::high_resolution_clock::now();
+    std::cout << "application: swapchain recreated in " << std::chrono::duration<double, std::milli>(recreate_end_time - recreate_start_time).count() << " ms"
+        << (full_rebuild ? " (full renderer rebuild)" : " (incremental)") << std::endl;
+}
+
+/**
+ * \brief Destroys swapchains retired by recreate_vulkan_swapchain() once it is safe to do so.
+ * \param force Destroy every retired swapchain regardless of age. The device must be idle.
+ */
+void application::destroy_retired_swapchains(bool force)
+{
+    auto it = retired_swapchains_.begin();
+    while (it != retired_swapchains_.end())
+    {
+        if (force || frame_number_ >= it->destroy_frame)
+        {
+            vkDestroySwapchainKHR(vk_device_, it->vk_swapchain_khr, nullptr);
+            it = retired_swapchains_.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+/**
+ * \brief Creates the images headless runs render into instead of swapchain images, one per frame in flight, and picks the depth buffer format.
+ */
+void application::init_offscreen_targets()
+{
+    vk_swapchain_image_format_ = select_optimal_supported_format({VK_FORMAT_B8G8R8A8_UNORM, VK_FORMAT_R8G8B8A8_UNORM}, VK_IMAGE_TILING_OPTIMAL,
+                                                                 VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT);
+    vk_swapchain_extent_2d_ = {std::max(config_.headless_width, 1u), std::max(config_.headless_height, 1u)};
+
+    vk_swapchain_images_.resize(max_frames_in_flight_);
+    vk_swapchain_image_views_.resize(max_frames_in_flight_);
+    vk_offscreen_image_memories_.resize(max_frames_in_flight_);
+
+    for (uint32_t i = 0; i < max_frames_in_flight_; i++)
+    {
+        vulkan_utils::create_image_2d(vk_renderer_context_, vk_swapchain_extent_2d_.width, vk_swapchain_extent_2d_.height, 1, vk_swapchain_image_format_, VK_IMAGE_TILING_OPTIMAL,
+                                      VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vk_swapchain_images_[i],
+                                      vk_offscreen_image_memories_[i]);
+
+        vk_swapchain_image_views_[i] = vulkan_utils::create_image_2d_view(vk_renderer_context_, vk_swapchain_images_[i], 1, vk_swapchain_image_format_, VK_IMAGE_ASPECT_COLOR_BIT);
+    }
+
+    vk_depth_format_ = select_optimal_depth_format();
+
+    std::cout << "application: headless, " << max_frames_in_flight_ << " offscreen target(s) of " << vk_swapchain_extent_2d_.width << "x" << vk_swapchain_extent_2d_.height << std::endl;
+}
+
+/**
+ * \brief Destroys the images created in init_offscreen_targets(). The device must be idle.
+ */
+void application::shutdown_offscreen_targets()
+{
+    for (size_t i = 0; i < vk_swapchain_images_.size(); i++)
+    {
+        vkDestroyImageView(vk_device_, vk_swapchain_image_views_[i], nullptr);
+        vkDestroyImage(vk_device_, vk_swapchain_images_[i], nullptr);
+        vkFreeMemory(vk_device_, vk_offscreen_image_memories_[i], nullptr);
+    }
+
+    vk_swapchain_image_views_.clear();
+    vk_swapchain_images_.clear();
+    vk_offscreen_image_memories_.clear();
+}
+
+/**
+ * \brief Reads back the target of the last frame and writes it as a binary PPM. The device must be idle.
+ * \param path File to write.
+ */
+void application::save_offscreen_image(const std::string& path) const
+{
+    const uint32_t width = vk_swapchain_extent_2d_.width;
+    const uint32_t height = vk_swapchain_extent_2d_.height;
+    const VkDeviceSize size = static_cast<VkDeviceSize>(width) * height * 4;
+
+    VkBuffer staging_buffer = VK_NULL_HANDLE;
+    VkDeviceMemory staging_memory = VK_NULL_HANDLE;
+    vulkan_utils::create_buffer(vk_renderer_context_, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                staging_buffer, staging_memory);
+
+    // NOTE(dhaval): The render graph leaves every target in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL.
+    vulkan_utils::copy_image_to_buffer(vk_renderer_context_, vk_swapchain_images_[last_image_index_], staging_buffer, width, height);
+
+    void* data = nullptr;
+    VK_CHECK(vkMapMemory(vk_device_, staging_memory, 0, size, 0, &data));
+
+    std::ofstream file(path, std::ios::binary);
+    if (file.is_open())
+    {
+        const uint8_t* pixels = static_cast<const uint8_t*>(data);
+        const bool bgra = vk_swapchain_image_format_ == VK_FORMAT_B8G8R8A8_UNORM;
+
+        std::vector<uint8_t> row(static_cast<size_t>(width) * 3);
+
+        file << "P6\n" << width << " " << height << "\n255\n";
+        for (uint32_t y = 0; y < height; y++)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                const uint8_t* pixel = pixels + (static_cast<size_t>(y) * width + x) * 4;
+                row[x * 3 + 0] = bgra ? pixel[2] : pixel[0];
+                row[x * 3 + 1] = pixel[1];
+                row[x * 3 + 2] = bgra ? pixel[0] : pixel[2];
+            }
+
+            file.write(reinterpret_cast<const char*>(row.data()), row.size());
+        }
+
+        std::cout << "application: wrote the last frame to " << path << std::endl;
+    }
+    else
+    {
+        std::cout << "application: can't open " << path << ", last frame not written" << std::endl;
+    }
+
+    vkUnmapMemory(vk_device_, staging_memory);
+
+    vkDestroyBuffer(vk_device_, staging_buffer, nullptr);
+    vkFreeMemory(vk_device_, staging_memory, nullptr);
 }
 
 /**
@@ -911,16 +1466,274 @@ void application::recreate_vulkan_swapchain()
  */
 void application::main_loop()
 {
-    if (!window_)
+    if (!window_ && !config_.headless)
     {
         return;
     }
 
-    while (!glfwWindowShouldClose(window_))
+    uint64_t first_frame = frame_number_;
+
+    // NOTE(dhaval): Nothing closes a headless run, it always stops after a fixed number of frames.
+    uint64_t frame_count = config_.frame_count;
+    if (config_.headless && frame_count == 0)
+    {
+        frame_count = headless_frame_count;
+    }
+
+    if (config_.benchmark_frame_count > 0)
+    {
+        frame_count = config_.benchmark_warmup_frame_count + config_.benchmark_frame_count;
+        benchmark_report_.reset(config_.benchmark_frame_count);
+
+        std::cout << "application: benchmark, " << config_.benchmark_warmup_frame_count << " warm-up and " << config_.benchmark_frame_count << " measured frames, "
+            << config_.benchmark_timestep_ms << " ms timestep" << std::endl;
+    }
+
+    start_time_ = std::chrono::high_resolution_clock::now();
+
+    if (config_.benchmark_frame_count == 0)
+    {
+        simulation_->start(start_time_);
+    }
+
+    PBR_PROFILE_THREAD("main");
+
+    if (config_.profile_capture_frames > 0)
+    {
+        PBR_PROFILE_BEGIN_CAPTURE(config_.profile_capture_frames, config_.profile_capture_path);
+    }
+
+    while (!window_ || !glfwWindowShouldClose(window_))
     {
+        uint64_t rendered_frame = frame_number_;
+
+        // NOTE(dhaval): Between two frames, so a frame never mixes pipelines from before and after a reload.
+        if (shader_library_->apply_reloads() > 0)
+        {
+            renderer_->reload_shaders();
+        }
+
+        // NOTE(dhaval): Swaps placeholders for finished resources between two frames as well. The bindless materials are rewritten in place, the
+        // frames in flight must be done with them first, this waits once per finished upload batch.
+        if (resource_loader_->update() > 0)
+        {
+            if (renderer_config_.bindless_textures)
+            {
+                vkDeviceWaitIdle(vk_device_);
+            }
+
+            renderer_->refresh_scene_resources();
+            report_scene_load();
+        }
+
+        auto frame_start_time = std::chrono::high_resolution_clock::now();
         render();
-        glfwPollEvents();
+        auto frame_end_time = std::chrono::high_resolution_clock::now();
+
+        if (frame_number_ == 1)
+        {
+            std::cout << "application: first frame after " << std::chrono::duration<double, std::milli>(frame_end_time - scene_load_start_time_).count() << " ms, "
+                << std::lround(100.0f * resource_loader_->get_progress().get_fraction()) << "% of the scene loaded" << std::endl;
+        }
+
+        // NOTE(dhaval): A frame that only recreated the swapchain is not a sample.
+        if (config_.benchmark_frame_count > 0 && frame_number_ != rendered_frame && rendered_frame - first_frame >= config_.benchmark_warmup_frame_count)
+        {
+            add_benchmark_samples(std::chrono::duration<double, std::milli>(frame_end_time - frame_start_time).count());
+        }
+
+        if (window_)
+        {
+            PBR_PROFILE_ZONE("glfwPollEvents");
+            glfwPollEvents();
+        }
+
+        PBR_PROFILE_FRAME();
+
+        if (frame_count != 0 && frame_number_ - first_frame >= frame_count)
+        {
+            break;
+        }
     }
 
+    simulation_->stop();
+
+    // NOTE(dhaval): Writes out a capture the loop ended before it was complete.
+    PBR_PROFILE_END_CAPTURE();
+
     vkDeviceWaitIdle(vk_device_);
+
+    if (config_.benchmark_frame_count > 0)
+    {
+        finish_benchmark();
+    }
+
+    uint64_t rendered_frames = frame_number_ - first_frame;
+    if (rendered_frames > 0)
+    {
+        std::cout << "application: " << max_frames_in_flight_ << " frame(s) in flight, " << rendered_frames << " frames, CPU fence wait "
+            << total_fence_wait_ms_ / rendered_frames << " ms/frame avg, " << max_fence_wait_ms_ << " ms max" << std::endl;
+    }
+
+    const simulation_statistics& simulation_statistics = simulation_->get_statistics();
+    if (simulation_statistics.tick_count > 0)
+    {
+        std::cout << "simulation: " << simulation_statistics.tick_count << " ticks at " << config_.simulation_tick_rate << " Hz, tick jitter "
+            << simulation_statistics.total_tick_jitter_ms / simulation_statistics.tick_count << " ms avg, " << simulation_statistics.max_tick_jitter_ms << " ms max, "
+            << simulation_statistics.skipped_tick_count << " skipped, tick " << simulation_statistics.total_tick_ms / simulation_statistics.tick_count << " ms avg" << std::endl;
+    }
+
+    if (simulation_statistics.snapshot_count > 0)
+    {
+        std::cout << "simulation: render thread snapshot wait " << 1000.0 * simulation_statistics.total_snapshot_wait_ms / simulation_statistics.snapshot_count << " us avg, "
+            << 1000.0 * simulation_statistics.max_snapshot_wait_ms << " us max, snapshot age " << simulation_statistics.total_snapshot_age_ms / simulation_statistics.snapshot_count
+            << " ms avg, " << simulation_statistics.max_snapshot_age_ms << " ms max, " << simulation_statistics.reused_snapshot_count << " frame(s) reused a snapshot" << std::endl;
+    }
+
+    shader_library_statistics shader_statistics = shader_library_->get_statistics();
+    uint32_t shader_request_count = shader_statistics.compiler.cache_hit_count + shader_statistics.compiler.compile_count + shader_statistics.compiler.failure_count;
+    if (shader_request_count > 0)
+    {
+        std::cout << "application: shader cache " << 100.0 * shader_statistics.compiler.cache_hit_count / shader_request_count << "% hit rate, "
+            << shader_statistics.compiler.compile_count << " compile(s) in " << shader_statistics.compiler.total_compile_ms << " ms, "
+            << shader_statistics.compiler.failure_count << " failed, " << shader_statistics.reload_count << " hot reload(s)" << std::endl;
+    }
+
+    const renderer_statistics& statistics = renderer_->get_statistics();
+    if (statistics.frame_count > 0)
+    {
+        std::cout << "renderer: " << renderer_config_.record_thread_count << " record thread(s), " << renderer_config_.draw_count << " draws x " << renderer_config_.instance_count
+            << " instances, recording " << statistics.total_record_ms / statistics.frame_count << " ms/frame avg, " << statistics.max_record_ms << " ms max" << std::endl;
+
+        std::cout << "renderer: frustum culling " << (renderer_config_.frustum_culling ? "on" : "off") << ", " << statistics.total_cull_ms / statistics.frame_count << " ms/frame avg, "
+            << statistics.max_cull_ms << " ms max, " << statistics.total_visible_instance_count / statistics.frame_count << " visible instances/frame avg" << std::endl;
+
+        if (renderer_config_.occluder_count > 0)
+        {
+            std::cout << "renderer: occlusion culling with " << renderer_config_.occluder_count << " occluder(s), " << statistics.total_occlusion_ms / statistics.frame_count << " ms/frame avg, "
+                << statistics.total_occluded_instance_count / statistics.frame_count << " occluded instances/frame avg" << std::endl;
+        }
+
+        std::cout << "renderer: draw sorting " << statistics.total_sort_ms / statistics.frame_count << " ms/frame avg, binds/frame avg: "
+            << statistics.total_pipeline_binds / statistics.frame_count << " pipeline, " << statistics.total_material_binds / statistics.frame_count << " descriptor set, "
+            << statistics.total_mesh_binds / statistics.frame_count << " mesh" << std::endl;
+
+        std::cout << "renderer: " << statistics.total_descriptor_set_count / static_cast<double>(statistics.frame_count) << " descriptor set allocation(s)/frame avg, "
+            << statistics.max_descriptor_set_count << " max" << std::endl;
+
+        const render_graph_statistics& render_graph_statistics = renderer_->get_render_graph().get_graph().get_statistics();
+        const render_graph_execution_statistics& render_graph_execution_statistics = renderer_->get_render_graph().get_execution_statistics();
+        if (render_graph_execution_statistics.frame_count > 0)
+        {
+            std::cout << "renderer: render graph " << render_graph_execution_statistics.total_image_barrier_count / render_graph_execution_statistics.frame_count << " image barrier(s) in "
+                << render_graph_execution_statistics.total_pipeline_barrier_count / render_graph_execution_statistics.frame_count << " vkCmdPipelineBarrier/frame avg, "
+                << render_graph_statistics.transient_memory_size / 1024 << " KB transient attachments, "
+                << (render_graph_statistics.transient_memory_size - render_graph_statistics.allocated_memory_size) / 1024 << " KB saved by aliasing" << std::endl;
+        }
+
+        if (renderer_config_.bindless_textures)
+        {
+            const texture_table_statistics& texture_table_statistics = renderer_->get_texture_table().get_statistics();
+            std::cout << "renderer: bindless textures, " << texture_table_statistics.texture_count << " texture(s), " << texture_table_statistics.descriptor_write_count
+                << " descriptor writes in total" << std::endl;
+        }
+
+        for (const gpu_profiler_scope& scope : renderer_->get_gpu_profiler().get_scopes())
+        {
+            if (scope.sample_count == 0)
+            {
+                continue;
+            }
+
+            std::cout << "renderer: GPU " << scope.name << " " << scope.total_ms / scope.sample_count << " ms avg, last " << scope.history_count << " frames "
+                << scope.get_average_ms() << " ms avg, " << scope.get_max_ms() << " ms max" << std::endl;
+
+            if (scope.has_pipeline_statistics)
+            {
+                const gpu_pipeline_statistics& pipeline_statistics = scope.pipeline_statistics;
+                std::cout << "renderer: GPU " << scope.name << " last frame " << pipeline_statistics.input_assembly_primitives << " primitives, "
+                    << pipeline_statistics.vertex_shader_invocations << " vertex invocations, " << pipeline_statistics.clipping_primitives << " clipped primitives, "
+                    << pipeline_statistics.fragment_shader_invocations << " fragment invocations" << std::endl;
+            }
+        }
+    }
+}
+
+/**
+ * \brief Adds the timings of the frame render() just submitted to the benchmark report.
+ * \param cpu_frame_ms CPU time of the frame, from the fence wait to the present.
+ */
+void application::add_benchmark_samples(double cpu_frame_ms)
+{
+    benchmark_report_.add_sample(benchmark_metric::cpu_frame, cpu_frame_ms);
+    benchmark_report_.add_sample(benchmark_metric::fence_wait, last_fence_wait_ms_);
+
+    if (!config_.headless)
+    {
+        benchmark_report_.add_sample(benchmark_metric::acquire, last_acquire_ms_);
+    }
+
+    // NOTE(dhaval): GPU results arrive frames in flight late, a new one belongs to a frame after the warm-up once sampling started.
+    for (const gpu_profiler_scope& scope : renderer_->get_gpu_profiler().get_scopes())
+    {
+        if (scope.name != "frame")
+        {
+            continue;
+        }
+
+        if (gpu_frame_sample_count_ != 0 && scope.sample_count > gpu_frame_sample_count_)
+        {
+            benchmark_report_.add_sample(benchmark_metric::gpu_frame, scope.get_latest_ms());
+        }
+
+        gpu_frame_sample_count_ = scope.sample_count;
+    }
+}
+
+/**
+ * \brief Prints and writes the benchmark report and compares it against the baseline report, if one was given.
+ */
+void application::finish_benchmark()
+{
+    benchmark_report_.print(std::cout);
+
+    VkPhysicalDeviceProperties physical_device_properties{};
+    vkGetPhysicalDeviceProperties(vk_physical_device_, &physical_device_properties);
+
+    benchmark_run_description description{};
+    description.warmup_frame_count = config_.benchmark_warmup_frame_count;
+    description.measured_frame_count = config_.benchmark_frame_count;
+    description.timestep_ms = config_.benchmark_timestep_ms;
+    description.width = vk_swapchain_extent_2d_.width;
+    description.height = vk_swapchain_extent_2d_.height;
+    description.device_name = physical_device_properties.deviceName;
+
+    if (!config_.benchmark_output_path.empty())
+    {
+        if (benchmark_report_.write_json(config_.benchmark_output_path, description))
+        {
+            std::cout << "application: benchmark report written to " << config_.benchmark_output_path << std::endl;
+        }
+        else
+        {
+            std::cout << "application: can't write " << config_.benchmark_output_path << ", benchmark report dropped" << std::endl;
+        }
+    }
+
+    if (config_.benchmark_baseline_path.empty())
+    {
+        return;
+    }
+
+    std::array<benchmark_summary, benchmark_metric_count> baseline{};
+    if (!benchmark_report::read_json(config_.benchmark_baseline_path, baseline))
+    {
+        std::cout << "application: can't read baseline " << config_.benchmark_baseline_path << ", nothing compared" << std::endl;
+        return;
+    }
+
+    benchmark_regressed_ = benchmark_report_.compare(baseline, config_.benchmark_regression_threshold, std::cout);
+
+    std::cout << "application: " << (benchmark_regressed_ ? "regression" : "no regression") << " against " << config_.benchmark_baseline_path << " at a "
+        << config_.benchmark_regression_threshold << "% threshold" << std::endl;
 }
@@ -4,12 +4,81 @@
 
 #include <vector>
 #include <optional>
+#include <string>
+#include <chrono>
 
+#include "BenchmarkReport.hpp"
+#include "VulkanRenderer.hpp"
 #include "VulkanRendererContext.hpp"
 
 struct GLFWwindow;
-class renderer;
 class render_scene;
+class vulkan_shader_library;
+class vulkan_resource_loader;
+class simulation;
+class vulkan_frame_context;
+class vulkan_pipeline_cache;
+
+/**
+ * \brief Startup options of the application, filled from the command line.
+ */
+struct application_config
+{
+    // NOTE(dhaval): Number of frames the CPU may record ahead of the GPU, independent of the swapchain image count. Clamped to [1, 4].
+    uint32_t frames_in_flight{2};
+
+    // NOTE(dhaval): Close the application after this many frames, 0 runs until the window is closed.
+    uint64_t frame_count{0};
+
+    // NOTE(dhaval): Threads of the job system including the main thread, 0 runs one per core.
+    uint32_t job_thread_count{0};
+
+    // NOTE(dhaval): Tasks recording command buffers, draw calls and instances per draw call, see renderer_config.
+    uint32_t record_thread_count{1};
+    uint32_t draw_count{1};
+    uint32_t instance_count{1};
+    bool indirect_draws{true};
+    bool frustum_culling{true};
+    uint32_t occluder_count{0};
+    bool bindless_textures{false};
+
+    // NOTE(dhaval): material_feature mask of every material, see renderer_config. Empty uses the renderer's default material.
+    std::vector<uint32_t> material_features;
+
+    // NOTE(dhaval): GPU time per pass from timestamp queries, pipeline statistics implies profiling.
+    bool gpu_profiling{false};
+    bool gpu_pipeline_statistics{false};
+
+    // NOTE(dhaval): Render into offscreen images without a window, surface or swapchain. Runs frame_count frames, headless_frame_count if that is 0,
+    // and writes the last one to output_image_path as a PPM when that is set.
+    bool headless{false};
+    uint32_t headless_width{1280};
+    uint32_t headless_height{720};
+    std::string output_image_path;
+
+    // NOTE(dhaval): Khronos validation layers, skipped with a warning when they are not installed.
+    bool validation{true};
+
+    // NOTE(dhaval): Frames the CPU profiler captures from the first frame on, written as a Chrome trace. Needs a build with PBR_ENABLE_PROFILER.
+    uint32_t profile_capture_frames{0};
+    std::string profile_capture_path{"profile.json"};
+
+    // NOTE(dhaval): Benchmark mode animates by a fixed timestep so every run draws the same frames, renders benchmark_warmup_frame_count frames
+    // unmeasured and then benchmark_frame_count measured ones, 0 turns it off. The report is written to benchmark_output_path and compared against
+    // benchmark_baseline_path when that is set, a statistic more than benchmark_regression_threshold percent slower fails the run.
+    uint64_t benchmark_frame_count{0};
+    uint64_t benchmark_warmup_frame_count{60};
+    double benchmark_timestep_ms{1000.0 / 60.0};
+    std::string benchmark_output_path{"benchmark.json"};
+    std::string benchmark_baseline_path;
+    double benchmark_regression_threshold{5.0};
+
+    // NOTE(dhaval): Recompile shaders whose sources change while the application runs and swap them in between frames.
+    bool shader_hot_reload{false};
+
+    // NOTE(dhaval): Ticks per second of the simulation thread. Benchmark runs step the simulation once per frame on the render thread instead.
+    double simulation_tick_rate{120.0};
+};
 
 /**
  * \brief Helper Struct that is used to determine whether the physical device chosen supports a certain queue family.
@@ -42,14 +111,27 @@ struct SwapchainSettings
     VkExtent2D extent_2d;
 };
 
+/**
+ * \brief Swapchain that was replaced during recreation. It is kept alive until its pending presents are done.
+ */
+struct retired_swapchain
+{
+    VkSwapchainKHR vk_swapchain_khr{VK_NULL_HANDLE};
+    uint64_t destroy_frame{0};
+};
+
 /**
  * \brief This class is used to initialize and manage our applications state.
  */
 class application
 {
 public:
+    application(const application_config& config);
+
     void run();
 
+    inline bool has_benchmark_regression() const { return benchmark_regressed_; }
+
 private:
     void init_window();
     void shutdown_window();
@@ -57,6 +139,7 @@ private:
     bool check_required_extensions(std::vector<const char*>& extensions) const;
     bool check_required_layers(std::vector<const char*>& layers) const;
     bool check_required_physical_device_extensions(VkPhysicalDevice physical_device, std::vector<const char*>& physical_device_extensions) const;
+    std::vector<const char*> get_required_physical_device_extensions() const;
 
     SwapchainSupportDetails fetch_swapchain_support_details(VkPhysicalDevice physical_device, VkSurfaceKHR surface_khr) const;
     SwapchainSettings select_optimal_swapchain_settings(const SwapchainSupportDetails& swapchain_support_details) const;
@@ -68,29 +151,58 @@ private:
     void init_vulkan();
     void shutdown_vulkan();
 
-    void init_vulkan_swapchain();
+    void init_frame_contexts();
+    void shutdown_frame_contexts();
+    void wait_for_frame_contexts() const;
+
+    void init_vulkan_swapchain(VkSwapchainKHR old_swapchain = VK_NULL_HANDLE);
     void shutdown_vulkan_swapchain();
+    void shutdown_vulkan_swapchain_attachments();
     void recreate_vulkan_swapchain();
+    void destroy_retired_swapchains(bool force);
+
+    void init_offscreen_targets();
+    void shutdown_offscreen_targets();
+    void save_offscreen_image(const std::string& path) const;
+
+    vulkan_swapchain_context create_swapchain_context() const;
+
+    void init_job_system();
+    void shutdown_job_system();
 
     void init_render_scene();
     void shutdown_render_scene();
+    void report_scene_load();
 
     void init_renderer();
     void shutdown_renderer();
 
+    void init_simulation();
+    void shutdown_simulation();
+
     void render();
     void main_loop();
 
+    void add_benchmark_samples(double cpu_frame_ms);
+    void finish_benchmark();
+
     static void on_frame_buffer_resize(GLFWwindow* window, int width, int height);
 
 private:
     GLFWwindow* window_{nullptr};
     renderer* renderer_{nullptr};
     render_scene* render_scene_{nullptr};
+    vulkan_shader_library* shader_library_{nullptr};
+    vulkan_resource_loader* resource_loader_{nullptr};
+    job_system* jobs_{nullptr};
+    simulation* simulation_{nullptr};
+    vulkan_pipeline_cache* pipeline_cache_{nullptr};
+    std::vector<vulkan_frame_context*> frame_contexts_;
 
     vulkan_renderer_context vk_renderer_context_ = {};
 
     VkInstance vk_instance_{VK_NULL_HANDLE};
+    uint32_t vk_instance_api_version_{VK_API_VERSION_1_0};
     VkPhysicalDevice vk_physical_device_{VK_NULL_HANDLE};
     VkDevice vk_device_{VK_NULL_HANDLE};
     VkSurfaceKHR vk_surface_khr_{VK_NULL_HANDLE};
@@ -99,29 +211,45 @@ private:
     VkQueue vk_present_queue_{VK_NULL_HANDLE};
 
     VkSwapchainKHR vk_swapchain_khr_{VK_NULL_HANDLE};
+    std::vector<retired_swapchain> retired_swapchains_;
     std::vector<VkImage> vk_swapchain_images_{VK_NULL_HANDLE};
     std::vector<VkImageView> vk_swapchain_image_views_{VK_NULL_HANDLE};
 
+    // NOTE(dhaval): Memory of the headless targets, which stand in for the swapchain images. last_image_index_ is the target of the last submitted frame.
+    std::vector<VkDeviceMemory> vk_offscreen_image_memories_;
+    uint32_t last_image_index_{0};
+
     VkFormat vk_swapchain_image_format_;
     VkExtent2D vk_swapchain_extent_2d_;
 
-    VkImage vk_depth_image_{VK_NULL_HANDLE};
-    VkImageView vk_depth_image_view_{VK_NULL_HANDLE};
-    VkDeviceMemory vk_depth_image_memory_{VK_NULL_HANDLE};
-
     VkFormat vk_depth_format_;
 
-    VkDescriptorPool vk_descriptor_pool_{VK_NULL_HANDLE};
     VkCommandPool vk_command_pool_{VK_NULL_HANDLE};
 
-    std::vector<VkSemaphore> vk_available_image_semaphores_{VK_NULL_HANDLE};
-    std::vector<VkSemaphore> vk_finished_render_semaphores_{VK_NULL_HANDLE};
-    std::vector<VkFence> vk_in_flight_fences_{VK_NULL_HANDLE};
     size_t current_frame_{0};
+    uint64_t frame_number_{0};
+
+    // NOTE(dhaval): Time the CPU spent blocked on frame fences, reported on shutdown.
+    double total_fence_wait_ms_{0.0};
+    double max_fence_wait_ms_{0.0};
+
+    // NOTE(dhaval): Timings of the last rendered frame and the samples of a benchmark run. gpu_frame_sample_count_ is how many results of the
+    // GPU "frame" scope were already taken, the profiler reads them back frames later.
+    std::chrono::high_resolution_clock::time_point start_time_;
+    double last_fence_wait_ms_{0.0};
+    double last_acquire_ms_{0.0};
+    uint64_t gpu_frame_sample_count_{0};
+    benchmark_report benchmark_report_;
+    bool benchmark_regressed_{false};
+
+    // NOTE(dhaval): When init_render_scene() queued the scene, the first frame and the end of loading are reported relative to it.
+    std::chrono::high_resolution_clock::time_point scene_load_start_time_;
+    bool scene_load_reported_{false};
 
     VkDebugUtilsMessengerEXT vk_debug_utils_messenger_{VK_NULL_HANDLE};
 
     static std::vector<const char*> vk_required_physical_device_extensions_;
+    static std::vector<const char*> vk_optional_physical_device_extensions_;
     static std::vector<const char*> vk_required_validation_layers_;
 
     static PFN_vkCreateDebugUtilsMessengerEXT vk_create_debug_utils_messenger_;
@@ -129,5 +257,7 @@ private:
 
     bool frame_buffer_resized{false};
 
-    const uint32_t max_frames_in_flight_ = 2;
+    application_config config_;
+    renderer_config renderer_config_;
+    uint32_t max_frames_in_flight_{2};
 };
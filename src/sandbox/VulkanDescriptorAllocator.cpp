@@ -0,0 +1,166 @@
+#include "VulkanDescriptorAllocator.hpp"
+#include "VulkanUtils.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+/**
+ * \brief Initializes the allocator. No pool is created until the first allocation.
+ * \param sets_per_pool Number of descriptor sets the first pool can hold.
+ * \param pool_ratios Number of descriptors of each type that are reserved per descriptor set.
+ * \param max_sets_per_pool Upper bound for the size of the pools created when the allocator grows.
+ */
+void vulkan_descriptor_allocator::init(uint32_t sets_per_pool, const std::vector<descriptor_pool_ratio>& pool_ratios, uint32_t max_sets_per_pool)
+{
+    assert(sets_per_pool > 0 && "Descriptor pools must hold at least one set");
+    assert(!pool_ratios.empty() && "Descriptor pools need at least one descriptor type");
+
+    sets_per_pool_ = sets_per_pool;
+    max_sets_per_pool_ = std::max(sets_per_pool, max_sets_per_pool);
+    pool_ratios_ = pool_ratios;
+
+    statistics_ = {};
+}
+
+/**
+ * \brief Destroys every pool owned by the allocator. All sets allocated from it become invalid.
+ */
+void vulkan_descriptor_allocator::shutdown()
+{
+    for (VkDescriptorPool pool : vk_used_pools_)
+    {
+        vkDestroyDescriptorPool(vk_renderer_context_.vk_device_, pool, nullptr);
+    }
+
+    vk_used_pools_.clear();
+
+    for (VkDescriptorPool pool : vk_free_pools_)
+    {
+        vkDestroyDescriptorPool(vk_renderer_context_.vk_device_, pool, nullptr);
+    }
+
+    vk_free_pools_.clear();
+
+    vk_current_pool_ = VK_NULL_HANDLE;
+    statistics_ = {};
+}
+
+/**
+ * \brief Allocates a descriptor set, moving on to a new pool if the current one is full or fragmented.
+ * \param descriptor_set_layout Layout of the set to allocate.
+ * \param descriptor_set Receives the allocated set.
+ * \return bool
+ */
+bool vulkan_descriptor_allocator::allocate(VkDescriptorSetLayout descriptor_set_layout, VkDescriptorSet& descriptor_set)
+{
+    if (vk_current_pool_ == VK_NULL_HANDLE)
+    {
+        vk_current_pool_ = grab_pool();
+        vk_used_pools_.push_back(vk_current_pool_);
+    }
+
+    VkDescriptorSetAllocateInfo descriptor_set_allocate_info{};
+    descriptor_set_allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    descriptor_set_allocate_info.descriptorPool = vk_current_pool_;
+    descriptor_set_allocate_info.descriptorSetCount = 1;
+    descriptor_set_allocate_info.pSetLayouts = &descriptor_set_layout;
+
+    VkResult result = vkAllocateDescriptorSets(vk_renderer_context_.vk_device_, &descriptor_set_allocate_info, &descriptor_set);
+
+    // NOTE(dhaval): The current pool is exhausted, retry once with a fresh pool.
+    if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+    {
+        vk_current_pool_ = grab_pool();
+        vk_used_pools_.push_back(vk_current_pool_);
+
+        descriptor_set_allocate_info.descriptorPool = vk_current_pool_;
+        result = vkAllocateDescriptorSets(vk_renderer_context_.vk_device_, &descriptor_set_allocate_info, &descriptor_set);
+    }
+
+    if (result != VK_SUCCESS)
+    {
+        std::cerr << "vulkan_descriptor_allocator::allocate(): failed to allocate descriptor set (" << result << ")" << std::endl;
+        descriptor_set = VK_NULL_HANDLE;
+        return false;
+    }
+
+    statistics_.allocation_count++;
+    return true;
+}
+
+/**
+ * \brief Returns every set to its pool with vkResetDescriptorPool. The caller must make sure the GPU no longer uses them.
+ */
+void vulkan_descriptor_allocator::reset()
+{
+    for (VkDescriptorPool pool : vk_used_pools_)
+    {
+        VK_CHECK(vkResetDescriptorPool(vk_renderer_context_.vk_device_, pool, 0));
+        vk_free_pools_.push_back(pool);
+    }
+
+    vk_used_pools_.clear();
+    vk_current_pool_ = VK_NULL_HANDLE;
+
+    statistics_.allocation_count = 0;
+    statistics_.grow_count = 0;
+}
+
+/**
+ * \brief Reuses a pool that was previously reset or creates a new one, doubling the pool size every time the allocator grows.
+ * \return VkDescriptorPool
+ */
+VkDescriptorPool vulkan_descriptor_allocator::grab_pool()
+{
+    if (!vk_free_pools_.empty())
+    {
+        VkDescriptorPool pool = vk_free_pools_.back();
+        vk_free_pools_.pop_back();
+        return pool;
+    }
+
+    VkDescriptorPool pool = create_pool(sets_per_pool_);
+
+    statistics_.pool_count++;
+    statistics_.grow_count++;
+
+    if (statistics_.pool_count > 1)
+    {
+        std::cout << "vulkan_descriptor_allocator: grew to " << statistics_.pool_count << " pools (" << sets_per_pool_ << " sets in the newest pool)" << std::endl;
+    }
+
+    sets_per_pool_ = std::min(sets_per_pool_ * 2, max_sets_per_pool_);
+
+    return pool;
+}
+
+/**
+ * \brief Creates a descriptor pool sized according to the allocator's per type ratios.
+ * \param set_count Maximum number of sets the pool can hold.
+ * \return VkDescriptorPool
+ */
+VkDescriptorPool vulkan_descriptor_allocator::create_pool(uint32_t set_count) const
+{
+    std::vector<VkDescriptorPoolSize> descriptor_pool_sizes;
+    descriptor_pool_sizes.reserve(pool_ratios_.size());
+
+    for (const descriptor_pool_ratio& pool_ratio : pool_ratios_)
+    {
+        VkDescriptorPoolSize descriptor_pool_size{};
+        descriptor_pool_size.type = pool_ratio.type;
+        descriptor_pool_size.descriptorCount = std::max(1u, static_cast<uint32_t>(pool_ratio.ratio * set_count));
+        descriptor_pool_sizes.push_back(descriptor_pool_size);
+    }
+
+    VkDescriptorPoolCreateInfo descriptor_pool_create_info{};
+    descriptor_pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    descriptor_pool_create_info.poolSizeCount = static_cast<uint32_t>(descriptor_pool_sizes.size());
+    descriptor_pool_create_info.pPoolSizes = descriptor_pool_sizes.data();
+    descriptor_pool_create_info.maxSets = set_count;
+    descriptor_pool_create_info.flags = 0;
+
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    VK_CHECK(vkCreateDescriptorPool(vk_renderer_context_.vk_device_, &descriptor_pool_create_info, nullptr, &pool));
+
+    return pool;
+}
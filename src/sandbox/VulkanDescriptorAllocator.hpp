@@ -0,0 +1,62 @@
+#pragma once
+
+#include <volk.h>
+
+#include <vector>
+
+#include "VulkanRendererContext.hpp"
+
+/**
+ * \brief How many descriptors of a given type a pool reserves for every set it can hold.
+ */
+struct descriptor_pool_ratio
+{
+    VkDescriptorType type;
+    float ratio;
+};
+
+/**
+ * \brief Allocation counters of a descriptor allocator since its last reset.
+ */
+struct descriptor_allocator_statistics
+{
+    uint32_t allocation_count{0};
+    uint32_t pool_count{0};
+    uint32_t grow_count{0};
+};
+
+/**
+ * \brief Allocates descriptor sets from a list of descriptor pools that grows whenever the current pool runs out of memory.
+ */
+class vulkan_descriptor_allocator
+{
+public:
+    vulkan_descriptor_allocator(const vulkan_renderer_context& renderer_context) : vk_renderer_context_(renderer_context)
+    {
+    }
+
+    void init(uint32_t sets_per_pool, const std::vector<descriptor_pool_ratio>& pool_ratios, uint32_t max_sets_per_pool = 4096);
+    void shutdown();
+
+    bool allocate(VkDescriptorSetLayout descriptor_set_layout, VkDescriptorSet& descriptor_set);
+    void reset();
+
+    inline const descriptor_allocator_statistics& get_statistics() const { return statistics_; }
+
+private:
+    VkDescriptorPool grab_pool();
+    VkDescriptorPool create_pool(uint32_t set_count) const;
+
+private:
+    vulkan_renderer_context vk_renderer_context_;
+
+    std::vector<descriptor_pool_ratio> pool_ratios_;
+    uint32_t sets_per_pool_{0};
+    uint32_t max_sets_per_pool_{0};
+
+    VkDescriptorPool vk_current_pool_{VK_NULL_HANDLE};
+    std::vector<VkDescriptorPool> vk_used_pools_;
+    std::vector<VkDescriptorPool> vk_free_pools_;
+
+    descriptor_allocator_statistics statistics_{};
+};
@@ -0,0 +1,225 @@
+#include "VulkanFrameContext.hpp"
+#include "VulkanUtils.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+
+/**
+ * \brief Creates the frame's command pools and buffers, its persistently mapped arenas, descriptor allocator and sync objects.
+ * \param config Arena sizes, descriptor pool ratios and the number of secondary command buffers, one per recording thread.
+ */
+void vulkan_frame_context::init(const frame_context_config& config)
+{
+    // NOTE(dhaval): Create Command Pool, reset as a whole at the start of every frame.
+    VkCommandPoolCreateInfo command_pool_create_info{};
+    command_pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    command_pool_create_info.queueFamilyIndex = vk_renderer_context_.graphics_queue_family_index;
+    command_pool_create_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    VK_CHECK(vkCreateCommandPool(vk_renderer_context_.vk_device_, &command_pool_create_info, nullptr, &vk_command_pool_));
+
+    VkCommandBufferAllocateInfo command_buffer_allocate_info{};
+    command_buffer_allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    command_buffer_allocate_info.commandPool = vk_command_pool_;
+    command_buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    command_buffer_allocate_info.commandBufferCount = 1;
+
+    VK_CHECK(vkAllocateCommandBuffers(vk_renderer_context_.vk_device_, &command_buffer_allocate_info, &vk_command_buffer_));
+
+    // NOTE(dhaval): Create Secondary Command Pools
+    vk_secondary_command_pools_.resize(config.secondary_command_buffer_count);
+    vk_secondary_command_buffers_.resize(config.secondary_command_buffer_count);
+
+    for (uint32_t i = 0; i < config.secondary_command_buffer_count; i++)
+    {
+        VK_CHECK(vkCreateCommandPool(vk_renderer_context_.vk_device_, &command_pool_create_info, nullptr, &vk_secondary_command_pools_[i]));
+
+        command_buffer_allocate_info.commandPool = vk_secondary_command_pools_[i];
+        command_buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+
+        VK_CHECK(vkAllocateCommandBuffers(vk_renderer_context_.vk_device_, &command_buffer_allocate_info, &vk_secondary_command_buffers_[i]));
+    }
+
+    // NOTE(dhaval): Create Arenas, mapped once for the lifetime of the frame.
+    VkPhysicalDeviceProperties physical_device_properties;
+    vkGetPhysicalDeviceProperties(vk_renderer_context_.vk_physical_device_, &physical_device_properties);
+
+    create_arena(uniform_arena_, config.uniform_arena_size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, physical_device_properties.limits.minUniformBufferOffsetAlignment);
+    create_arena(instance_arena_, config.instance_arena_size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, 16);
+    create_arena(indirect_arena_, config.indirect_arena_size, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, 16);
+
+    // NOTE(dhaval): Create Descriptor Allocator
+    descriptor_allocator_.init(64, config.descriptor_pool_ratios);
+
+    // NOTE(dhaval): Create Sync Objects
+    VkSemaphoreCreateInfo semaphore_create_info{};
+    semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    VK_CHECK(vkCreateSemaphore(vk_renderer_context_.vk_device_, &semaphore_create_info, nullptr, &vk_image_available_semaphore_));
+    VK_CHECK(vkCreateSemaphore(vk_renderer_context_.vk_device_, &semaphore_create_info, nullptr, &vk_render_finished_semaphore_));
+
+    VkFenceCreateInfo fence_create_info{};
+    fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fence_create_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+    VK_CHECK(vkCreateFence(vk_renderer_context_.vk_device_, &fence_create_info, nullptr, &vk_in_flight_fence_));
+}
+
+/**
+ * \brief Destroys everything created in init(). The frame must not be in flight.
+ */
+void vulkan_frame_context::shutdown()
+{
+    vkDestroyFence(vk_renderer_context_.vk_device_, vk_in_flight_fence_, nullptr);
+    vk_in_flight_fence_ = VK_NULL_HANDLE;
+
+    vkDestroySemaphore(vk_renderer_context_.vk_device_, vk_render_finished_semaphore_, nullptr);
+    vk_render_finished_semaphore_ = VK_NULL_HANDLE;
+
+    vkDestroySemaphore(vk_renderer_context_.vk_device_, vk_image_available_semaphore_, nullptr);
+    vk_image_available_semaphore_ = VK_NULL_HANDLE;
+
+    descriptor_allocator_.shutdown();
+
+    destroy_arena(indirect_arena_);
+    destroy_arena(instance_arena_);
+    destroy_arena(uniform_arena_);
+
+    for (auto secondary_command_pool : vk_secondary_command_pools_)
+    {
+        vkDestroyCommandPool(vk_renderer_context_.vk_device_, secondary_command_pool, nullptr);
+    }
+
+    vk_secondary_command_pools_.clear();
+    vk_secondary_command_buffers_.clear();
+
+    vkDestroyCommandPool(vk_renderer_context_.vk_device_, vk_command_pool_, nullptr);
+    vk_command_pool_ = VK_NULL_HANDLE;
+    vk_command_buffer_ = VK_NULL_HANDLE;
+}
+
+/**
+ * \brief Blocks until the GPU has finished the last submission that used this frame.
+ */
+void vulkan_frame_context::wait() const
+{
+    VK_CHECK(vkWaitForFences(vk_renderer_context_.vk_device_, 1, &vk_in_flight_fence_, VK_TRUE, std::numeric_limits<uint64_t>::max()));
+}
+
+/**
+ * \brief Recycles the frame's command buffers, arenas and descriptor sets. Must be called after wait().
+ */
+void vulkan_frame_context::begin()
+{
+    VK_CHECK(vkResetCommandPool(vk_renderer_context_.vk_device_, vk_command_pool_, 0));
+
+    for (auto secondary_command_pool : vk_secondary_command_pools_)
+    {
+        VK_CHECK(vkResetCommandPool(vk_renderer_context_.vk_device_, secondary_command_pool, 0));
+    }
+
+    descriptor_allocator_.reset();
+    uniform_arena_.offset = 0;
+    instance_arena_.offset = 0;
+    indirect_arena_.offset = 0;
+}
+
+/**
+ * \brief Bump allocates uniform data from the frame's uniform arena.
+ * \param size Size of the allocation in bytes.
+ * \param allocation Receives the buffer, offset and mapped pointer of the allocation.
+ * \return bool
+ */
+bool vulkan_frame_context::allocate_uniform(VkDeviceSize size, frame_allocation& allocation)
+{
+    return allocate_from_arena(uniform_arena_, size, allocation, "uniform");
+}
+
+/**
+ * \brief Bump allocates per instance vertex data from the frame's instance arena.
+ * \param size Size of the allocation in bytes.
+ * \param allocation Receives the buffer, offset and mapped pointer of the allocation.
+ * \return bool
+ */
+bool vulkan_frame_context::allocate_instances(VkDeviceSize size, frame_allocation& allocation)
+{
+    return allocate_from_arena(instance_arena_, size, allocation, "instance");
+}
+
+/**
+ * \brief Bump allocates indirect draw commands and draw counts from the frame's indirect arena.
+ * \param size Size of the allocation in bytes.
+ * \param allocation Receives the buffer, offset and mapped pointer of the allocation.
+ * \return bool
+ */
+bool vulkan_frame_context::allocate_indirect(VkDeviceSize size, frame_allocation& allocation)
+{
+    return allocate_from_arena(indirect_arena_, size, allocation, "indirect");
+}
+
+/**
+ * \brief Creates a host visible, host coherent buffer and maps it for the lifetime of the arena.
+ * \param arena Arena to create.
+ * \param size Size of the arena in bytes.
+ * \param usage Usage of the backing buffer.
+ * \param alignment Alignment of every allocation.
+ */
+void vulkan_frame_context::create_arena(frame_arena& arena, VkDeviceSize size, VkBufferUsageFlags usage, VkDeviceSize alignment) const
+{
+    arena.size = std::max<VkDeviceSize>(size, 1);
+    arena.offset = 0;
+    arena.alignment = std::max<VkDeviceSize>(alignment, 1);
+
+    vulkan_utils::create_buffer(vk_renderer_context_, arena.size, usage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, arena.vk_buffer, arena.vk_buffer_memory);
+
+    void* data = nullptr;
+    VK_CHECK(vkMapMemory(vk_renderer_context_.vk_device_, arena.vk_buffer_memory, 0, arena.size, 0, &data));
+    arena.data = static_cast<unsigned char*>(data);
+}
+
+/**
+ * \brief Unmaps and destroys an arena created with create_arena().
+ * \param arena Arena to destroy.
+ */
+void vulkan_frame_context::destroy_arena(frame_arena& arena) const
+{
+    vkUnmapMemory(vk_renderer_context_.vk_device_, arena.vk_buffer_memory);
+    arena.data = nullptr;
+
+    vkDestroyBuffer(vk_renderer_context_.vk_device_, arena.vk_buffer, nullptr);
+    arena.vk_buffer = VK_NULL_HANDLE;
+
+    vkFreeMemory(vk_renderer_context_.vk_device_, arena.vk_buffer_memory, nullptr);
+    arena.vk_buffer_memory = VK_NULL_HANDLE;
+
+    arena.size = 0;
+    arena.offset = 0;
+}
+
+/**
+ * \brief Bump allocates from an arena.
+ * \param arena Arena to allocate from.
+ * \param size Size of the allocation in bytes.
+ * \param allocation Receives the buffer, offset and mapped pointer of the allocation.
+ * \param name Name of the arena used in error messages.
+ * \return bool
+ */
+bool vulkan_frame_context::allocate_from_arena(frame_arena& arena, VkDeviceSize size, frame_allocation& allocation, const char* name) const
+{
+    VkDeviceSize offset = (arena.offset + arena.alignment - 1) / arena.alignment * arena.alignment;
+    if (offset + size > arena.size)
+    {
+        std::cerr << "vulkan_frame_context: " << name << " arena is full (" << arena.size << " bytes)" << std::endl;
+        return false;
+    }
+
+    arena.offset = offset + size;
+
+    allocation.buffer = arena.vk_buffer;
+    allocation.offset = offset;
+    allocation.size = size;
+    allocation.data = arena.data + offset;
+
+    return true;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <volk.h>
+
+#include <vector>
+
+#include "VulkanDescriptorAllocator.hpp"
+#include "VulkanRendererContext.hpp"
+
+/**
+ * \brief A slice of one of a frame's arenas.
+ */
+struct frame_allocation
+{
+    VkBuffer buffer{VK_NULL_HANDLE};
+    VkDeviceSize offset{0};
+    VkDeviceSize size{0};
+    void* data{nullptr};
+};
+
+/**
+ * \brief Sizes of everything a frame context creates up front.
+ */
+struct frame_context_config
+{
+    VkDeviceSize uniform_arena_size{0};
+    VkDeviceSize instance_arena_size{0};
+    VkDeviceSize indirect_arena_size{0};
+    std::vector<descriptor_pool_ratio> descriptor_pool_ratios;
+    uint32_t secondary_command_buffer_count{0};
+};
+
+/**
+ * \brief Everything a single frame in flight owns: its command buffers, uniform, instance and indirect arenas, transient descriptor pools and synchronization objects.
+ *        Nothing in here may be touched by the CPU until wait() has returned for this frame.
+ */
+class vulkan_frame_context
+{
+public:
+    vulkan_frame_context(const vulkan_renderer_context& renderer_context, uint32_t frame_index)
+        : vk_renderer_context_(renderer_context), frame_index_(frame_index), descriptor_allocator_(renderer_context)
+    {
+    }
+
+    void init(const frame_context_config& config);
+    void shutdown();
+
+    void wait() const;
+    void begin();
+
+    bool allocate_uniform(VkDeviceSize size, frame_allocation& allocation);
+    bool allocate_instances(VkDeviceSize size, frame_allocation& allocation);
+    bool allocate_indirect(VkDeviceSize size, frame_allocation& allocation);
+
+    inline uint32_t get_frame_index() const { return frame_index_; }
+    inline VkCommandBuffer get_command_buffer() const { return vk_command_buffer_; }
+    inline VkCommandBuffer get_secondary_command_buffer(uint32_t index) const { return vk_secondary_command_buffers_[index]; }
+    inline uint32_t get_secondary_command_buffer_count() const { return static_cast<uint32_t>(vk_secondary_command_buffers_.size()); }
+    inline VkDeviceSize get_uniform_alignment() const { return uniform_arena_.alignment; }
+    inline VkSemaphore get_image_available_semaphore() const { return vk_image_available_semaphore_; }
+    inline VkSemaphore get_render_finished_semaphore() const { return vk_render_finished_semaphore_; }
+    inline VkFence get_in_flight_fence() const { return vk_in_flight_fence_; }
+
+    inline vulkan_descriptor_allocator& get_descriptor_allocator() { return descriptor_allocator_; }
+    inline const vulkan_descriptor_allocator& get_descriptor_allocator() const { return descriptor_allocator_; }
+
+private:
+    /**
+     * \brief Persistently mapped host visible buffer that is bump allocated and rewound every frame.
+     */
+    struct frame_arena
+    {
+        VkBuffer vk_buffer{VK_NULL_HANDLE};
+        VkDeviceMemory vk_buffer_memory{VK_NULL_HANDLE};
+        unsigned char* data{nullptr};
+        VkDeviceSize size{0};
+        VkDeviceSize offset{0};
+        VkDeviceSize alignment{1};
+    };
+
+    void create_arena(frame_arena& arena, VkDeviceSize size, VkBufferUsageFlags usage, VkDeviceSize alignment) const;
+    void destroy_arena(frame_arena& arena) const;
+    bool allocate_from_arena(frame_arena& arena, VkDeviceSize size, frame_allocation& allocation, const char* name) const;
+
+private:
+    vulkan_renderer_context vk_renderer_context_;
+
+    // NOTE(dhaval): Position among the frames in flight, keys per frame resources owned elsewhere (GPU queries).
+    uint32_t frame_index_{0};
+
+    VkCommandPool vk_command_pool_{VK_NULL_HANDLE};
+    VkCommandBuffer vk_command_buffer_{VK_NULL_HANDLE};
+
+    // NOTE(dhaval): One pool per secondary command buffer, so each recording thread owns its pool for the frame.
+    std::vector<VkCommandPool> vk_secondary_command_pools_;
+    std::vector<VkCommandBuffer> vk_secondary_command_buffers_;
+
+    frame_arena uniform_arena_;
+    frame_arena instance_arena_;
+    frame_arena indirect_arena_;
+
+    vulkan_descriptor_allocator descriptor_allocator_;
+
+    VkSemaphore vk_image_available_semaphore_{VK_NULL_HANDLE};
+    VkSemaphore vk_render_finished_semaphore_{VK_NULL_HANDLE};
+    VkFence vk_in_flight_fence_{VK_NULL_HANDLE};
+};
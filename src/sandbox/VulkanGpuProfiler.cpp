@@ -0,0 +1,325 @@
+#include "VulkanGpuProfiler.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+// NOTE(dhaval): Every query result is followed by its availability word.
+static const uint32_t timestamp_result_stride = 2;
+static const uint32_t statistics_counter_count = 6;
+static const uint32_t statistics_result_stride = statistics_counter_count + 1;
+
+/**
+ * \brief Newest sample of the history.
+ * \return double 0 if nothing was recorded yet.
+ */
+double gpu_profiler_scope::get_latest_ms() const
+{
+    return history_count == 0 ? 0.0 : history_ms[(history_next + gpu_profiler_history_length - 1) % gpu_profiler_history_length];
+}
+
+/**
+ * \brief Average over the history.
+ * \return double 0 if nothing was recorded yet.
+ */
+double gpu_profiler_scope::get_average_ms() const
+{
+    double sum = 0.0;
+    for (uint32_t i = 0; i < history_count; i++)
+    {
+        sum += history_ms[i];
+    }
+
+    return history_count == 0 ? 0.0 : sum / history_count;
+}
+
+/**
+ * \brief Slowest sample of the history.
+ * \return double 0 if nothing was recorded yet.
+ */
+double gpu_profiler_scope::get_max_ms() const
+{
+    double max_ms = 0.0;
+    for (uint32_t i = 0; i < history_count; i++)
+    {
+        max_ms = std::max(max_ms, history_ms[i]);
+    }
+
+    return max_ms;
+}
+
+/**
+ * \brief Checks timestamp support of the graphics queue. Query pools are created by begin_frame() the first time each frame uses them.
+ * \param max_scope_count Scopes a single frame may record.
+ * \param pipeline_statistics Also record pipeline statistics for scopes that ask for them. Ignored without vulkan_renderer_context::pipeline_statistics_query_supported.
+ */
+void vulkan_gpu_profiler::init(uint32_t max_scope_count, bool pipeline_statistics)
+{
+    uint32_t queue_family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(vk_renderer_context_.vk_physical_device_, &queue_family_count, nullptr);
+    std::vector<VkQueueFamilyProperties> queue_families(queue_family_count);
+    vkGetPhysicalDeviceQueueFamilyProperties(vk_renderer_context_.vk_physical_device_, &queue_family_count, queue_families.data());
+
+    uint32_t timestamp_valid_bits = queue_families[vk_renderer_context_.graphics_queue_family_index].timestampValidBits;
+    if (timestamp_valid_bits == 0)
+    {
+        std::cout << "vulkan_gpu_profiler: graphics queue does not support timestamps, GPU profiling disabled" << std::endl;
+        return;
+    }
+
+    VkPhysicalDeviceProperties physical_device_properties;
+    vkGetPhysicalDeviceProperties(vk_renderer_context_.vk_physical_device_, &physical_device_properties);
+
+    timestamp_period_ns_ = physical_device_properties.limits.timestampPeriod;
+    timestamp_mask_ = timestamp_valid_bits >= 64 ? ~0ull : (1ull << timestamp_valid_bits) - 1;
+
+    pipeline_statistics_enabled_ = pipeline_statistics && vk_renderer_context_.pipeline_statistics_query_supported;
+    if (pipeline_statistics && !pipeline_statistics_enabled_)
+    {
+        std::cout << "vulkan_gpu_profiler: pipeline statistics queries not supported, recording timestamps only" << std::endl;
+    }
+
+    max_scope_count_ = max_scope_count;
+    enabled_ = true;
+}
+
+/**
+ * \brief Destroys the query pools. The device must be done with every frame that used them.
+ */
+void vulkan_gpu_profiler::shutdown()
+{
+    for (frame_queries& queries : frames_)
+    {
+        vkDestroyQueryPool(vk_renderer_context_.vk_device_, queries.vk_timestamp_query_pool, nullptr);
+        vkDestroyQueryPool(vk_renderer_context_.vk_device_, queries.vk_statistics_query_pool, nullptr);
+    }
+
+    frames_.clear();
+    scopes_.clear();
+
+    current_frame_ = invalid_gpu_scope;
+    enabled_ = false;
+    pipeline_statistics_enabled_ = false;
+}
+
+/**
+ * \brief Reads back what the frame recorded last time and resets its queries. Record first into the frame's command buffer, before any scope.
+ * \param frame_index Index of the frame in flight, its fence must have signaled.
+ * \param command_buffer Frame's primary command buffer, outside of a render pass.
+ */
+void vulkan_gpu_profiler::begin_frame(uint32_t frame_index, VkCommandBuffer command_buffer)
+{
+    if (!enabled_)
+    {
+        return;
+    }
+
+    if (frame_index >= frames_.size())
+    {
+        frames_.resize(frame_index + 1);
+    }
+
+    frame_queries& queries = frames_[frame_index];
+    if (queries.vk_timestamp_query_pool == VK_NULL_HANDLE)
+    {
+        create_frame_queries(queries);
+    }
+
+    read_frame_queries(queries);
+
+    queries.recorded_scopes.clear();
+    queries.statistics_query_count = 0;
+
+    vkCmdResetQueryPool(command_buffer, queries.vk_timestamp_query_pool, 0, max_scope_count_ * 2);
+    if (pipeline_statistics_enabled_)
+    {
+        vkCmdResetQueryPool(command_buffer, queries.vk_statistics_query_pool, 0, max_scope_count_);
+    }
+
+    current_frame_ = frame_index;
+    statistics_query_active_ = false;
+}
+
+/**
+ * \brief Starts a scope. Scopes may nest, scopes with pipeline statistics may not.
+ * \param command_buffer Command buffer of the current frame.
+ * \param name Name of the scope, samples of scopes with the same name go into the same history.
+ * \param pipeline_statistics Also record pipeline statistics. Secondary command buffers executed inside must inherit get_pipeline_statistics_flags().
+ * \return uint32_t Scope to pass to end_scope(), invalid_gpu_scope if profiling is disabled or the frame is out of queries.
+ */
+uint32_t vulkan_gpu_profiler::begin_scope(VkCommandBuffer command_buffer, const std::string& name, bool pipeline_statistics)
+{
+    if (!enabled_ || current_frame_ == invalid_gpu_scope)
+    {
+        return invalid_gpu_scope;
+    }
+
+    frame_queries& queries = frames_[current_frame_];
+    if (queries.recorded_scopes.size() >= max_scope_count_)
+    {
+        return invalid_gpu_scope;
+    }
+
+    recorded_scope recorded;
+    recorded.scope = find_scope(name);
+    recorded.timestamp_query = static_cast<uint32_t>(queries.recorded_scopes.size()) * 2;
+
+    vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queries.vk_timestamp_query_pool, recorded.timestamp_query);
+
+    if (pipeline_statistics && pipeline_statistics_enabled_)
+    {
+        assert(!statistics_query_active_ && "GPU profiler scopes with pipeline statistics cannot nest");
+
+        recorded.statistics_query = queries.statistics_query_count++;
+        vkCmdBeginQuery(command_buffer, queries.vk_statistics_query_pool, recorded.statistics_query, 0);
+        statistics_query_active_ = true;
+    }
+
+    queries.recorded_scopes.push_back(recorded);
+    return static_cast<uint32_t>(queries.recorded_scopes.size() - 1);
+}
+
+/**
+ * \brief Ends a scope started with begin_scope() in the same command buffer.
+ * \param command_buffer Command buffer the scope was started in.
+ * \param scope Value returned by begin_scope().
+ */
+void vulkan_gpu_profiler::end_scope(VkCommandBuffer command_buffer, uint32_t scope)
+{
+    if (scope == invalid_gpu_scope)
+    {
+        return;
+    }
+
+    frame_queries& queries = frames_[current_frame_];
+    const recorded_scope& recorded = queries.recorded_scopes[scope];
+
+    if (recorded.statistics_query != invalid_gpu_scope)
+    {
+        vkCmdEndQuery(command_buffer, queries.vk_statistics_query_pool, recorded.statistics_query);
+        statistics_query_active_ = false;
+    }
+
+    vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queries.vk_timestamp_query_pool, recorded.timestamp_query + 1);
+}
+
+/**
+ * \brief Pipeline statistics the profiler records. Secondary command buffers executed inside a statistics scope must inherit them.
+ * \return VkQueryPipelineStatisticFlags
+ */
+VkQueryPipelineStatisticFlags vulkan_gpu_profiler::get_pipeline_statistics_flags()
+{
+    return VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT | VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+           VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+           VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT | VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+}
+
+/**
+ * \brief Creates the query pools of a frame.
+ * \param queries Frame to create the pools of.
+ */
+void vulkan_gpu_profiler::create_frame_queries(frame_queries& queries) const
+{
+    VkQueryPoolCreateInfo query_pool_create_info{};
+    query_pool_create_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    query_pool_create_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    query_pool_create_info.queryCount = max_scope_count_ * 2;
+
+    VK_CHECK(vkCreateQueryPool(vk_renderer_context_.vk_device_, &query_pool_create_info, nullptr, &queries.vk_timestamp_query_pool));
+
+    if (pipeline_statistics_enabled_)
+    {
+        query_pool_create_info.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        query_pool_create_info.queryCount = max_scope_count_;
+        query_pool_create_info.pipelineStatistics = get_pipeline_statistics_flags();
+
+        VK_CHECK(vkCreateQueryPool(vk_renderer_context_.vk_device_, &query_pool_create_info, nullptr, &queries.vk_statistics_query_pool));
+    }
+}
+
+/**
+ * \brief Adds the results of the scopes a frame recorded to their histories. Results that are not available are skipped rather than waited on.
+ * \param queries Frame whose fence has signaled.
+ */
+void vulkan_gpu_profiler::read_frame_queries(frame_queries& queries)
+{
+    uint32_t scope_count = static_cast<uint32_t>(queries.recorded_scopes.size());
+    if (scope_count == 0)
+    {
+        return;
+    }
+
+    const VkQueryResultFlags result_flags = VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT;
+
+    query_results_.resize(scope_count * 2 * timestamp_result_stride);
+    vkGetQueryPoolResults(vk_renderer_context_.vk_device_, queries.vk_timestamp_query_pool, 0, scope_count * 2, query_results_.size() * sizeof(uint64_t), query_results_.data(),
+                          timestamp_result_stride * sizeof(uint64_t), result_flags);
+
+    for (const recorded_scope& recorded : queries.recorded_scopes)
+    {
+        const uint64_t* begin = &query_results_[recorded.timestamp_query * timestamp_result_stride];
+        const uint64_t* end = &query_results_[(recorded.timestamp_query + 1) * timestamp_result_stride];
+        if (begin[1] == 0 || end[1] == 0)
+        {
+            continue;
+        }
+
+        double ms = static_cast<double>((end[0] - begin[0]) & timestamp_mask_) * timestamp_period_ns_ / 1000000.0;
+
+        gpu_profiler_scope& scope = scopes_[recorded.scope];
+        scope.history_ms[scope.history_next] = ms;
+        scope.history_next = (scope.history_next + 1) % gpu_profiler_history_length;
+        scope.history_count = std::min(scope.history_count + 1, gpu_profiler_history_length);
+        scope.sample_count++;
+        scope.total_ms += ms;
+    }
+
+    if (queries.statistics_query_count == 0)
+    {
+        return;
+    }
+
+    query_results_.resize(queries.statistics_query_count * statistics_result_stride);
+    vkGetQueryPoolResults(vk_renderer_context_.vk_device_, queries.vk_statistics_query_pool, 0, queries.statistics_query_count, query_results_.size() * sizeof(uint64_t),
+                          query_results_.data(), statistics_result_stride * sizeof(uint64_t), result_flags);
+
+    for (const recorded_scope& recorded : queries.recorded_scopes)
+    {
+        const uint64_t* counters = recorded.statistics_query == invalid_gpu_scope ? nullptr : &query_results_[recorded.statistics_query * statistics_result_stride];
+        if (counters == nullptr || counters[statistics_counter_count] == 0)
+        {
+            continue;
+        }
+
+        gpu_profiler_scope& scope = scopes_[recorded.scope];
+        scope.has_pipeline_statistics = true;
+        scope.pipeline_statistics.input_assembly_vertices = counters[0];
+        scope.pipeline_statistics.input_assembly_primitives = counters[1];
+        scope.pipeline_statistics.vertex_shader_invocations = counters[2];
+        scope.pipeline_statistics.clipping_invocations = counters[3];
+        scope.pipeline_statistics.clipping_primitives = counters[4];
+        scope.pipeline_statistics.fragment_shader_invocations = counters[5];
+    }
+}
+
+/**
+ * \brief Returns the index of the scope with the given name, adding it on first use.
+ * \param name Name of the scope.
+ * \return uint32_t
+ */
+uint32_t vulkan_gpu_profiler::find_scope(const std::string& name)
+{
+    for (uint32_t i = 0; i < scopes_.size(); i++)
+    {
+        if (scopes_[i].name == name)
+        {
+            return i;
+        }
+    }
+
+    gpu_profiler_scope scope;
+    scope.name = name;
+
+    scopes_.push_back(scope);
+    return static_cast<uint32_t>(scopes_.size() - 1);
+}
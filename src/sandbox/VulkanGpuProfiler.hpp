@@ -0,0 +1,117 @@
+#pragma once
+
+#include <volk.h>
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "VulkanRendererContext.hpp"
+
+static const uint32_t gpu_profiler_history_length = 120;
+static const uint32_t invalid_gpu_scope = UINT32_MAX;
+
+/**
+ * \brief Counters of a VK_QUERY_TYPE_PIPELINE_STATISTICS query, in the order Vulkan writes them.
+ */
+struct gpu_pipeline_statistics
+{
+    uint64_t input_assembly_vertices{0};
+    uint64_t input_assembly_primitives{0};
+    uint64_t vertex_shader_invocations{0};
+    uint64_t clipping_invocations{0};
+    uint64_t clipping_primitives{0};
+    uint64_t fragment_shader_invocations{0};
+};
+
+/**
+ * \brief GPU time of one named scope over the last gpu_profiler_history_length frames it was recorded in.
+ */
+struct gpu_profiler_scope
+{
+    std::string name;
+
+    // NOTE(dhaval): Ring buffer, history_next is where the next sample goes.
+    std::array<double, gpu_profiler_history_length> history_ms{};
+    uint32_t history_next{0};
+    uint32_t history_count{0};
+
+    uint64_t sample_count{0};
+    double total_ms{0.0};
+
+    // NOTE(dhaval): Latest counters, only filled for scopes recorded with pipeline statistics.
+    bool has_pipeline_statistics{false};
+    gpu_pipeline_statistics pipeline_statistics;
+
+    double get_latest_ms() const;
+    double get_average_ms() const;
+    double get_max_ms() const;
+};
+
+/**
+ * \brief Measures GPU time of named scopes with timestamp queries, and optionally pipeline statistics.
+ *        Every frame in flight has its own query pools. They are read back when the frame comes around again, once its fence has signaled,
+ *        so results are as many frames old as there are frames in flight and reading them never stalls.
+ */
+class vulkan_gpu_profiler
+{
+public:
+    vulkan_gpu_profiler(const vulkan_renderer_context& renderer_context) : vk_renderer_context_(renderer_context)
+    {
+    }
+
+    void init(uint32_t max_scope_count, bool pipeline_statistics);
+    void shutdown();
+
+    void begin_frame(uint32_t frame_index, VkCommandBuffer command_buffer);
+    uint32_t begin_scope(VkCommandBuffer command_buffer, const std::string& name, bool pipeline_statistics);
+    void end_scope(VkCommandBuffer command_buffer, uint32_t scope);
+
+    inline bool is_enabled() const { return enabled_; }
+    inline bool is_pipeline_statistics_enabled() const { return pipeline_statistics_enabled_; }
+    inline const std::vector<gpu_profiler_scope>& get_scopes() const { return scopes_; }
+
+    static VkQueryPipelineStatisticFlags get_pipeline_statistics_flags();
+
+private:
+    struct recorded_scope
+    {
+        uint32_t scope{invalid_gpu_scope};
+        uint32_t timestamp_query{0};
+        uint32_t statistics_query{invalid_gpu_scope};
+    };
+
+    struct frame_queries
+    {
+        VkQueryPool vk_timestamp_query_pool{VK_NULL_HANDLE};
+        VkQueryPool vk_statistics_query_pool{VK_NULL_HANDLE};
+
+        // NOTE(dhaval): Scopes recorded the last time this frame was used, read back the next time it begins.
+        std::vector<recorded_scope> recorded_scopes;
+        uint32_t statistics_query_count{0};
+    };
+
+    void create_frame_queries(frame_queries& queries) const;
+    void read_frame_queries(frame_queries& queries);
+    uint32_t find_scope(const std::string& name);
+
+private:
+    vulkan_renderer_context vk_renderer_context_;
+
+    bool enabled_{false};
+    bool pipeline_statistics_enabled_{false};
+    uint32_t max_scope_count_{0};
+
+    // NOTE(dhaval): Nanoseconds per timestamp tick, and the mask of the bits the graphics queue actually writes.
+    double timestamp_period_ns_{1.0};
+    uint64_t timestamp_mask_{~0ull};
+
+    std::vector<frame_queries> frames_;
+    uint32_t current_frame_{invalid_gpu_scope};
+
+    // NOTE(dhaval): Only one pipeline statistics query may be active at a time, statistics scopes cannot nest.
+    bool statistics_query_active_{false};
+
+    std::vector<gpu_profiler_scope> scopes_;
+    std::vector<uint64_t> query_results_;
+};
@@ -1,11 +1,7 @@
 #include "VulkanMesh.hpp"
 #include "VulkanUtils.hpp"
 
-#include <assimp/Importer.hpp>
-#include <assimp/scene.h>
-#include <assimp/postprocess.h>
-
-#include <iostream>
+#include <cstring>
 
 vulkan_mesh::~vulkan_mesh()
 {
@@ -17,7 +13,7 @@ VkVertexInputBindingDescription vulkan_mesh::get_vertex_input_binding_descriptio
 {
     VkVertexInputBindingDescription vertex_input_binding_description;
     vertex_input_binding_description.binding = 0;
-    vertex_input_binding_description.stride = sizeof(vertex);
+    vertex_input_binding_description.stride = sizeof(mesh_vertex);
     vertex_input_binding_description.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
     return vertex_input_binding_description;
@@ -30,93 +26,34 @@ std::array<VkVertexInputAttributeDescription, 3> vulkan_mesh::get_vertex_input_a
     vertex_input_attribute_descriptions[0].binding = 0;
     vertex_input_attribute_descriptions[0].location = 0;
     vertex_input_attribute_descriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-    vertex_input_attribute_descriptions[0].offset = offsetof(vertex, position);
+    vertex_input_attribute_descriptions[0].offset = offsetof(mesh_vertex, position);
 
     vertex_input_attribute_descriptions[1].binding = 0;
     vertex_input_attribute_descriptions[1].location = 1;
     vertex_input_attribute_descriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-    vertex_input_attribute_descriptions[1].offset = offsetof(vertex, color);
+    vertex_input_attribute_descriptions[1].offset = offsetof(mesh_vertex, color);
 
     vertex_input_attribute_descriptions[2].binding = 0;
     vertex_input_attribute_descriptions[2].location = 2;
     vertex_input_attribute_descriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-    vertex_input_attribute_descriptions[2].offset = offsetof(vertex, uv);
+    vertex_input_attribute_descriptions[2].offset = offsetof(mesh_vertex, uv);
 
     return vertex_input_attribute_descriptions;
 }
 
-bool vulkan_mesh::load_from_file(const std::string& path)
+/**
+ * \brief Loads the first mesh of a model file and uploads it.
+ * \param path Model file.
+ * \param nodes Optional, receives the node hierarchy of the file.
+ * \return bool
+ */
+bool vulkan_mesh::load_from_file(const std::string& path, scene_graph* nodes)
 {
-    Assimp::Importer importer;
-
-    unsigned int flags = aiProcess_CalcTangentSpace | aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_SortByPType;
-    const aiScene* scene = importer.ReadFile(path, flags);
-
-    if (!scene)
+    if (!data_.load_from_file(path, nodes))
     {
-        std::cerr << importer.GetErrorString() << std::endl;
         return false;
     }
 
-    if (!scene->HasMeshes())
-    {
-        std::cerr << "vulkan_mesh::load_from_file(): model has no meshs" << std::endl;
-    }
-
-    aiMesh* mesh = scene->mMeshes[0];
-    assert(mesh != nullptr && "Mesh is null");
-
-    vertices.resize(mesh->mNumVertices);
-    indices.resize(mesh->mNumFaces * 3);
-
-    aiVector3D* mesh_vertices = mesh->mVertices;
-    for (unsigned int i = 0; i < mesh->mNumVertices; i++)
-    {
-        vertices[i].position = glm::vec3(mesh_vertices[i].x, mesh_vertices[i].y, mesh_vertices[i].z);
-    }
-
-    aiVector3D* mesh_uvs = mesh->mTextureCoords[0];
-    if (mesh_uvs)
-    {
-        for (unsigned int i = 0; i < mesh->mNumVertices; i++)
-        {
-            vertices[i].uv = glm::vec2(mesh_uvs[i].x, 1.0f - mesh_uvs[i].y);
-        }
-    }
-    else
-    {
-        for (unsigned int i = 0; i < mesh->mNumVertices; i++)
-        {
-            vertices[i].uv = glm::vec2(0.0f, 0.0f);
-        }
-    }
-
-    aiColor4D* mesh_colors = mesh->mColors[0];
-    if (mesh_colors)
-    {
-        for (unsigned int i = 0; i < mesh->mNumVertices; i++)
-        {
-            vertices[i].color = glm::vec3(mesh_colors[i].r, mesh_colors[i].g, mesh_colors[i].b);
-        }
-    }
-    else
-    {
-        for (unsigned int i = 0; i < mesh->mNumVertices; i++)
-        {
-            vertices[i].color = glm::vec3(1.0f, 1.0f, 1.0f);
-        }
-    }
-
-    aiFace* mesh_faces = mesh->mFaces;
-    unsigned int index = 0;
-    for (unsigned int i = 0; i < mesh->mNumFaces; i++)
-    {
-        for (unsigned int face_index = 0; face_index < mesh_faces[i].mNumIndices; face_index++)
-        {
-            indices[index++] = mesh_faces[i].mIndices[face_index];
-        }
-    }
-
     // NOTE(dhaval): Upload cpu data to gpu
     clear_gpu_data();
     upload_to_gpu();
@@ -127,73 +64,105 @@ bool vulkan_mesh::load_from_file(const std::string& path)
 }
 
 /**
- * \brief
+ * \brief Builds a simplified copy of the mesh for the occlusion culler. Needs the cpu data, call before clear_cpu_data().
+ * \param max_triangle_count Most triangles to keep, see occluder_mesh::simplify().
+ * \return occluder_mesh
  */
-void vulkan_mesh::create_vertex_buffer()
+occluder_mesh vulkan_mesh::build_occluder_mesh(uint32_t max_triangle_count) const
 {
-    VkDeviceSize buffer_size = sizeof(vertex) * vertices.size();
+    return occluder_mesh::simplify(data_.vertices.data(), data_.vertices.size(), sizeof(mesh_vertex), data_.indices.data(), data_.indices.size(), max_triangle_count);
+}
 
-    VkBuffer staging_buffer = VK_NULL_HANDLE;
-    VkDeviceMemory staging_buffer_memory = VK_NULL_HANDLE;
+/**
+ * \brief Takes over mesh data that was parsed elsewhere, e.g. on a loader thread. Call upload_to_gpu() or record_upload() next.
+ * \param data Parsed mesh.
+ */
+void vulkan_mesh::set_data(mesh_data&& data)
+{
+    clear_gpu_data();
+    data_ = std::move(data);
+}
+
+/**
+ * \brief Staging memory record_upload() needs, the vertices followed by the indices.
+ * \return VkDeviceSize
+ */
+VkDeviceSize vulkan_mesh::get_upload_size() const
+{
+    return sizeof(mesh_vertex) * data_.vertices.size() + sizeof(uint32_t) * data_.indices.size();
+}
+
+/**
+ * \brief Creates the vertex and index buffers and records their copy from a staging buffer. The buffers may be used once the command buffer completed.
+ * \param command_buffer Command buffer in the recording state.
+ * \param staging_buffer Host visible buffer the copies read from.
+ * \param staging_offset Offset of get_upload_size() bytes reserved for this mesh in the staging buffer.
+ * \param staging_data Mapped pointer to the start of the staging buffer.
+ */
+void vulkan_mesh::record_upload(VkCommandBuffer command_buffer, VkBuffer staging_buffer, VkDeviceSize staging_offset, void* staging_data)
+{
+    VkDeviceSize vertex_buffer_size = sizeof(mesh_vertex) * data_.vertices.size();
+    VkDeviceSize index_buffer_size = sizeof(uint32_t) * data_.indices.size();
 
-    vulkan_utils::create_buffer(vk_renderer_context_, buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vk_vertex_buffer_,
+    vulkan_utils::create_buffer(vk_renderer_context_, vertex_buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vk_vertex_buffer_,
                                 vk_vertex_buffer_memory_);
 
-    // NOTE(dhaval): Create staging buffer.
-    vulkan_utils::create_buffer(vk_renderer_context_, buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging_buffer,
-                                staging_buffer_memory);
+    vulkan_utils::create_buffer(vk_renderer_context_, index_buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vk_index_buffer_,
+                                vk_index_buffer_memory_);
 
     // NOTE(dhaval): Fill staging buffer.
-    void* data = nullptr;
-    VK_CHECK(vkMapMemory(vk_renderer_context_.vk_device_, staging_buffer_memory, 0, buffer_size, 0, &data));
-    memcpy(data, vertices.data(), static_cast<size_t>(buffer_size));
-    vkUnmapMemory(vk_renderer_context_.vk_device_, staging_buffer_memory);
+    uint8_t* staging_bytes = static_cast<uint8_t*>(staging_data) + staging_offset;
+    memcpy(staging_bytes, data_.vertices.data(), static_cast<size_t>(vertex_buffer_size));
+    memcpy(staging_bytes + vertex_buffer_size, data_.indices.data(), static_cast<size_t>(index_buffer_size));
 
     // NOTE(dhaval): Transfer to GPU local memory.
-    vulkan_utils::copy_buffer(vk_renderer_context_, staging_buffer, vk_vertex_buffer_, buffer_size);
-
-    // NOTE(dhaval): Destroy staging buffer.
-    vkDestroyBuffer(vk_renderer_context_.vk_device_, staging_buffer, nullptr);
-    vkFreeMemory(vk_renderer_context_.vk_device_, staging_buffer_memory, nullptr);
+    VkBufferCopy vertex_buffer_copy{};
+    vertex_buffer_copy.srcOffset = staging_offset;
+    vertex_buffer_copy.size = vertex_buffer_size;
+    vkCmdCopyBuffer(command_buffer, staging_buffer, vk_vertex_buffer_, 1, &vertex_buffer_copy);
+
+    VkBufferCopy index_buffer_copy{};
+    index_buffer_copy.srcOffset = staging_offset + vertex_buffer_size;
+    index_buffer_copy.size = index_buffer_size;
+    vkCmdCopyBuffer(command_buffer, staging_buffer, vk_index_buffer_, 1, &index_buffer_copy);
+
+    // NOTE(dhaval): Makes the copies visible to vertex input of any later submission.
+    VkMemoryBarrier memory_barrier{};
+    memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    memory_barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
 }
 
 /**
- * \brief
+ * \brief Uploads the cpu data through its own staging buffer and waits for the copy.
  */
-void vulkan_mesh::create_index_buffer()
+void vulkan_mesh::upload_to_gpu()
 {
-    VkDeviceSize buffer_size = sizeof(uint32_t) * indices.size();
+    VkDeviceSize upload_size = get_upload_size();
 
     VkBuffer staging_buffer = VK_NULL_HANDLE;
     VkDeviceMemory staging_buffer_memory = VK_NULL_HANDLE;
 
-    vulkan_utils::create_buffer(vk_renderer_context_, buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vk_index_buffer_,
-                                vk_index_buffer_memory_);
-
     // NOTE(dhaval): Create staging buffer.
-    vulkan_utils::create_buffer(vk_renderer_context_, buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging_buffer,
+    vulkan_utils::create_buffer(vk_renderer_context_, upload_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging_buffer,
                                 staging_buffer_memory);
 
-    // NOTE(dhaval): Fill staging buffer.
     void* data = nullptr;
-    VK_CHECK(vkMapMemory(vk_renderer_context_.vk_device_, staging_buffer_memory, 0, buffer_size, 0, &data));
-    memcpy(data, indices.data(), static_cast<size_t>(buffer_size));
-    vkUnmapMemory(vk_renderer_context_.vk_device_, staging_buffer_memory);
+    VK_CHECK(vkMapMemory(vk_renderer_context_.vk_device_, staging_buffer_memory, 0, upload_size, 0, &data));
 
-    // NOTE(dhaval): Transfer to GPU local memory.
-    vulkan_utils::copy_buffer(vk_renderer_context_, staging_buffer, vk_index_buffer_, buffer_size);
+    VkCommandBuffer command_buffer = vulkan_utils::begin_single_time_commands(vk_renderer_context_);
+    record_upload(command_buffer, staging_buffer, 0, data);
+    vulkan_utils::end_single_time_commands(vk_renderer_context_, command_buffer);
+
+    vkUnmapMemory(vk_renderer_context_.vk_device_, staging_buffer_memory);
 
     // NOTE(dhaval): Destroy staging buffer.
     vkDestroyBuffer(vk_renderer_context_.vk_device_, staging_buffer, nullptr);
     vkFreeMemory(vk_renderer_context_.vk_device_, staging_buffer_memory, nullptr);
 }
 
-void vulkan_mesh::upload_to_gpu()
-{
-    create_vertex_buffer();
-    create_index_buffer();
-}
-
 void vulkan_mesh::clear_gpu_data()
 {
     vkDestroyBuffer(vk_renderer_context_.vk_device_, vk_vertex_buffer_, nullptr);
@@ -211,7 +180,6 @@ void vulkan_mesh::clear_gpu_data()
 
 void vulkan_mesh::clear_cpu_data()
 {
-    vertices.clear();
-    indices.clear();
+    data_.clear();
 }
 
@@ -2,12 +2,11 @@
 
 #include <volk.h>
 
-#include <glm/glm.hpp>
-
 #include <array>
-#include <vector>
 #include <string>
 
+#include "MeshData.hpp"
+#include "OcclusionCuller.hpp"
 #include "VulkanRendererContext.hpp"
 
 class vulkan_mesh
@@ -21,33 +20,29 @@ public:
 
     inline VkBuffer get_vertex_buffer() const { return vk_vertex_buffer_; }
     inline VkBuffer get_index_buffer() const { return vk_index_buffer_; }
-    inline uint32_t get_num_indices() const { return static_cast<uint32_t>(indices.size()); }
+    inline uint32_t get_num_indices() const { return static_cast<uint32_t>(data_.indices.size()); }
+    inline const bounding_volume& get_bounds() const { return data_.bounds; }
+
+    occluder_mesh build_occluder_mesh(uint32_t max_triangle_count) const;
 
     static VkVertexInputBindingDescription get_vertex_input_binding_description();
     static std::array<VkVertexInputAttributeDescription, 3> get_vertex_input_attribute_descriptions();
 
-    bool load_from_file(const std::string& path);
+    bool load_from_file(const std::string& path, scene_graph* nodes = nullptr);
+    void set_data(mesh_data&& data);
+
+    VkDeviceSize get_upload_size() const;
+    void record_upload(VkCommandBuffer command_buffer, VkBuffer staging_buffer, VkDeviceSize staging_offset, void* staging_data);
 
     void upload_to_gpu();
     void clear_gpu_data();
     void clear_cpu_data();
 
-private:
-    void create_vertex_buffer();
-    void create_index_buffer();
-
 private:
     vulkan_renderer_context vk_renderer_context_;
 
-    struct vertex
-    {
-        glm::vec3 position;
-        glm::vec3 color;
-        glm::vec2 uv;
-    };
-
-    std::vector<vertex> vertices;
-    std::vector<uint32_t> indices;
+    // NOTE(dhaval): The bounds are kept when the cpu data is cleared.
+    mesh_data data_;
 
     VkBuffer vk_vertex_buffer_{VK_NULL_HANDLE};
     VkDeviceMemory vk_vertex_buffer_memory_{VK_NULL_HANDLE};
@@ -0,0 +1,143 @@
+#include "VulkanPipelineCache.hpp"
+#include "VulkanUtils.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+/**
+ * \brief Creates the pipeline cache, seeding it with the data stored at path if that data was written by the same driver and device.
+ * \param path File the cache is loaded from and saved to.
+ */
+void vulkan_pipeline_cache::init(const std::string& path)
+{
+    path_ = path;
+    warm_ = false;
+
+    std::vector<char> data;
+
+    std::ifstream file(path_, std::ios::ate | std::ios::binary);
+    if (file.is_open())
+    {
+        size_t file_size = static_cast<size_t>(file.tellg());
+        data.resize(file_size);
+
+        file.seekg(0);
+        file.read(data.data(), file_size);
+        file.close();
+    }
+
+    if (!data.empty() && !is_compatible(data))
+    {
+        std::cout << "vulkan_pipeline_cache: " << path_ << " was created by another driver or device, starting cold" << std::endl;
+        data.clear();
+    }
+
+    VkPipelineCacheCreateInfo pipeline_cache_create_info{};
+    pipeline_cache_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    pipeline_cache_create_info.initialDataSize = data.size();
+    pipeline_cache_create_info.pInitialData = data.empty() ? nullptr : data.data();
+
+    VkResult result = vkCreatePipelineCache(vk_renderer_context_.vk_device_, &pipeline_cache_create_info, nullptr, &vk_pipeline_cache_);
+
+    // NOTE(dhaval): Drivers may still reject data that passed the header check, fall back to an empty cache.
+    if (result != VK_SUCCESS && !data.empty())
+    {
+        pipeline_cache_create_info.initialDataSize = 0;
+        pipeline_cache_create_info.pInitialData = nullptr;
+        data.clear();
+
+        result = vkCreatePipelineCache(vk_renderer_context_.vk_device_, &pipeline_cache_create_info, nullptr, &vk_pipeline_cache_);
+    }
+
+    VK_CHECK(result);
+
+    warm_ = !data.empty();
+    std::cout << "vulkan_pipeline_cache: " << (warm_ ? "warm" : "cold") << " start (" << data.size() << " bytes loaded from " << path_ << ")" << std::endl;
+}
+
+/**
+ * \brief Saves the cache to disk and destroys it.
+ */
+void vulkan_pipeline_cache::shutdown()
+{
+    if (vk_pipeline_cache_ == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    save();
+
+    vkDestroyPipelineCache(vk_renderer_context_.vk_device_, vk_pipeline_cache_, nullptr);
+    vk_pipeline_cache_ = VK_NULL_HANDLE;
+}
+
+/**
+ * \brief Writes the cache contents to a temporary file and renames it over the previous cache, so a crash never leaves a truncated cache behind.
+ * \return bool
+ */
+bool vulkan_pipeline_cache::save() const
+{
+    size_t data_size = 0;
+    VK_CHECK(vkGetPipelineCacheData(vk_renderer_context_.vk_device_, vk_pipeline_cache_, &data_size, nullptr));
+
+    std::vector<char> data(data_size);
+    VK_CHECK(vkGetPipelineCacheData(vk_renderer_context_.vk_device_, vk_pipeline_cache_, &data_size, data.data()));
+
+    const std::string temporary_path = path_ + ".tmp";
+
+    std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        std::cerr << "vulkan_pipeline_cache::save(): can't open " << temporary_path << std::endl;
+        return false;
+    }
+
+    file.write(data.data(), data_size);
+    file.close();
+
+    if (file.fail())
+    {
+        std::cerr << "vulkan_pipeline_cache::save(): can't write " << temporary_path << std::endl;
+        return false;
+    }
+
+    std::error_code error_code;
+    std::filesystem::rename(temporary_path, path_, error_code);
+
+    if (error_code)
+    {
+        std::cerr << "vulkan_pipeline_cache::save(): can't replace " << path_ << ": " << error_code.message() << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * \brief Checks the pipeline cache header against the current physical device.
+ * \param data Pipeline cache data as returned by vkGetPipelineCacheData.
+ * \return bool
+ */
+bool vulkan_pipeline_cache::is_compatible(const std::vector<char>& data) const
+{
+    VkPipelineCacheHeaderVersionOne header{};
+    if (data.size() < sizeof(header))
+    {
+        return false;
+    }
+
+    memcpy(&header, data.data(), sizeof(header));
+
+    if (header.headerSize < sizeof(header) || header.headerSize > data.size() || header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE)
+    {
+        return false;
+    }
+
+    VkPhysicalDeviceProperties physical_device_properties;
+    vkGetPhysicalDeviceProperties(vk_renderer_context_.vk_physical_device_, &physical_device_properties);
+
+    return header.vendorID == physical_device_properties.vendorID && header.deviceID == physical_device_properties.deviceID
+        && memcmp(header.pipelineCacheUUID, physical_device_properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <volk.h>
+
+#include <string>
+#include <vector>
+
+#include "VulkanRendererContext.hpp"
+
+/**
+ * \brief VkPipelineCache that is loaded from and saved to disk so that driver side shader compilation survives between runs.
+ */
+class vulkan_pipeline_cache
+{
+public:
+    vulkan_pipeline_cache(const vulkan_renderer_context& renderer_context) : vk_renderer_context_(renderer_context)
+    {
+    }
+
+    void init(const std::string& path);
+    void shutdown();
+
+    bool save() const;
+
+    inline VkPipelineCache get_pipeline_cache() const { return vk_pipeline_cache_; }
+    inline bool is_warm() const { return warm_; }
+
+private:
+    bool is_compatible(const std::vector<char>& data) const;
+
+private:
+    vulkan_renderer_context vk_renderer_context_;
+
+    std::string path_;
+    VkPipelineCache vk_pipeline_cache_{VK_NULL_HANDLE};
+    bool warm_{false};
+};
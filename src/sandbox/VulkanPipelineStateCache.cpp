@@ -0,0 +1,504 @@
+#include "VulkanPipelineStateCache.hpp"
+#include "VulkanUtils.hpp"
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+
+/**
+ * \brief Folds the bytes of a value into a 64 bit FNV-1a hash.
+ * \param hash Running hash value.
+ * \param value Value to fold into the hash. Must not contain padding bytes.
+ */
+template <typename T>
+static void hash_value(uint64_t& hash, const T& value)
+{
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&value);
+    for (size_t i = 0; i < sizeof(T); i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+}
+
+/**
+ * \brief Computes a hash over every field of the description. Equal descriptions always produce equal hashes.
+ * \return uint64_t
+ */
+uint64_t pipeline_description::hash() const
+{
+    uint64_t hash = 14695981039346656037ull;
+
+    hash_value(hash, vertex_shader);
+    hash_value(hash, fragment_shader);
+    hash_value(hash, specialization_mask);
+
+    hash_value(hash, vertex_bindings.size());
+    for (const VkVertexInputBindingDescription& binding : vertex_bindings)
+    {
+        hash_value(hash, binding.binding);
+        hash_value(hash, binding.stride);
+        hash_value(hash, binding.inputRate);
+    }
+
+    hash_value(hash, vertex_attributes.size());
+    for (const VkVertexInputAttributeDescription& attribute : vertex_attributes)
+    {
+        hash_value(hash, attribute.location);
+        hash_value(hash, attribute.binding);
+        hash_value(hash, attribute.format);
+        hash_value(hash, attribute.offset);
+    }
+
+    hash_value(hash, topology);
+
+    hash_value(hash, polygon_mode);
+    hash_value(hash, cull_mode);
+    hash_value(hash, front_face);
+    hash_value(hash, samples);
+
+    hash_value(hash, depth_test);
+    hash_value(hash, depth_write);
+    hash_value(hash, depth_compare_op);
+
+    hash_value(hash, blend_enable);
+    hash_value(hash, src_color_blend_factor);
+    hash_value(hash, dst_color_blend_factor);
+    hash_value(hash, color_blend_op);
+    hash_value(hash, src_alpha_blend_factor);
+    hash_value(hash, dst_alpha_blend_factor);
+    hash_value(hash, alpha_blend_op);
+
+    hash_value(hash, pipeline_layout);
+    hash_value(hash, render_pass);
+    hash_value(hash, subpass);
+
+    return hash;
+}
+
+/**
+ * \brief Field by field comparison, used to resolve hash collisions.
+ * \param other Description to compare against.
+ * \return bool
+ */
+bool pipeline_description::operator==(const pipeline_description& other) const
+{
+    auto bindings_equal = [](const VkVertexInputBindingDescription& a, const VkVertexInputBindingDescription& b)
+    {
+        return a.binding == b.binding && a.stride == b.stride && a.inputRate == b.inputRate;
+    };
+
+    auto attributes_equal = [](const VkVertexInputAttributeDescription& a, const VkVertexInputAttributeDescription& b)
+    {
+        return a.location == b.location && a.binding == b.binding && a.format == b.format && a.offset == b.offset;
+    };
+
+    return vertex_shader == other.vertex_shader && fragment_shader == other.fragment_shader && specialization_mask == other.specialization_mask
+        && std::equal(vertex_bindings.begin(), vertex_bindings.end(), other.vertex_bindings.begin(), other.vertex_bindings.end(), bindings_equal)
+        && std::equal(vertex_attributes.begin(), vertex_attributes.end(), other.vertex_attributes.begin(), other.vertex_attributes.end(), attributes_equal)
+        && topology == other.topology
+        && polygon_mode == other.polygon_mode && cull_mode == other.cull_mode && front_face == other.front_face && samples == other.samples
+        && depth_test == other.depth_test && depth_write == other.depth_write && depth_compare_op == other.depth_compare_op
+        && blend_enable == other.blend_enable && src_color_blend_factor == other.src_color_blend_factor && dst_color_blend_factor == other.dst_color_blend_factor
+        && color_blend_op == other.color_blend_op && src_alpha_blend_factor == other.src_alpha_blend_factor && dst_alpha_blend_factor == other.dst_alpha_blend_factor
+        && alpha_blend_op == other.alpha_blend_op && pipeline_layout == other.pipeline_layout && render_pass == other.render_pass && subpass == other.subpass;
+}
+
+/**
+ * \brief Starts the background compilation threads.
+ * \param worker_count Number of threads that compile missing pipelines. Zero compiles every miss inline.
+ */
+void vulkan_pipeline_state_cache::init(uint32_t worker_count)
+{
+    stop_workers_ = false;
+    statistics_ = {};
+
+    for (uint32_t i = 0; i < worker_count; i++)
+    {
+        workers_.emplace_back(&vulkan_pipeline_state_cache::worker_main, this);
+    }
+}
+
+/**
+ * \brief Stops the background threads and destroys every pipeline owned by the cache. Queued compilations are dropped.
+ */
+void vulkan_pipeline_state_cache::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_workers_ = true;
+    }
+
+    work_available_.notify_all();
+
+    for (std::thread& worker : workers_)
+    {
+        worker.join();
+    }
+
+    workers_.clear();
+    pending_entries_.clear();
+
+    for (const auto& entry : entries_)
+    {
+        vkDestroyPipeline(vk_renderer_context_.vk_device_, entry->pipeline, nullptr);
+    }
+
+    entries_.clear();
+    lookup_.clear();
+
+    vk_fallback_pipeline_ = VK_NULL_HANDLE;
+}
+
+/**
+ * \brief Returns the pipeline for the description. On a miss the pipeline is queued for background compilation
+ *        and the fallback pipeline is returned until it is ready. Without workers or a fallback the miss is compiled inline.
+ * \param description Pipeline to look up.
+ * \return VkPipeline
+ */
+VkPipeline vulkan_pipeline_state_cache::get_pipeline(const pipeline_description& description)
+{
+    const uint64_t hash = description.hash();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    pipeline_entry* entry = find_entry(description, hash);
+    if (entry != nullptr && !entry->pending)
+    {
+        statistics_.hit_count++;
+        return entry->pipeline;
+    }
+
+    if (entry != nullptr)
+    {
+        if (vk_fallback_pipeline_ != VK_NULL_HANDLE)
+        {
+            statistics_.fallback_count++;
+            return vk_fallback_pipeline_;
+        }
+
+        work_finished_.wait(lock, [entry]() { return !entry->pending; });
+        return entry->pipeline;
+    }
+
+    statistics_.miss_count++;
+
+    entry = insert_entry(description, hash);
+
+    if (!workers_.empty() && vk_fallback_pipeline_ != VK_NULL_HANDLE)
+    {
+        pending_entries_.push_back(entry);
+        work_available_.notify_one();
+
+        statistics_.fallback_count++;
+        return vk_fallback_pipeline_;
+    }
+
+    lock.unlock();
+    VkPipeline pipeline = create_pipeline(entry->description);
+    lock.lock();
+
+    entry->pipeline = pipeline;
+    entry->pending = false;
+    statistics_.pipeline_count++;
+
+    work_finished_.notify_all();
+
+    return pipeline;
+}
+
+/**
+ * \brief Returns the pipeline for the description, waiting for or compiling it inline if it isn't ready yet. Never returns the fallback.
+ * \param description Pipeline to look up.
+ * \return VkPipeline
+ */
+VkPipeline vulkan_pipeline_state_cache::get_pipeline_blocking(const pipeline_description& description)
+{
+    const uint64_t hash = description.hash();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    pipeline_entry* entry = find_entry(description, hash);
+    if (entry != nullptr)
+    {
+        if (entry->pending)
+        {
+            work_finished_.wait(lock, [entry]() { return !entry->pending; });
+        }
+        else
+        {
+            statistics_.hit_count++;
+        }
+
+        return entry->pipeline;
+    }
+
+    statistics_.miss_count++;
+
+    entry = insert_entry(description, hash);
+
+    lock.unlock();
+    VkPipeline pipeline = create_pipeline(entry->description);
+    lock.lock();
+
+    entry->pipeline = pipeline;
+    entry->pending = false;
+    statistics_.pipeline_count++;
+
+    work_finished_.notify_all();
+
+    return pipeline;
+}
+
+/**
+ * \brief Compiles the description inline and uses it in place of any pipeline that is still being compiled.
+ * \param description Pipeline to use as fallback. Must be compatible with the render passes it stands in for.
+ */
+void vulkan_pipeline_state_cache::set_fallback_pipeline(const pipeline_description& description)
+{
+    VkPipeline pipeline = get_pipeline_blocking(description);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    vk_fallback_pipeline_ = pipeline;
+}
+
+/**
+ * \brief
+ * \return pipeline_state_cache_statistics
+ */
+pipeline_state_cache_statistics vulkan_pipeline_state_cache::get_statistics() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return statistics_;
+}
+
+/**
+ * \brief Looks up an entry. The cache mutex must be held.
+ * \param description Description to look up.
+ * \param hash Hash of the description.
+ * \return pipeline_entry*
+ */
+vulkan_pipeline_state_cache::pipeline_entry* vulkan_pipeline_state_cache::find_entry(const pipeline_description& description, uint64_t hash) const
+{
+    auto range = lookup_.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (it->second->description == description)
+        {
+            return it->second;
+        }
+    }
+
+    return nullptr;
+}
+
+/**
+ * \brief Adds a pending entry. The cache mutex must be held.
+ * \param description Description of the new entry.
+ * \param hash Hash of the description.
+ * \return pipeline_entry*
+ */
+vulkan_pipeline_state_cache::pipeline_entry* vulkan_pipeline_state_cache::insert_entry(const pipeline_description& description, uint64_t hash)
+{
+    entries_.push_back(std::make_unique<pipeline_entry>());
+
+    pipeline_entry* entry = entries_.back().get();
+    entry->description = description;
+    entry->hash = hash;
+    entry->pending = true;
+
+    lookup_.emplace(hash, entry);
+
+    return entry;
+}
+
+/**
+ * \brief Background thread that compiles queued pipelines.
+ */
+void vulkan_pipeline_state_cache::worker_main()
+{
+    while (true)
+    {
+        pipeline_entry* entry = nullptr;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_available_.wait(lock, [this]() { return stop_workers_ || !pending_entries_.empty(); });
+
+            if (stop_workers_)
+            {
+                return;
+            }
+
+            entry = pending_entries_.front();
+            pending_entries_.pop_front();
+        }
+
+        VkPipeline pipeline = create_pipeline(entry->description);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            entry->pipeline = pipeline;
+            entry->pending = false;
+            statistics_.pipeline_count++;
+        }
+
+        work_finished_.notify_all();
+    }
+}
+
+/**
+ * \brief Builds the fixed function state for a description and creates the pipeline through the shared VkPipelineCache.
+ * \param description Pipeline to create.
+ * \return VkPipeline
+ */
+VkPipeline vulkan_pipeline_state_cache::create_pipeline(const pipeline_description& description) const
+{
+    // NOTE(dhaval): Creating Shader Stages.
+    VkPipelineShaderStageCreateInfo vertex_shader_stage_create_info{};
+    vertex_shader_stage_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    vertex_shader_stage_create_info.stage = VK_SHADER_STAGE_VERTEX_BIT;
+    vertex_shader_stage_create_info.module = description.vertex_shader;
+    vertex_shader_stage_create_info.pName = "main";
+
+    // NOTE(dhaval): Every constant is specialized, disabled features compile out of the pipeline. Ids the shader doesn't declare are ignored.
+    std::array<VkBool32, pipeline_specialization_constant_count> specialization_values{};
+    std::array<VkSpecializationMapEntry, pipeline_specialization_constant_count> specialization_map_entries{};
+
+    for (uint32_t i = 0; i < pipeline_specialization_constant_count; i++)
+    {
+        specialization_values[i] = (description.specialization_mask & (1u << i)) != 0 ? VK_TRUE : VK_FALSE;
+
+        specialization_map_entries[i].constantID = i;
+        specialization_map_entries[i].offset = i * sizeof(VkBool32);
+        specialization_map_entries[i].size = sizeof(VkBool32);
+    }
+
+    VkSpecializationInfo specialization_info{};
+    specialization_info.mapEntryCount = static_cast<uint32_t>(specialization_map_entries.size());
+    specialization_info.pMapEntries = specialization_map_entries.data();
+    specialization_info.dataSize = sizeof(specialization_values);
+    specialization_info.pData = specialization_values.data();
+
+    VkPipelineShaderStageCreateInfo fragment_shader_stage_create_info{};
+    fragment_shader_stage_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    fragment_shader_stage_create_info.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    fragment_shader_stage_create_info.module = description.fragment_shader;
+    fragment_shader_stage_create_info.pName = "main";
+    fragment_shader_stage_create_info.pSpecializationInfo = &specialization_info;
+
+    VkPipelineShaderStageCreateInfo shader_stages[] = {vertex_shader_stage_create_info, fragment_shader_stage_create_info};
+
+    // NOTE(dhaval): Creating Vertex Input.
+    VkPipelineVertexInputStateCreateInfo vertex_input_state_create_info{};
+    vertex_input_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertex_input_state_create_info.vertexBindingDescriptionCount = static_cast<uint32_t>(description.vertex_bindings.size());
+    vertex_input_state_create_info.pVertexBindingDescriptions = description.vertex_bindings.data();
+    vertex_input_state_create_info.vertexAttributeDescriptionCount = static_cast<uint32_t>(description.vertex_attributes.size());
+    vertex_input_state_create_info.pVertexAttributeDescriptions = description.vertex_attributes.data();
+
+    // NOTE(dhaval): Creating Input Assembly.
+    VkPipelineInputAssemblyStateCreateInfo input_assembly_state_create_info{};
+    input_assembly_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    input_assembly_state_create_info.topology = description.topology;
+    input_assembly_state_create_info.primitiveRestartEnable = VK_FALSE;
+
+    // NOTE(dhaval): Creating Viewport State. Viewport and scissor are dynamic, so pipelines don't depend on the swapchain size.
+    VkPipelineViewportStateCreateInfo viewport_state_create_info{};
+    viewport_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewport_state_create_info.viewportCount = 1;
+    viewport_state_create_info.pViewports = nullptr;
+    viewport_state_create_info.scissorCount = 1;
+    viewport_state_create_info.pScissors = nullptr;
+
+    // NOTE(dhaval): Create Rasterizer State.
+    VkPipelineRasterizationStateCreateInfo rasterization_state_create_info{};
+    rasterization_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterization_state_create_info.depthClampEnable = VK_FALSE;
+    rasterization_state_create_info.rasterizerDiscardEnable = VK_FALSE;
+    rasterization_state_create_info.polygonMode = description.polygon_mode;
+    rasterization_state_create_info.lineWidth = 1.0f;
+    rasterization_state_create_info.cullMode = description.cull_mode;
+    rasterization_state_create_info.frontFace = description.front_face;
+    rasterization_state_create_info.depthBiasEnable = VK_FALSE;
+    rasterization_state_create_info.depthBiasConstantFactor = 0.0f;
+    rasterization_state_create_info.depthBiasClamp = 0.0f;
+    rasterization_state_create_info.depthBiasSlopeFactor = 0.0f;
+
+    // NOTE(dhaval): Create MultiSampling State.
+    VkPipelineMultisampleStateCreateInfo multisample_state_create_info{};
+    multisample_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisample_state_create_info.sampleShadingEnable = VK_FALSE;
+    multisample_state_create_info.rasterizationSamples = description.samples;
+    multisample_state_create_info.minSampleShading = 1.0f;
+    multisample_state_create_info.pSampleMask = nullptr;
+    multisample_state_create_info.alphaToCoverageEnable = VK_FALSE;
+    multisample_state_create_info.alphaToOneEnable = VK_FALSE;
+
+    // NOTE(dhaval): Create Depth Stencil State.
+    VkPipelineDepthStencilStateCreateInfo depth_stencil_state_create_info{};
+    depth_stencil_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depth_stencil_state_create_info.depthTestEnable = description.depth_test ? VK_TRUE : VK_FALSE;
+    depth_stencil_state_create_info.depthWriteEnable = description.depth_write ? VK_TRUE : VK_FALSE;
+    depth_stencil_state_create_info.depthCompareOp = description.depth_compare_op;
+    depth_stencil_state_create_info.depthBoundsTestEnable = VK_FALSE;
+    depth_stencil_state_create_info.minDepthBounds = 0.0f;
+    depth_stencil_state_create_info.maxDepthBounds = 1.0f;
+    depth_stencil_state_create_info.stencilTestEnable = VK_FALSE;
+    depth_stencil_state_create_info.front = {};
+    depth_stencil_state_create_info.back = {};
+
+    // NOTE(dhaval): Create Color Blend State.
+    VkPipelineColorBlendAttachmentState color_blend_attachment_state{};
+    color_blend_attachment_state.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    color_blend_attachment_state.blendEnable = description.blend_enable ? VK_TRUE : VK_FALSE;
+    color_blend_attachment_state.srcColorBlendFactor = description.src_color_blend_factor;
+    color_blend_attachment_state.dstColorBlendFactor = description.dst_color_blend_factor;
+    color_blend_attachment_state.colorBlendOp = description.color_blend_op;
+    color_blend_attachment_state.srcAlphaBlendFactor = description.src_alpha_blend_factor;
+    color_blend_attachment_state.dstAlphaBlendFactor = description.dst_alpha_blend_factor;
+    color_blend_attachment_state.alphaBlendOp = description.alpha_blend_op;
+
+    VkPipelineColorBlendStateCreateInfo color_blend_state_create_info{};
+    color_blend_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    color_blend_state_create_info.logicOpEnable = VK_FALSE;
+    color_blend_state_create_info.logicOp = VK_LOGIC_OP_COPY;
+    color_blend_state_create_info.attachmentCount = 1;
+    color_blend_state_create_info.pAttachments = &color_blend_attachment_state;
+    color_blend_state_create_info.blendConstants[0] = 0.0f;
+    color_blend_state_create_info.blendConstants[1] = 0.0f;
+    color_blend_state_create_info.blendConstants[2] = 0.0f;
+    color_blend_state_create_info.blendConstants[3] = 0.0f;
+
+    // NOTE(dhaval): Create Pipeline Dynamic State.
+    VkDynamicState dynamic_states[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+
+    VkPipelineDynamicStateCreateInfo dynamic_state_create_info{};
+    dynamic_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamic_state_create_info.dynamicStateCount = 2;
+    dynamic_state_create_info.pDynamicStates = dynamic_states;
+
+    // NOTE(dhaval): Create Graphics Pipeline;
+    VkGraphicsPipelineCreateInfo graphics_pipeline_create_info{};
+    graphics_pipeline_create_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    graphics_pipeline_create_info.stageCount = 2;
+    graphics_pipeline_create_info.pStages = shader_stages;
+    graphics_pipeline_create_info.pVertexInputState = &vertex_input_state_create_info;
+    graphics_pipeline_create_info.pInputAssemblyState = &input_assembly_state_create_info;
+    graphics_pipeline_create_info.pViewportState = &viewport_state_create_info;
+    graphics_pipeline_create_info.pRasterizationState = &rasterization_state_create_info;
+    graphics_pipeline_create_info.pMultisampleState = &multisample_state_create_info;
+    graphics_pipeline_create_info.pDepthStencilState = &depth_stencil_state_create_info;
+    graphics_pipeline_create_info.pColorBlendState = &color_blend_state_create_info;
+    graphics_pipeline_create_info.pDynamicState = &dynamic_state_create_info;
+    graphics_pipeline_create_info.layout = description.pipeline_layout;
+    graphics_pipeline_create_info.renderPass = description.render_pass;
+    graphics_pipeline_create_info.subpass = description.subpass;
+    graphics_pipeline_create_info.basePipelineHandle = VK_NULL_HANDLE;
+    graphics_pipeline_create_info.basePipelineIndex = -1;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VK_CHECK(vkCreateGraphicsPipelines(vk_renderer_context_.vk_device_, vk_renderer_context_.vk_pipeline_cache_, 1, &graphics_pipeline_create_info, nullptr, &pipeline));
+
+    return pipeline;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <volk.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "VulkanRendererContext.hpp"
+
+static const uint32_t pipeline_specialization_constant_count = 8;
+
+/**
+ * \brief Full description of a graphics pipeline. Two equal descriptions always map to the same VkPipeline.
+ */
+struct pipeline_description
+{
+    VkShaderModule vertex_shader{VK_NULL_HANDLE};
+    VkShaderModule fragment_shader{VK_NULL_HANDLE};
+
+    // NOTE(dhaval): Bit i is the VkBool32 specialization constant with constant_id i of the fragment shader, for i < pipeline_specialization_constant_count.
+    uint32_t specialization_mask{0};
+
+    std::vector<VkVertexInputBindingDescription> vertex_bindings;
+    std::vector<VkVertexInputAttributeDescription> vertex_attributes;
+
+    VkPrimitiveTopology topology{VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST};
+
+    VkPolygonMode polygon_mode{VK_POLYGON_MODE_FILL};
+    VkCullModeFlags cull_mode{VK_CULL_MODE_BACK_BIT};
+    VkFrontFace front_face{VK_FRONT_FACE_COUNTER_CLOCKWISE};
+    VkSampleCountFlagBits samples{VK_SAMPLE_COUNT_1_BIT};
+
+    bool depth_test{true};
+    bool depth_write{true};
+    VkCompareOp depth_compare_op{VK_COMPARE_OP_LESS};
+
+    bool blend_enable{false};
+    VkBlendFactor src_color_blend_factor{VK_BLEND_FACTOR_ONE};
+    VkBlendFactor dst_color_blend_factor{VK_BLEND_FACTOR_ZERO};
+    VkBlendOp color_blend_op{VK_BLEND_OP_ADD};
+    VkBlendFactor src_alpha_blend_factor{VK_BLEND_FACTOR_ONE};
+    VkBlendFactor dst_alpha_blend_factor{VK_BLEND_FACTOR_ZERO};
+    VkBlendOp alpha_blend_op{VK_BLEND_OP_ADD};
+
+    VkPipelineLayout pipeline_layout{VK_NULL_HANDLE};
+    VkRenderPass render_pass{VK_NULL_HANDLE};
+    uint32_t subpass{0};
+
+    uint64_t hash() const;
+    bool operator==(const pipeline_description& other) const;
+};
+
+/**
+ * \brief Counters of the pipeline state cache since it was created.
+ */
+struct pipeline_state_cache_statistics
+{
+    uint32_t hit_count{0};
+    uint32_t miss_count{0};
+    uint32_t fallback_count{0};
+    uint32_t pipeline_count{0};
+};
+
+/**
+ * \brief Hands out one VkPipeline per unique pipeline_description, creating missing pipelines either inline or on background threads.
+ */
+class vulkan_pipeline_state_cache
+{
+public:
+    vulkan_pipeline_state_cache(const vulkan_renderer_context& renderer_context) : vk_renderer_context_(renderer_context)
+    {
+    }
+
+    void init(uint32_t worker_count);
+    void shutdown();
+
+    VkPipeline get_pipeline(const pipeline_description& description);
+    VkPipeline get_pipeline_blocking(const pipeline_description& description);
+
+    void set_fallback_pipeline(const pipeline_description& description);
+
+    pipeline_state_cache_statistics get_statistics() const;
+
+private:
+    struct pipeline_entry
+    {
+        pipeline_description description;
+        uint64_t hash{0};
+        VkPipeline pipeline{VK_NULL_HANDLE};
+        bool pending{false};
+    };
+
+    pipeline_entry* find_entry(const pipeline_description& description, uint64_t hash) const;
+    pipeline_entry* insert_entry(const pipeline_description& description, uint64_t hash);
+
+    VkPipeline create_pipeline(const pipeline_description& description) const;
+    void worker_main();
+
+private:
+    vulkan_renderer_context vk_renderer_context_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable work_available_;
+    std::condition_variable work_finished_;
+
+    std::vector<std::unique_ptr<pipeline_entry>> entries_;
+    std::unordered_multimap<uint64_t, pipeline_entry*> lookup_;
+
+    std::deque<pipeline_entry*> pending_entries_;
+    std::vector<std::thread> workers_;
+    bool stop_workers_{false};
+
+    VkPipeline vk_fallback_pipeline_{VK_NULL_HANDLE};
+
+    pipeline_state_cache_statistics statistics_{};
+};
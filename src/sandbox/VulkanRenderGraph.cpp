@@ -0,0 +1,619 @@
+#include "VulkanRenderGraph.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#include "VulkanUtils.hpp"
+
+/**
+ * \brief Layout, stages and accesses of a render graph usage. Source stages are waited on when leaving the usage, destination stages when entering it.
+ */
+struct usage_state
+{
+    VkImageLayout layout;
+    VkPipelineStageFlags source_stages;
+    VkPipelineStageFlags destination_stages;
+    VkAccessFlags accesses;
+    VkAccessFlags write_accesses;
+};
+
+/**
+ * \brief Maps a render graph usage to what a Vulkan barrier needs.
+ * \param usage Usage to map.
+ * \return usage_state
+ */
+static usage_state get_usage_state(render_graph_usage usage)
+{
+    const VkPipelineStageFlags fragment_tests = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+    switch (usage)
+    {
+    case render_graph_usage::color_attachment:
+        return {VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT};
+    case render_graph_usage::depth_attachment:
+        return {VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, fragment_tests, fragment_tests,
+                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT};
+    case render_graph_usage::depth_read:
+        return {VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, fragment_tests | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, fragment_tests | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_SHADER_READ_BIT, 0};
+    case render_graph_usage::shader_read:
+        return {VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, 0};
+    case render_graph_usage::transfer_source:
+        return {VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, 0};
+    case render_graph_usage::transfer_destination:
+        return {VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_WRITE_BIT};
+    case render_graph_usage::present:
+        // NOTE(dhaval): Acquired swapchain images are waited on at color attachment output, leaving present from there chains the barrier to the acquire semaphore.
+        return {VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0};
+    case render_graph_usage::undefined:
+    default:
+        return {VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, 0};
+    }
+}
+
+/**
+ * \brief Checks if a usage makes the resource an attachment of the pass's render pass.
+ * \param usage Usage to check.
+ * \return bool
+ */
+static bool is_attachment_usage(render_graph_usage usage)
+{
+    return usage == render_graph_usage::color_attachment || usage == render_graph_usage::depth_attachment || usage == render_graph_usage::depth_read;
+}
+
+/**
+ * \brief Compares two attachment descriptions field by field.
+ * \return bool
+ */
+static bool attachment_descriptions_equal(const VkAttachmentDescription& a, const VkAttachmentDescription& b)
+{
+    return a.flags == b.flags && a.format == b.format && a.samples == b.samples && a.loadOp == b.loadOp && a.storeOp == b.storeOp && a.stencilLoadOp == b.stencilLoadOp &&
+           a.stencilStoreOp == b.stencilStoreOp && a.initialLayout == b.initialLayout && a.finalLayout == b.finalLayout;
+}
+
+/**
+ * \brief Destroys the transient images, their memory and the framebuffers, and removes every pass and resource. Cached render passes are kept.
+ *        The device must be done with the frames that used them.
+ */
+void vulkan_render_graph::reset()
+{
+    for (framebuffer_entry& entry : framebuffers_)
+    {
+        vkDestroyFramebuffer(vk_renderer_context_.vk_device_, entry.framebuffer, nullptr);
+    }
+
+    framebuffers_.clear();
+
+    for (image_entry& entry : images_)
+    {
+        if (entry.owned)
+        {
+            vkDestroyImageView(vk_renderer_context_.vk_device_, entry.image_view, nullptr);
+            vkDestroyImage(vk_renderer_context_.vk_device_, entry.image, nullptr);
+        }
+    }
+
+    images_.clear();
+
+    for (VkDeviceMemory memory : vk_memory_blocks_)
+    {
+        vkFreeMemory(vk_renderer_context_.vk_device_, memory, nullptr);
+    }
+
+    vk_memory_blocks_.clear();
+
+    passes_.clear();
+    graph_.reset();
+}
+
+/**
+ * \brief Destroys everything, including the cached render passes.
+ */
+void vulkan_render_graph::shutdown()
+{
+    reset();
+
+    for (render_pass_entry& entry : render_passes_)
+    {
+        vkDestroyRenderPass(vk_renderer_context_.vk_device_, entry.render_pass, nullptr);
+    }
+
+    render_passes_.clear();
+}
+
+/**
+ * \brief Adds an image the graph does not own, like a swapchain image. It can be swapped every frame with set_imported_image().
+ * \param name Name of the image, for debugging.
+ * \param image Image.
+ * \param image_view View used when the image is an attachment.
+ * \param format Format of the image.
+ * \param extent Size of the image.
+ * \param aspect Aspects of the image.
+ * \param initial_usage Usage the image is in when the graph starts.
+ * \param final_usage Usage the image is left in when the graph ends.
+ * \return uint32_t Index of the resource.
+ */
+uint32_t vulkan_render_graph::import_image(const std::string& name, VkImage image, VkImageView image_view, VkFormat format, VkExtent2D extent, VkImageAspectFlags aspect,
+                                           render_graph_usage initial_usage, render_graph_usage final_usage)
+{
+    image_entry entry;
+    entry.image = image;
+    entry.image_view = image_view;
+    entry.description.format = format;
+    entry.description.extent = extent;
+    entry.description.aspect = aspect;
+    entry.owned = false;
+
+    images_.push_back(entry);
+
+    uint32_t resource = graph_.import_resource(name, initial_usage, final_usage);
+    assert(resource == images_.size() - 1 && "Render graph resources out of sync");
+
+    return resource;
+}
+
+/**
+ * \brief Adds a transient image. It is created by compile() and only exists if a surviving pass uses it.
+ * \param name Name of the image, for debugging.
+ * \param description Format, size and usage of the image.
+ * \return uint32_t Index of the resource.
+ */
+uint32_t vulkan_render_graph::create_image(const std::string& name, const render_graph_image_description& description)
+{
+    image_entry entry;
+    entry.description = description;
+    entry.owned = true;
+
+    images_.push_back(entry);
+
+    uint32_t resource = graph_.create_resource(name);
+    assert(resource == images_.size() - 1 && "Render graph resources out of sync");
+
+    return resource;
+}
+
+/**
+ * \brief Marks a resource as a result of the graph, see render_graph::set_output().
+ * \param resource Index of the resource.
+ */
+void vulkan_render_graph::set_output(uint32_t resource)
+{
+    graph_.set_output(resource);
+}
+
+/**
+ * \brief Adds a pass. Its commands are given every frame with set_pass_record().
+ * \param name Name of the pass, for debugging.
+ * \return uint32_t Index of the pass.
+ */
+uint32_t vulkan_render_graph::add_pass(const std::string& name)
+{
+    passes_.emplace_back();
+
+    uint32_t pass = graph_.add_pass(name);
+    assert(pass == passes_.size() - 1 && "Render graph passes out of sync");
+
+    return pass;
+}
+
+/**
+ * \brief Declares that a pass reads a resource, see render_graph::read().
+ */
+void vulkan_render_graph::read(uint32_t pass, uint32_t resource, render_graph_usage usage)
+{
+    graph_.read(pass, resource, usage);
+    passes_[pass].clear_values.push_back({});
+}
+
+/**
+ * \brief Declares that a pass writes a resource, see render_graph::write().
+ * \param clear_value Value attachments are cleared to when load_op is render_graph_load_op::clear.
+ */
+void vulkan_render_graph::write(uint32_t pass, uint32_t resource, render_graph_usage usage, render_graph_load_op load_op, VkClearValue clear_value)
+{
+    graph_.write(pass, resource, usage, load_op);
+    passes_[pass].clear_values.push_back(clear_value);
+}
+
+/**
+ * \brief Compiles the graph, then creates the transient images, allocates one memory block per group of aliased images and builds the render passes.
+ */
+void vulkan_render_graph::compile()
+{
+    graph_.compile([&](uint32_t resource) {
+        image_entry& entry = images_[resource];
+
+        VkImageCreateInfo image_create_info{};
+        image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        image_create_info.imageType = VK_IMAGE_TYPE_2D;
+        image_create_info.extent.width = entry.description.extent.width;
+        image_create_info.extent.height = entry.description.extent.height;
+        image_create_info.extent.depth = 1;
+        image_create_info.mipLevels = 1;
+        image_create_info.arrayLayers = 1;
+        image_create_info.format = entry.description.format;
+        image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        image_create_info.usage = entry.description.usage;
+        image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+        image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VK_CHECK(vkCreateImage(vk_renderer_context_.vk_device_, &image_create_info, nullptr, &entry.image));
+
+        VkMemoryRequirements memory_requirements;
+        vkGetImageMemoryRequirements(vk_renderer_context_.vk_device_, entry.image, &memory_requirements);
+
+        render_graph_memory_requirements requirements;
+        requirements.size = memory_requirements.size;
+        requirements.alignment = memory_requirements.alignment;
+        requirements.memory_type_bits = memory_requirements.memoryTypeBits;
+
+        return requirements;
+    });
+
+    // NOTE(dhaval): Every image of a block is bound at offset 0, their lifetimes never overlap so they can share the memory.
+    for (const render_graph_memory_block& block : graph_.get_memory_blocks())
+    {
+        VkMemoryAllocateInfo memory_allocate_info{};
+        memory_allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        memory_allocate_info.allocationSize = block.size;
+        memory_allocate_info.memoryTypeIndex = vulkan_utils::find_memory_type(vk_renderer_context_, block.memory_type_bits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VK_CHECK(vkAllocateMemory(vk_renderer_context_.vk_device_, &memory_allocate_info, nullptr, &memory));
+        vk_memory_blocks_.push_back(memory);
+
+        for (uint32_t resource : block.resources)
+        {
+            image_entry& entry = images_[resource];
+
+            VK_CHECK(vkBindImageMemory(vk_renderer_context_.vk_device_, entry.image, memory, 0));
+            entry.image_view = vulkan_utils::create_image_2d_view(vk_renderer_context_, entry.image, 1, entry.description.format, entry.description.aspect);
+        }
+    }
+
+    for (uint32_t i = 0; i < passes_.size(); i++)
+    {
+        if (!graph_.is_pass_culled(i))
+        {
+            create_render_pass(i);
+        }
+    }
+}
+
+/**
+ * \brief Builds the render pass of a pass from its attachment accesses: color attachments first, then depth.
+ *        Layouts never change inside the render pass, the graph's barriers transition them beforehand.
+ * \param pass Index of the pass.
+ */
+void vulkan_render_graph::create_render_pass(uint32_t pass)
+{
+    pass_entry& entry = passes_[pass];
+    const std::vector<render_graph_access>& accesses = graph_.get_pass_accesses(pass);
+
+    entry.attachment_accesses.clear();
+    entry.render_pass = VK_NULL_HANDLE;
+
+    uint32_t color_attachment_count = 0;
+    for (uint32_t i = 0; i < accesses.size(); i++)
+    {
+        if (accesses[i].usage == render_graph_usage::color_attachment)
+        {
+            entry.attachment_accesses.push_back(i);
+            color_attachment_count++;
+        }
+    }
+
+    bool has_depth_attachment = false;
+    for (uint32_t i = 0; i < accesses.size(); i++)
+    {
+        if (is_attachment_usage(accesses[i].usage) && accesses[i].usage != render_graph_usage::color_attachment)
+        {
+            assert(!has_depth_attachment && "Render graph pass has more than one depth attachment");
+            entry.attachment_accesses.push_back(i);
+            has_depth_attachment = true;
+        }
+    }
+
+    if (entry.attachment_accesses.empty())
+    {
+        return;
+    }
+
+    std::vector<VkAttachmentDescription> attachments;
+    for (uint32_t access_index : entry.attachment_accesses)
+    {
+        const render_graph_access& access = accesses[access_index];
+        const image_entry& image = images_[access.resource];
+
+        assert(image.description.extent.width == images_[accesses[entry.attachment_accesses[0]].resource].description.extent.width &&
+               image.description.extent.height == images_[accesses[entry.attachment_accesses[0]].resource].description.extent.height && "Render graph attachments differ in size");
+
+        VkAttachmentDescription attachment{};
+        attachment.format = image.description.format;
+        attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        attachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+        if (access.write && access.load_op == render_graph_load_op::clear)
+        {
+            attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        }
+        else if (access.write && access.load_op == render_graph_load_op::dont_care)
+        {
+            attachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        }
+
+        // NOTE(dhaval): Nothing after this pass reads the contents, tiled GPUs can skip writing them back to memory.
+        attachment.storeOp = access.store ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachment.initialLayout = get_usage_state(access.usage).layout;
+        attachment.finalLayout = attachment.initialLayout;
+
+        attachments.push_back(attachment);
+    }
+
+    entry.render_pass = find_render_pass(attachments, color_attachment_count, has_depth_attachment);
+}
+
+/**
+ * \brief Returns the cached render pass with the given attachments, creating it if needed. Passes with the same attachments share one render pass,
+ *        which keeps pipelines built against it valid after the graph is rebuilt.
+ * \param attachments Attachments, color first.
+ * \param color_attachment_count Number of color attachments.
+ * \param has_depth_attachment The last attachment is the depth attachment.
+ * \return VkRenderPass
+ */
+VkRenderPass vulkan_render_graph::find_render_pass(const std::vector<VkAttachmentDescription>& attachments, uint32_t color_attachment_count, bool has_depth_attachment)
+{
+    for (const render_pass_entry& entry : render_passes_)
+    {
+        if (entry.color_attachment_count == color_attachment_count && entry.has_depth_attachment == has_depth_attachment && entry.attachments.size() == attachments.size() &&
+            std::equal(attachments.begin(), attachments.end(), entry.attachments.begin(), attachment_descriptions_equal))
+        {
+            return entry.render_pass;
+        }
+    }
+
+    std::vector<VkAttachmentReference> color_attachment_references(color_attachment_count);
+    for (uint32_t i = 0; i < color_attachment_count; i++)
+    {
+        color_attachment_references[i].attachment = i;
+        color_attachment_references[i].layout = attachments[i].initialLayout;
+    }
+
+    VkAttachmentReference depth_attachment_reference{};
+    depth_attachment_reference.attachment = color_attachment_count;
+    depth_attachment_reference.layout = has_depth_attachment ? attachments[color_attachment_count].initialLayout : VK_IMAGE_LAYOUT_UNDEFINED;
+
+    VkSubpassDescription subpass_description{};
+    subpass_description.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass_description.colorAttachmentCount = color_attachment_count;
+    subpass_description.pColorAttachments = color_attachment_references.data();
+    subpass_description.pDepthStencilAttachment = has_depth_attachment ? &depth_attachment_reference : nullptr;
+
+    VkRenderPassCreateInfo render_pass_create_info{};
+    render_pass_create_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    render_pass_create_info.attachmentCount = static_cast<uint32_t>(attachments.size());
+    render_pass_create_info.pAttachments = attachments.data();
+    render_pass_create_info.subpassCount = 1;
+    render_pass_create_info.pSubpasses = &subpass_description;
+
+    render_pass_entry entry;
+    entry.attachments = attachments;
+    entry.color_attachment_count = color_attachment_count;
+    entry.has_depth_attachment = has_depth_attachment;
+
+    VK_CHECK(vkCreateRenderPass(vk_renderer_context_.vk_device_, &render_pass_create_info, nullptr, &entry.render_pass));
+    render_passes_.push_back(entry);
+
+    return entry.render_pass;
+}
+
+/**
+ * \brief Returns the framebuffer of a render pass and a set of attachments, creating it if needed. Imported images change every frame,
+ *        so there is one framebuffer per swapchain image once warm.
+ * \param render_pass Render pass.
+ * \param image_views Attachments in render pass order.
+ * \param extent Size of the attachments.
+ * \return VkFramebuffer
+ */
+VkFramebuffer vulkan_render_graph::find_framebuffer(VkRenderPass render_pass, const std::vector<VkImageView>& image_views, VkExtent2D extent)
+{
+    for (const framebuffer_entry& entry : framebuffers_)
+    {
+        if (entry.render_pass == render_pass && entry.image_views == image_views)
+        {
+            return entry.framebuffer;
+        }
+    }
+
+    VkFramebufferCreateInfo framebuffer_create_info{};
+    framebuffer_create_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebuffer_create_info.renderPass = render_pass;
+    framebuffer_create_info.attachmentCount = static_cast<uint32_t>(image_views.size());
+    framebuffer_create_info.pAttachments = image_views.data();
+    framebuffer_create_info.width = extent.width;
+    framebuffer_create_info.height = extent.height;
+    framebuffer_create_info.layers = 1;
+
+    framebuffer_entry entry;
+    entry.render_pass = render_pass;
+    entry.image_views = image_views;
+
+    VK_CHECK(vkCreateFramebuffer(vk_renderer_context_.vk_device_, &framebuffer_create_info, nullptr, &entry.framebuffer));
+    framebuffers_.push_back(entry);
+
+    return entry.framebuffer;
+}
+
+/**
+ * \brief Swaps the image behind an imported resource, e.g. to the swapchain image acquired this frame.
+ * \param resource Index of an imported resource.
+ * \param image Image.
+ * \param image_view View used when the image is an attachment.
+ */
+void vulkan_render_graph::set_imported_image(uint32_t resource, VkImage image, VkImageView image_view)
+{
+    assert(graph_.is_resource_imported(resource) && "Only imported render graph images can be replaced");
+
+    images_[resource].image = image;
+    images_[resource].image_view = image_view;
+}
+
+/**
+ * \brief Sets the function recording a pass's commands. Called by execute() inside the pass's render pass, if it has one.
+ * \param pass Index of the pass.
+ * \param contents How the render pass is begun, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS if record only executes secondary command buffers.
+ * \param record Function recording the pass.
+ */
+void vulkan_render_graph::set_pass_record(uint32_t pass, VkSubpassContents contents, const render_graph_record_function& record)
+{
+    passes_[pass].contents = contents;
+    passes_[pass].record = record;
+}
+
+/**
+ * \brief Records the surviving passes with their barriers into a command buffer.
+ * \param command_buffer Primary command buffer, outside of a render pass.
+ * \param gpu_profiler Optional, every pass and its barriers are measured as a scope named after the pass, with pipeline statistics.
+ */
+void vulkan_render_graph::execute(VkCommandBuffer command_buffer, vulkan_gpu_profiler* gpu_profiler)
+{
+    for (uint32_t i = 0; i < passes_.size(); i++)
+    {
+        if (graph_.is_pass_culled(i))
+        {
+            continue;
+        }
+
+        uint32_t gpu_scope = gpu_profiler ? gpu_profiler->begin_scope(command_buffer, graph_.get_pass_name(i), true) : invalid_gpu_scope;
+
+        record_barriers(command_buffer, graph_.get_pass_barriers(i));
+
+        pass_entry& entry = passes_[i];
+        const std::vector<render_graph_access>& accesses = graph_.get_pass_accesses(i);
+
+        render_graph_pass_context context;
+        context.command_buffer = command_buffer;
+        context.render_pass = entry.render_pass;
+
+        if (entry.render_pass == VK_NULL_HANDLE)
+        {
+            if (entry.record)
+            {
+                entry.record(context);
+            }
+
+            if (gpu_profiler)
+            {
+                gpu_profiler->end_scope(command_buffer, gpu_scope);
+            }
+
+            continue;
+        }
+
+        attachment_views_.clear();
+        attachment_clear_values_.clear();
+        for (uint32_t access_index : entry.attachment_accesses)
+        {
+            attachment_views_.push_back(images_[accesses[access_index].resource].image_view);
+            attachment_clear_values_.push_back(entry.clear_values[access_index]);
+        }
+
+        context.extent = images_[accesses[entry.attachment_accesses[0]].resource].description.extent;
+        context.framebuffer = find_framebuffer(entry.render_pass, attachment_views_, context.extent);
+
+        VkRenderPassBeginInfo render_pass_begin_info{};
+        render_pass_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        render_pass_begin_info.renderPass = entry.render_pass;
+        render_pass_begin_info.framebuffer = context.framebuffer;
+        render_pass_begin_info.renderArea.offset = {0, 0};
+        render_pass_begin_info.renderArea.extent = context.extent;
+        render_pass_begin_info.clearValueCount = static_cast<uint32_t>(attachment_clear_values_.size());
+        render_pass_begin_info.pClearValues = attachment_clear_values_.data();
+
+        vkCmdBeginRenderPass(command_buffer, &render_pass_begin_info, entry.contents);
+
+        if (entry.record)
+        {
+            entry.record(context);
+        }
+
+        vkCmdEndRenderPass(command_buffer);
+
+        if (gpu_profiler)
+        {
+            gpu_profiler->end_scope(command_buffer, gpu_scope);
+        }
+    }
+
+    record_barriers(command_buffer, graph_.get_final_barriers());
+
+    execution_statistics_.frame_count++;
+}
+
+/**
+ * \brief Records one vkCmdPipelineBarrier holding every image barrier of the list.
+ * \param command_buffer Command buffer, outside of a render pass.
+ * \param barriers Barriers placed by the graph.
+ */
+void vulkan_render_graph::record_barriers(VkCommandBuffer command_buffer, const std::vector<render_graph_barrier>& barriers)
+{
+    if (barriers.empty())
+    {
+        return;
+    }
+
+    VkPipelineStageFlags source_stages = 0;
+    VkPipelineStageFlags destination_stages = 0;
+
+    image_barriers_.clear();
+    for (const render_graph_barrier& barrier : barriers)
+    {
+        const image_entry& image = images_[barrier.resource];
+        usage_state source = get_usage_state(barrier.source_usage);
+        usage_state destination = get_usage_state(barrier.destination_usage);
+
+        VkImageMemoryBarrier image_memory_barrier{};
+        image_memory_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        image_memory_barrier.srcAccessMask = source.write_accesses;
+        image_memory_barrier.dstAccessMask = destination.accesses;
+        image_memory_barrier.oldLayout = barrier.discard ? VK_IMAGE_LAYOUT_UNDEFINED : source.layout;
+        image_memory_barrier.newLayout = destination.layout;
+        image_memory_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        image_memory_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        image_memory_barrier.image = image.image;
+        image_memory_barrier.subresourceRange.aspectMask = image.description.aspect;
+        image_memory_barrier.subresourceRange.baseMipLevel = 0;
+        image_memory_barrier.subresourceRange.levelCount = 1;
+        image_memory_barrier.subresourceRange.baseArrayLayer = 0;
+        image_memory_barrier.subresourceRange.layerCount = 1;
+
+        // NOTE(dhaval): Layout transitions of depth stencil images must include both aspects.
+        if ((image.description.aspect & VK_IMAGE_ASPECT_DEPTH_BIT) && vulkan_utils::has_stencil_component(image.description.format))
+        {
+            image_memory_barrier.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+        }
+
+        image_barriers_.push_back(image_memory_barrier);
+
+        source_stages |= source.source_stages;
+        destination_stages |= destination.destination_stages;
+    }
+
+    vkCmdPipelineBarrier(command_buffer, source_stages, destination_stages, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(image_barriers_.size()), image_barriers_.data());
+
+    execution_statistics_.total_image_barrier_count += image_barriers_.size();
+    execution_statistics_.total_pipeline_barrier_count++;
+}
+
+/**
+ * \brief Returns the render pass a pass records into. Pipelines drawing in the pass are built against it.
+ * \param pass Index of a pass that survived culling.
+ * \return VkRenderPass VK_NULL_HANDLE if the pass has no attachments.
+ */
+VkRenderPass vulkan_render_graph::get_render_pass(uint32_t pass) const
+{
+    return passes_[pass].render_pass;
+}
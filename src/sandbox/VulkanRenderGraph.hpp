@@ -0,0 +1,141 @@
+#pragma once
+
+#include <volk.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "RenderGraph.hpp"
+#include "VulkanGpuProfiler.hpp"
+#include "VulkanRendererContext.hpp"
+
+/**
+ * \brief Image created and owned by the render graph. Its memory may be shared with transient images whose lifetimes do not overlap.
+ */
+struct render_graph_image_description
+{
+    VkFormat format{VK_FORMAT_UNDEFINED};
+    VkExtent2D extent{0, 0};
+    VkImageUsageFlags usage{0};
+    VkImageAspectFlags aspect{VK_IMAGE_ASPECT_COLOR_BIT};
+};
+
+/**
+ * \brief What a pass records into. render_pass and framebuffer are VK_NULL_HANDLE for passes without attachments.
+ */
+struct render_graph_pass_context
+{
+    VkCommandBuffer command_buffer{VK_NULL_HANDLE};
+    VkRenderPass render_pass{VK_NULL_HANDLE};
+    VkFramebuffer framebuffer{VK_NULL_HANDLE};
+    VkExtent2D extent{0, 0};
+};
+
+using render_graph_record_function = std::function<void(const render_graph_pass_context&)>;
+
+/**
+ * \brief Barriers the render graph issued since it was initialized.
+ */
+struct render_graph_execution_statistics
+{
+    uint64_t frame_count{0};
+    uint64_t total_image_barrier_count{0};
+    uint64_t total_pipeline_barrier_count{0};
+};
+
+/**
+ * \brief Runs a render_graph on Vulkan. Creates the transient images and their aliased memory, one render pass per pass with attachments,
+ *        and issues the barriers the graph placed. Render passes are cached until shutdown(), pipelines built against them survive reset().
+ */
+class vulkan_render_graph
+{
+public:
+    vulkan_render_graph(const vulkan_renderer_context& renderer_context) : vk_renderer_context_(renderer_context)
+    {
+    }
+
+    void reset();
+    void shutdown();
+
+    uint32_t import_image(const std::string& name, VkImage image, VkImageView image_view, VkFormat format, VkExtent2D extent, VkImageAspectFlags aspect,
+                          render_graph_usage initial_usage, render_graph_usage final_usage);
+    uint32_t create_image(const std::string& name, const render_graph_image_description& description);
+    void set_output(uint32_t resource);
+
+    uint32_t add_pass(const std::string& name);
+    void read(uint32_t pass, uint32_t resource, render_graph_usage usage);
+    void write(uint32_t pass, uint32_t resource, render_graph_usage usage, render_graph_load_op load_op, VkClearValue clear_value = {});
+
+    void compile();
+
+    void set_imported_image(uint32_t resource, VkImage image, VkImageView image_view);
+    void set_pass_record(uint32_t pass, VkSubpassContents contents, const render_graph_record_function& record);
+    void execute(VkCommandBuffer command_buffer, vulkan_gpu_profiler* gpu_profiler = nullptr);
+
+    VkRenderPass get_render_pass(uint32_t pass) const;
+
+    inline const render_graph& get_graph() const { return graph_; }
+    inline const render_graph_execution_statistics& get_execution_statistics() const { return execution_statistics_; }
+
+private:
+    struct image_entry
+    {
+        VkImage image{VK_NULL_HANDLE};
+        VkImageView image_view{VK_NULL_HANDLE};
+        render_graph_image_description description;
+        bool owned{false};
+    };
+
+    struct pass_entry
+    {
+        render_graph_record_function record;
+        VkSubpassContents contents{VK_SUBPASS_CONTENTS_INLINE};
+
+        // NOTE(dhaval): Index of the access for every attachment of the render pass, in attachment order. Depth comes last.
+        std::vector<uint32_t> attachment_accesses;
+        // NOTE(dhaval): Clear value of every access, in declaration order.
+        std::vector<VkClearValue> clear_values;
+        VkRenderPass render_pass{VK_NULL_HANDLE};
+    };
+
+    struct render_pass_entry
+    {
+        std::vector<VkAttachmentDescription> attachments;
+        uint32_t color_attachment_count{0};
+        bool has_depth_attachment{false};
+        VkRenderPass render_pass{VK_NULL_HANDLE};
+    };
+
+    struct framebuffer_entry
+    {
+        VkRenderPass render_pass{VK_NULL_HANDLE};
+        std::vector<VkImageView> image_views;
+        VkFramebuffer framebuffer{VK_NULL_HANDLE};
+    };
+
+    void create_render_pass(uint32_t pass);
+    VkRenderPass find_render_pass(const std::vector<VkAttachmentDescription>& attachments, uint32_t color_attachment_count, bool has_depth_attachment);
+    VkFramebuffer find_framebuffer(VkRenderPass render_pass, const std::vector<VkImageView>& image_views, VkExtent2D extent);
+
+    void record_barriers(VkCommandBuffer command_buffer, const std::vector<render_graph_barrier>& barriers);
+
+private:
+    vulkan_renderer_context vk_renderer_context_;
+
+    render_graph graph_;
+
+    std::vector<image_entry> images_;
+    std::vector<pass_entry> passes_;
+    std::vector<VkDeviceMemory> vk_memory_blocks_;
+
+    std::vector<render_pass_entry> render_passes_;
+    std::vector<framebuffer_entry> framebuffers_;
+
+    // NOTE(dhaval): Scratch space for execute(), reused every frame.
+    std::vector<VkImageMemoryBarrier> image_barriers_;
+    std::vector<VkImageView> attachment_views_;
+    std::vector<VkClearValue> attachment_clear_values_;
+
+    render_graph_execution_statistics execution_statistics_{};
+};
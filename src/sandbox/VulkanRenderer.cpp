@@ -2,6 +2,8 @@
 #include "VulkanRenderer.hpp"
 #include "VulkanUtils.hpp"
 
+#include "DrawSorter.hpp"
+#include "Profiler.hpp"
 #include "RenderScene.hpp"
 
 #define GLM_FORCE_RADIANS
@@ -9,156 +11,422 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+
+// NOTE(dhaval): Background threads used to compile pipelines that miss the pipeline state cache.
+static const uint32_t pipeline_compile_thread_count = 2;
+
+// NOTE(dhaval): Room for the uniform data of one frame.
+static const VkDeviceSize frame_uniform_base_size = 64 * 1024;
+
+// NOTE(dhaval): Distance between the copies of the mesh when more than one copy is requested.
+static const float draw_grid_spacing = 2.5f;
+
+// NOTE(dhaval): Fewest instances a job refreshes the culling bounds of, scenes up to this size are refreshed on the calling thread.
+static const uint32_t instance_update_chunk_size = 2048;
+
+// NOTE(dhaval): Size of the software depth buffer used for occlusion culling, and how many of the mesh's triangles its occluder keeps.
+static const uint32_t occlusion_depth_width = 256;
+static const uint32_t occlusion_depth_height = 128;
+static const uint32_t occluder_triangle_budget = 1024;
+
+// NOTE(dhaval): Slots of the bindless texture table and materials in its material buffer.
+static const uint32_t bindless_texture_capacity = 4096;
+static const uint32_t bindless_material_capacity = 1024;
+
+// NOTE(dhaval): Parameters of the scene's materials, only pipelines with the matching material_feature read them.
+static const glm::vec4 default_emissive_factor = glm::vec4(0.2f, 0.15f, 0.05f, 0.0f);
+static const float default_alpha_cutoff = 0.5f;
+
+// NOTE(dhaval): GPU profiler scopes one frame may record, the frame itself plus one per render graph pass.
+static const uint32_t gpu_profiler_scope_capacity = 32;
 
 struct shared_renderer_state
 {
-    glm::mat4 model;
     glm::mat4 view;
     glm::mat4 projection;
 };
 
 /**
- * \brief Initializes the Renderer.
- * \param vertex_shader_file Path to the vertex shader file.
- * \param fragment_shader_file Path to the fragment shader file.
- * \param texture_file
- * \param model_file
+ * \brief Everything a recording thread needs to record its share of the frame's draws. Read only while recording.
  */
-void renderer::init(const render_scene* render_scene)
+struct draw_recording_state
 {
-    // NOTE(dhaval): Create Uniform buffers
-    VkDeviceSize uniform_buffer_object_size = sizeof(shared_renderer_state);
+    VkExtent2D extent;
+    VkPipelineLayout pipeline_layout;
+
+    // NOTE(dhaval): Tables indexed by the pipeline, material and mesh fields of the draw keys.
+    const VkPipeline* pipelines;
+    const VkDescriptorSet* descriptor_sets;
+    const vulkan_mesh* const* meshes;
+
+    instance_data* instances;
+    VkBuffer instance_buffer;
+    VkDeviceSize instance_offset;
+
+    // NOTE(dhaval): Null when draws are submitted directly.
+    VkDrawIndexedIndirectCommand* indirect_commands;
+    uint32_t* indirect_draw_counts;
+    VkBuffer indirect_buffer;
+    VkDeviceSize indirect_commands_offset;
+    VkDeviceSize indirect_draw_counts_offset;
+
+    bool multi_draw_indirect;
+    bool draw_indirect_count;
+    uint32_t max_draw_indirect_count;
+
+    // NOTE(dhaval): Draw i draws visible_instances[draw_first_visible[i]] up to visible_instances[draw_first_visible[i + 1]].
+    const glm::mat4* instance_transforms;
+    const uint32_t* visible_instances;
+    const uint32_t* draw_first_visible;
+
+    // NOTE(dhaval): Draws are recorded in key order. draw_order[i] is the draw at position i, draw_keys[i] its key.
+    //               Indirect commands and draw counts are indexed by position.
+    const uint32_t* draw_order;
+    const uint64_t* draw_keys;
+
+    // NOTE(dhaval): Null unless bindless textures are used, bound once per command buffer as set 1.
+    VkDescriptorSet texture_table_set;
+};
 
-    uint32_t image_count = static_cast<uint32_t>(vk_swapchain_context_.vk_swapchain_image_views_.size());
-    vk_uniform_buffers_.resize(image_count);
-    vk_uniform_buffers_memory_.resize(image_count);
+/**
+ * \brief Per instance vertex data is read through binding 1, one element per instance.
+ * \return VkVertexInputBindingDescription
+ */
+VkVertexInputBindingDescription instance_data::get_vertex_input_binding_description()
+{
+    VkVertexInputBindingDescription vertex_input_binding_description;
+    vertex_input_binding_description.binding = 1;
+    vertex_input_binding_description.stride = sizeof(instance_data);
+    vertex_input_binding_description.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+    return vertex_input_binding_description;
+}
+
+/**
+ * \brief The model matrix takes locations 3 to 6, one per column.
+ * \return std::array<VkVertexInputAttributeDescription, 4>
+ */
+std::array<VkVertexInputAttributeDescription, 4> instance_data::get_vertex_input_attribute_descriptions()
+{
+    std::array<VkVertexInputAttributeDescription, 4> vertex_input_attribute_descriptions = {};
 
-    for (uint32_t i = 0; i < image_count; i++)
+    for (uint32_t i = 0; i < 4; i++)
     {
-        vulkan_utils::create_buffer(vk_renderer_context_, uniform_buffer_object_size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                                    vk_uniform_buffers_[i], vk_uniform_buffers_memory_[i]);
+        vertex_input_attribute_descriptions[i].binding = 1;
+        vertex_input_attribute_descriptions[i].location = 3 + i;
+        vertex_input_attribute_descriptions[i].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+        vertex_input_attribute_descriptions[i].offset = static_cast<uint32_t>(offsetof(instance_data, model) + sizeof(glm::vec4) * i);
     }
 
-    // NOTE(dhaval): Creating Shader Stages.
-    VkPipelineShaderStageCreateInfo vertex_shader_stage_create_info{};
-    vertex_shader_stage_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vertex_shader_stage_create_info.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vertex_shader_stage_create_info.module = render_scene->get_vertex_shader();
-    vertex_shader_stage_create_info.pName = "main";
+    return vertex_input_attribute_descriptions;
+}
+
+/**
+ * \brief The whole block is visible to the vertex shader, which forwards the material index to the fragment shader.
+ * \return VkPushConstantRange
+ */
+VkPushConstantRange draw_push_constants::get_push_constant_range()
+{
+    VkPushConstantRange push_constant_range{};
+    push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    push_constant_range.offset = 0;
+    push_constant_range.size = sizeof(draw_push_constants);
 
-    VkPipelineShaderStageCreateInfo fragment_shader_stage_create_info{};
-    fragment_shader_stage_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    fragment_shader_stage_create_info.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragment_shader_stage_create_info.module = render_scene->get_fragment_shader();
-    fragment_shader_stage_create_info.pName = "main";
+    return push_constant_range;
+}
 
-    VkPipelineShaderStageCreateInfo shader_stages[] = {vertex_shader_stage_create_info, fragment_shader_stage_create_info};
+/**
+ * \brief Pushes the per draw constants of a draw.
+ * \param state Shared recording state of the frame.
+ * \param command_buffer Command buffer to push into.
+ * \param draw Index of the draw.
+ * \param key Key of the draw, provides the material.
+ * \param model Model matrix of the draw's only instance, null when the instances come from the instance arena.
+ */
+static void push_draw_constants(const draw_recording_state& state, VkCommandBuffer command_buffer, uint32_t draw, uint64_t key, const glm::mat4* model)
+{
+    draw_push_constants constants{};
+    constants.object_index = draw;
+    constants.material_index = get_draw_key_material(key);
+    constants.flags = model != nullptr ? draw_push_model_flag : 0;
 
-    // NOTE(dhaval): Creating Vertex Input.
-    VkVertexInputBindingDescription vertex_input_binding_description = vulkan_mesh::get_vertex_input_binding_description();
-    auto vertex_input_attribute_descriptions = vulkan_mesh::get_vertex_input_attribute_descriptions();
+    if (model != nullptr)
+    {
+        for (int row = 0; row < 3; row++)
+        {
+            constants.model_rows[row] = glm::vec4((*model)[0][row], (*model)[1][row], (*model)[2][row], (*model)[3][row]);
+        }
+    }
 
-    VkPipelineVertexInputStateCreateInfo vertex_input_state_create_info{};
-    vertex_input_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertex_input_state_create_info.vertexBindingDescriptionCount = 1;
-    vertex_input_state_create_info.pVertexBindingDescriptions = &vertex_input_binding_description;
-    vertex_input_state_create_info.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertex_input_attribute_descriptions.size());
-    vertex_input_state_create_info.pVertexAttributeDescriptions = vertex_input_attribute_descriptions.data();
+    // NOTE(dhaval): Only the header is pushed when the matrix is not used.
+    uint32_t size = static_cast<uint32_t>(model != nullptr ? sizeof(constants) : offsetof(draw_push_constants, model_rows));
+    vkCmdPushConstants(command_buffer, state.pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, size, &constants);
+}
 
-    // NOTE(dhaval): Creating Input Assembly.
-    VkPipelineInputAssemblyStateCreateInfo input_assembly_state_create_info{};
-    input_assembly_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    input_assembly_state_create_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    input_assembly_state_create_info.primitiveRestartEnable = VK_FALSE;
+/**
+ * \brief State currently bound in a command buffer, binds that would set the same state again are skipped.
+ */
+struct bound_draw_state
+{
+    VkPipeline pipeline{VK_NULL_HANDLE};
+    VkDescriptorSet descriptor_set{VK_NULL_HANDLE};
+    const vulkan_mesh* mesh{nullptr};
+
+    draw_state_changes changes;
+};
 
-    // NOTE(dhaval): Creating Viewport State.
+/**
+ * \brief Binds the pipeline, material and mesh a draw key refers to, skipping what is already bound.
+ * \param state Shared recording state of the frame.
+ * \param command_buffer Command buffer to bind into.
+ * \param key Key of the draw about to be recorded.
+ * \param bound State bound in the command buffer so far, updated.
+ */
+static void bind_draw_state(const draw_recording_state& state, VkCommandBuffer command_buffer, uint64_t key, bound_draw_state& bound)
+{
+    VkPipeline pipeline = state.pipelines[get_draw_key_pipeline(key)];
+    if (pipeline != bound.pipeline)
+    {
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+        bound.pipeline = pipeline;
+        bound.changes.pipeline_binds++;
+    }
+
+    // NOTE(dhaval): Every pipeline uses the same layout, bound sets stay valid across pipeline binds.
+    VkDescriptorSet descriptor_set = state.descriptor_sets[get_draw_key_material(key)];
+    if (descriptor_set != bound.descriptor_set)
+    {
+        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, state.pipeline_layout, 0, 1, &descriptor_set, 0, nullptr);
+        bound.descriptor_set = descriptor_set;
+        bound.changes.material_binds++;
+    }
+
+    const vulkan_mesh* mesh = state.meshes[get_draw_key_mesh(key)];
+    if (mesh != bound.mesh)
+    {
+        VkBuffer vertex_buffer = mesh->get_vertex_buffer();
+        VkDeviceSize vertex_offset = 0;
+
+        vkCmdBindVertexBuffers(command_buffer, 0, 1, &vertex_buffer, &vertex_offset);
+        vkCmdBindIndexBuffer(command_buffer, mesh->get_index_buffer(), 0, VK_INDEX_TYPE_UINT32);
+        bound.mesh = mesh;
+        bound.changes.mesh_binds++;
+    }
+}
+
+/**
+ * \brief Submits a run of indirect commands that share the same bound state, with as few calls as the device allows.
+ * \param state Shared recording state of the frame.
+ * \param command_buffer Primary or secondary command buffer inside the render pass.
+ * \param first_slot Slot of the first command of the run, also selects the run's slot in the draw count buffer.
+ * \param draw_count Number of commands in the run.
+ */
+static void record_indirect_draws(const draw_recording_state& state, VkCommandBuffer command_buffer, uint32_t first_slot, uint32_t draw_count)
+{
+    const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+    VkDeviceSize commands_offset = state.indirect_commands_offset + static_cast<VkDeviceSize>(first_slot) * stride;
+
+    // NOTE(dhaval): The count is read by the GPU, a GPU culling pass could lower it without touching the commands.
+    if (state.draw_indirect_count && state.multi_draw_indirect && draw_count <= state.max_draw_indirect_count)
+    {
+        state.indirect_draw_counts[first_slot] = draw_count;
+
+        VkDeviceSize count_offset = state.indirect_draw_counts_offset + static_cast<VkDeviceSize>(first_slot) * sizeof(uint32_t);
+        vkCmdDrawIndexedIndirectCountKHR(command_buffer, state.indirect_buffer, commands_offset, state.indirect_buffer, count_offset, draw_count, stride);
+        return;
+    }
+
+    // NOTE(dhaval): Without multiDrawIndirect every call is limited to a single draw, larger batches are split by maxDrawIndirectCount.
+    uint32_t batch_size = state.multi_draw_indirect ? state.max_draw_indirect_count : 1;
+
+    for (uint32_t submitted = 0; submitted < draw_count; submitted += batch_size)
+    {
+        uint32_t batch_draw_count = std::min(batch_size, draw_count - submitted);
+        vkCmdDrawIndexedIndirect(command_buffer, state.indirect_buffer, commands_offset + static_cast<VkDeviceSize>(submitted) * stride, batch_draw_count, stride);
+    }
+}
+
+/**
+ * \brief Writes the visible instances of a range of sorted draws and records them, directly or through indirect commands.
+ * \param state Shared recording state of the frame.
+ * \param command_buffer Primary or secondary command buffer inside the render pass.
+ * \param first_position Position of the first draw to record in the sorted draw order.
+ * \param draw_count Number of draws to record.
+ * \return draw_state_changes Binds recorded.
+ */
+static draw_state_changes record_draws(const draw_recording_state& state, VkCommandBuffer command_buffer, uint32_t first_position, uint32_t draw_count)
+{
+    // NOTE(dhaval): Viewport and scissor are dynamic so the pipeline survives window resizes.
     VkViewport viewport{};
     viewport.x = 0.0f;
     viewport.y = 0.0f;
-    viewport.width = static_cast<float>(vk_swapchain_context_.vk_extent_2d_.width);
-    viewport.height = static_cast<float>(vk_swapchain_context_.vk_extent_2d_.height);
+    viewport.width = static_cast<float>(state.extent.width);
+    viewport.height = static_cast<float>(state.extent.height);
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
 
     VkRect2D scissor{};
     scissor.offset = {0, 0};
-    scissor.extent = vk_swapchain_context_.vk_extent_2d_;
-
-    VkPipelineViewportStateCreateInfo viewport_state_create_info{};
-    viewport_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewport_state_create_info.viewportCount = 1;
-    viewport_state_create_info.pViewports = &viewport;
-    viewport_state_create_info.scissorCount = 1;
-    viewport_state_create_info.pScissors = &scissor;
-
-    // NOTE(dhaval): Create Rasterizer State.
-    VkPipelineRasterizationStateCreateInfo rasterization_state_create_info{};
-    rasterization_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterization_state_create_info.depthClampEnable = VK_FALSE;
-    rasterization_state_create_info.rasterizerDiscardEnable = VK_FALSE;
-    rasterization_state_create_info.polygonMode = VK_POLYGON_MODE_FILL;
-    rasterization_state_create_info.lineWidth = 1.0f;
-    rasterization_state_create_info.cullMode = VK_CULL_MODE_BACK_BIT;
-    rasterization_state_create_info.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-    rasterization_state_create_info.depthBiasEnable = VK_FALSE;
-    rasterization_state_create_info.depthBiasConstantFactor = 0.0f;
-    rasterization_state_create_info.depthBiasClamp = 0.0f;
-    rasterization_state_create_info.depthBiasSlopeFactor = 0.0f;
-
-    // NOTE(dhaval): Create MultiSampling State.
-    VkPipelineMultisampleStateCreateInfo multisample_state_create_info{};
-    multisample_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisample_state_create_info.sampleShadingEnable = VK_FALSE;
-    multisample_state_create_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-    multisample_state_create_info.minSampleShading = 1.0f;
-    multisample_state_create_info.pSampleMask = nullptr;
-    multisample_state_create_info.alphaToCoverageEnable = VK_FALSE;
-    multisample_state_create_info.alphaToOneEnable = VK_FALSE;
-
-    // NOTE(dhaval): Create Depth Stencil State.
-    VkPipelineDepthStencilStateCreateInfo depth_stencil_state_create_info{};
-    depth_stencil_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-    depth_stencil_state_create_info.depthTestEnable = VK_TRUE;
-    depth_stencil_state_create_info.depthWriteEnable = VK_TRUE;
-    depth_stencil_state_create_info.depthCompareOp = VK_COMPARE_OP_LESS;
-    depth_stencil_state_create_info.depthBoundsTestEnable = VK_FALSE;
-    depth_stencil_state_create_info.minDepthBounds = 0.0f;
-    depth_stencil_state_create_info.maxDepthBounds = 1.0f;
-    depth_stencil_state_create_info.stencilTestEnable = VK_FALSE;
-    depth_stencil_state_create_info.front = {};
-    depth_stencil_state_create_info.back = {};
-
-
-    // NOTE(dhaval): Create Color Blend State.
-    VkPipelineColorBlendAttachmentState color_blend_attachment_state{};
-    color_blend_attachment_state.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    color_blend_attachment_state.blendEnable = VK_FALSE;
-    color_blend_attachment_state.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
-    color_blend_attachment_state.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
-    color_blend_attachment_state.colorBlendOp = VK_BLEND_OP_ADD;
-    color_blend_attachment_state.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-    color_blend_attachment_state.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-    color_blend_attachment_state.alphaBlendOp = VK_BLEND_OP_ADD;
-
-    VkPipelineColorBlendStateCreateInfo color_blend_state_create_info{};
-    color_blend_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    color_blend_state_create_info.logicOpEnable = VK_FALSE;
-    color_blend_state_create_info.logicOp = VK_LOGIC_OP_COPY;
-    color_blend_state_create_info.attachmentCount = 1;
-    color_blend_state_create_info.pAttachments = &color_blend_attachment_state;
-    color_blend_state_create_info.blendConstants[0] = 0.0f;
-    color_blend_state_create_info.blendConstants[1] = 0.0f;
-    color_blend_state_create_info.blendConstants[2] = 0.0f;
-    color_blend_state_create_info.blendConstants[3] = 0.0f;
-
-    // NOTE(dhaval): Create Pipeline Dynamic State. (For Later Use)
-    VkDynamicState dynamic_states[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_LINE_WIDTH};
-
-    VkPipelineDynamicStateCreateInfo dynamic_state_create_info{};
-    dynamic_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-    dynamic_state_create_info.dynamicStateCount = 2;
-    dynamic_state_create_info.pDynamicStates = dynamic_states;
+    scissor.extent = state.extent;
+
+    vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+    vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+
+    // NOTE(dhaval): Instances of every draw live in the same arena, binding 1 never changes.
+    vkCmdBindVertexBuffers(command_buffer, 1, 1, &state.instance_buffer, &state.instance_offset);
+
+    if (state.texture_table_set != VK_NULL_HANDLE)
+    {
+        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, state.pipeline_layout, 1, 1, &state.texture_table_set, 0, nullptr);
+    }
+
+    bound_draw_state bound;
+    uint32_t run_first_position = first_position;
+    uint32_t last_position = first_position + draw_count;
+
+    for (uint32_t position = first_position; position < last_position; position++)
+    {
+        uint32_t draw = state.draw_order[position];
+        uint64_t key = state.draw_keys[position];
+
+        uint32_t first_visible = state.draw_first_visible[draw];
+        uint32_t visible_count = state.draw_first_visible[draw + 1] - first_visible;
+
+        // NOTE(dhaval): A direct draw of a single instance carries its model matrix in the push constants and skips the instance arena.
+        bool push_model = state.indirect_commands == nullptr && visible_count == 1;
+
+        for (uint32_t i = first_visible; i < first_visible + visible_count && !push_model; i++)
+        {
+            instance_data instance{};
+            instance.model = state.instance_transforms[state.visible_instances[i]];
+
+            // NOTE(dhaval): The arena is write combined memory, write whole instances and never read back.
+            memcpy(&state.instances[i], &instance, sizeof(instance));
+        }
+
+        // NOTE(dhaval): Keys are sorted, draws binding the same state are adjacent and share one indirect submission.
+        bool state_changed = position == first_position || (key >> draw_key_mesh_shift) != (state.draw_keys[position - 1] >> draw_key_mesh_shift);
+
+        if (state.indirect_commands != nullptr && state_changed && position > run_first_position)
+        {
+            record_indirect_draws(state, command_buffer, run_first_position, position - run_first_position);
+            run_first_position = position;
+        }
+
+        if (state_changed)
+        {
+            bind_draw_state(state, command_buffer, key, bound);
+        }
+
+        if (state.indirect_commands != nullptr)
+        {
+            // NOTE(dhaval): A run shares its material, one push covers every command of it. object_index is the first draw of the run.
+            if (state_changed)
+            {
+                push_draw_constants(state, command_buffer, draw, key, nullptr);
+            }
+
+            VkDrawIndexedIndirectCommand command{};
+            command.indexCount = bound.mesh->get_num_indices();
+            command.instanceCount = visible_count;
+            command.firstIndex = 0;
+            command.vertexOffset = 0;
+            command.firstInstance = first_visible;
+
+            memcpy(&state.indirect_commands[position], &command, sizeof(command));
+        }
+        else
+        {
+            push_draw_constants(state, command_buffer, draw, key, push_model ? &state.instance_transforms[state.visible_instances[first_visible]] : nullptr);
+            vkCmdDrawIndexed(command_buffer, bound.mesh->get_num_indices(), visible_count, 0, 0, first_visible);
+        }
+    }
+
+    if (state.indirect_commands != nullptr && last_position > run_first_position)
+    {
+        record_indirect_draws(state, command_buffer, run_first_position, last_position - run_first_position);
+    }
+
+    return bound.changes;
+}
+
+/**
+ * \brief Descriptor pool ratios of the transient pools every frame context owns.
+ * \return std::vector<descriptor_pool_ratio>
+ */
+std::vector<descriptor_pool_ratio> renderer::get_frame_descriptor_pool_ratios()
+{
+    return {
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f},
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.0f},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0.5f},
+    };
+}
+
+/**
+ * \brief What a frame context must be created with to record frames with the given renderer config.
+ * \param config Renderer config the frames will be recorded with.
+ * \return frame_context_config
+ */
+frame_context_config renderer::get_frame_context_config(const renderer_config& config)
+{
+    VkDeviceSize draw_count = std::max(config.draw_count, 1u);
+    VkDeviceSize instance_count = std::max(config.instance_count, 1u);
+    VkDeviceSize record_thread_count = std::max(config.record_thread_count, 1u);
+
+    frame_context_config frame_config{};
+    frame_config.uniform_arena_size = frame_uniform_base_size;
+    frame_config.instance_arena_size = sizeof(instance_data) * draw_count * instance_count;
+    frame_config.indirect_arena_size = (sizeof(VkDrawIndexedIndirectCommand) + sizeof(uint32_t)) * draw_count + 64;
+    frame_config.descriptor_pool_ratios = get_frame_descriptor_pool_ratios();
+    frame_config.secondary_command_buffer_count = static_cast<uint32_t>(record_thread_count);
+
+    return frame_config;
+}
+
+/**
+ * \brief Initializes the Renderer.
+ * \param render_scene Scene that provides the shaders, mesh and texture to draw.
+ * \param jobs Job system culling and recording run on, it must outlive the renderer.
+ * \param config Draw count and recording thread count. Frame contexts must be created with config.record_thread_count secondary command buffers.
+ */
+void renderer::init(const render_scene* render_scene, job_system* jobs, const renderer_config& config)
+{
+    jobs_ = jobs;
+    config_ = config;
+    config_.record_thread_count = std::max(config_.record_thread_count, 1u);
+    config_.draw_count = std::max(config_.draw_count, 1u);
+    config_.instance_count = std::max(config_.instance_count, 1u);
+
+    // NOTE(dhaval): Every draw but the first needs a non zero firstInstance, which indirect draws only honor with drawIndirectFirstInstance.
+    if (config_.indirect_draws && !vk_renderer_context_.draw_indirect_first_instance_supported)
+    {
+        std::cout << "renderer: drawIndirectFirstInstance is not supported, falling back to direct draws" << std::endl;
+        config_.indirect_draws = false;
+    }
+
+    VkPhysicalDeviceProperties physical_device_properties;
+    vkGetPhysicalDeviceProperties(vk_renderer_context_.vk_physical_device_, &physical_device_properties);
+    max_draw_indirect_count_ = std::max(physical_device_properties.limits.maxDrawIndirectCount, 1u);
+
+    if (config_.indirect_draws)
+    {
+        std::cout << "renderer: indirect draws ("
+            << (vk_renderer_context_.draw_indirect_count_supported ? "vkCmdDrawIndexedIndirectCount" : (vk_renderer_context_.multi_draw_indirect_supported ? "multi draw" : "single draw"))
+            << ")" << std::endl;
+    }
+
+    statistics_ = {};
+
+    if (config_.gpu_profiling)
+    {
+        gpu_profiler_.init(gpu_profiler_scope_capacity, config_.gpu_pipeline_statistics);
+    }
 
     // NOTE(dhaval): Create descriptor set layout
     VkDescriptorSetLayoutBinding uniform_buffer_layout_binding{};
@@ -177,292 +445,773 @@ void renderer::init(const render_scene* render_scene)
 
     std::array<VkDescriptorSetLayoutBinding, 2> descriptor_set_layout_bindings = {uniform_buffer_layout_binding, sampler_layout_binding};
 
+    // NOTE(dhaval): With bindless textures the per frame set only holds the uniform buffer, textures come from the texture table.
     VkDescriptorSetLayoutCreateInfo descriptor_set_layout_create_info{};
     descriptor_set_layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    descriptor_set_layout_create_info.bindingCount = static_cast<uint32_t>(descriptor_set_layout_bindings.size());
+    descriptor_set_layout_create_info.bindingCount = config_.bindless_textures ? 1 : static_cast<uint32_t>(descriptor_set_layout_bindings.size());
     descriptor_set_layout_create_info.pBindings = descriptor_set_layout_bindings.data();
 
     VK_CHECK(vkCreateDescriptorSetLayout(vk_renderer_context_.vk_device_, &descriptor_set_layout_create_info, nullptr, &vk_descriptor_set_layout_));
 
-    // NOTE(dhaval): Create descriptor sets
-    std::vector<VkDescriptorSetLayout> descriptor_set_layouts(image_count, vk_descriptor_set_layout_);
+    if (config_.bindless_textures)
+    {
+        texture_table_.init(bindless_texture_capacity, bindless_material_capacity);
+    }
+
+    // NOTE(dhaval): Create Pipeline Layout.
+    std::array<VkDescriptorSetLayout, 2> descriptor_set_layouts = {vk_descriptor_set_layout_, texture_table_.get_descriptor_set_layout()};
 
-    VkDescriptorSetAllocateInfo descriptor_set_allocate_info{};
-    descriptor_set_allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    descriptor_set_allocate_info.descriptorPool = vk_swapchain_context_.vk_descriptor_pool;
-    descriptor_set_allocate_info.descriptorSetCount = image_count;
-    descriptor_set_allocate_info.pSetLayouts = descriptor_set_layouts.data();
+    // NOTE(dhaval): Per frame globals stay in the uniform buffer, per draw data is pushed.
+    VkPushConstantRange push_constant_range = draw_push_constants::get_push_constant_range();
+
+    VkPipelineLayoutCreateInfo pipeline_layout_create_info{};
+    pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipeline_layout_create_info.setLayoutCount = config_.bindless_textures ? 2 : 1;
+    pipeline_layout_create_info.pSetLayouts = descriptor_set_layouts.data();
+    pipeline_layout_create_info.pushConstantRangeCount = 1;
+    pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
+
+    VK_CHECK(vkCreatePipelineLayout(vk_renderer_context_.vk_device_, &pipeline_layout_create_info, nullptr, &vk_pipeline_layout_));
 
-    vk_descriptor_sets_.resize(image_count);
-    VK_CHECK(vkAllocateDescriptorSets(vk_renderer_context_.vk_device_, &descriptor_set_allocate_info, vk_descriptor_sets_.data()));
+    // NOTE(dhaval): The render graph builds the render pass, the pipeline needs it so the graph is compiled first.
+    create_swapchain_resources();
 
-    for (size_t i = 0; i < image_count; i++)
+    // NOTE(dhaval): Create Graphics Pipeline through the pipeline state cache.
+    pipeline_description_ = {};
+    pipeline_description_.vertex_shader = render_scene->get_vertex_shader();
+    pipeline_description_.fragment_shader = render_scene->get_fragment_shader();
+
+    auto vertex_input_attribute_descriptions = vulkan_mesh::get_vertex_input_attribute_descriptions();
+    auto instance_input_attribute_descriptions = instance_data::get_vertex_input_attribute_descriptions();
+    pipeline_description_.vertex_bindings = {vulkan_mesh::get_vertex_input_binding_description(), instance_data::get_vertex_input_binding_description()};
+    pipeline_description_.vertex_attributes.assign(vertex_input_attribute_descriptions.begin(), vertex_input_attribute_descriptions.end());
+    pipeline_description_.vertex_attributes.insert(pipeline_description_.vertex_attributes.end(), instance_input_attribute_descriptions.begin(), instance_input_attribute_descriptions.end());
+
+    pipeline_description_.pipeline_layout = vk_pipeline_layout_;
+    pipeline_description_.render_pass = render_graph_.get_render_pass(render_graph_main_pass_);
+    pipeline_description_.subpass = 0;
+
+    pipeline_state_cache_.init(pipeline_compile_thread_count);
+
+    create_material_permutations();
+
+    auto pipeline_start_time = std::chrono::high_resolution_clock::now();
+
+    // NOTE(dhaval): The first material's pipeline is compiled up front and stands in for any pipeline that is still compiling. The other permutations
+    // the scene uses are queued on the compile threads together and waited for, so no draw starts out on the fallback.
+    pipeline_state_cache_.set_fallback_pipeline(permutation_descriptions_[material_permutations_[0]]);
+
+    for (const pipeline_description& description : permutation_descriptions_)
     {
-        const vulkan_texture& texture = render_scene->get_texture();
+        pipeline_state_cache_.get_pipeline(description);
+    }
 
-        VkDescriptorBufferInfo descriptor_buffer_info{};
-        descriptor_buffer_info.buffer = vk_uniform_buffers_[i];
-        descriptor_buffer_info.offset = 0;
-        descriptor_buffer_info.range = sizeof(shared_renderer_state);
+    permutation_pipelines_.clear();
+    for (const pipeline_description& description : permutation_descriptions_)
+    {
+        permutation_pipelines_.push_back(pipeline_state_cache_.get_pipeline_blocking(description));
+    }
 
-        VkDescriptorImageInfo descriptor_image_info{};
-        descriptor_image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        descriptor_image_info.imageView = texture.get_image_view();
-        descriptor_image_info.sampler = texture.get_sampler();
+    auto pipeline_end_time = std::chrono::high_resolution_clock::now();
+    std::cout << "renderer: " << config_.material_features.size() << " material(s), " << permutations_.get_count() << " pipeline permutation(s) created in "
+        << std::chrono::duration<double, std::milli>(pipeline_end_time - pipeline_start_time).count() << " ms" << std::endl;
 
-        std::array<VkWriteDescriptorSet, 2> write_descriptor_sets{};
+    render_scene_ = render_scene;
+    create_instance_graph();
 
-        write_descriptor_sets[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        write_descriptor_sets[0].dstSet = vk_descriptor_sets_[i];
-        write_descriptor_sets[0].dstBinding = 0;
-        write_descriptor_sets[0].dstArrayElement = 0;
-        write_descriptor_sets[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        write_descriptor_sets[0].descriptorCount = 1;
-        write_descriptor_sets[0].pBufferInfo = &descriptor_buffer_info;
+    if (config_.bindless_textures)
+    {
+        update_materials();
+    }
 
-        write_descriptor_sets[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        write_descriptor_sets[1].dstSet = vk_descriptor_sets_[i];
-        write_descriptor_sets[1].dstBinding = 1;
-        write_descriptor_sets[1].dstArrayElement = 0;
-        write_descriptor_sets[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        write_descriptor_sets[1].descriptorCount = 1;
-        write_descriptor_sets[1].pImageInfo = &descriptor_image_info;
+    if (config_.occluder_count > 0)
+    {
+        occluder_mesh_ = render_scene_->get_mesh().build_occluder_mesh(occluder_triangle_budget);
+        occlusion_culler_.init(occlusion_depth_width, occlusion_depth_height);
 
-        vkUpdateDescriptorSets(vk_renderer_context_.vk_device_, static_cast<uint32_t>(write_descriptor_sets.size()), write_descriptor_sets.data(), 0, nullptr);
+        std::cout << "renderer: occlusion culling with " << config_.occluder_count << " occluder(s), " << occluder_mesh_.indices.size() / 3 << " triangles each" << std::endl;
     }
+}
 
-    // NOTE(dhaval): Create Pipeline Layout.
-    VkPipelineLayoutCreateInfo pipeline_layout_create_info{};
-    pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipeline_layout_create_info.setLayoutCount = 1;
-    pipeline_layout_create_info.pSetLayouts = &vk_descriptor_set_layout_;
-    pipeline_layout_create_info.pushConstantRangeCount = 0;
-    pipeline_layout_create_info.pPushConstantRanges = nullptr;
+/**
+ * \brief Picks up the current shader modules of the scene after a hot reload. The pipelines with the new modules compile in the background,
+ *        the renderer draws with the fallback pipeline until they are ready.
+ */
+void renderer::reload_shaders()
+{
+    pipeline_description_.vertex_shader = render_scene_->get_vertex_shader();
+    pipeline_description_.fragment_shader = render_scene_->get_fragment_shader();
 
-    VK_CHECK(vkCreatePipelineLayout(vk_renderer_context_.vk_device_, &pipeline_layout_create_info, nullptr, &vk_pipeline_layout_));
+    for (pipeline_description& description : permutation_descriptions_)
+    {
+        description.vertex_shader = pipeline_description_.vertex_shader;
+        description.fragment_shader = pipeline_description_.fragment_shader;
+    }
+}
 
-    // NOTE(dhaval): Create RenderPass.
-    VkAttachmentDescription color_attachment_description{};
-    color_attachment_description.format = vk_swapchain_context_.vk_color_format_;
-    color_attachment_description.samples = VK_SAMPLE_COUNT_1_BIT;
-    color_attachment_description.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    color_attachment_description.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    color_attachment_description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    color_attachment_description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    color_attachment_description.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    color_attachment_description.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-    VkAttachmentReference color_attachment_reference{};
-    color_attachment_reference.attachment = 0;
-    color_attachment_reference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    VkAttachmentDescription depth_attachment_description{};
-    depth_attachment_description.format = vk_swapchain_context_.vk_depth_format_;
-    depth_attachment_description.samples = VK_SAMPLE_COUNT_1_BIT;
-    depth_attachment_description.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    depth_attachment_description.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    depth_attachment_description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    depth_attachment_description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    depth_attachment_description.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    depth_attachment_description.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-    VkAttachmentReference depth_attachment_reference{};
-    depth_attachment_reference.attachment = 1;
-    depth_attachment_reference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-    VkSubpassDescription subpass_description{};
-    subpass_description.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass_description.colorAttachmentCount = 1;
-    subpass_description.pColorAttachments = &color_attachment_reference;
-    subpass_description.pDepthStencilAttachment = &depth_attachment_reference;
-
-    VkSubpassDependency subpass_dependency{};
-    subpass_dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    subpass_dependency.dstSubpass = 0;
-    subpass_dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    subpass_dependency.srcAccessMask = 0;
-    subpass_dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    subpass_dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-    std::array<VkAttachmentDescription, 2> attachment_descriptions = {color_attachment_description, depth_attachment_description};
-    VkRenderPassCreateInfo render_pass_create_info{};
-    render_pass_create_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    render_pass_create_info.attachmentCount = static_cast<uint32_t>(attachment_descriptions.size());
-    render_pass_create_info.pAttachments = attachment_descriptions.data();
-    render_pass_create_info.subpassCount = 1;
-    render_pass_create_info.pSubpasses = &subpass_description;
-    render_pass_create_info.dependencyCount = 1;
-    render_pass_create_info.pDependencies = &subpass_dependency;
-
-    VK_CHECK(vkCreateRenderPass(vk_renderer_context_.vk_device_, &render_pass_create_info, nullptr, &vk_render_pass_));
-
-    // NOTE(dhaval): Create Graphics Pipeline;
-    VkGraphicsPipelineCreateInfo graphics_pipeline_create_info{};
-    graphics_pipeline_create_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    graphics_pipeline_create_info.stageCount = 2;
-    graphics_pipeline_create_info.pStages = shader_stages;
-    graphics_pipeline_create_info.pVertexInputState = &vertex_input_state_create_info;
-    graphics_pipeline_create_info.pInputAssemblyState = &input_assembly_state_create_info;
-    graphics_pipeline_create_info.pViewportState = &viewport_state_create_info;
-    graphics_pipeline_create_info.pRasterizationState = &rasterization_state_create_info;
-    graphics_pipeline_create_info.pMultisampleState = &multisample_state_create_info;
-    graphics_pipeline_create_info.pDepthStencilState = &depth_stencil_state_create_info;
-    graphics_pipeline_create_info.pColorBlendState = &color_blend_state_create_info;
-    graphics_pipeline_create_info.pDynamicState = nullptr;
-    graphics_pipeline_create_info.layout = vk_pipeline_layout_;
-    graphics_pipeline_create_info.renderPass = vk_render_pass_;
-    graphics_pipeline_create_info.subpass = 0;
-    graphics_pipeline_create_info.basePipelineHandle = VK_NULL_HANDLE;
-    graphics_pipeline_create_info.basePipelineIndex = -1;
-
-    VK_CHECK(vkCreateGraphicsPipelines(vk_renderer_context_.vk_device_, VK_NULL_HANDLE, 1, &graphics_pipeline_create_info, nullptr, &vk_pipeline_));
-
-    // NOTE(dhaval): Create Frambuffers
-    vk_frame_buffers_.resize(image_count);
-    for (size_t i = 0; i < image_count; i++)
-    {
-        std::array<VkImageView, 2> attachment_image_views = {vk_swapchain_context_.vk_swapchain_image_views_[i], vk_swapchain_context_.vk_depth_image_view_};
-
-        VkFramebufferCreateInfo framebuffer_create_info{};
-        framebuffer_create_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebuffer_create_info.renderPass = vk_render_pass_;
-        framebuffer_create_info.attachmentCount = static_cast<uint32_t>(attachment_image_views.size());
-        framebuffer_create_info.pAttachments = attachment_image_views.data();
-        framebuffer_create_info.width = vk_swapchain_context_.vk_extent_2d_.width;
-        framebuffer_create_info.height = vk_swapchain_context_.vk_extent_2d_.height;
-        framebuffer_create_info.layers = 1;
-
-        VK_CHECK(vkCreateFramebuffer(vk_renderer_context_.vk_device_, &framebuffer_create_info, nullptr, &vk_frame_buffers_[i]));
-    }
-
-    // NOTE(dhaval): Create Command Buffers
-    vk_command_buffers_.resize(image_count);
-
-    VkCommandBufferAllocateInfo command_buffer_allocate_info{};
-    command_buffer_allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    command_buffer_allocate_info.commandPool = vk_renderer_context_.vk_command_pool_;
-    command_buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    command_buffer_allocate_info.commandBufferCount = static_cast<uint32_t>(vk_command_buffers_.size());
-
-    VK_CHECK(vkAllocateCommandBuffers(vk_renderer_context_.vk_device_, &command_buffer_allocate_info, vk_command_buffers_.data()));
-
-    // NOTE(dhaval): Record Command Buffers
-    for (size_t i = 0; i < vk_command_buffers_.size(); i++)
-    {
-        VkCommandBufferBeginInfo command_buffer_begin_info{};
-        command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-        command_buffer_begin_info.pInheritanceInfo = nullptr;
-
-        VK_CHECK(vkBeginCommandBuffer(vk_command_buffers_[i], &command_buffer_begin_info));
-
-        VkRenderPassBeginInfo render_pass_begin_info{};
-        render_pass_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        render_pass_begin_info.renderPass = vk_render_pass_;
-        render_pass_begin_info.framebuffer = vk_frame_buffers_[i];
-        render_pass_begin_info.renderArea.offset = {0, 0};
-        render_pass_begin_info.renderArea.extent = vk_swapchain_context_.vk_extent_2d_;
-
-        std::array<VkClearValue, 2> clear_values = {};
-        clear_values[0].color = {0.0f, 0.0f, 0.0f, 1.0f};
-        clear_values[1].depthStencil = {1.0f, 0};
-        render_pass_begin_info.clearValueCount = static_cast<uint32_t>(clear_values.size());
-        render_pass_begin_info.pClearValues = clear_values.data();
-
-        vkCmdBeginRenderPass(vk_command_buffers_[i], &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
-        vkCmdBindPipeline(vk_command_buffers_[i], VK_PIPELINE_BIND_POINT_GRAPHICS, vk_pipeline_);
-        vkCmdBindDescriptorSets(vk_command_buffers_[i], VK_PIPELINE_BIND_POINT_GRAPHICS, vk_pipeline_layout_, 0, 1, &vk_descriptor_sets_[i], 0, nullptr);
-
-        const vulkan_mesh& mesh = render_scene->get_mesh();
-
-        VkBuffer vertex_buffers[] = {mesh.get_vertex_buffer()};
-        VkBuffer index_buffer = mesh.get_index_buffer();
-
-        VkDeviceSize offsets[] = {0};
-
-        vkCmdBindVertexBuffers(vk_command_buffers_[i], 0, 1, vertex_buffers, offsets);
-        vkCmdBindIndexBuffer(vk_command_buffers_[i], index_buffer, 0, VK_INDEX_TYPE_UINT32);
+/**
+ * \brief Picks up scene resources the loader finished since init() or the last call, they replace the placeholders the renderer drew so far.
+ *        Rebuilds the instances from the model's nodes and the occluder from its triangles and, with bindless textures, points the materials
+ *        at the new texture. No frame in flight may still read the materials.
+ */
+void renderer::refresh_scene_resources()
+{
+    create_instance_graph();
 
-        vkCmdDrawIndexed(vk_command_buffers_[i], mesh.get_num_indices(), 1, 0, 0, 0);
-
-        vkCmdEndRenderPass(vk_command_buffers_[i]);
+    if (config_.bindless_textures)
+    {
+        update_materials();
+    }
 
-        VK_CHECK(vkEndCommandBuffer(vk_command_buffers_[i]));
+    if (config_.occluder_count > 0)
+    {
+        occluder_mesh_ = render_scene_->get_mesh().build_occluder_mesh(occluder_triangle_budget);
     }
 }
 
 /**
- * \brief
- * \param image_index
- * \return  
+ * \brief Finds the distinct feature sets of the materials and specializes the pipeline description for each. Features the renderer can't provide
+ *        are dropped first, materials that only differed by those share a permutation.
  */
-VkCommandBuffer renderer::render(uint32_t image_index)
+void renderer::create_material_permutations()
 {
-    static auto start_time = std::chrono::high_resolution_clock::now();
-    auto current_time = std::chrono::high_resolution_clock::now();
+    if (config_.material_features.empty())
+    {
+        config_.material_features = {material_feature_default};
+    }
+
+    uint32_t material_capacity = config_.bindless_textures ? bindless_material_capacity : 1u << draw_key_material_bits;
+    assert(config_.material_features.size() <= material_capacity && "Too many materials");
+
+    uint32_t supported_features = get_supported_material_features();
+
+    permutations_.clear();
+    material_permutations_.clear();
+
+    for (uint32_t& features : config_.material_features)
+    {
+        if ((features & ~supported_features) != 0)
+        {
+            std::cout << "renderer: " << get_material_features_string(features & ~supported_features) << " not supported without bindless textures, ignored" << std::endl;
+            features &= supported_features;
+        }
+
+        material_permutations_.push_back(permutations_.add(features));
+    }
+
+    assert(permutations_.get_count() <= (1u << draw_key_pipeline_bits) && "Too many pipeline permutations");
 
-    const float rotation_speed = 0.1f;
-    float time = std::chrono::duration<float, std::chrono::seconds::period>(current_time - start_time).count();
+    permutation_descriptions_.clear();
+    for (uint32_t i = 0; i < permutations_.get_count(); i++)
+    {
+        pipeline_description description = pipeline_description_;
+        description.specialization_mask = permutations_.get_features(i);
 
-    VkBuffer uniform_buffer = vk_uniform_buffers_[image_index];
-    VkDeviceMemory uniform_buffer_memory = vk_uniform_buffers_memory_[image_index];
+        permutation_descriptions_.push_back(description);
 
-    const glm::vec3& up = {0.0f, 0.0f, 1.0f};
-    const glm::vec3& zero = {0.0f, 0.0f, 0.0f};
+        std::cout << "renderer: pipeline permutation " << i << ": " << get_material_features_string(permutations_.get_features(i)) << std::endl;
+    }
+}
+
+/**
+ * \brief Material features the fragment shader in use implements. Emissive materials need the material buffer of the bindless path.
+ * \return uint32_t
+ */
+uint32_t renderer::get_supported_material_features() const
+{
+    return config_.bindless_textures ? material_feature_all : material_feature_all & ~material_feature_emissive;
+}
 
+/**
+ * \brief Adds the scene texture to the texture table, replacing the one added before, and writes every material. The model has no authored
+ *        materials, every material samples the scene texture and differs only by its features.
+ */
+void renderer::update_materials()
+{
+    const vulkan_texture& texture = render_scene_->get_texture();
+    if (&texture == material_texture_)
+    {
+        return;
+    }
+
+    if (material_texture_index_ != invalid_texture_index)
+    {
+        texture_table_.remove_texture(material_texture_index_);
+    }
+
+    material_texture_ = &texture;
+    material_texture_index_ = texture_table_.add_texture(texture);
+
+    for (uint32_t i = 0; i < config_.material_features.size(); i++)
+    {
+        material_data material{};
+        material.base_color_texture = material_texture_index_;
+        material.base_color_factor = glm::vec4(1.0f);
+        material.emissive_factor = default_emissive_factor;
+        material.alpha_cutoff = default_alpha_cutoff;
+
+        texture_table_.set_material(i, material);
+    }
+}
+
+/**
+ * \brief Rebuilds the resources that depend on the swapchain size. Pipelines, layouts and the render pass are kept.
+ * \param swapchain_context The recreated swapchain. Must use the same color and depth formats as before.
+ */
+void renderer::resize(const vulkan_swapchain_context& swapchain_context)
+{
+    assert(swapchain_context.vk_color_format_ == vk_swapchain_context_.vk_color_format_ && "Swapchain color format changed, the renderer must be rebuilt");
+    assert(swapchain_context.vk_depth_format_ == vk_swapchain_context_.vk_depth_format_ && "Swapchain depth format changed, the renderer must be rebuilt");
+
+    destroy_swapchain_resources();
+
+    vk_swapchain_context_ = swapchain_context;
+
+    create_swapchain_resources();
+
+    assert(render_graph_.get_render_pass(render_graph_main_pass_) == pipeline_description_.render_pass && "Render graph built a different render pass, the renderer must be rebuilt");
+}
+
+/**
+ * \brief Declares and compiles the frame's render graph for the current swapchain. The main pass clears and draws into the swapchain image
+ *        and a transient depth buffer, the swapchain image is then handed to presentation, or left for readback when running headless.
+ */
+void renderer::create_swapchain_resources()
+{
+    const VkExtent2D& extent = vk_swapchain_context_.vk_extent_2d_;
+
+    // NOTE(dhaval): The acquired image changes every frame, render() swaps it in with set_imported_image().
+    render_graph_backbuffer_ = render_graph_.import_image("backbuffer", vk_swapchain_context_.vk_swapchain_images_[0], vk_swapchain_context_.vk_swapchain_image_views_[0],
+                                                          vk_swapchain_context_.vk_color_format_, extent, VK_IMAGE_ASPECT_COLOR_BIT, vk_swapchain_context_.backbuffer_usage_,
+                                                          vk_swapchain_context_.backbuffer_usage_);
+
+    render_graph_image_description depth_description{};
+    depth_description.format = vk_swapchain_context_.vk_depth_format_;
+    depth_description.extent = extent;
+    depth_description.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    depth_description.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+
+    uint32_t depth = render_graph_.create_image("depth", depth_description);
+
+    VkClearValue clear_color{};
+    clear_color.color = {0.0f, 0.0f, 0.0f, 1.0f};
+
+    VkClearValue clear_depth{};
+    clear_depth.depthStencil = {1.0f, 0};
+
+    render_graph_main_pass_ = render_graph_.add_pass("main");
+    render_graph_.write(render_graph_main_pass_, render_graph_backbuffer_, render_graph_usage::color_attachment, render_graph_load_op::clear, clear_color);
+    render_graph_.write(render_graph_main_pass_, depth, render_graph_usage::depth_attachment, render_graph_load_op::clear, clear_depth);
+    render_graph_.set_output(render_graph_backbuffer_);
+
+    render_graph_.compile();
+
+    const render_graph_statistics& statistics = render_graph_.get_graph().get_statistics();
+    std::cout << "renderer: render graph compiled, " << statistics.pass_count - statistics.culled_pass_count << " pass(es), " << statistics.culled_pass_count << " culled, "
+              << statistics.barrier_count << " barrier(s)/frame, " << statistics.transient_memory_size / 1024 << " KB transient attachments in "
+              << statistics.allocated_memory_size / 1024 << " KB" << std::endl;
+}
+
+/**
+ * \brief Destroys the render graph's attachments and framebuffers. Its render passes are kept for the pipelines.
+ */
+void renderer::destroy_swapchain_resources()
+{
+    render_graph_.reset();
+}
+
+/**
+ * \brief Writes the per frame state into the frame's uniform arena and records the frame's command buffer.
+ *        Instances outside the view frustum are culled first, the draws are then split evenly across the recording threads, each one recording a secondary command buffer.
+ * \param frame Frame context to record into. Its fence must have signaled and begin() must have been called.
+ * \param image_index Index of the acquired swapchain image.
+ * \param snapshot Simulation state the frame is drawn from, the camera and the instance transforms.
+ * \return VkCommandBuffer
+ */
+VkCommandBuffer renderer::render(vulkan_frame_context& frame, uint32_t image_index, const simulation_snapshot& snapshot)
+{
+    PBR_PROFILE_ZONE("renderer::render");
+
+    auto record_start_time = std::chrono::high_resolution_clock::now();
+
+    const simulation_camera& camera = snapshot.camera;
+    const glm::vec3& camera_position = camera.position;
     const float aspect = vk_swapchain_context_.vk_extent_2d_.width / (float)vk_swapchain_context_.vk_extent_2d_.height;
-    const float z_near = 0.1f;
-    const float z_far = 10.0f;
 
     shared_renderer_state uniform_buffer_object{};
-    uniform_buffer_object.model = glm::rotate(glm::mat4(1.0f), time * rotation_speed * glm::radians(90.0f), up);
-    uniform_buffer_object.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), zero, up);
-    uniform_buffer_object.projection = glm::perspective(glm::radians(45.0f), aspect, z_near, z_far);
+    uniform_buffer_object.view = camera.view;
+    uniform_buffer_object.projection = glm::perspective(glm::radians(camera.fov_y_degrees), aspect, camera.z_near, camera.z_far);
     uniform_buffer_object.projection[1][1] *= -1;
 
-    void* data;
-    vkMapMemory(vk_renderer_context_.vk_device_, uniform_buffer_memory, 0, sizeof(uniform_buffer_object), 0, &data);
-    memcpy(data, &uniform_buffer_object, sizeof(uniform_buffer_object));
-    vkUnmapMemory(vk_renderer_context_.vk_device_, uniform_buffer_memory);
+    // NOTE(dhaval): The arenas are persistently mapped, no map/unmap per frame.
+    frame_allocation uniform{};
+    bool allocated = frame.allocate_uniform(sizeof(uniform_buffer_object), uniform);
+    assert(allocated && "Can't allocate per frame uniform data");
+
+    memcpy(uniform.data, &uniform_buffer_object, sizeof(uniform_buffer_object));
+
+    // NOTE(dhaval): Frames drawn faster than the simulation ticks keep the transforms and culling bounds of the tick they already drew.
+    if (snapshot.tick != instance_tick_)
+    {
+        update_instances(snapshot.model_rotation);
+        instance_tick_ = snapshot.tick;
+    }
+
+    auto cull_start_time = std::chrono::high_resolution_clock::now();
+
+    cull_instances(uniform_buffer_object.projection * uniform_buffer_object.view, camera_position);
+
+    auto cull_end_time = std::chrono::high_resolution_clock::now();
+    double cull_ms = std::chrono::duration<double, std::milli>(cull_end_time - cull_start_time).count();
+
+    uint32_t visible_instance_count = static_cast<uint32_t>(visible_instances_.size());
+    PBR_PROFILE_COUNTER("visible instances", visible_instance_count);
+
+    auto sort_start_time = std::chrono::high_resolution_clock::now();
+
+    sort_draws(camera_position, camera.z_far);
+
+    auto sort_end_time = std::chrono::high_resolution_clock::now();
+    double sort_ms = std::chrono::duration<double, std::milli>(sort_end_time - sort_start_time).count();
+
+    uint32_t sorted_draw_count = static_cast<uint32_t>(sorted_draws_.size());
+
+    // NOTE(dhaval): Filled by the recording threads, each one writes the visible instances of its own draws. Never empty so the binding offset stays valid.
+    frame_allocation instances{};
+    allocated = frame.allocate_instances(sizeof(instance_data) * std::max(visible_instance_count, 1u), instances);
+    assert(allocated && "Can't allocate per frame instance data");
+
+    uint32_t task_count = std::min({config_.record_thread_count, sorted_draw_count, frame.get_secondary_command_buffer_count()});
+    task_count = std::max(task_count, 1u);
+
+    frame_allocation indirect_commands{};
+    frame_allocation indirect_draw_counts{};
+
+    if (config_.indirect_draws)
+    {
+        allocated = frame.allocate_indirect(sizeof(VkDrawIndexedIndirectCommand) * config_.draw_count, indirect_commands);
+        allocated = allocated && frame.allocate_indirect(sizeof(uint32_t) * config_.draw_count, indirect_draw_counts);
+        assert(allocated && "Can't allocate per frame indirect commands");
+    }
 
-    return vk_command_buffers_[image_index];
+    // NOTE(dhaval): Transient descriptor set, recycled together with the rest of the frame.
+    VkDescriptorSet descriptor_set = VK_NULL_HANDLE;
+    allocated = frame.get_descriptor_allocator().allocate(vk_descriptor_set_layout_, descriptor_set);
+    assert(allocated && "Can't allocate per frame descriptor set");
+
+    const vulkan_texture& texture = render_scene_->get_texture();
+
+    VkDescriptorBufferInfo descriptor_buffer_info{};
+    descriptor_buffer_info.buffer = uniform.buffer;
+    descriptor_buffer_info.offset = uniform.offset;
+    descriptor_buffer_info.range = sizeof(shared_renderer_state);
+
+    VkDescriptorImageInfo descriptor_image_info{};
+    descriptor_image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    descriptor_image_info.imageView = texture.get_image_view();
+    descriptor_image_info.sampler = texture.get_sampler();
+
+    std::array<VkWriteDescriptorSet, 2> write_descriptor_sets{};
+
+    write_descriptor_sets[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write_descriptor_sets[0].dstSet = descriptor_set;
+    write_descriptor_sets[0].dstBinding = 0;
+    write_descriptor_sets[0].dstArrayElement = 0;
+    write_descriptor_sets[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    write_descriptor_sets[0].descriptorCount = 1;
+    write_descriptor_sets[0].pBufferInfo = &descriptor_buffer_info;
+
+    write_descriptor_sets[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write_descriptor_sets[1].dstSet = descriptor_set;
+    write_descriptor_sets[1].dstBinding = 1;
+    write_descriptor_sets[1].dstArrayElement = 0;
+    write_descriptor_sets[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write_descriptor_sets[1].descriptorCount = 1;
+    write_descriptor_sets[1].pImageInfo = &descriptor_image_info;
+
+    uint32_t write_descriptor_set_count = config_.bindless_textures ? 1 : static_cast<uint32_t>(write_descriptor_sets.size());
+    vkUpdateDescriptorSets(vk_renderer_context_.vk_device_, write_descriptor_set_count, write_descriptor_sets.data(), 0, nullptr);
+
+    // NOTE(dhaval): Asked every frame so a pipeline that finished compiling in the background replaces the fallback.
+    for (uint32_t i = 0; i < permutation_descriptions_.size(); i++)
+    {
+        permutation_pipelines_[i] = pipeline_state_cache_.get_pipeline(permutation_descriptions_[i]);
+    }
+
+    // NOTE(dhaval): Materials differ by their material buffer entry and pipeline, they all bind the frame's set. The mesh table has a single entry for now.
+    material_descriptor_sets_.assign(config_.material_features.size(), descriptor_set);
+    const vulkan_mesh* meshes[] = {&render_scene_->get_mesh()};
+
+    draw_recording_state recording_state{};
+    recording_state.extent = vk_swapchain_context_.vk_extent_2d_;
+    recording_state.pipeline_layout = vk_pipeline_layout_;
+    recording_state.pipelines = permutation_pipelines_.data();
+    recording_state.descriptor_sets = material_descriptor_sets_.data();
+    recording_state.meshes = meshes;
+    recording_state.instances = static_cast<instance_data*>(instances.data);
+    recording_state.instance_buffer = instances.buffer;
+    recording_state.instance_offset = instances.offset;
+    recording_state.indirect_commands = static_cast<VkDrawIndexedIndirectCommand*>(indirect_commands.data);
+    recording_state.indirect_draw_counts = static_cast<uint32_t*>(indirect_draw_counts.data);
+    recording_state.indirect_buffer = indirect_commands.buffer;
+    recording_state.indirect_commands_offset = indirect_commands.offset;
+    recording_state.indirect_draw_counts_offset = indirect_draw_counts.offset;
+    recording_state.multi_draw_indirect = vk_renderer_context_.multi_draw_indirect_supported;
+    recording_state.draw_indirect_count = vk_renderer_context_.draw_indirect_count_supported;
+    recording_state.max_draw_indirect_count = max_draw_indirect_count_;
+    recording_state.instance_transforms = instance_transforms_.data();
+    recording_state.visible_instances = visible_instances_.data();
+    recording_state.draw_first_visible = draw_first_visible_.data();
+    recording_state.draw_order = sorted_draws_.data();
+    recording_state.draw_keys = draw_sorter_.get_sorted_keys().data();
+    recording_state.texture_table_set = config_.bindless_textures ? texture_table_.get_descriptor_set() : VK_NULL_HANDLE;
+
+    draw_state_changes state_changes;
+
+    // NOTE(dhaval): Record Command Buffer
+    VkCommandBuffer command_buffer = frame.get_command_buffer();
+
+    VkCommandBufferBeginInfo command_buffer_begin_info{};
+    command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    command_buffer_begin_info.pInheritanceInfo = nullptr;
+
+    VK_CHECK(vkBeginCommandBuffer(command_buffer, &command_buffer_begin_info));
+
+    gpu_profiler_.begin_frame(frame.get_frame_index(), command_buffer);
+    uint32_t frame_gpu_scope = gpu_profiler_.begin_scope(command_buffer, "frame", false);
+
+    render_graph_.set_imported_image(render_graph_backbuffer_, vk_swapchain_context_.vk_swapchain_images_[image_index], vk_swapchain_context_.vk_swapchain_image_views_[image_index]);
+
+    if (task_count <= 1)
+    {
+        render_graph_.set_pass_record(render_graph_main_pass_, VK_SUBPASS_CONTENTS_INLINE, [&](const render_graph_pass_context& context) {
+            state_changes = record_draws(recording_state, context.command_buffer, 0, sorted_draw_count);
+        });
+    }
+    else
+    {
+        render_graph_.set_pass_record(render_graph_main_pass_, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS, [&](const render_graph_pass_context& context) {
+            VkCommandBufferInheritanceInfo command_buffer_inheritance_info{};
+            command_buffer_inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+            command_buffer_inheritance_info.renderPass = context.render_pass;
+            command_buffer_inheritance_info.subpass = 0;
+            command_buffer_inheritance_info.framebuffer = context.framebuffer;
+
+            // NOTE(dhaval): The profiler's statistics query stays active while the secondary command buffers execute.
+            if (gpu_profiler_.is_pipeline_statistics_enabled())
+            {
+                command_buffer_inheritance_info.pipelineStatistics = vulkan_gpu_profiler::get_pipeline_statistics_flags();
+            }
+
+            std::vector<draw_state_changes> task_state_changes(task_count);
+
+            // NOTE(dhaval): Each task only touches its own secondary command buffer, pool and instances.
+            std::function<void(uint32_t)> record_task = [&](uint32_t task_index) {
+                PBR_PROFILE_ZONE("record draws");
+
+                uint32_t first_position = static_cast<uint32_t>(static_cast<uint64_t>(sorted_draw_count) * task_index / task_count);
+                uint32_t last_position = static_cast<uint32_t>(static_cast<uint64_t>(sorted_draw_count) * (task_index + 1) / task_count);
+
+                VkCommandBuffer secondary_command_buffer = frame.get_secondary_command_buffer(task_index);
+
+                VkCommandBufferBeginInfo secondary_begin_info{};
+                secondary_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+                secondary_begin_info.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+                secondary_begin_info.pInheritanceInfo = &command_buffer_inheritance_info;
+
+                VK_CHECK(vkBeginCommandBuffer(secondary_command_buffer, &secondary_begin_info));
+                task_state_changes[task_index] = record_draws(recording_state, secondary_command_buffer, first_position, last_position - first_position);
+                VK_CHECK(vkEndCommandBuffer(secondary_command_buffer));
+            };
+
+            jobs_->dispatch(task_count, record_task);
+
+            // NOTE(dhaval): Every secondary command buffer starts with nothing bound, each task pays its own first binds.
+            for (const draw_state_changes& changes : task_state_changes)
+            {
+                state_changes.pipeline_binds += changes.pipeline_binds;
+                state_changes.material_binds += changes.material_binds;
+                state_changes.mesh_binds += changes.mesh_binds;
+            }
+
+            std::vector<VkCommandBuffer> secondary_command_buffers(task_count);
+            for (uint32_t i = 0; i < task_count; i++)
+            {
+                secondary_command_buffers[i] = frame.get_secondary_command_buffer(i);
+            }
+
+            vkCmdExecuteCommands(context.command_buffer, task_count, secondary_command_buffers.data());
+        });
+    }
+
+    // NOTE(dhaval): Barriers, render pass begin and end all come from the render graph.
+    {
+        PBR_PROFILE_ZONE("render graph execute");
+        render_graph_.execute(command_buffer, config_.gpu_profiling ? &gpu_profiler_ : nullptr);
+    }
+
+    gpu_profiler_.end_scope(command_buffer, frame_gpu_scope);
+
+    VK_CHECK(vkEndCommandBuffer(command_buffer));
+
+    auto record_end_time = std::chrono::high_resolution_clock::now();
+    double record_ms = std::chrono::duration<double, std::milli>(record_end_time - record_start_time).count();
+
+    statistics_.frame_count++;
+    statistics_.total_record_ms += record_ms;
+    statistics_.max_record_ms = std::max(statistics_.max_record_ms, record_ms);
+    statistics_.total_cull_ms += cull_ms;
+    statistics_.max_cull_ms = std::max(statistics_.max_cull_ms, cull_ms);
+    statistics_.total_visible_instance_count += visible_instance_count;
+    statistics_.total_sort_ms += sort_ms;
+    statistics_.total_pipeline_binds += state_changes.pipeline_binds;
+    statistics_.total_material_binds += state_changes.material_binds;
+    statistics_.total_mesh_binds += state_changes.mesh_binds;
+
+    // NOTE(dhaval): The frame's allocator was reset when the frame began, its count covers this frame only.
+    uint32_t descriptor_set_count = frame.get_descriptor_allocator().get_statistics().allocation_count;
+    PBR_PROFILE_COUNTER("descriptor sets", descriptor_set_count);
+
+    statistics_.total_descriptor_set_count += descriptor_set_count;
+    statistics_.max_descriptor_set_count = std::max(statistics_.max_descriptor_set_count, descriptor_set_count);
+
+    return command_buffer;
 }
 
 /**
- * \brief Destorys all resources created in renderer::init().
+ * \brief Builds the instance scene graph, one root per instance on a square grid centered on the origin.
  */
-void renderer::shutdown()
+void renderer::create_instance_graph()
 {
-    for (auto uniform_buffer : vk_uniform_buffers_)
+    uint32_t total_instance_count = config_.draw_count * config_.instance_count;
+
+    uint32_t grid_size = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(total_instance_count))));
+    float grid_offset = (grid_size - 1) * 0.5f;
+
+    const scene_graph& model_graph = render_scene_->get_scene_graph();
+    uint32_t model_mesh_node = model_graph.find_mesh_node(0);
+
+    instance_graph_.clear();
+    instance_nodes_.resize(total_instance_count);
+
+    for (uint32_t i = 0; i < total_instance_count; i++)
+    {
+        glm::vec3 position((i % grid_size - grid_offset) * draw_grid_spacing, (i / grid_size - grid_offset) * draw_grid_spacing, 0.0f);
+
+        instance_nodes_[i] = instance_graph_.add_node(invalid_scene_index, position, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f));
+        instance_graph_.append(model_graph, instance_nodes_[i]);
+    }
+
+    // NOTE(dhaval): Without a node for the mesh the instance root itself places it.
+    instance_mesh_node_offset_ = model_mesh_node == invalid_scene_index ? 0 : model_mesh_node + 1;
+    instance_tick_ = invalid_simulation_tick;
+}
+
+/**
+ * \brief Rotates every instance root, updates the instance scene graph and refreshes the world bounds in the frustum culler.
+ * \param model_rotation Rotation of every instance around its grid position.
+ */
+void renderer::update_instances(const glm::quat& model_rotation)
+{
+    PBR_PROFILE_ZONE("update instances");
+
+    uint32_t total_instance_count = config_.draw_count * config_.instance_count;
+
+    instance_transforms_.resize(total_instance_count);
+    frustum_culler_.resize(total_instance_count);
+
+    for (uint32_t node : instance_nodes_)
+    {
+        instance_graph_.set_local_transform(node, instance_graph_.get_translation(node), model_rotation, instance_graph_.get_scale(node));
+    }
+
+    instance_graph_.update_world_transforms(jobs_);
+
+    const bounding_volume& mesh_bounds = render_scene_->get_mesh().get_bounds();
+
+    jobs_->parallel_for(total_instance_count, instance_update_chunk_size, [&](uint32_t first_instance, uint32_t last_instance) {
+        for (uint32_t i = first_instance; i < last_instance; i++)
+        {
+            instance_transforms_[i] = instance_graph_.get_world_transform(instance_nodes_[i] + instance_mesh_node_offset_);
+            frustum_culler_.set_bounds(i, mesh_bounds, instance_transforms_[i]);
+        }
+    });
+}
+
+/**
+ * \brief Builds the sorted list of visible instances and the range of it every draw covers.
+ * \param view_projection Projection matrix multiplied by the view matrix of the frame.
+ * \param camera_position World position of the camera, used to pick the occluders.
+ */
+void renderer::cull_instances(const glm::mat4& view_projection, const glm::vec3& camera_position)
+{
+    PBR_PROFILE_ZONE("cull instances");
+
+    uint32_t total_instance_count = config_.draw_count * config_.instance_count;
+
+    if (config_.frustum_culling)
+    {
+        frustum_culler_.cull(frustum::from_view_projection(view_projection), visible_instances_, jobs_);
+    }
+    else
+    {
+        visible_instances_.resize(total_instance_count);
+        std::iota(visible_instances_.begin(), visible_instances_.end(), 0u);
+    }
+
+    if (config_.occluder_count > 0)
+    {
+        auto occlusion_start_time = std::chrono::high_resolution_clock::now();
+
+        cull_occluded_instances(view_projection, camera_position);
+
+        auto occlusion_end_time = std::chrono::high_resolution_clock::now();
+        statistics_.total_occlusion_ms += std::chrono::duration<double, std::milli>(occlusion_end_time - occlusion_start_time).count();
+    }
+
+    // NOTE(dhaval): Visible indices are ascending, so the visible instances of each draw are contiguous.
+    uint32_t visible_instance_count = static_cast<uint32_t>(visible_instances_.size());
+    draw_first_visible_.resize(config_.draw_count + 1);
+
+    uint32_t visible = 0;
+    for (uint32_t i = 0; i < config_.draw_count; i++)
+    {
+        draw_first_visible_[i] = visible;
+
+        uint32_t draw_end = (i + 1) * config_.instance_count;
+        while (visible < visible_instance_count && visible_instances_[visible] < draw_end)
+        {
+            visible++;
+        }
+    }
+
+    draw_first_visible_[config_.draw_count] = visible_instance_count;
+}
+
+/**
+ * \brief Builds the key of every draw with visible instances and sorts them. Draws binding the same state end up next to each other, front to back.
+ * \param camera_position World position of the camera.
+ * \param z_far Distance of the far plane, depths are normalized by it.
+ */
+void renderer::sort_draws(const glm::vec3& camera_position, float z_far)
+{
+    PBR_PROFILE_ZONE("sort draws");
+
+    draw_keys_.clear();
+    key_draws_.clear();
+
+    for (uint32_t i = 0; i < config_.draw_count; i++)
     {
-        vkDestroyBuffer(vk_renderer_context_.vk_device_, uniform_buffer, nullptr);
+        uint32_t first_visible = draw_first_visible_[i];
+
+        // NOTE(dhaval): Fully culled draws are not recorded at all.
+        if (first_visible == draw_first_visible_[i + 1])
+        {
+            continue;
+        }
+
+        // NOTE(dhaval): The first visible instance stands in for the whole draw, good enough for front to back ordering.
+        glm::vec3 offset = glm::vec3(instance_transforms_[visible_instances_[first_visible]][3]) - camera_position;
+
+        uint32_t material = i % static_cast<uint32_t>(material_permutations_.size());
+
+        draw_keys_.push_back(make_draw_key(0, material_permutations_[material], material, 0, std::sqrt(glm::dot(offset, offset)) / z_far));
+        key_draws_.push_back(i);
     }
 
-    vk_uniform_buffers_.clear();
+    uint32_t key_count = static_cast<uint32_t>(draw_keys_.size());
+    draw_sorter_.sort(draw_keys_.data(), key_count);
+
+    const std::vector<uint32_t>& order = draw_sorter_.get_order();
+    sorted_draws_.resize(key_count);
 
-    for (auto uniform_buffer_memory : vk_uniform_buffers_memory_)
+    for (uint32_t i = 0; i < key_count; i++)
     {
-        vkFreeMemory(vk_renderer_context_.vk_device_, uniform_buffer_memory, nullptr);
+        sorted_draws_[i] = key_draws_[order[i]];
     }
+}
+
+/**
+ * \brief Rasterizes the instances nearest to the camera as occluders and removes the instances hidden behind them from visible_instances_.
+ * \param view_projection Projection matrix multiplied by the view matrix of the frame.
+ * \param camera_position World position of the camera.
+ */
+void renderer::cull_occluded_instances(const glm::mat4& view_projection, const glm::vec3& camera_position)
+{
+    PBR_PROFILE_ZONE("occlusion cull");
+
+    // NOTE(dhaval): Close instances cover the most pixels, they make the best occluders.
+    occluder_candidates_ = visible_instances_;
 
-    vk_uniform_buffers_memory_.clear();
+    uint32_t occluder_count = std::min(config_.occluder_count, static_cast<uint32_t>(occluder_candidates_.size()));
 
-    for (auto frame_buffer : vk_frame_buffers_)
+    auto distance_squared = [&](uint32_t instance) {
+        glm::vec3 offset = glm::vec3(instance_transforms_[instance][3]) - camera_position;
+        return glm::dot(offset, offset);
+    };
+
+    if (occluder_count < occluder_candidates_.size())
     {
-        vkDestroyFramebuffer(vk_renderer_context_.vk_device_, frame_buffer, nullptr);
+        std::nth_element(occluder_candidates_.begin(), occluder_candidates_.begin() + occluder_count, occluder_candidates_.end(),
+                         [&](uint32_t a, uint32_t b) { return distance_squared(a) < distance_squared(b); });
     }
 
-    vk_frame_buffers_.clear();
+    occlusion_culler_.begin(view_projection);
+    for (uint32_t i = 0; i < occluder_count; i++)
+    {
+        occlusion_culler_.add_occluder(occluder_mesh_, instance_transforms_[occluder_candidates_[i]]);
+    }
+
+    occlusion_culler_.rasterize(jobs_);
+
+    // NOTE(dhaval): Compaction keeps the order, the list stays ascending for the per draw ranges built after this.
+    uint32_t frustum_visible_count = static_cast<uint32_t>(visible_instances_.size());
+    uint32_t visible_count = occlusion_culler_.cull(frustum_culler_, visible_instances_, jobs_);
+
+    statistics_.total_occluded_instance_count += frustum_visible_count - visible_count;
+}
+
+/**
+ * \brief Destorys all resources created in renderer::init().
+ */
+void renderer::shutdown()
+{
+    render_scene_ = nullptr;
+    jobs_ = nullptr;
+
+    gpu_profiler_.shutdown();
+
+    instance_graph_.clear();
+    instance_nodes_.clear();
+    instance_tick_ = invalid_simulation_tick;
+
+    occlusion_culler_.shutdown();
+    occluder_mesh_ = {};
+
+    if (config_.bindless_textures)
+    {
+        texture_table_.shutdown();
+    }
+
+    material_texture_ = nullptr;
+    material_texture_index_ = invalid_texture_index;
+
+    destroy_swapchain_resources();
+
+    pipeline_state_cache_.shutdown();
 
-    vkDestroyPipeline(vk_renderer_context_.vk_device_, vk_pipeline_, nullptr);
-    vk_pipeline_ = VK_NULL_HANDLE;
+    permutations_.clear();
+    material_permutations_.clear();
+    permutation_descriptions_.clear();
+    permutation_pipelines_.clear();
+    material_descriptor_sets_.clear();
 
     vkDestroyPipelineLayout(vk_renderer_context_.vk_device_, vk_pipeline_layout_, nullptr);
     vk_pipeline_layout_ = VK_NULL_HANDLE;
 
     vkDestroyDescriptorSetLayout(vk_renderer_context_.vk_device_, vk_descriptor_set_layout_, nullptr);
-    vk_descriptor_set_layout_ = nullptr;
+    vk_descriptor_set_layout_ = VK_NULL_HANDLE;
 
-    vkDestroyRenderPass(vk_renderer_context_.vk_device_, vk_render_pass_, nullptr);
-    vk_render_pass_ = VK_NULL_HANDLE;
+    render_graph_.shutdown();
 }
@@ -2,41 +2,220 @@
 
 #include <volk.h>
 
+#include <glm/glm.hpp>
+
+#include <array>
 #include <string>
 #include <vector>
 
+#include "DrawSorter.hpp"
+#include "FrustumCuller.hpp"
+#include "JobSystem.hpp"
+#include "OcclusionCuller.hpp"
+#include "SceneGraph.hpp"
+#include "ShaderPermutation.hpp"
+#include "Simulation.hpp"
+#include "VulkanDescriptorAllocator.hpp"
+#include "VulkanFrameContext.hpp"
+#include "VulkanGpuProfiler.hpp"
+#include "VulkanPipelineStateCache.hpp"
+#include "VulkanRenderGraph.hpp"
 #include "VulkanRendererContext.hpp"
+#include "VulkanTextureTable.hpp"
 
 class render_scene;
 
+/**
+ * \brief Startup options of the renderer.
+ */
+struct renderer_config
+{
+    // NOTE(dhaval): Job system tasks recording secondary command buffers, 1 records everything inline into the primary.
+    uint32_t record_thread_count{1};
+
+    // NOTE(dhaval): Draw calls issued each frame for the scene mesh.
+    uint32_t draw_count{1};
+
+    // NOTE(dhaval): Instances drawn by each draw call.
+    uint32_t instance_count{1};
+
+    // NOTE(dhaval): Submit draws through vkCmdDrawIndexedIndirect(Count) instead of one vkCmdDrawIndexed each. Ignored without drawIndirectFirstInstance.
+    bool indirect_draws{true};
+
+    // NOTE(dhaval): Cull instances against the view frustum on the CPU, only visible instances are written and drawn.
+    bool frustum_culling{true};
+
+    // NOTE(dhaval): Nearest visible instances rasterized as occluders each frame, 0 disables occlusion culling.
+    uint32_t occluder_count{0};
+
+    // NOTE(dhaval): Sample textures through the bindless texture table, materials index it from the material buffer. Needs descriptor indexing.
+    bool bindless_textures{false};
+
+    // NOTE(dhaval): Measure GPU time of the frame and of every render graph pass, optionally with pipeline statistics.
+    bool gpu_profiling{false};
+    bool gpu_pipeline_statistics{false};
+
+    // NOTE(dhaval): material_feature mask of every material of the scene, draw i uses material i % size. One pipeline is built per distinct mask.
+    std::vector<uint32_t> material_features{material_feature_default};
+};
+
+/**
+ * \brief Per instance vertex data, written every frame into the frame's instance arena. Per draw data (material) goes through draw_push_constants.
+ */
+struct instance_data
+{
+    glm::mat4 model;
+
+    static VkVertexInputBindingDescription get_vertex_input_binding_description();
+    static std::array<VkVertexInputAttributeDescription, 4> get_vertex_input_attribute_descriptions();
+};
+
+// NOTE(dhaval): draw_push_constants::model_rows holds the model matrix of the draw's only instance, the instance arena is not read.
+static const uint32_t draw_push_model_flag = 1 << 0;
+
+/**
+ * \brief Per draw data pushed with vkCmdPushConstants before every direct draw, or once per run of indirect draws. Read by the vertex shader.
+ */
+struct draw_push_constants
+{
+    uint32_t object_index;
+    uint32_t material_index;
+    uint32_t flags;
+    uint32_t padding;
+
+    // NOTE(dhaval): First three rows of the model matrix, the last one is always (0, 0, 0, 1).
+    glm::vec4 model_rows[3];
+
+    static VkPushConstantRange get_push_constant_range();
+};
+
+/**
+ * \brief CPU timings of the renderer since it was initialized.
+ */
+struct renderer_statistics
+{
+    uint64_t frame_count{0};
+    double total_record_ms{0.0};
+    double max_record_ms{0.0};
+    double total_cull_ms{0.0};
+    double max_cull_ms{0.0};
+    uint64_t total_visible_instance_count{0};
+    double total_occlusion_ms{0.0};
+    uint64_t total_occluded_instance_count{0};
+    double total_sort_ms{0.0};
+    uint64_t total_pipeline_binds{0};
+    uint64_t total_material_binds{0};
+    uint64_t total_mesh_binds{0};
+    uint64_t total_descriptor_set_count{0};
+    uint32_t max_descriptor_set_count{0};
+};
+
 /**
  * \brief Renderer that the application will create and use.
  */
 class renderer
 {
 public:
-    renderer(const vulkan_renderer_context& renderer_context, const vulkan_swapchain_context& swapchain_context) : vk_renderer_context_(renderer_context), vk_swapchain_context_(swapchain_context)
+    renderer(const vulkan_renderer_context& renderer_context, const vulkan_swapchain_context& swapchain_context)
+        : vk_renderer_context_(renderer_context), vk_swapchain_context_(swapchain_context), pipeline_state_cache_(renderer_context),
+          texture_table_(renderer_context), render_graph_(renderer_context), gpu_profiler_(renderer_context)
     {
     }
 
-    void init(const render_scene* render_scene);
-    VkCommandBuffer render(uint32_t image_index);
+    void init(const render_scene* render_scene, job_system* jobs, const renderer_config& config);
+    VkCommandBuffer render(vulkan_frame_context& frame, uint32_t image_index, const simulation_snapshot& snapshot);
     void shutdown();
 
+    void resize(const vulkan_swapchain_context& swapchain_context);
+    void destroy_swapchain_resources();
+
+    void reload_shaders();
+    void refresh_scene_resources();
+
+    inline const renderer_statistics& get_statistics() const { return statistics_; }
+    inline const vulkan_texture_table& get_texture_table() const { return texture_table_; }
+    inline const vulkan_render_graph& get_render_graph() const { return render_graph_; }
+    inline const vulkan_gpu_profiler& get_gpu_profiler() const { return gpu_profiler_; }
+
+    static std::vector<descriptor_pool_ratio> get_frame_descriptor_pool_ratios();
+    static frame_context_config get_frame_context_config(const renderer_config& config);
+
+private:
+    void create_swapchain_resources();
+    void create_instance_graph();
+    void update_instances(const glm::quat& model_rotation);
+    void cull_instances(const glm::mat4& view_projection, const glm::vec3& camera_position);
+    void cull_occluded_instances(const glm::mat4& view_projection, const glm::vec3& camera_position);
+    void sort_draws(const glm::vec3& camera_position, float z_far);
+
+    void create_material_permutations();
+    uint32_t get_supported_material_features() const;
+    void update_materials();
+
 private:
     vulkan_renderer_context vk_renderer_context_;
     vulkan_swapchain_context vk_swapchain_context_;
 
-    VkRenderPass vk_render_pass_{VK_NULL_HANDLE};
+    const render_scene* render_scene_{nullptr};
+
+    renderer_config config_;
+    renderer_statistics statistics_;
+    uint32_t max_draw_indirect_count_{1};
+
+    // NOTE(dhaval): Borrowed from the application. Culling and recording run on it, asset loading shares its workers.
+    job_system* jobs_{nullptr};
+
+    // NOTE(dhaval): One root per instance with a copy of the model's nodes below it, the mesh node sits instance_mesh_node_offset_ after its root.
+    scene_graph instance_graph_;
+    std::vector<uint32_t> instance_nodes_;
+    uint32_t instance_mesh_node_offset_{0};
+
+    // NOTE(dhaval): Simulation tick the instance transforms and culling bounds were last updated to.
+    uint64_t instance_tick_{invalid_simulation_tick};
+
+    // NOTE(dhaval): Rebuilt every frame. draw_first_visible_[i] is the first entry of visible_instances_ drawn by draw i.
+    std::vector<glm::mat4> instance_transforms_;
+    std::vector<uint32_t> visible_instances_;
+    std::vector<uint32_t> draw_first_visible_;
+    frustum_culler frustum_culler_;
+
+    // NOTE(dhaval): Only used when config_.occluder_count > 0. occluder_candidates_ is scratch space reused every frame.
+    occlusion_culler occlusion_culler_;
+    occluder_mesh occluder_mesh_;
+    std::vector<uint32_t> occluder_candidates_;
+
+    // NOTE(dhaval): Rebuilt every frame. draw_keys_[i] is the key of draw key_draws_[i], sorted_draws_ lists the draws in key order.
+    std::vector<uint64_t> draw_keys_;
+    std::vector<uint32_t> key_draws_;
+    std::vector<uint32_t> sorted_draws_;
+    draw_sorter draw_sorter_;
+
     VkDescriptorSetLayout vk_descriptor_set_layout_{VK_NULL_HANDLE};
     VkPipelineLayout vk_pipeline_layout_{VK_NULL_HANDLE};
-    VkPipeline vk_pipeline_{VK_NULL_HANDLE};
 
-    std::vector<VkFramebuffer> vk_frame_buffers_;
-    std::vector<VkCommandBuffer> vk_command_buffers_;
+    // NOTE(dhaval): Owns every pipeline the renderer uses, permutation_pipelines_ are borrowed from it.
+    vulkan_pipeline_state_cache pipeline_state_cache_;
+    pipeline_description pipeline_description_;
+
+    // NOTE(dhaval): material_permutations_[m] is the permutation of material m. permutation_descriptions_[p] is pipeline_description_ specialized
+    // for permutation p, permutation_pipelines_[p] its pipeline this frame, looked up by the pipeline field of the draw keys.
+    shader_permutation_set permutations_;
+    std::vector<uint32_t> material_permutations_;
+    std::vector<pipeline_description> permutation_descriptions_;
+    std::vector<VkPipeline> permutation_pipelines_;
+    std::vector<VkDescriptorSet> material_descriptor_sets_;
+
+    // NOTE(dhaval): Only used when config_.bindless_textures is set, bound as set 1 next to the per frame set. material_texture_ is the scene
+    // texture the materials point at, in slot material_texture_index_.
+    vulkan_texture_table texture_table_;
+    const vulkan_texture* material_texture_{nullptr};
+    uint32_t material_texture_index_{invalid_texture_index};
 
-    std::vector<VkBuffer> vk_uniform_buffers_;
-    std::vector<VkDeviceMemory> vk_uniform_buffers_memory_;
+    // NOTE(dhaval): Rebuilt with the swapchain. Owns the depth buffer and the render pass the pipelines are built against.
+    vulkan_render_graph render_graph_;
+    uint32_t render_graph_backbuffer_{invalid_render_graph_index};
+    uint32_t render_graph_main_pass_{invalid_render_graph_index};
 
-    std::vector<VkDescriptorSet> vk_descriptor_sets_;
+    // NOTE(dhaval): Only used when config_.gpu_profiling is set. Results lag the frame being recorded by the number of frames in flight.
+    vulkan_gpu_profiler gpu_profiler_;
 };
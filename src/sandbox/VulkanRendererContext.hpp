@@ -4,6 +4,8 @@
 
 #include <vector>
 
+#include "RenderGraph.hpp"
+
 /**
  * \brief Macro that checks if a vulkan api function was successfull or not.
  * \param call Any vulkan api function that returns a VkResult.
@@ -18,9 +20,22 @@ struct vulkan_renderer_context
     VkDevice vk_device_{VK_NULL_HANDLE};
     VkPhysicalDevice vk_physical_device_{VK_NULL_HANDLE};
     VkCommandPool vk_command_pool_{VK_NULL_HANDLE};
+    VkPipelineCache vk_pipeline_cache_{VK_NULL_HANDLE};
 
     VkQueue graphics_queue{VK_NULL_HANDLE};
     VkQueue present_queue{VK_NULL_HANDLE};
+    uint32_t graphics_queue_family_index{0};
+
+    // NOTE(dhaval): Optional device features, only enabled when the physical device supports them.
+    bool multi_draw_indirect_supported{false};
+    bool draw_indirect_first_instance_supported{false};
+    bool draw_indirect_count_supported{false};
+
+    // NOTE(dhaval): pipelineStatisticsQuery and inheritedQueries, statistics queries may then stay active across secondary command buffers.
+    bool pipeline_statistics_query_supported{false};
+
+    // NOTE(dhaval): VK_EXT_descriptor_indexing with partially bound, update after bind sampled image arrays. Only enabled when bindless textures are requested.
+    bool descriptor_indexing_supported{false};
 };
 
 /**
@@ -28,10 +43,12 @@ struct vulkan_renderer_context
  */
 struct vulkan_swapchain_context
 {
-    VkDescriptorPool vk_descriptor_pool{VK_NULL_HANDLE};
     VkFormat vk_color_format_;
     VkFormat vk_depth_format_;
     VkExtent2D vk_extent_2d_;
+    std::vector<VkImage> vk_swapchain_images_;
     std::vector<VkImageView> vk_swapchain_image_views_;
-    VkImageView vk_depth_image_view_{VK_NULL_HANDLE};
+
+    // NOTE(dhaval): Usage the images are left in after a frame, present for swapchain images, transfer_source for headless targets the application reads back.
+    render_graph_usage backbuffer_usage_{render_graph_usage::present};
 };
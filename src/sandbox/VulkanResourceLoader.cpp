@@ -0,0 +1,420 @@
+#include "VulkanResourceLoader.hpp"
+#include "VulkanUtils.hpp"
+
+#include <array>
+#include <cassert>
+#include <iostream>
+
+// NOTE(dhaval): Staging memory one batch may take. A resource larger than this goes up alone in a batch of its own.
+static const VkDeviceSize upload_batch_budget = 64 * 1024 * 1024;
+
+// NOTE(dhaval): Every resource starts at a multiple of this in the staging buffer, texture copies need at least the texel size.
+static const VkDeviceSize upload_alignment = 16;
+
+static const float placeholder_mesh_half_extent = 0.5f;
+static const uint8_t placeholder_texel[4] = {128, 128, 128, 255};
+
+/**
+ * \brief Creates and uploads the placeholders.
+ * \param jobs Job system the files are decoded on, as background jobs. It must outlive the loader.
+ */
+void vulkan_resource_loader::init(job_system* jobs)
+{
+    jobs_ = jobs;
+
+    create_placeholders();
+
+    VkFenceCreateInfo fence_create_info{};
+    fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    VK_CHECK(vkCreateFence(vk_renderer_context_.vk_device_, &fence_create_info, nullptr, &vk_upload_fence_));
+
+    progress_ = {};
+    stop_ = false;
+}
+
+/**
+ * \brief Waits for the decode jobs, skipping files not started yet, and for the batch in flight, then destroys every resource and the placeholders.
+ *        Nothing may use them afterwards.
+ */
+void vulkan_resource_loader::shutdown()
+{
+    stop_ = true;
+    jobs_->wait(decode_jobs_);
+
+    if (!batch_.entries.empty())
+    {
+        VK_CHECK(vkWaitForFences(vk_renderer_context_.vk_device_, 1, &vk_upload_fence_, VK_TRUE, UINT64_MAX));
+        end_upload_batch();
+    }
+
+    vkDestroyFence(vk_renderer_context_.vk_device_, vk_upload_fence_, nullptr);
+    vk_upload_fence_ = VK_NULL_HANDLE;
+
+    decoded_queue_.clear();
+    pending_decode_count_ = 0;
+    entries_.clear();
+    jobs_ = nullptr;
+
+    placeholder_mesh_.clear_gpu_data();
+    placeholder_mesh_.clear_cpu_data();
+    placeholder_texture_.clear_gpu_data();
+    placeholder_texture_.clear_cpu_data();
+    placeholder_nodes_.clear();
+}
+
+/**
+ * \brief Queues the first mesh of a model file. The node hierarchy of the file comes along, see get_mesh_nodes().
+ * \param path Model file.
+ * \return uint32_t Handle for get_mesh(), valid right away.
+ */
+uint32_t vulkan_resource_loader::load_mesh(const std::string& path)
+{
+    return queue_load(resource_type::mesh, path);
+}
+
+/**
+ * \brief Queues an image file, its mips are generated while decoding.
+ * \param path Image file.
+ * \return uint32_t Handle for get_texture(), valid right away.
+ */
+uint32_t vulkan_resource_loader::load_texture(const std::string& path)
+{
+    return queue_load(resource_type::texture, path);
+}
+
+/**
+ * \brief Call once per frame on the render thread. Finishes the upload batch in flight if its fence signaled and starts the next one with
+ *        whatever the decode jobs finished meanwhile. Never waits for the GPU.
+ * \return uint32_t Number of resources that became ready, their handles resolve to the real resource from now on.
+ */
+uint32_t vulkan_resource_loader::update()
+{
+    uint32_t ready_count = 0;
+
+    if (!batch_.entries.empty())
+    {
+        VkResult fence_status = vkGetFenceStatus(vk_renderer_context_.vk_device_, vk_upload_fence_);
+        if (fence_status == VK_NOT_READY)
+        {
+            return 0;
+        }
+
+        VK_CHECK(fence_status);
+        ready_count = end_upload_batch();
+    }
+
+    begin_upload_batch();
+
+    return ready_count;
+}
+
+/**
+ * \brief Blocks until every queued resource is ready or failed, e.g. for runs that must not depend on how fast files load.
+ */
+void vulkan_resource_loader::wait_until_loaded()
+{
+    while (true)
+    {
+        update();
+
+        if (!batch_.entries.empty())
+        {
+            VK_CHECK(vkWaitForFences(vk_renderer_context_.vk_device_, 1, &vk_upload_fence_, VK_TRUE, UINT64_MAX));
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (decoded_queue_.empty() && pending_decode_count_ == 0)
+        {
+            return;
+        }
+
+        work_finished_.wait(lock, [this]() { return !decoded_queue_.empty() || pending_decode_count_ == 0; });
+    }
+}
+
+/**
+ * \brief
+ * \param mesh Handle returned by load_mesh().
+ * \return const vulkan_mesh& The placeholder cube until the mesh is ready.
+ */
+const vulkan_mesh& vulkan_resource_loader::get_mesh(uint32_t mesh) const
+{
+    assert(mesh < entries_.size() && entries_[mesh]->type == resource_type::mesh && "Invalid mesh handle");
+
+    const resource_entry& entry = *entries_[mesh];
+    return entry.ready ? *entry.mesh : placeholder_mesh_;
+}
+
+/**
+ * \brief Node hierarchy of the model file, world transforms are up to date.
+ * \param mesh Handle returned by load_mesh().
+ * \return const scene_graph& An empty graph until the mesh is ready.
+ */
+const scene_graph& vulkan_resource_loader::get_mesh_nodes(uint32_t mesh) const
+{
+    assert(mesh < entries_.size() && entries_[mesh]->type == resource_type::mesh && "Invalid mesh handle");
+
+    const resource_entry& entry = *entries_[mesh];
+    return entry.ready ? entry.nodes : placeholder_nodes_;
+}
+
+/**
+ * \brief
+ * \param texture Handle returned by load_texture().
+ * \return const vulkan_texture& The grey placeholder until the texture is ready.
+ */
+const vulkan_texture& vulkan_resource_loader::get_texture(uint32_t texture) const
+{
+    assert(texture < entries_.size() && entries_[texture]->type == resource_type::texture && "Invalid texture handle");
+
+    const resource_entry& entry = *entries_[texture];
+    return entry.ready ? *entry.texture : placeholder_texture_;
+}
+
+/**
+ * \brief
+ * \param resource Handle returned by load_mesh() or load_texture().
+ * \return bool False while loading and for resources that failed to load.
+ */
+bool vulkan_resource_loader::is_ready(uint32_t resource) const
+{
+    return resource < entries_.size() && entries_[resource]->ready;
+}
+
+/**
+ * \brief Snapshot of the progress, safe while decode jobs run.
+ * \return resource_load_progress
+ */
+resource_load_progress vulkan_resource_loader::get_progress() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return progress_;
+}
+
+uint32_t vulkan_resource_loader::queue_load(resource_type type, const std::string& path)
+{
+    auto entry = std::make_unique<resource_entry>();
+    entry->type = type;
+    entry->path = path;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_decode_count_++;
+        progress_.resource_count++;
+    }
+
+    // NOTE(dhaval): A background job, a frame waiting for its culling jobs never ends up parsing a model.
+    resource_entry* decoded_entry = entry.get();
+    entries_.push_back(std::move(entry));
+
+    jobs_->run_background([this, decoded_entry]() { decode_main(decoded_entry); }, &decode_jobs_);
+
+    return static_cast<uint32_t>(entries_.size() - 1);
+}
+
+/**
+ * \brief A unit cube and a single grey texel. Both are tiny, they are uploaded on the spot.
+ */
+void vulkan_resource_loader::create_placeholders()
+{
+    const float e = placeholder_mesh_half_extent;
+
+    const std::array<glm::vec3, 8> corners = {glm::vec3(-e, -e, -e), glm::vec3(e, -e, -e), glm::vec3(e, e, -e), glm::vec3(-e, e, -e),
+                                              glm::vec3(-e, -e, e),  glm::vec3(e, -e, e),  glm::vec3(e, e, e),  glm::vec3(-e, e, e)};
+
+    const std::array<uint32_t, 36> indices = {0, 2, 1, 0, 3, 2, 4, 5, 6, 4, 6, 7, 0, 1, 5, 0, 5, 4, 2, 3, 7, 2, 7, 6, 1, 2, 6, 1, 6, 5, 3, 0, 4, 3, 4, 7};
+
+    mesh_data cube;
+    for (const glm::vec3& corner : corners)
+    {
+        cube.vertices.push_back({corner, glm::vec3(1.0f), glm::vec2(corner.x > 0.0f ? 1.0f : 0.0f, corner.y > 0.0f ? 1.0f : 0.0f)});
+    }
+
+    cube.indices.assign(indices.begin(), indices.end());
+    cube.bounds = compute_bounding_volume(cube.vertices.data(), cube.vertices.size(), sizeof(mesh_vertex));
+
+    placeholder_mesh_.set_data(std::move(cube));
+    placeholder_mesh_.upload_to_gpu();
+
+    texture_data texel;
+    texel.load_from_pixels(placeholder_texel, 1, 1);
+
+    placeholder_texture_.set_data(std::move(texel));
+    placeholder_texture_.upload_to_gpu();
+}
+
+/**
+ * \brief Takes decoded resources off the queue up to the batch budget, copies them into one staging buffer and submits their uploads in one
+ *        command buffer signaling the upload fence.
+ */
+void vulkan_resource_loader::begin_upload_batch()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        while (!decoded_queue_.empty())
+        {
+            resource_entry* entry = decoded_queue_.front();
+
+            VkDeviceSize aligned_size = (entry->upload_size + upload_alignment - 1) & ~(upload_alignment - 1);
+            if (!batch_.entries.empty() && batch_.size + aligned_size > upload_batch_budget)
+            {
+                break;
+            }
+
+            batch_.entries.push_back(entry);
+            batch_.size += aligned_size;
+            decoded_queue_.pop_front();
+        }
+    }
+
+    if (batch_.entries.empty())
+    {
+        return;
+    }
+
+    vulkan_utils::create_buffer(vk_renderer_context_, batch_.size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                batch_.vk_staging_buffer, batch_.vk_staging_buffer_memory);
+
+    void* staging_data = nullptr;
+    VK_CHECK(vkMapMemory(vk_renderer_context_.vk_device_, batch_.vk_staging_buffer_memory, 0, batch_.size, 0, &staging_data));
+
+    VkCommandBufferAllocateInfo command_buffer_allocate_info{};
+    command_buffer_allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    command_buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    command_buffer_allocate_info.commandPool = vk_renderer_context_.vk_command_pool_;
+    command_buffer_allocate_info.commandBufferCount = 1;
+
+    VK_CHECK(vkAllocateCommandBuffers(vk_renderer_context_.vk_device_, &command_buffer_allocate_info, &batch_.vk_command_buffer));
+
+    VkCommandBufferBeginInfo command_buffer_begin_info{};
+    command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    VK_CHECK(vkBeginCommandBuffer(batch_.vk_command_buffer, &command_buffer_begin_info));
+
+    VkDeviceSize staging_offset = 0;
+    for (resource_entry* entry : batch_.entries)
+    {
+        if (entry->type == resource_type::mesh)
+        {
+            entry->mesh = std::make_unique<vulkan_mesh>(vk_renderer_context_);
+            entry->mesh->set_data(std::move(entry->decoded_mesh));
+            entry->mesh->record_upload(batch_.vk_command_buffer, batch_.vk_staging_buffer, staging_offset, staging_data);
+        }
+        else
+        {
+            entry->texture = std::make_unique<vulkan_texture>(vk_renderer_context_);
+            entry->texture->set_data(std::move(entry->decoded_texture));
+            entry->texture->record_upload(batch_.vk_command_buffer, batch_.vk_staging_buffer, staging_offset, staging_data);
+        }
+
+        staging_offset += (entry->upload_size + upload_alignment - 1) & ~(upload_alignment - 1);
+    }
+
+    vkUnmapMemory(vk_renderer_context_.vk_device_, batch_.vk_staging_buffer_memory);
+
+    VK_CHECK(vkEndCommandBuffer(batch_.vk_command_buffer));
+
+    VkSubmitInfo submit_info{};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &batch_.vk_command_buffer;
+
+    VK_CHECK(vkResetFences(vk_renderer_context_.vk_device_, 1, &vk_upload_fence_));
+    VK_CHECK(vkQueueSubmit(vk_renderer_context_.graphics_queue, 1, &submit_info, vk_upload_fence_));
+}
+
+/**
+ * \brief Releases the staging memory of a batch whose fence signaled and marks its resources ready.
+ * \return uint32_t Number of resources in the batch.
+ */
+uint32_t vulkan_resource_loader::end_upload_batch()
+{
+    vkFreeCommandBuffers(vk_renderer_context_.vk_device_, vk_renderer_context_.vk_command_pool_, 1, &batch_.vk_command_buffer);
+
+    vkDestroyBuffer(vk_renderer_context_.vk_device_, batch_.vk_staging_buffer, nullptr);
+    vkFreeMemory(vk_renderer_context_.vk_device_, batch_.vk_staging_buffer_memory, nullptr);
+
+    for (resource_entry* entry : batch_.entries)
+    {
+        entry->ready = true;
+    }
+
+    uint32_t ready_count = static_cast<uint32_t>(batch_.entries.size());
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        progress_.ready_count += ready_count;
+        progress_.upload_batch_count++;
+        progress_.uploaded_bytes += batch_.size;
+    }
+
+    batch_ = {};
+
+    return ready_count;
+}
+
+/**
+ * \brief Decode job of one entry. Queues the result for upload, a file that fails keeps its placeholder.
+ * \param entry Entry to decode.
+ */
+void vulkan_resource_loader::decode_main(resource_entry* entry)
+{
+    bool decoded = !stop_ && decode(*entry);
+
+    if (!decoded && !stop_)
+    {
+        std::cerr << "vulkan_resource_loader: can't load " << entry->path << ", keeping the placeholder" << std::endl;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (decoded)
+        {
+            decoded_queue_.push_back(entry);
+        }
+        else
+        {
+            progress_.failed_count++;
+        }
+
+        pending_decode_count_--;
+    }
+
+    work_finished_.notify_all();
+}
+
+/**
+ * \brief Reads a file into the cpu side of its entry, everything that doesn't need the device.
+ * \param entry Entry popped from the load queue.
+ * \return bool False if the file can't be read or parsed.
+ */
+bool vulkan_resource_loader::decode(resource_entry& entry)
+{
+    if (entry.type == resource_type::mesh)
+    {
+        if (!entry.decoded_mesh.load_from_file(entry.path, &entry.nodes) || entry.decoded_mesh.indices.empty())
+        {
+            return false;
+        }
+
+        entry.nodes.update_world_transforms();
+        entry.upload_size = sizeof(mesh_vertex) * entry.decoded_mesh.vertices.size() + sizeof(uint32_t) * entry.decoded_mesh.indices.size();
+    }
+    else
+    {
+        if (!entry.decoded_texture.load_from_file(entry.path))
+        {
+            return false;
+        }
+
+        // NOTE(dhaval): Mips are filtered here too, the render thread only copies the finished chain.
+        entry.decoded_texture.generate_mips();
+        entry.upload_size = entry.decoded_texture.get_size();
+    }
+
+    return true;
+}
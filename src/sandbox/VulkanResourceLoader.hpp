@@ -0,0 +1,134 @@
+#pragma once
+
+#include <volk.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "JobSystem.hpp"
+#include "MeshData.hpp"
+#include "SceneGraph.hpp"
+#include "TextureData.hpp"
+#include "VulkanMesh.hpp"
+#include "VulkanRendererContext.hpp"
+#include "VulkanTexture.hpp"
+
+static const uint32_t invalid_resource = UINT32_MAX;
+
+/**
+ * \brief Progress of the loads queued so far. Resources that failed to load keep their placeholder.
+ */
+struct resource_load_progress
+{
+    uint32_t resource_count{0};
+    uint32_t ready_count{0};
+    uint32_t failed_count{0};
+
+    uint32_t upload_batch_count{0};
+    uint64_t uploaded_bytes{0};
+
+    inline bool is_done() const { return ready_count + failed_count == resource_count; }
+    inline float get_fraction() const { return resource_count == 0 ? 1.0f : static_cast<float>(ready_count + failed_count) / resource_count; }
+};
+
+/**
+ * \brief Loads meshes and textures without blocking the render thread. load_mesh() and load_texture() return a handle right away, background
+ *        jobs parse and decode the files and update() copies whatever is decoded to the GPU in one batched submission per frame. Until a resource is
+ *        uploaded its handle resolves to a placeholder, a cube for meshes and a grey texel for textures.
+ */
+class vulkan_resource_loader
+{
+public:
+    vulkan_resource_loader(const vulkan_renderer_context& renderer_context) : vk_renderer_context_(renderer_context), placeholder_mesh_(renderer_context), placeholder_texture_(renderer_context)
+    {
+    }
+
+    void init(job_system* jobs);
+    void shutdown();
+
+    uint32_t load_mesh(const std::string& path);
+    uint32_t load_texture(const std::string& path);
+
+    uint32_t update();
+    void wait_until_loaded();
+
+    const vulkan_mesh& get_mesh(uint32_t mesh) const;
+    const scene_graph& get_mesh_nodes(uint32_t mesh) const;
+    const vulkan_texture& get_texture(uint32_t texture) const;
+    bool is_ready(uint32_t resource) const;
+
+    resource_load_progress get_progress() const;
+
+private:
+    enum class resource_type : uint32_t
+    {
+        mesh,
+        texture,
+    };
+
+    struct resource_entry
+    {
+        resource_type type{resource_type::mesh};
+        std::string path;
+
+        // NOTE(dhaval): Written by a decode job before the entry is queued for upload, handed over to the GPU resource by update().
+        mesh_data decoded_mesh;
+        texture_data decoded_texture;
+        scene_graph nodes;
+        VkDeviceSize upload_size{0};
+
+        // NOTE(dhaval): Only the render thread touches these.
+        std::unique_ptr<vulkan_mesh> mesh;
+        std::unique_ptr<vulkan_texture> texture;
+        bool ready{false};
+    };
+
+    struct upload_batch
+    {
+        std::vector<resource_entry*> entries;
+
+        VkBuffer vk_staging_buffer{VK_NULL_HANDLE};
+        VkDeviceMemory vk_staging_buffer_memory{VK_NULL_HANDLE};
+        VkCommandBuffer vk_command_buffer{VK_NULL_HANDLE};
+        VkDeviceSize size{0};
+    };
+
+    uint32_t queue_load(resource_type type, const std::string& path);
+
+    void create_placeholders();
+    void begin_upload_batch();
+    uint32_t end_upload_batch();
+
+    void decode_main(resource_entry* entry);
+    static bool decode(resource_entry& entry);
+
+private:
+    vulkan_renderer_context vk_renderer_context_;
+
+    vulkan_mesh placeholder_mesh_;
+    vulkan_texture placeholder_texture_;
+    scene_graph placeholder_nodes_;
+
+    // NOTE(dhaval): Entries are created and read on the render thread. mutex_ guards the decoded queue and the progress, a decode job only
+    // sees the entry it was started for.
+    std::vector<std::unique_ptr<resource_entry>> entries_;
+
+    job_system* jobs_{nullptr};
+    job_counter decode_jobs_;
+    std::atomic<bool> stop_{false};
+
+    mutable std::mutex mutex_;
+    std::deque<resource_entry*> decoded_queue_;
+    uint32_t pending_decode_count_{0};
+    resource_load_progress progress_;
+    std::condition_variable work_finished_;
+
+    // NOTE(dhaval): At most one batch is in flight, the next one starts once its fence signaled.
+    upload_batch batch_;
+    VkFence vk_upload_fence_{VK_NULL_HANDLE};
+};
@@ -0,0 +1,319 @@
+#include "VulkanShaderLibrary.hpp"
+#include "VulkanUtils.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+// NOTE(dhaval): How often the watcher checks the write times, a saved shader shows up at most this late.
+static const std::chrono::milliseconds shader_watch_interval(250);
+
+/**
+ * \brief Creates the compiler and, with hot reload, starts the thread watching the shader sources.
+ * \param cache_directory Directory the compiled SPIR-V is cached in.
+ * \param hot_reload Recompile shaders whose sources change while the application runs.
+ */
+void vulkan_shader_library::init(const std::string& cache_directory, bool hot_reload)
+{
+    compiler_.init(cache_directory);
+    reload_count_ = 0;
+
+    if (hot_reload)
+    {
+        stop_watcher_ = false;
+        watcher_ = std::thread(&vulkan_shader_library::watcher_main, this);
+
+        std::cout << "vulkan_shader_library: hot reload on, watching shader sources" << (shader_compiler::is_available() ? "" : " (precompiled SPIR-V)") << std::endl;
+    }
+}
+
+/**
+ * \brief Stops the watcher and destroys every module. Pipelines created from them must be destroyed or no longer used.
+ */
+void vulkan_shader_library::shutdown()
+{
+    if (watcher_.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_watcher_ = true;
+        }
+
+        stop_watcher_condition_.notify_all();
+        watcher_.join();
+    }
+
+    for (auto& shader : shaders_)
+    {
+        vkDestroyShaderModule(vk_renderer_context_.vk_device_, shader->vk_module, nullptr);
+    }
+
+    for (VkShaderModule vk_module : retired_modules_)
+    {
+        vkDestroyShaderModule(vk_renderer_context_.vk_device_, vk_module, nullptr);
+    }
+
+    shaders_.clear();
+    compiled_shaders_.clear();
+    retired_modules_.clear();
+
+    compiler_.shutdown();
+}
+
+/**
+ * \brief Compiles a shader, or reads it from the cache, and creates its module.
+ * \param path GLSL source file.
+ * \param stage Stage the shader is compiled for.
+ * \param defines Preprocessor macros, "NAME" or "NAME=VALUE".
+ * \return uint32_t Handle for get_module(), the shader stays loaded until shutdown. invalid_shader if neither the source nor its precompiled SPIR-V loads.
+ */
+uint32_t vulkan_shader_library::load(const std::string& path, shader_stage stage, const std::vector<std::string>& defines)
+{
+    auto shader = std::make_unique<shader_entry>();
+    shader->path = path;
+    shader->stage = stage;
+    shader->defines = defines;
+
+    std::vector<uint32_t> spirv;
+    bool compiled = false;
+    {
+        std::lock_guard<std::mutex> lock(compiler_mutex_);
+        compiled = compiler_.compile(path, stage, defines, spirv, shader->dependencies);
+    }
+
+    // NOTE(dhaval): Start on the SPIR-V the build compiled rather than without the shader, the watcher keeps retrying the source on every change.
+    if (!compiled && shader_compiler::is_available() && defines.empty() && shader_compiler::load_precompiled(path, spirv))
+    {
+        std::cout << "vulkan_shader_library: " << path << " doesn't compile, using its precompiled SPIR-V" << std::endl;
+        compiled = true;
+
+        if (shader->dependencies.empty())
+        {
+            shader->dependencies.push_back(path);
+        }
+    }
+
+    if (!compiled)
+    {
+        std::cerr << "vulkan_shader_library: can't load " << path << std::endl;
+        return invalid_shader;
+    }
+
+    shader->dependency_write_times = get_write_times(shader->dependencies);
+    shader->vk_module = create_module(spirv);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    shaders_.push_back(std::move(shader));
+
+    return static_cast<uint32_t>(shaders_.size() - 1);
+}
+
+/**
+ * \brief Current module of a shader. It changes when apply_reloads() swaps in a recompiled one.
+ * \param shader Handle returned by load().
+ * \return VkShaderModule VK_NULL_HANDLE for invalid_shader.
+ */
+VkShaderModule vulkan_shader_library::get_module(uint32_t shader) const
+{
+    if (shader == invalid_shader)
+    {
+        return VK_NULL_HANDLE;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    return shaders_[shader]->vk_module;
+}
+
+/**
+ * \brief Swaps in the modules the watcher recompiled since the last call. Call between frames, pipelines created after it use the new modules.
+ * \return uint32_t Number of shaders that changed.
+ */
+uint32_t vulkan_shader_library::apply_reloads()
+{
+    std::vector<compiled_shader> compiled_shaders;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (compiled_shaders_.empty())
+        {
+            return 0;
+        }
+
+        compiled_shaders.swap(compiled_shaders_);
+    }
+
+    for (const compiled_shader& compiled : compiled_shaders)
+    {
+        VkShaderModule vk_module = create_module(compiled.spirv);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        shader_entry& shader = *shaders_[compiled.shader];
+
+        retired_modules_.push_back(shader.vk_module);
+        shader.vk_module = vk_module;
+
+        std::cout << "vulkan_shader_library: reloaded " << shader.path << std::endl;
+    }
+
+    reload_count_ += static_cast<uint32_t>(compiled_shaders.size());
+
+    return static_cast<uint32_t>(compiled_shaders.size());
+}
+
+/**
+ * \brief Snapshot of the counters, safe while the watcher compiles.
+ * \return shader_library_statistics
+ */
+shader_library_statistics vulkan_shader_library::get_statistics() const
+{
+    shader_library_statistics statistics{};
+    {
+        std::lock_guard<std::mutex> lock(compiler_mutex_);
+        statistics.compiler = compiler_.get_statistics();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    statistics.shader_count = static_cast<uint32_t>(shaders_.size());
+    statistics.reload_count = reload_count_;
+
+    return statistics;
+}
+
+VkShaderModule vulkan_shader_library::create_module(const std::vector<uint32_t>& spirv) const
+{
+    VkShaderModuleCreateInfo shader_module_create_info{};
+    shader_module_create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    shader_module_create_info.codeSize = spirv.size() * sizeof(uint32_t);
+    shader_module_create_info.pCode = spirv.data();
+
+    VkShaderModule shader_module;
+    VK_CHECK(vkCreateShaderModule(vk_renderer_context_.vk_device_, &shader_module_create_info, nullptr, &shader_module));
+
+    return shader_module;
+}
+
+/**
+ * \brief Watcher thread. Polls the write times of every dependency, recompiles shaders with a changed one and queues the SPIR-V for apply_reloads().
+ *        A shader that fails to compile keeps its current module and is retried on its next change.
+ */
+void vulkan_shader_library::watcher_main()
+{
+    struct watched_shader
+    {
+        uint32_t shader;
+        std::string path;
+        shader_stage stage;
+        std::vector<std::string> defines;
+        std::vector<std::string> dependencies;
+        std::vector<std::filesystem::file_time_type> dependency_write_times;
+    };
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (!stop_watcher_condition_.wait_for(lock, shader_watch_interval, [this]() { return stop_watcher_; }))
+    {
+        std::vector<watched_shader> watched_shaders;
+        watched_shaders.reserve(shaders_.size());
+
+        for (uint32_t i = 0; i < shaders_.size(); i++)
+        {
+            const shader_entry& shader = *shaders_[i];
+            watched_shaders.push_back({i, shader.path, shader.stage, shader.defines, shader.dependencies, shader.dependency_write_times});
+        }
+
+        // NOTE(dhaval): Stat and compile without mutex_, get_module() takes it on the render thread. Compiling takes long, the render thread keeps
+        //               drawing with the current modules meanwhile.
+        lock.unlock();
+
+        std::vector<watched_shader> changed_shaders;
+
+        for (watched_shader& watched : watched_shaders)
+        {
+            std::vector<std::filesystem::file_time_type> write_times = get_write_times(watched.dependencies);
+            if (write_times != watched.dependency_write_times)
+            {
+                watched.dependency_write_times = write_times;
+                changed_shaders.push_back(std::move(watched));
+            }
+        }
+
+        std::vector<compiled_shader> compiled_shaders;
+        std::vector<std::vector<std::string>> dependencies(changed_shaders.size());
+
+        for (size_t i = 0; i < changed_shaders.size(); i++)
+        {
+            const watched_shader& changed = changed_shaders[i];
+
+            std::vector<uint32_t> spirv;
+            bool compiled = false;
+
+            double compile_ms = 0.0;
+            {
+                std::lock_guard<std::mutex> compiler_lock(compiler_mutex_);
+
+                double previous_compile_ms = compiler_.get_statistics().total_compile_ms;
+                compiled = compiler_.compile(changed.path, changed.stage, changed.defines, spirv, dependencies[i]);
+                compile_ms = compiler_.get_statistics().total_compile_ms - previous_compile_ms;
+            }
+
+            if (compiled)
+            {
+                std::cout << "vulkan_shader_library: " << changed.path << " changed, compiled in " << compile_ms << " ms" << std::endl;
+                compiled_shaders.push_back({changed.shader, std::move(spirv)});
+            }
+        }
+
+        lock.lock();
+
+        // NOTE(dhaval): Keep the write times read before compiling, a file saved during the compile then shows up on the next check. An edit can add
+        //               or remove includes, watch what the shader depends on now. A new include was never checked, its default time makes the next
+        //               check compile once more and record it.
+        for (size_t i = 0; i < changed_shaders.size(); i++)
+        {
+            const watched_shader& changed = changed_shaders[i];
+            shader_entry& shader = *shaders_[changed.shader];
+
+            if (dependencies[i].empty())
+            {
+                shader.dependency_write_times = changed.dependency_write_times;
+                continue;
+            }
+
+            shader.dependencies = dependencies[i];
+            shader.dependency_write_times.clear();
+
+            for (const std::string& dependency : shader.dependencies)
+            {
+                auto watched_dependency = std::find(changed.dependencies.begin(), changed.dependencies.end(), dependency);
+                bool was_watched = watched_dependency != changed.dependencies.end();
+
+                shader.dependency_write_times.push_back(was_watched ? changed.dependency_write_times[watched_dependency - changed.dependencies.begin()] : std::filesystem::file_time_type());
+            }
+        }
+
+        for (compiled_shader& compiled : compiled_shaders)
+        {
+            compiled_shaders_.push_back(std::move(compiled));
+        }
+    }
+}
+
+/**
+ * \brief Last write time of every file, a default time for files that are gone.
+ * \param paths Files to check.
+ * \return std::vector<std::filesystem::file_time_type>
+ */
+std::vector<std::filesystem::file_time_type> vulkan_shader_library::get_write_times(const std::vector<std::string>& paths)
+{
+    std::vector<std::filesystem::file_time_type> write_times;
+    write_times.reserve(paths.size());
+
+    for (const std::string& path : paths)
+    {
+        std::error_code error_code;
+        std::filesystem::file_time_type write_time = std::filesystem::last_write_time(path, error_code);
+
+        write_times.push_back(error_code ? std::filesystem::file_time_type() : write_time);
+    }
+
+    return write_times;
+}
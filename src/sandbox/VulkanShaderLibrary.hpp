@@ -0,0 +1,94 @@
+#pragma once
+
+#include <volk.h>
+
+#include <condition_variable>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ShaderCompiler.hpp"
+#include "VulkanRendererContext.hpp"
+
+static const uint32_t invalid_shader = UINT32_MAX;
+
+/**
+ * \brief Counters of the shader library, the compiler's plus how often shaders were swapped at runtime.
+ */
+struct shader_library_statistics
+{
+    shader_compiler_statistics compiler;
+    uint32_t shader_count{0};
+    uint32_t reload_count{0};
+};
+
+/**
+ * \brief Owns the shader modules of the application. Shaders are compiled from GLSL through shader_compiler and its SPIR-V cache.
+ *        With hot reload a background thread watches every file a shader depends on, recompiles it when one changes and queues the result,
+ *        apply_reloads() then swaps the modules between two frames.
+ */
+class vulkan_shader_library
+{
+public:
+    vulkan_shader_library(const vulkan_renderer_context& renderer_context) : vk_renderer_context_(renderer_context)
+    {
+    }
+
+    void init(const std::string& cache_directory, bool hot_reload);
+    void shutdown();
+
+    uint32_t load(const std::string& path, shader_stage stage, const std::vector<std::string>& defines = {});
+    VkShaderModule get_module(uint32_t shader) const;
+
+    uint32_t apply_reloads();
+
+    shader_library_statistics get_statistics() const;
+
+private:
+    struct shader_entry
+    {
+        std::string path;
+        shader_stage stage{shader_stage::vertex};
+        std::vector<std::string> defines;
+
+        // NOTE(dhaval): Files the current module was compiled from and their write times at that point, only the watcher changes them after load().
+        std::vector<std::string> dependencies;
+        std::vector<std::filesystem::file_time_type> dependency_write_times;
+
+        VkShaderModule vk_module{VK_NULL_HANDLE};
+    };
+
+    struct compiled_shader
+    {
+        uint32_t shader{invalid_shader};
+        std::vector<uint32_t> spirv;
+    };
+
+    VkShaderModule create_module(const std::vector<uint32_t>& spirv) const;
+    void watcher_main();
+
+    static std::vector<std::filesystem::file_time_type> get_write_times(const std::vector<std::string>& paths);
+
+private:
+    vulkan_renderer_context vk_renderer_context_;
+
+    // NOTE(dhaval): compiler_mutex_ serializes compiles of load() and the watcher, mutex_ guards the entries and the queue of compiled shaders.
+    shader_compiler compiler_;
+    mutable std::mutex compiler_mutex_;
+    mutable std::mutex mutex_;
+
+    std::vector<std::unique_ptr<shader_entry>> shaders_;
+    std::vector<compiled_shader> compiled_shaders_;
+
+    // NOTE(dhaval): Modules replaced by a reload. Pipelines are cached by module handle, destroying one would let the driver hand the same handle
+    // to a new module and the cache return a stale pipeline, so they live until shutdown.
+    std::vector<VkShaderModule> retired_modules_;
+    uint32_t reload_count_{0};
+
+    std::thread watcher_;
+    std::condition_variable stop_watcher_condition_;
+    bool stop_watcher_{false};
+};
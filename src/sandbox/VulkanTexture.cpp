@@ -1,11 +1,8 @@
 #include "VulkanTexture.hpp"
 #include "VulkanUtils.hpp"
 
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
-
-#include <algorithm>
-#include <iostream>
+#include <cstring>
+#include <vector>
 
 vulkan_texture::~vulkan_texture()
 {
@@ -15,28 +12,13 @@ vulkan_texture::~vulkan_texture()
 
 bool vulkan_texture::load_from_file(const std::string& path)
 {
-    // TODO(dhaval): Support other image formats
-    stbi_uc* stb_pixels = stbi_load(path.c_str(), &width_, &height_, &channels_, STBI_rgb_alpha);
-
-    if (!stb_pixels)
+    if (!data_.load_from_file(path))
     {
-        std::cerr << "vulkan_texture::load_from_file(): " << stbi_failure_reason() << std::endl;
         return false;
     }
 
-    mip_levels_ = static_cast<int>(std::floor(std::log2(std::max(width_, height_))) + 1);
-
-    size_t image_size = width_ * height_ * 4;
-    if (pixels_ != nullptr)
-    {
-        delete[] pixels_;
-    }
-
-    pixels_ = new unsigned char[image_size];
-    memcpy(pixels_, stb_pixels, image_size);
-
-    stbi_image_free(stb_pixels);
-    stb_pixels = nullptr;
+    // NOTE(dhaval): Mips are filtered on the CPU, the whole chain goes up in one staging copy instead of a blit per level.
+    data_.generate_mips();
 
     // NOTE(dhaval): Upload CPU data to GPU
     clear_gpu_data();
@@ -47,13 +29,82 @@ bool vulkan_texture::load_from_file(const std::string& path)
     return true;
 }
 
-void vulkan_texture::upload_to_gpu()
+/**
+ * \brief Takes over texture data that was decoded elsewhere, e.g. on a loader thread. Call upload_to_gpu() or record_upload() next.
+ * \param data Decoded texture, with its mips if it should have any.
+ */
+void vulkan_texture::set_data(texture_data&& data)
+{
+    clear_gpu_data();
+    data_ = std::move(data);
+}
+
+/**
+ * \brief Staging memory record_upload() needs, the whole mip chain.
+ * \return VkDeviceSize
+ */
+VkDeviceSize vulkan_texture::get_upload_size() const
+{
+    // NOTE(dhaval): Pixel data will have alpha channel even if the original image doesn't
+    return data_.get_size();
+}
+
+/**
+ * \brief Creates the image, records the copy of every mip from a staging buffer and the transition for shader reads. The image may be sampled
+ *        once the command buffer completed.
+ * \param command_buffer Command buffer in the recording state.
+ * \param staging_buffer Host visible buffer the copies read from.
+ * \param staging_offset Offset of get_upload_size() bytes reserved for this texture, a multiple of 4.
+ * \param staging_data Mapped pointer to the start of the staging buffer.
+ */
+void vulkan_texture::record_upload(VkCommandBuffer command_buffer, VkBuffer staging_buffer, VkDeviceSize staging_offset, void* staging_data)
 {
     // TODO(dhaval): Support other image formats
     vk_format_ = VK_FORMAT_R8G8B8A8_UNORM;
 
-    // NOTE(dhaval): Pixel data will have alpha channel even if the original image doesn't
-    VkDeviceSize image_size = width_ * height_ * 4;
+    uint32_t mip_levels = data_.get_mip_count();
+
+    // NOTE(dhaval): Fill staging buffer
+    memcpy(static_cast<uint8_t*>(staging_data) + staging_offset, data_.get_pixels(), static_cast<size_t>(get_upload_size()));
+
+    vulkan_utils::create_image_2d(vk_renderer_context_, data_.get_width(), data_.get_height(), mip_levels, vk_format_, VK_IMAGE_TILING_OPTIMAL,
+                                  VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vk_image_, vk_image_memory_);
+
+    // NOTE(dhaval): Prepare the image for transfer
+    vulkan_utils::record_image_layout_transition(command_buffer, vk_image_, mip_levels, vk_format_, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+    // NOTE(dhaval): Copy every mip to the image memory on the gpu
+    std::vector<VkBufferImageCopy> regions(mip_levels);
+    for (uint32_t level = 0; level < mip_levels; level++)
+    {
+        const texture_mip& mip = data_.get_mip(level);
+
+        VkBufferImageCopy& region = regions[level];
+        region = {};
+        region.bufferOffset = staging_offset + mip.offset;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = level;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = {mip.width, mip.height, 1};
+    }
+
+    vkCmdCopyBufferToImage(command_buffer, staging_buffer, vk_image_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+
+    // NOTE(dhaval): Prepare the image for shader access
+    vulkan_utils::record_image_layout_transition(command_buffer, vk_image_, mip_levels, vk_format_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    // NOTE(dhaval): create image view & sampler
+    vk_image_view_ = vulkan_utils::create_image_2d_view(vk_renderer_context_, vk_image_, mip_levels, vk_format_, VK_IMAGE_ASPECT_COLOR_BIT);
+    vk_image_sampler_ = vulkan_utils::create_sampler(vk_renderer_context_, mip_levels);
+}
+
+/**
+ * \brief Uploads the cpu data through its own staging buffer and waits for the copy.
+ */
+void vulkan_texture::upload_to_gpu()
+{
+    VkDeviceSize image_size = get_upload_size();
 
     VkBuffer staging_buffer = VK_NULL_HANDLE;
     VkDeviceMemory staging_buffer_memory = VK_NULL_HANDLE;
@@ -61,35 +112,18 @@ void vulkan_texture::upload_to_gpu()
     vulkan_utils::create_buffer(vk_renderer_context_, image_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging_buffer,
                                 staging_buffer_memory);
 
-    // NOTE(dhaval): Fill staging buffer
     void* data = nullptr;
     vkMapMemory(vk_renderer_context_.vk_device_, staging_buffer_memory, 0, image_size, 0, &data);
-    memcpy(data, pixels_, static_cast<size_t>(image_size));
-    vkUnmapMemory(vk_renderer_context_.vk_device_, staging_buffer_memory);
-
-    vulkan_utils::create_image_2d(vk_renderer_context_, width_, height_, mip_levels_, vk_format_, VK_IMAGE_TILING_OPTIMAL,
-                                  VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vk_image_, vk_image_memory_);
-
-    // NOTE(dhaval): Prepare the image for transfer
-    vulkan_utils::transition_image_layout(vk_renderer_context_, vk_image_, mip_levels_, vk_format_, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-
-    // NOTE(dhaval): Copy to the image memory on the gpu
-    vulkan_utils::copy_buffer_to_image(vk_renderer_context_, staging_buffer, vk_image_, width_, height_);
 
-    // NOTE(dhaval): Generate Mipmaps on GPU with linear filtering
-    vulkan_utils::generate_image_2d_mipmaps(vk_renderer_context_, vk_image_, width_, height_, mip_levels_, vk_format_, VK_FILTER_LINEAR);
+    VkCommandBuffer command_buffer = vulkan_utils::begin_single_time_commands(vk_renderer_context_);
+    record_upload(command_buffer, staging_buffer, 0, data);
+    vulkan_utils::end_single_time_commands(vk_renderer_context_, command_buffer);
 
-    // NOTE(dhaval): Prepare the image for shader access
-    vulkan_utils::transition_image_layout(vk_renderer_context_, vk_image_, mip_levels_, vk_format_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    vkUnmapMemory(vk_renderer_context_.vk_device_, staging_buffer_memory);
 
     // NOTE(dhaval): destroy staging buffer
     vkDestroyBuffer(vk_renderer_context_.vk_device_, staging_buffer, nullptr);
     vkFreeMemory(vk_renderer_context_.vk_device_, staging_buffer_memory, nullptr);
-
-    // NOTE(dhaval): create image view & sampler
-    vk_image_view_ = vulkan_utils::create_image_2d_view(vk_renderer_context_, vk_image_, mip_levels_, vk_format_, VK_IMAGE_ASPECT_COLOR_BIT);
-    vk_image_sampler_ = vulkan_utils::create_sampler(vk_renderer_context_, mip_levels_);
 }
 
 void vulkan_texture::clear_gpu_data()
@@ -109,10 +143,5 @@ void vulkan_texture::clear_gpu_data()
 
 void vulkan_texture::clear_cpu_data()
 {
-    delete[] pixels_;
-    pixels_ = nullptr;
-
-    width_ = 0;
-    height_ = 0;
-    channels_ = 0;
+    data_.clear();
 }
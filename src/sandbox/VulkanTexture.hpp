@@ -4,6 +4,7 @@
 
 #include <string>
 
+#include "TextureData.hpp"
 #include "VulkanRendererContext.hpp"
 
 class vulkan_texture
@@ -20,6 +21,10 @@ public:
     inline VkSampler get_sampler() const { return vk_image_sampler_; }
 
     bool load_from_file(const std::string& path);
+    void set_data(texture_data&& data);
+
+    VkDeviceSize get_upload_size() const;
+    void record_upload(VkCommandBuffer command_buffer, VkBuffer staging_buffer, VkDeviceSize staging_offset, void* staging_data);
 
     void upload_to_gpu();
     void clear_gpu_data();
@@ -27,12 +32,7 @@ public:
 private:
     vulkan_renderer_context vk_renderer_context_;
 
-    unsigned char* pixels_{nullptr};
-
-    int width_{0};
-    int height_{0};
-    int channels_{0};
-    int mip_levels_{0};
+    texture_data data_;
 
     VkFormat vk_format_{VK_FORMAT_R8G8B8A8_UNORM};
 
@@ -0,0 +1,239 @@
+#include "VulkanTextureTable.hpp"
+#include "VulkanTexture.hpp"
+#include "VulkanUtils.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+
+/**
+ * \brief Largest texture array a single stage can index on this device, limited by the update after bind limits of descriptor indexing.
+ * \param renderer_context Context of the device, must have descriptor indexing enabled.
+ * \return uint32_t
+ */
+uint32_t vulkan_texture_table::get_max_texture_count(const vulkan_renderer_context& renderer_context)
+{
+    VkPhysicalDeviceDescriptorIndexingPropertiesEXT descriptor_indexing_properties{};
+    descriptor_indexing_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+
+    VkPhysicalDeviceProperties2 physical_device_properties{};
+    physical_device_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    physical_device_properties.pNext = &descriptor_indexing_properties;
+
+    vkGetPhysicalDeviceProperties2(renderer_context.vk_physical_device_, &physical_device_properties);
+
+    // NOTE(dhaval): Combined image samplers count against both the sampled image and the sampler limits.
+    return std::min({descriptor_indexing_properties.maxPerStageDescriptorUpdateAfterBindSampledImages, descriptor_indexing_properties.maxPerStageDescriptorUpdateAfterBindSamplers,
+                     descriptor_indexing_properties.maxDescriptorSetUpdateAfterBindSampledImages, descriptor_indexing_properties.maxDescriptorSetUpdateAfterBindSamplers});
+}
+
+/**
+ * \brief Creates the descriptor set layout, the descriptor set and the material buffer. Every texture slot starts unbound.
+ * \param max_texture_count Size of the texture array, clamped to get_max_texture_count().
+ * \param max_material_count Number of materials the material buffer holds.
+ */
+void vulkan_texture_table::init(uint32_t max_texture_count, uint32_t max_material_count)
+{
+    assert(vk_renderer_context_.descriptor_indexing_supported && "Bindless textures need VK_EXT_descriptor_indexing");
+
+    texture_capacity_ = std::max(std::min(max_texture_count, get_max_texture_count(vk_renderer_context_)), 1u);
+    material_capacity_ = std::max(max_material_count, 1u);
+
+    free_texture_slots_.clear();
+    texture_high_water_ = 0;
+    statistics_ = {};
+
+    // NOTE(dhaval): Binding 0 is the texture array. Unused slots may stay unwritten (partially bound) and slots not used by a pending frame
+    //               can be rewritten while the set is bound (update after bind, unused while pending), so loading never waits for the GPU.
+    std::array<VkDescriptorSetLayoutBinding, 2> descriptor_set_layout_bindings{};
+
+    descriptor_set_layout_bindings[0].binding = 0;
+    descriptor_set_layout_bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptor_set_layout_bindings[0].descriptorCount = texture_capacity_;
+    descriptor_set_layout_bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    descriptor_set_layout_bindings[0].pImmutableSamplers = nullptr;
+
+    descriptor_set_layout_bindings[1].binding = 1;
+    descriptor_set_layout_bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptor_set_layout_bindings[1].descriptorCount = 1;
+    descriptor_set_layout_bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    descriptor_set_layout_bindings[1].pImmutableSamplers = nullptr;
+
+    std::array<VkDescriptorBindingFlagsEXT, 2> descriptor_binding_flags = {
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT,
+        0,
+    };
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfoEXT descriptor_set_layout_binding_flags_create_info{};
+    descriptor_set_layout_binding_flags_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+    descriptor_set_layout_binding_flags_create_info.bindingCount = static_cast<uint32_t>(descriptor_binding_flags.size());
+    descriptor_set_layout_binding_flags_create_info.pBindingFlags = descriptor_binding_flags.data();
+
+    VkDescriptorSetLayoutCreateInfo descriptor_set_layout_create_info{};
+    descriptor_set_layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    descriptor_set_layout_create_info.pNext = &descriptor_set_layout_binding_flags_create_info;
+    descriptor_set_layout_create_info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+    descriptor_set_layout_create_info.bindingCount = static_cast<uint32_t>(descriptor_set_layout_bindings.size());
+    descriptor_set_layout_create_info.pBindings = descriptor_set_layout_bindings.data();
+
+    VK_CHECK(vkCreateDescriptorSetLayout(vk_renderer_context_.vk_device_, &descriptor_set_layout_create_info, nullptr, &vk_descriptor_set_layout_));
+
+    // NOTE(dhaval): Update after bind sets need a pool of their own created with the matching flag.
+    std::array<VkDescriptorPoolSize, 2> descriptor_pool_sizes{};
+    descriptor_pool_sizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptor_pool_sizes[0].descriptorCount = texture_capacity_;
+    descriptor_pool_sizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptor_pool_sizes[1].descriptorCount = 1;
+
+    VkDescriptorPoolCreateInfo descriptor_pool_create_info{};
+    descriptor_pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    descriptor_pool_create_info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+    descriptor_pool_create_info.maxSets = 1;
+    descriptor_pool_create_info.poolSizeCount = static_cast<uint32_t>(descriptor_pool_sizes.size());
+    descriptor_pool_create_info.pPoolSizes = descriptor_pool_sizes.data();
+
+    VK_CHECK(vkCreateDescriptorPool(vk_renderer_context_.vk_device_, &descriptor_pool_create_info, nullptr, &vk_descriptor_pool_));
+
+    VkDescriptorSetAllocateInfo descriptor_set_allocate_info{};
+    descriptor_set_allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    descriptor_set_allocate_info.descriptorPool = vk_descriptor_pool_;
+    descriptor_set_allocate_info.descriptorSetCount = 1;
+    descriptor_set_allocate_info.pSetLayouts = &vk_descriptor_set_layout_;
+
+    VK_CHECK(vkAllocateDescriptorSets(vk_renderer_context_.vk_device_, &descriptor_set_allocate_info, &vk_descriptor_set_));
+
+    // NOTE(dhaval): Materials are small and rarely written, host visible memory read straight by the shaders is good enough.
+    VkDeviceSize material_buffer_size = sizeof(material_data) * material_capacity_;
+    vulkan_utils::create_buffer(vk_renderer_context_, material_buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                vk_material_buffer_, vk_material_buffer_memory_);
+
+    void* data = nullptr;
+    VK_CHECK(vkMapMemory(vk_renderer_context_.vk_device_, vk_material_buffer_memory_, 0, material_buffer_size, 0, &data));
+    materials_ = static_cast<material_data*>(data);
+
+    VkDescriptorBufferInfo descriptor_buffer_info{};
+    descriptor_buffer_info.buffer = vk_material_buffer_;
+    descriptor_buffer_info.offset = 0;
+    descriptor_buffer_info.range = material_buffer_size;
+
+    VkWriteDescriptorSet write_descriptor_set{};
+    write_descriptor_set.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write_descriptor_set.dstSet = vk_descriptor_set_;
+    write_descriptor_set.dstBinding = 1;
+    write_descriptor_set.dstArrayElement = 0;
+    write_descriptor_set.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write_descriptor_set.descriptorCount = 1;
+    write_descriptor_set.pBufferInfo = &descriptor_buffer_info;
+
+    vkUpdateDescriptorSets(vk_renderer_context_.vk_device_, 1, &write_descriptor_set, 0, nullptr);
+    statistics_.descriptor_write_count++;
+
+    std::cout << "texture_table: " << texture_capacity_ << " texture slots, " << material_capacity_ << " materials" << std::endl;
+}
+
+/**
+ * \brief Destroys everything created in init(). Textures added to the table are not owned by it and stay alive.
+ */
+void vulkan_texture_table::shutdown()
+{
+    if (vk_material_buffer_memory_ != VK_NULL_HANDLE)
+    {
+        vkUnmapMemory(vk_renderer_context_.vk_device_, vk_material_buffer_memory_);
+        materials_ = nullptr;
+    }
+
+    vkDestroyBuffer(vk_renderer_context_.vk_device_, vk_material_buffer_, nullptr);
+    vk_material_buffer_ = VK_NULL_HANDLE;
+
+    vkFreeMemory(vk_renderer_context_.vk_device_, vk_material_buffer_memory_, nullptr);
+    vk_material_buffer_memory_ = VK_NULL_HANDLE;
+
+    // NOTE(dhaval): Destroying the pool frees the set.
+    vkDestroyDescriptorPool(vk_renderer_context_.vk_device_, vk_descriptor_pool_, nullptr);
+    vk_descriptor_pool_ = VK_NULL_HANDLE;
+    vk_descriptor_set_ = VK_NULL_HANDLE;
+
+    vkDestroyDescriptorSetLayout(vk_renderer_context_.vk_device_, vk_descriptor_set_layout_, nullptr);
+    vk_descriptor_set_layout_ = VK_NULL_HANDLE;
+
+    free_texture_slots_.clear();
+    texture_high_water_ = 0;
+    texture_capacity_ = 0;
+    material_capacity_ = 0;
+}
+
+/**
+ * \brief Writes a texture into a free slot of the array. This is the only descriptor write a texture costs.
+ * \param texture Texture to add, must be uploaded and stay alive until it is removed.
+ * \return uint32_t Index of the texture in the array, invalid_texture_index if the table is full.
+ */
+uint32_t vulkan_texture_table::add_texture(const vulkan_texture& texture)
+{
+    uint32_t texture_index = invalid_texture_index;
+
+    if (!free_texture_slots_.empty())
+    {
+        texture_index = free_texture_slots_.back();
+        free_texture_slots_.pop_back();
+    }
+    else if (texture_high_water_ < texture_capacity_)
+    {
+        texture_index = texture_high_water_++;
+    }
+    else
+    {
+        std::cerr << "texture_table: all " << texture_capacity_ << " texture slots are in use" << std::endl;
+        return invalid_texture_index;
+    }
+
+    VkDescriptorImageInfo descriptor_image_info{};
+    descriptor_image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    descriptor_image_info.imageView = texture.get_image_view();
+    descriptor_image_info.sampler = texture.get_sampler();
+
+    VkWriteDescriptorSet write_descriptor_set{};
+    write_descriptor_set.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write_descriptor_set.dstSet = vk_descriptor_set_;
+    write_descriptor_set.dstBinding = 0;
+    write_descriptor_set.dstArrayElement = texture_index;
+    write_descriptor_set.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write_descriptor_set.descriptorCount = 1;
+    write_descriptor_set.pImageInfo = &descriptor_image_info;
+
+    vkUpdateDescriptorSets(vk_renderer_context_.vk_device_, 1, &write_descriptor_set, 0, nullptr);
+
+    statistics_.texture_count++;
+    statistics_.descriptor_write_count++;
+
+    return texture_index;
+}
+
+/**
+ * \brief Frees the slot of an evicted texture, the next added texture may reuse it. No frame in flight may still sample the texture,
+ *        the same rule as for destroying it.
+ * \param texture_index Index returned by add_texture().
+ */
+void vulkan_texture_table::remove_texture(uint32_t texture_index)
+{
+    assert(texture_index < texture_high_water_ && "Texture index was never handed out");
+    assert(std::find(free_texture_slots_.begin(), free_texture_slots_.end(), texture_index) == free_texture_slots_.end() && "Texture removed twice");
+
+    // NOTE(dhaval): The stale descriptor stays in the slot, partially bound arrays only require that nothing indexes it.
+    free_texture_slots_.push_back(texture_index);
+    statistics_.texture_count--;
+}
+
+/**
+ * \brief Writes a material into the material buffer. No frame in flight may still read the material being replaced.
+ * \param material_index Index of the material, the value the instances pass to the shaders.
+ * \param material Material to write, its textures must be in the table.
+ */
+void vulkan_texture_table::set_material(uint32_t material_index, const material_data& material)
+{
+    assert(material_index < material_capacity_ && "Material index out of range");
+
+    // NOTE(dhaval): Mapped memory may be write combined, write the whole material and never read back.
+    memcpy(&materials_[material_index], &material, sizeof(material));
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <volk.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "VulkanRendererContext.hpp"
+
+class vulkan_texture;
+
+static const uint32_t invalid_texture_index = UINT32_MAX;
+
+/**
+ * \brief Material as the shaders read it from the material buffer, std430 layout.
+ */
+struct material_data
+{
+    uint32_t base_color_texture;
+    uint32_t padding[3];
+    glm::vec4 base_color_factor;
+
+    // NOTE(dhaval): Only read by pipelines with material_feature_emissive and material_feature_alpha_test respectively.
+    glm::vec4 emissive_factor;
+    float alpha_cutoff;
+    float padding_end[3];
+};
+
+/**
+ * \brief Descriptor write counters of a texture table since it was initialized.
+ */
+struct texture_table_statistics
+{
+    uint32_t texture_count{0};
+    uint32_t descriptor_write_count{0};
+};
+
+/**
+ * \brief Bindless texture table. One descriptor set holds a large, partially bound, update after bind array of textures and the material buffer.
+ *        Materials reference textures by their index in the array, descriptors are only written when a texture is added or removed.
+ *        Needs VK_EXT_descriptor_indexing, see vulkan_renderer_context::descriptor_indexing_supported.
+ */
+class vulkan_texture_table
+{
+public:
+    vulkan_texture_table(const vulkan_renderer_context& renderer_context) : vk_renderer_context_(renderer_context)
+    {
+    }
+
+    void init(uint32_t max_texture_count, uint32_t max_material_count);
+    void shutdown();
+
+    uint32_t add_texture(const vulkan_texture& texture);
+    void remove_texture(uint32_t texture_index);
+
+    void set_material(uint32_t material_index, const material_data& material);
+
+    inline VkDescriptorSetLayout get_descriptor_set_layout() const { return vk_descriptor_set_layout_; }
+    inline VkDescriptorSet get_descriptor_set() const { return vk_descriptor_set_; }
+    inline uint32_t get_texture_capacity() const { return texture_capacity_; }
+    inline uint32_t get_material_capacity() const { return material_capacity_; }
+    inline const texture_table_statistics& get_statistics() const { return statistics_; }
+
+    static uint32_t get_max_texture_count(const vulkan_renderer_context& renderer_context);
+
+private:
+    vulkan_renderer_context vk_renderer_context_;
+
+    uint32_t texture_capacity_{0};
+    uint32_t material_capacity_{0};
+
+    // NOTE(dhaval): Slots below texture_high_water_ that were removed, reused before growing the high water mark.
+    std::vector<uint32_t> free_texture_slots_;
+    uint32_t texture_high_water_{0};
+
+    VkDescriptorSetLayout vk_descriptor_set_layout_{VK_NULL_HANDLE};
+    VkDescriptorPool vk_descriptor_pool_{VK_NULL_HANDLE};
+    VkDescriptorSet vk_descriptor_set_{VK_NULL_HANDLE};
+
+    VkBuffer vk_material_buffer_{VK_NULL_HANDLE};
+    VkDeviceMemory vk_material_buffer_memory_{VK_NULL_HANDLE};
+    material_data* materials_{nullptr};
+
+    texture_table_statistics statistics_{};
+};
@@ -182,10 +182,51 @@ void vulkan_utils::copy_buffer_to_image(const vulkan_renderer_context& vk_render
     end_single_time_commands(vk_renderer_context, command_buffer);
 }
 
+void vulkan_utils::copy_buffer_to_image(const vulkan_renderer_context& vk_renderer_context, VkBuffer source, VkImage destination, const std::vector<VkBufferImageCopy>& regions)
+{
+    VkCommandBuffer command_buffer = begin_single_time_commands(vk_renderer_context);
+
+    vkCmdCopyBufferToImage(command_buffer, source, destination, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+
+    end_single_time_commands(vk_renderer_context, command_buffer);
+}
+
+void vulkan_utils::copy_image_to_buffer(const vulkan_renderer_context& vk_renderer_context, VkImage source, VkBuffer destination, uint32_t width, uint32_t height)
+{
+    VkCommandBuffer command_buffer = begin_single_time_commands(vk_renderer_context);
+
+    VkBufferImageCopy buffer_image_copy{};
+    buffer_image_copy.bufferOffset = 0;
+    buffer_image_copy.bufferRowLength = 0;
+    buffer_image_copy.bufferImageHeight = 0;
+
+    buffer_image_copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    buffer_image_copy.imageSubresource.mipLevel = 0;
+    buffer_image_copy.imageSubresource.baseArrayLayer = 0;
+    buffer_image_copy.imageSubresource.layerCount = 1;
+
+    buffer_image_copy.imageOffset = {0, 0, 0};
+    buffer_image_copy.imageExtent.width = width;
+    buffer_image_copy.imageExtent.height = height;
+    buffer_image_copy.imageExtent.depth = 1;
+
+    vkCmdCopyImageToBuffer(command_buffer, source, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, destination, 1, &buffer_image_copy);
+
+    end_single_time_commands(vk_renderer_context, command_buffer);
+}
+
 void vulkan_utils::transition_image_layout(const vulkan_renderer_context& vk_renderer_context, VkImage image, uint32_t mip_levels, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout)
 {
     VkCommandBuffer command_buffer = begin_single_time_commands(vk_renderer_context);
 
+    record_image_layout_transition(command_buffer, image, mip_levels, format, old_layout, new_layout);
+
+    end_single_time_commands(vk_renderer_context, command_buffer);
+}
+
+// NOTE(dhaval): Same barrier as transition_image_layout(), recorded into a command buffer the caller submits, for uploads batched into one submission.
+void vulkan_utils::record_image_layout_transition(VkCommandBuffer command_buffer, VkImage image, uint32_t mip_levels, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout)
+{
     VkImageMemoryBarrier image_memory_barrier{};
     image_memory_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
     image_memory_barrier.oldLayout = old_layout;
@@ -247,8 +288,6 @@ void vulkan_utils::transition_image_layout(const vulkan_renderer_context& vk_ren
     }
 
     vkCmdPipelineBarrier(command_buffer, src_pipeline_stage_flags, dst_pipeline_stage_flags, 0, 0, nullptr, 0, nullptr, 1, &image_memory_barrier);
-
-    end_single_time_commands(vk_renderer_context, command_buffer);
 }
 
 void vulkan_utils::generate_image_2d_mipmaps(const vulkan_renderer_context& vk_renderer_context, VkImage image, uint32_t width, uint32_t height, uint32_t mip_levels, VkFormat format, VkFilter filter)
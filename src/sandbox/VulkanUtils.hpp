@@ -3,6 +3,7 @@
 #include <volk.h>
 
 #include <cassert>
+#include <vector>
 
 struct vulkan_renderer_context;
 
@@ -40,12 +41,18 @@ public:
 
     static void copy_buffer_to_image(const vulkan_renderer_context& vk_renderer_context, VkBuffer source, VkImage destination, uint32_t width, uint32_t height);
 
+    static void copy_buffer_to_image(const vulkan_renderer_context& vk_renderer_context, VkBuffer source, VkImage destination, const std::vector<VkBufferImageCopy>& regions);
+
+    static void copy_image_to_buffer(const vulkan_renderer_context& vk_renderer_context, VkImage source, VkBuffer destination, uint32_t width, uint32_t height);
+
     static void transition_image_layout(const vulkan_renderer_context& vk_renderer_context, VkImage image, uint32_t mip_levels, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout);
 
+    static void record_image_layout_transition(VkCommandBuffer command_buffer, VkImage image, uint32_t mip_levels, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout);
+
     static void generate_image_2d_mipmaps(const vulkan_renderer_context& vk_renderer_context, VkImage image, uint32_t width, uint32_t height, uint32_t mip_levels, VkFormat format, VkFilter filter);
 
-private:
     static bool has_stencil_component(VkFormat format);
+
     static VkCommandBuffer begin_single_time_commands(const vulkan_renderer_context& vk_renderer_context);
     static void end_single_time_commands(const vulkan_renderer_context& vk_renderer_context, VkCommandBuffer command_buffer);
 };
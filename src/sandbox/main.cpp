@@ -8,34 +8,198 @@
 
 #include <iostream>
 #include <cassert>
+#include <cstring>
+#include <string>
 
+#include "Profiler.hpp"
+#include "ShaderPermutation.hpp"
 #include "VulkanApplication.hpp"
 #include "VulkanRenderer.hpp"
 
 #include <GLFW/glfw3.h>
 
-int main(void)
+/**
+ * \brief Fills the application config from the command line. Unknown arguments are reported and ignored.
+ * \param argc Argument count.
+ * \param argv Argument values.
+ * \return application_config
+ */
+static application_config parse_application_config(int argc, char** argv)
 {
-    if (!glfwInit())
+    application_config config{};
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = i + 1 < argc;
+
+        if (strcmp(argv[i], "--frames-in-flight") == 0 && has_value)
+        {
+            config.frames_in_flight = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--frame-count") == 0 && has_value)
+        {
+            config.frame_count = std::stoull(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--job-threads") == 0 && has_value)
+        {
+            config.job_thread_count = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--record-threads") == 0 && has_value)
+        {
+            config.record_thread_count = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--draw-count") == 0 && has_value)
+        {
+            config.draw_count = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--direct-draws") == 0)
+        {
+            config.indirect_draws = false;
+        }
+        else if (strcmp(argv[i], "--instance-count") == 0 && has_value)
+        {
+            config.instance_count = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--no-culling") == 0)
+        {
+            config.frustum_culling = false;
+        }
+        else if (strcmp(argv[i], "--bindless") == 0)
+        {
+            config.bindless_textures = true;
+        }
+        else if (strcmp(argv[i], "--gpu-profile") == 0)
+        {
+            config.gpu_profiling = true;
+        }
+        else if (strcmp(argv[i], "--gpu-statistics") == 0)
+        {
+            config.gpu_pipeline_statistics = true;
+        }
+        else if (strcmp(argv[i], "--headless") == 0)
+        {
+            config.headless = true;
+        }
+        else if (strcmp(argv[i], "--width") == 0 && has_value)
+        {
+            config.headless_width = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--height") == 0 && has_value)
+        {
+            config.headless_height = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--output") == 0 && has_value)
+        {
+            config.output_image_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--no-validation") == 0)
+        {
+            config.validation = false;
+        }
+        else if (strcmp(argv[i], "--profile-capture") == 0 && has_value)
+        {
+            config.profile_capture_frames = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--profile-output") == 0 && has_value)
+        {
+            config.profile_capture_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--benchmark") == 0 && has_value)
+        {
+            config.benchmark_frame_count = std::stoull(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--warmup") == 0 && has_value)
+        {
+            config.benchmark_warmup_frame_count = std::stoull(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--timestep-ms") == 0 && has_value)
+        {
+            config.benchmark_timestep_ms = std::stod(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--benchmark-output") == 0 && has_value)
+        {
+            config.benchmark_output_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--compare") == 0 && has_value)
+        {
+            config.benchmark_baseline_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--regression-threshold") == 0 && has_value)
+        {
+            config.benchmark_regression_threshold = std::stod(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--materials") == 0 && has_value)
+        {
+            // NOTE(dhaval): e.g. --materials texture+vertex_color,texture+alpha_test,texture+emissive
+            if (!parse_material_features(argv[++i], config.material_features))
+            {
+                std::cerr << "Invalid material list: " << argv[i] << std::endl;
+            }
+        }
+        else if (strcmp(argv[i], "--hot-reload") == 0)
+        {
+            config.shader_hot_reload = true;
+        }
+        else if (strcmp(argv[i], "--simulation-rate") == 0 && has_value)
+        {
+            config.simulation_tick_rate = std::stod(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--occluders") == 0 && has_value)
+        {
+            config.occluder_count = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+        else
+        {
+            std::cerr << "Unknown argument: " << argv[i] << std::endl;
+        }
+    }
+
+    return config;
+}
+
+int main(int argc, char** argv)
+{
+    application_config config = parse_application_config(argc, argv);
+
+    // NOTE(dhaval): Headless runs never touch GLFW, machines without a display can't initialize it.
+    if (!config.headless && !glfwInit())
     {
         return EXIT_FAILURE;
     }
 
+#if !defined(PBR_ENABLE_PROFILER)
+    if (config.profile_capture_frames > 0)
+    {
+        std::cerr << "--profile-capture needs a build with PBR_ENABLE_PROFILER, ignored" << std::endl;
+    }
+#endif
+
+    bool benchmark_regressed = false;
+
     try
     {
-        application sandbox;
+        application sandbox(config);
         sandbox.run();
+
+        benchmark_regressed = sandbox.has_benchmark_regression();
     }
     catch (const std::exception& e)
     {
         std::cerr << e.what() << std::endl;
 
-        glfwTerminate();
+        if (!config.headless)
+        {
+            glfwTerminate();
+        }
 
         return EXIT_FAILURE;
     }
 
-    glfwTerminate();
+    if (!config.headless)
+    {
+        glfwTerminate();
+    }
 
-    return EXIT_SUCCESS;
+    // NOTE(dhaval): Lets scripts gate on a benchmark compared with --compare.
+    return benchmark_regressed ? EXIT_FAILURE : EXIT_SUCCESS;
 }